@@ -24,23 +24,60 @@ ChannelListenerManager::ChannelListenerManager()
 }
 
 void ChannelListenerManager::addListener(unsigned int userSession, int channelID) {
+	QReadLocker volumeLock(&m_volumeLock);
 	QWriteLocker lock(&m_listenerLock);
 
-	m_listeningUsers[userSession] << channelID;
-	m_listenedChannels[channelID] << userSession;
+	QSet< int > &listenedChannels = m_listeningUsers[userSession];
+	if (listenedChannels.contains(channelID)) {
+		return;
+	}
+
+	listenedChannels << channelID;
+
+	ChannelListener key = {};
+	key.channelID       = channelID;
+	key.userSession     = userSession;
+
+	// The volume adjustment may have been set before the user started listening
+	auto it = m_listenerVolumeAdjustments.find(key);
+	if (it == m_listenerVolumeAdjustments.end()) {
+		m_listenedChannels[channelID].push_back({ userSession, VolumeAdjustment::fromFactor(1.0f) });
+	} else {
+		m_listenedChannels[channelID].push_back({ userSession, it->second });
+	}
 }
 
 void ChannelListenerManager::removeListener(unsigned int userSession, int channelID) {
 	QWriteLocker lock(&m_listenerLock);
 
 	m_listeningUsers[userSession].remove(channelID);
-	m_listenedChannels[channelID].remove(userSession);
+
+	auto it = m_listenedChannels.find(channelID);
+	if (it == m_listenedChannels.end()) {
+		return;
+	}
+
+	std::vector< ChannelListenerEntry > &listeners = it->second;
+	for (std::size_t i = 0; i < listeners.size(); ++i) {
+		if (listeners[i].userSession == userSession) {
+			// The order of the listeners doesn't matter
+			listeners[i] = listeners.back();
+			listeners.pop_back();
+			break;
+		}
+	}
+
+	if (listeners.empty()) {
+		m_listenedChannels.erase(it);
+	}
 }
 
 bool ChannelListenerManager::isListening(unsigned int userSession, int channelID) const {
 	QReadLocker lock(&m_listenerLock);
 
-	return m_listenedChannels[channelID].contains(userSession);
+	auto it = m_listeningUsers.constFind(userSession);
+
+	return it != m_listeningUsers.constEnd() && it.value().contains(channelID);
 }
 
 bool ChannelListenerManager::isListeningToAny(unsigned int userSession) const {
@@ -52,13 +89,17 @@ bool ChannelListenerManager::isListeningToAny(unsigned int userSession) const {
 bool ChannelListenerManager::isListenedByAny(int channelID) const {
 	QReadLocker lock(&m_listenerLock);
 
-	return !m_listenedChannels[channelID].isEmpty();
+	// Channels without listeners are removed from the map
+	return m_listenedChannels.find(channelID) != m_listenedChannels.end();
 }
 
 const QSet< unsigned int > ChannelListenerManager::getListenersForChannel(int channelID) const {
-	QReadLocker lock(&m_listenerLock);
+	QSet< unsigned int > listeners;
+
+	forEachListener(channelID,
+					[&listeners](unsigned int userSession, const VolumeAdjustment &) { listeners << userSession; });
 
-	return m_listenedChannels[channelID];
+	return listeners;
 }
 
 const QSet< int > ChannelListenerManager::getListenedChannelsForUser(unsigned int userSession) const {
@@ -70,7 +111,9 @@ const QSet< int > ChannelListenerManager::getListenedChannelsForUser(unsigned in
 int ChannelListenerManager::getListenerCountForChannel(int channelID) const {
 	QReadLocker lock(&m_listenerLock);
 
-	return m_listenedChannels[channelID].size();
+	auto it = m_listenedChannels.find(channelID);
+
+	return it == m_listenedChannels.end() ? 0 : static_cast< int >(it->second.size());
 }
 
 int ChannelListenerManager::getListenedChannelCountForUser(unsigned int userSession) const {
@@ -95,6 +138,19 @@ void ChannelListenerManager::setListenerVolumeAdjustment(unsigned int userSessio
 		}
 
 		m_listenerVolumeAdjustments[key] = volumeAdjustment;
+
+		// Keep the copy stored along with the listener in sync
+		QWriteLocker listenerLock(&m_listenerLock);
+
+		auto listenersIt = m_listenedChannels.find(channelID);
+		if (listenersIt != m_listenedChannels.end()) {
+			for (ChannelListenerEntry &entry : listenersIt->second) {
+				if (entry.userSession == userSession) {
+					entry.volumeAdjustment = volumeAdjustment;
+					break;
+				}
+			}
+		}
 	}
 
 	if (oldValue != volumeAdjustment.factor) {
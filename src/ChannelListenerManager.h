@@ -14,6 +14,7 @@
 #include <QtCore/QSet>
 
 #include <unordered_map>
+#include <vector>
 
 class User;
 class Channel;
@@ -34,10 +35,22 @@ template<> struct std::hash< ChannelListener > {
 std::size_t qHash(const ChannelListener &listener);
 bool operator==(const ChannelListener &lhs, const ChannelListener &rhs);
 
+/// A user listening to a channel, as stored for that channel
+struct ChannelListenerEntry {
+	/// The session ID of the listening user
+	unsigned int userSession;
+	/// The volume adjustment the user applies to the channel
+	VolumeAdjustment volumeAdjustment;
+};
+
 
 /// This class serves as a namespace for storing information about ChannelListeners. This is a feature
 /// that allows a user to listen to a channel without being in it. Kinda similar to linked channels
 /// except that this is something each user can do individually.
+///
+/// The listeners of each channel are kept in a flat vector along with their volume adjustments, so that they can be
+/// iterated (see forEachListener()) without copying or further lookups. All functions may be called concurrently:
+/// readers share the lock that writers take exclusively.
 class ChannelListenerManager : public QObject {
 private:
 	Q_OBJECT
@@ -48,9 +61,9 @@ protected:
 	mutable QReadWriteLock m_listenerLock;
 	/// A map between a user's session and a list of IDs of all channels the user is listening to
 	QHash< unsigned int, QSet< int > > m_listeningUsers;
-	/// A map between a channel's ID and a list of all user-sessions of users listening to that channel
-	QHash< int, QSet< unsigned int > > m_listenedChannels;
-	/// A lock for guarding m_listenerVolumeAdjustments
+	/// A map between a channel's ID and all users listening to that channel
+	std::unordered_map< int, std::vector< ChannelListenerEntry > > m_listenedChannels;
+	/// A lock for guarding m_listenerVolumeAdjustments. If both locks are needed, this one has to be taken first.
 	mutable QReadWriteLock m_volumeLock;
 	/// A map between channel IDs and local volume adjustments to be made for ChannelListeners
 	/// in that channel
@@ -93,6 +106,38 @@ public:
 	/// @returns A set of channel IDs of channels the given user is listening to
 	const QSet< int > getListenedChannelsForUser(unsigned int userSession) const;
 
+	/// Calls the given function with the session ID and the volume adjustment of every user listening to the given
+	/// channel. The function must not call back into this object.
+	///
+	/// @param channelID The ID of the channel
+	/// @param function The function to call as function(unsigned int userSession, const VolumeAdjustment &adjustment)
+	template< typename Function > void forEachListener(int channelID, Function &&function) const {
+		QReadLocker lock(&m_listenerLock);
+
+		auto it = m_listenedChannels.find(channelID);
+		if (it != m_listenedChannels.end()) {
+			for (const ChannelListenerEntry &entry : it->second) {
+				function(entry.userSession, entry.volumeAdjustment);
+			}
+		}
+	}
+
+	/// Calls the given function with the ID of every channel the given user is listening to. The function must not
+	/// call back into this object.
+	///
+	/// @param userSession The session ID of the user
+	/// @param function The function to call as function(int channelID)
+	template< typename Function > void forEachListenedChannel(unsigned int userSession, Function &&function) const {
+		QReadLocker lock(&m_listenerLock);
+
+		auto it = m_listeningUsers.constFind(userSession);
+		if (it != m_listeningUsers.constEnd()) {
+			for (int channelID : it.value()) {
+				function(channelID);
+			}
+		}
+	}
+
 	/// @param channelID The ID of the channel
 	/// @returns The amount of users that are listening to the given channel
 	int getListenerCountForChannel(int channelID) const;
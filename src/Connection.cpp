@@ -28,6 +28,7 @@ Connection::Connection(QObject *p, QSslSocket *qtsSock) : QObject(p) {
 	qtsSocket->setParent(this);
 	iPacketLength        = -1;
 	bDisconnectedEmitted = false;
+	m_receiveBuffer.reserve(RECEIVE_BUFFER_SIZE);
 	csCrypt              = std::make_unique< CryptStateOCB2 >();
 
 	static bool bDeclared = false;
@@ -134,11 +135,22 @@ void Connection::socketRead() {
 			return;
 		}
 
-		QByteArray qbaBuffer = qtsSocket->read(iPacketLength);
-		iPacketLength        = -1;
-		iAvailable -= iPacketLength;
+		const int length = iPacketLength;
+		iPacketLength    = -1;
+		iAvailable -= length;
 
-		emit message(m_type, qbaBuffer);
+		// Shrinking a buffer doesn't free it, so this only allocates if the buffer has to grow or is still
+		// referenced by a receiver of the previous message
+		m_receiveBuffer.resize(length);
+		qtsSocket->read(m_receiveBuffer.data(), length);
+
+		emit message(m_type, m_receiveBuffer);
+
+		if (length > RECEIVE_BUFFER_SIZE) {
+			// Don't hold on to the memory of an exceptionally big message (e.g. a texture)
+			m_receiveBuffer = QByteArray();
+			m_receiveBuffer.reserve(RECEIVE_BUFFER_SIZE);
+		}
 	}
 }
 
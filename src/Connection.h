@@ -43,6 +43,10 @@ protected:
 	QElapsedTimer qtLastPacket;
 	Mumble::Protocol::TCPMessageType m_type;
 	int iPacketLength;
+	/// Messages are read into this buffer, which is reused for all messages (unless a receiver keeps a copy of it)
+	QByteArray m_receiveBuffer;
+	/// Messages up to this size (in bytes) are read without allocating, bigger ones get a buffer of their own
+	static constexpr int RECEIVE_BUFFER_SIZE = 16 * 1024;
 #ifdef Q_OS_WIN
 	static HANDLE hQoS;
 	DWORD dwFlow;
@@ -0,0 +1,78 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "Frequency.h"
+
+#include <QHash>
+
+#include <cmath>
+
+Frequency Frequency::fromMHz(double frequencyMHz) {
+	if (!(frequencyMHz > 0)) {
+		return Frequency();
+	}
+
+	return Frequency(static_cast< unsigned int >(std::lround(frequencyMHz * 1000)));
+}
+
+Frequency Frequency::fromChannel(unsigned int channel) {
+	return Frequency(LOWEST_KHZ + channel * CHANNEL_SPACING_KHZ);
+}
+
+Frequency Frequency::fromString(const QString &string) {
+	const QString trimmed = string.trimmed();
+	const int separator   = trimmed.indexOf(QLatin1Char('.'));
+
+	const QStringRef mhzPart = separator < 0 ? trimmed.midRef(0) : trimmed.midRef(0, separator);
+	const QStringRef khzPart = separator < 0 ? QStringRef() : trimmed.midRef(separator + 1);
+
+	if (mhzPart.isEmpty() || mhzPart.size() > 3 || khzPart.size() > 3) {
+		return Frequency();
+	}
+
+	unsigned int kHz = 0;
+	for (QChar c : mhzPart) {
+		if (!c.isDigit()) {
+			return Frequency();
+		}
+		kHz = kHz * 10 + static_cast< unsigned int >(c.digitValue());
+	}
+
+	// Missing decimals are zeros, i.e. "121.5" is 121.500 MHz
+	for (int i = 0; i < 3; ++i) {
+		unsigned int digit = 0;
+		if (i < khzPart.size()) {
+			if (!khzPart.at(i).isDigit()) {
+				return Frequency();
+			}
+			digit = static_cast< unsigned int >(khzPart.at(i).digitValue());
+		}
+		kHz = kHz * 10 + digit;
+	}
+
+	return Frequency(kHz);
+}
+
+double Frequency::toMHz() const {
+	return m_kHz / 1000.0;
+}
+
+bool Frequency::isValid() const {
+	// Valid frequencies are either 25 kHz channels or the names of 8.33 kHz channels, which are the 25 kHz channel
+	// plus 5, 10 or 15 kHz (never 20 kHz).
+	return m_kHz >= LOWEST_KHZ && m_kHz <= HIGHEST_KHZ && (m_kHz % 5) == 0 && (m_kHz % CHANNEL_SPACING_KHZ) != 20;
+}
+
+Frequency::Spacing Frequency::spacing() const {
+	return (m_kHz % CHANNEL_SPACING_KHZ) == 0 ? Spacing::Channel25kHz : Spacing::Channel8_33kHz;
+}
+
+QString Frequency::toString() const {
+	return QString::fromLatin1("%1.%2").arg(m_kHz / 1000).arg(m_kHz % 1000, 3, 10, QLatin1Char('0'));
+}
+
+uint qHash(Frequency frequency, uint seed) {
+	return qHash(frequency.kHz(), seed);
+}
@@ -0,0 +1,62 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_FREQUENCY_H_
+#define MUMBLE_FREQUENCY_H_
+
+#include <QString>
+
+/// A VHF air band frequency. The frequency is stored as an exact number of kHz, so that frequencies can be compared
+/// and hashed without going through floating point numbers or strings.
+///
+/// With 8.33 kHz channel spacing, frequencies are identified by their channel name rather than by their actual
+/// frequency (e.g. 118.010 for the channel at 118.00833 MHz). This is what simulators report and what is stored here.
+class Frequency {
+public:
+	/// The lowest and highest channel of the VHF air band in kHz
+	static constexpr unsigned int LOWEST_KHZ  = 118000;
+	static constexpr unsigned int HIGHEST_KHZ = 136990;
+	/// The distance between two channels with 25 kHz channel spacing
+	static constexpr unsigned int CHANNEL_SPACING_KHZ = 25;
+
+	enum class Spacing { Channel25kHz, Channel8_33kHz };
+
+	/// Creates a null frequency, meaning that a radio is not tuned to anything
+	constexpr Frequency() = default;
+	constexpr explicit Frequency(unsigned int kHz) : m_kHz(kHz) {}
+
+	/// @returns The frequency closest to the given one in MHz
+	static Frequency fromMHz(double frequencyMHz);
+	/// @returns The frequency of the given 25 kHz channel, counting from the lowest one
+	static Frequency fromChannel(unsigned int channel);
+	/// Parses frequencies written as MHz (e.g. "118.325" or "121.5"). This is exact, i.e. doesn't involve floating
+	/// point numbers.
+	///
+	/// @returns The parsed frequency or a null frequency if the string is not a frequency
+	static Frequency fromString(const QString &string);
+
+	constexpr unsigned int kHz() const { return m_kHz; }
+	double toMHz() const;
+
+	constexpr bool isNull() const { return m_kHz == 0; }
+	/// @returns Whether this is the name of a channel in the VHF air band
+	bool isValid() const;
+	/// @returns The channel spacing this frequency requires. Only meaningful for valid frequencies.
+	Spacing spacing() const;
+
+	/// @returns The frequency in MHz with three decimals (e.g. "118.000")
+	QString toString() const;
+
+	friend constexpr bool operator==(Frequency lhs, Frequency rhs) { return lhs.m_kHz == rhs.m_kHz; }
+	friend constexpr bool operator!=(Frequency lhs, Frequency rhs) { return lhs.m_kHz != rhs.m_kHz; }
+	friend constexpr bool operator<(Frequency lhs, Frequency rhs) { return lhs.m_kHz < rhs.m_kHz; }
+
+private:
+	unsigned int m_kHz = 0;
+};
+
+uint qHash(Frequency frequency, uint seed = 0);
+
+#endif // MUMBLE_FREQUENCY_H_
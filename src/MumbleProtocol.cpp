@@ -9,6 +9,8 @@
 
 #include <QtEndian>
 
+#include <google/protobuf/wire_format_lite.h>
+
 #include <algorithm>
 #include <cassert>
 #include <cmath>
@@ -399,6 +401,208 @@ namespace Protocol {
 	}
 
 
+	template<>
+	bool UDPServerAudioFormatEncoder< UDPAudioFormat::Legacy >::prepareAudioPacket(const AudioData &data) {
+		byte type = 0;
+		switch (data.usedCodec) {
+			case AudioCodec::CELT_Alpha:
+				type = 0;
+				break;
+				// flag = 1 is reserved for ping packets
+			case AudioCodec::Speex:
+				type = 2;
+				break;
+			case AudioCodec::CELT_Beta:
+				type = 3;
+				break;
+			case AudioCodec::Opus:
+				type = 4;
+				break;
+		}
+		// The context is patched into the 5 least significant bits for every receiver
+		m_buffer[0] = static_cast< byte >(type << 5);
+
+		PacketDataStream stream(m_buffer.data() + 1, MAX_STATIC_PART_SIZE - 1);
+
+		stream << data.senderSession;
+		stream << static_cast< int >(data.frameNumber);
+
+		if (data.usedCodec == AudioCodec::Opus) {
+			assert(data.payload.size() < (1 << 13));
+			stream << static_cast< int >(data.isLastFrame ? data.payload.size() | (1 << 13) : data.payload.size());
+		}
+		stream.append(reinterpret_cast< const char * >(data.payload.data()), data.payload.size());
+
+		if (!stream.isValid()) {
+			qWarning("MumbleProtocol: Encoding legacy packet (fixed part) overflowed buffer size");
+			m_staticPartSize = 0;
+
+			return true;
+		}
+
+		// +1 for the header byte
+		m_staticPartSize = stream.size() + 1;
+
+		m_positionalDataSize = 0;
+		if (data.containsPositionalData) {
+			// The positional data directly follows the payload. As nothing is written after it, it can stay in place.
+			PacketDataStream positionalStream(m_buffer.data() + m_staticPartSize,
+											  m_buffer.size() - m_staticPartSize);
+			positionalStream << data.position[0];
+			positionalStream << data.position[1];
+			positionalStream << data.position[2];
+
+			m_positionalDataSize = positionalStream.size();
+		}
+		m_positionalDataInPlace = true;
+
+		return true;
+	}
+
+	template<>
+	gsl::span< const byte > UDPServerAudioFormatEncoder< UDPAudioFormat::Legacy >::updateAudioPacket(
+		audio_context_t context, const VolumeAdjustment &, bool includePositionalData) {
+		// The legacy format has no means of transmitting a volume adjustment, so the context is the only variable part
+		if (m_staticPartSize == 0 || context >= (1 << 5)) {
+			return {};
+		}
+
+		m_buffer[0] = static_cast< byte >(context) | (m_buffer[0] & 0xe0);
+
+		return { m_buffer.data(), m_staticPartSize + (includePositionalData ? m_positionalDataSize : 0) };
+	}
+
+	template<>
+	bool UDPServerAudioFormatEncoder< UDPAudioFormat::Protobuf >::prepareAudioPacket(const AudioData &data) {
+		using ::google::protobuf::internal::WireFormatLite;
+
+		// At the moment only Opus is supported in the newer Protobuf UDP protocol
+		if (data.usedCodec != AudioCodec::Opus) {
+			return false;
+		}
+
+		// The header byte, tags and varints of the other static fields take up at most 27 bytes
+		if (data.payload.size() + 27 > MAX_STATIC_PART_SIZE) {
+			qWarning("MumbleProtocol: Encoding protobuf packet (fixed part) overflowed buffer size");
+			m_staticPartSize = 0;
+
+			return true;
+		}
+
+		// The fields are written in the order the protobuf library serializes them in, which makes the packet equal
+		// to what UDPAudioEncoder produces. Fields with default values are omitted just like proto3 does.
+		m_buffer[0] = static_cast< byte >(UDPMessageType::Audio);
+		byte *target = m_buffer.data() + 1;
+
+		if (data.senderSession != 0) {
+			target = WireFormatLite::WriteUInt32ToArray(MumbleUDP::Audio::kSenderSessionFieldNumber,
+														data.senderSession, target);
+		}
+		if (data.frameNumber != 0) {
+			target =
+				WireFormatLite::WriteUInt64ToArray(MumbleUDP::Audio::kFrameNumberFieldNumber, data.frameNumber, target);
+		}
+		if (!data.payload.empty()) {
+			target = WireFormatLite::WriteTagToArray(MumbleUDP::Audio::kOpusDataFieldNumber,
+													 WireFormatLite::WIRETYPE_LENGTH_DELIMITED, target);
+			target = WireFormatLite::WriteUInt32NoTagToArray(static_cast< std::uint32_t >(data.payload.size()), target);
+			std::memcpy(target, data.payload.data(), data.payload.size());
+			target += data.payload.size();
+		}
+		if (data.isLastFrame) {
+			target = WireFormatLite::WriteBoolToArray(MumbleUDP::Audio::kIsTerminatorFieldNumber, true, target);
+		}
+
+		m_staticPartSize = static_cast< std::size_t >(target - m_buffer.data());
+
+		m_positionalDataSize = 0;
+		if (data.containsPositionalData) {
+			// The positional data is kept aside, as the variable part overwrites it for receivers not getting it
+			target = WireFormatLite::WriteTagToArray(MumbleUDP::Audio::kPositionalDataFieldNumber,
+													 WireFormatLite::WIRETYPE_LENGTH_DELIMITED,
+													 m_positionalData.data());
+			target = WireFormatLite::WriteUInt32NoTagToArray(3 * sizeof(float), target);
+			for (float coordinate : data.position) {
+				target = WireFormatLite::WriteFloatNoTagToArray(coordinate, target);
+			}
+
+			m_positionalDataSize = static_cast< std::size_t >(target - m_positionalData.data());
+		}
+		m_positionalDataInPlace = false;
+
+		return true;
+	}
+
+	template<>
+	gsl::span< const byte > UDPServerAudioFormatEncoder< UDPAudioFormat::Protobuf >::updateAudioPacket(
+		audio_context_t context, const VolumeAdjustment &volumeAdjustment, bool includePositionalData) {
+		using ::google::protobuf::internal::WireFormatLite;
+
+		if (m_staticPartSize == 0) {
+			return {};
+		}
+
+		std::size_t offset = m_staticPartSize;
+
+		if (includePositionalData && m_positionalDataSize > 0) {
+			if (!m_positionalDataInPlace) {
+				std::memcpy(m_buffer.data() + offset, m_positionalData.data(), m_positionalDataSize);
+				m_positionalDataInPlace = true;
+			}
+
+			offset += m_positionalDataSize;
+		} else {
+			m_positionalDataInPlace = false;
+		}
+
+		byte *target = m_buffer.data() + offset;
+
+		// A factor of 0 is the default value and thus wouldn't be serialized by protobuf either
+		if (volumeAdjustment.factor != 1.0f && volumeAdjustment.factor != 0.0f) {
+			target = WireFormatLite::WriteFloatToArray(MumbleUDP::Audio::kVolumeAdjustmentFieldNumber,
+													   volumeAdjustment.factor, target);
+		}
+
+		// The context is part of a oneof and is thus always serialized
+		target = WireFormatLite::WriteUInt32ToArray(MumbleUDP::Audio::kContextFieldNumber, context, target);
+
+		return { m_buffer.data(), static_cast< std::size_t >(target - m_buffer.data()) };
+	}
+
+
+	void UDPServerAudioEncoder::prepareAudioPacket(const AudioData &data) {
+		m_data             = data;
+		m_legacyPrepared   = false;
+		m_protobufPrepared = false;
+		// Whether the protobuf format can be used is only known once it has been prepared
+		m_protobufSupported = true;
+	}
+
+	gsl::span< const byte > UDPServerAudioEncoder::updateAudioPacket(Version::full_t receiverVersion,
+																	 audio_context_t context,
+																	 const VolumeAdjustment &volumeAdjustment,
+																	 bool includePositionalData) {
+		if (receiverVersion >= PROTOBUF_INTRODUCTION_VERSION && m_protobufSupported) {
+			if (!m_protobufPrepared) {
+				m_protobufSupported = m_protobufEncoder.prepareAudioPacket(m_data);
+				m_protobufPrepared  = true;
+			}
+
+			if (m_protobufSupported) {
+				return m_protobufEncoder.updateAudioPacket(context, volumeAdjustment, includePositionalData);
+			}
+		}
+
+		// Either an old client or a codec the protobuf format doesn't support
+		if (!m_legacyPrepared) {
+			m_legacyEncoder.prepareAudioPacket(m_data);
+			m_legacyPrepared = true;
+		}
+
+		return m_legacyEncoder.updateAudioPacket(context, volumeAdjustment, includePositionalData);
+	}
+
+
 	template< Role role >
 	UDPPingEncoder< role >::UDPPingEncoder(Version::full_t protocolVersion) : ProtocolHandler< role >(protocolVersion) {
 		// Use the assumption that a general ping package will be < 32bytes long (the legacy ping packet is at most
@@ -10,6 +10,7 @@
 #include "Version.h"
 #include "VolumeAdjustment.h"
 
+#include <array>
 #include <cstdint>
 #include <vector>
 
@@ -20,34 +21,35 @@
  *
  * Warning: Only append to the end. Never insert in between or remove an existing entry.
  */
-#define MUMBLE_ALL_TCP_MESSAGES                         \
-	PROCESS_MUMBLE_TCP_MESSAGE(Version, 0)              \
-	PROCESS_MUMBLE_TCP_MESSAGE(UDPTunnel, 1)            \
-	PROCESS_MUMBLE_TCP_MESSAGE(Authenticate, 2)         \
-	PROCESS_MUMBLE_TCP_MESSAGE(Ping, 3)                 \
-	PROCESS_MUMBLE_TCP_MESSAGE(Reject, 4)               \
-	PROCESS_MUMBLE_TCP_MESSAGE(ServerSync, 5)           \
-	PROCESS_MUMBLE_TCP_MESSAGE(ChannelRemove, 6)        \
-	PROCESS_MUMBLE_TCP_MESSAGE(ChannelState, 7)         \
-	PROCESS_MUMBLE_TCP_MESSAGE(UserRemove, 8)           \
-	PROCESS_MUMBLE_TCP_MESSAGE(UserState, 9)            \
-	PROCESS_MUMBLE_TCP_MESSAGE(BanList, 10)             \
-	PROCESS_MUMBLE_TCP_MESSAGE(TextMessage, 11)         \
-	PROCESS_MUMBLE_TCP_MESSAGE(PermissionDenied, 12)    \
-	PROCESS_MUMBLE_TCP_MESSAGE(ACL, 13)                 \
-	PROCESS_MUMBLE_TCP_MESSAGE(QueryUsers, 14)          \
-	PROCESS_MUMBLE_TCP_MESSAGE(CryptSetup, 15)          \
-	PROCESS_MUMBLE_TCP_MESSAGE(ContextActionModify, 16) \
-	PROCESS_MUMBLE_TCP_MESSAGE(ContextAction, 17)       \
-	PROCESS_MUMBLE_TCP_MESSAGE(UserList, 18)            \
-	PROCESS_MUMBLE_TCP_MESSAGE(VoiceTarget, 19)         \
-	PROCESS_MUMBLE_TCP_MESSAGE(PermissionQuery, 20)     \
-	PROCESS_MUMBLE_TCP_MESSAGE(CodecVersion, 21)        \
-	PROCESS_MUMBLE_TCP_MESSAGE(UserStats, 22)           \
-	PROCESS_MUMBLE_TCP_MESSAGE(RequestBlob, 23)         \
-	PROCESS_MUMBLE_TCP_MESSAGE(ServerConfig, 24)        \
-	PROCESS_MUMBLE_TCP_MESSAGE(SuggestConfig, 25)       \
-	PROCESS_MUMBLE_TCP_MESSAGE(PluginDataTransmission, 26)
+#define MUMBLE_ALL_TCP_MESSAGES                            \
+	PROCESS_MUMBLE_TCP_MESSAGE(Version, 0)                 \
+	PROCESS_MUMBLE_TCP_MESSAGE(UDPTunnel, 1)               \
+	PROCESS_MUMBLE_TCP_MESSAGE(Authenticate, 2)            \
+	PROCESS_MUMBLE_TCP_MESSAGE(Ping, 3)                    \
+	PROCESS_MUMBLE_TCP_MESSAGE(Reject, 4)                  \
+	PROCESS_MUMBLE_TCP_MESSAGE(ServerSync, 5)              \
+	PROCESS_MUMBLE_TCP_MESSAGE(ChannelRemove, 6)           \
+	PROCESS_MUMBLE_TCP_MESSAGE(ChannelState, 7)            \
+	PROCESS_MUMBLE_TCP_MESSAGE(UserRemove, 8)              \
+	PROCESS_MUMBLE_TCP_MESSAGE(UserState, 9)               \
+	PROCESS_MUMBLE_TCP_MESSAGE(BanList, 10)                \
+	PROCESS_MUMBLE_TCP_MESSAGE(TextMessage, 11)            \
+	PROCESS_MUMBLE_TCP_MESSAGE(PermissionDenied, 12)       \
+	PROCESS_MUMBLE_TCP_MESSAGE(ACL, 13)                    \
+	PROCESS_MUMBLE_TCP_MESSAGE(QueryUsers, 14)             \
+	PROCESS_MUMBLE_TCP_MESSAGE(CryptSetup, 15)             \
+	PROCESS_MUMBLE_TCP_MESSAGE(ContextActionModify, 16)    \
+	PROCESS_MUMBLE_TCP_MESSAGE(ContextAction, 17)          \
+	PROCESS_MUMBLE_TCP_MESSAGE(UserList, 18)               \
+	PROCESS_MUMBLE_TCP_MESSAGE(VoiceTarget, 19)            \
+	PROCESS_MUMBLE_TCP_MESSAGE(PermissionQuery, 20)        \
+	PROCESS_MUMBLE_TCP_MESSAGE(CodecVersion, 21)           \
+	PROCESS_MUMBLE_TCP_MESSAGE(UserStats, 22)              \
+	PROCESS_MUMBLE_TCP_MESSAGE(RequestBlob, 23)            \
+	PROCESS_MUMBLE_TCP_MESSAGE(ServerConfig, 24)           \
+	PROCESS_MUMBLE_TCP_MESSAGE(SuggestConfig, 25)          \
+	PROCESS_MUMBLE_TCP_MESSAGE(PluginDataTransmission, 26) \
+	PROCESS_MUMBLE_TCP_MESSAGE(RadioTune, 27)
 
 /**
  * "X-macro" for all Mumble Protobuf UDP messages types.
@@ -100,9 +102,12 @@ namespace Protocol {
 		constexpr audio_context_t SHOUT   = 1;
 		constexpr audio_context_t WHISPER = 2;
 		constexpr audio_context_t LISTEN  = 3;
+		// Radio transmissions, tagged with the radio of the receiver they were received on
+		constexpr audio_context_t RADIO_COM1 = 4;
+		constexpr audio_context_t RADIO_COM2 = 5;
 
 		constexpr audio_context_t BEGIN = NORMAL;
-		constexpr audio_context_t END   = LISTEN + 1;
+		constexpr audio_context_t END   = RADIO_COM2 + 1;
 	}; // namespace AudioContext
 
 	enum class Role { Server, Client };
@@ -232,6 +237,93 @@ namespace Protocol {
 		gsl::span< const byte > getPreEncodedVolumeAdjustment(const VolumeAdjustment &adjustment) const;
 	};
 
+	/**
+	 * The wire formats of UDP audio packets
+	 */
+	enum class UDPAudioFormat {
+		// The format used before PROTOBUF_INTRODUCTION_VERSION (and for all codecs other than Opus)
+		Legacy,
+		Protobuf,
+	};
+
+	/**
+	 * Encodes the audio packets the server sends out in a single wire format. The packet lives in a fixed-size buffer:
+	 * its static part (sender, frame number, payload and positional data) is encoded once per packet, after which
+	 * only the variable part (context and volume adjustment) is patched in place for every receiver.
+	 */
+	template< UDPAudioFormat format > class UDPServerAudioFormatEncoder {
+	public:
+		/**
+		 * Encodes the static part of the given audio packet.
+		 *
+		 * @param data The AudioData to encode (the context and volume adjustment are ignored)
+		 * @return Whether the packet can be encoded in this format
+		 */
+		bool prepareAudioPacket(const AudioData &data);
+		/**
+		 * @param context The audio context to encode
+		 * @param volumeAdjustment The volume adjustment to encode (ignored by the legacy format)
+		 * @param includePositionalData Whether the positional data of the prepared packet (if any) is to be included
+		 * @return A span to the complete audio packet or an empty span if it can't be encoded
+		 */
+		gsl::span< const byte > updateAudioPacket(audio_context_t context, const VolumeAdjustment &volumeAdjustment,
+												  bool includePositionalData);
+
+	protected:
+		// Leave enough space for the positional data and the variable part
+		static constexpr std::size_t MAX_STATIC_PART_SIZE = MAX_UDP_PACKET_SIZE - 32;
+
+		std::array< byte, MAX_UDP_PACKET_SIZE > m_buffer;
+		std::size_t m_staticPartSize = 0;
+		std::array< byte, 16 > m_positionalData;
+		std::size_t m_positionalDataSize = 0;
+		/// Whether the positional data currently follows the static part in m_buffer
+		bool m_positionalDataInPlace = false;
+	};
+
+	template<> bool UDPServerAudioFormatEncoder< UDPAudioFormat::Legacy >::prepareAudioPacket(const AudioData &data);
+	template<>
+	gsl::span< const byte > UDPServerAudioFormatEncoder< UDPAudioFormat::Legacy >::updateAudioPacket(
+		audio_context_t context, const VolumeAdjustment &volumeAdjustment, bool includePositionalData);
+	template<> bool UDPServerAudioFormatEncoder< UDPAudioFormat::Protobuf >::prepareAudioPacket(const AudioData &data);
+	template<>
+	gsl::span< const byte > UDPServerAudioFormatEncoder< UDPAudioFormat::Protobuf >::updateAudioPacket(
+		audio_context_t context, const VolumeAdjustment &volumeAdjustment, bool includePositionalData);
+
+	/**
+	 * Encodes the audio packets the server sends out in all wire formats, such that a packet is encoded at most once
+	 * per format, no matter in which order the receivers' protocol versions come. A format is only encoded once the
+	 * first receiver requiring it comes up.
+	 */
+	class UDPServerAudioEncoder {
+	public:
+		/**
+		 * Starts a new audio packet. Nothing is encoded until the packet is requested for the first receiver.
+		 *
+		 * @param data The AudioData to encode. Its payload has to stay valid until the next call to this function.
+		 */
+		void prepareAudioPacket(const AudioData &data);
+		/**
+		 * @param receiverVersion The protocol version of the receiver
+		 * @param context The audio context to encode
+		 * @param volumeAdjustment The volume adjustment to encode
+		 * @param includePositionalData Whether the positional data of the packet (if any) is to be included
+		 * @return A span to the audio packet as it is to be sent to the receiver or an empty span if it can't be
+		 * encoded
+		 */
+		gsl::span< const byte > updateAudioPacket(Version::full_t receiverVersion, audio_context_t context,
+												  const VolumeAdjustment &volumeAdjustment, bool includePositionalData);
+
+	protected:
+		AudioData m_data;
+		bool m_legacyPrepared   = false;
+		bool m_protobufPrepared = false;
+		/// Whether the packet can be encoded in the protobuf format (if not, the legacy format is used for everyone)
+		bool m_protobufSupported = false;
+		UDPServerAudioFormatEncoder< UDPAudioFormat::Legacy > m_legacyEncoder;
+		UDPServerAudioFormatEncoder< UDPAudioFormat::Protobuf > m_protobufEncoder;
+	};
+
 	template< Role role > class UDPPingEncoder : public ProtocolHandler< role > {
 	public:
 		UDPPingEncoder(Version::full_t protocolVersion = Version::UNKNOWN);
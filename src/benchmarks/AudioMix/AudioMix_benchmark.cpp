@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+
+#include "AudioMixKernels.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 rng(rd());
+std::uniform_real_distribution< float > random_sample(-1.0f, 1.0f);
+
+constexpr int SPEAKER_COUNT_RANGE = 0;
+
+constexpr int SPEAKER_COUNT_BEGIN      = 1;
+constexpr int SPEAKER_COUNT_END        = 64;
+constexpr int SPEAKER_COUNT_MULTIPLIER = 2;
+
+// A 10 ms callback at 48 kHz into a stereo device
+constexpr unsigned int FRAME_COUNT = 480;
+constexpr unsigned int CHANNELS    = 2;
+
+// Every other speaker sends a stereo stream
+std::vector< std::vector< float > > sources;
+std::vector< float > output;
+std::vector< short > converted;
+
+const float panningFactors[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+class Fixture : public ::benchmark::Fixture {
+public:
+	void SetUp(const ::benchmark::State &state) {
+		sources.resize(state.range(SPEAKER_COUNT_RANGE));
+		for (std::size_t i = 0; i < sources.size(); ++i) {
+			sources[i].resize(FRAME_COUNT * (i % 2 == 0 ? 1 : 2));
+			std::generate(sources[i].begin(), sources[i].end(), []() { return random_sample(rng); });
+		}
+
+		output.resize(FRAME_COUNT * CHANNELS);
+		converted.resize(FRAME_COUNT * CHANNELS);
+	}
+};
+
+BENCHMARK_DEFINE_F(Fixture, BM_mixScalar)(::benchmark::State &state) {
+	// The per-sample loops AudioOutput::mix used before the mixing kernels were introduced
+	for (auto _ : state) {
+		std::fill(output.begin(), output.end(), 0.0f);
+
+		for (std::size_t source = 0; source < sources.size(); ++source) {
+			const float *buffer = sources[source].data();
+			const bool stereo   = source % 2 != 0;
+			const float str     = 0.5f;
+
+			for (unsigned int s = 0; s < CHANNELS; ++s) {
+				float *o = output.data() + s;
+				if (stereo) {
+					for (unsigned int i = 0; i < FRAME_COUNT; ++i)
+						o[i * CHANNELS] +=
+							(buffer[2 * i] * panningFactors[2 * s + 0] + buffer[2 * i + 1] * panningFactors[2 * s + 1])
+							* str;
+				} else {
+					for (unsigned int i = 0; i < FRAME_COUNT; ++i)
+						o[i * CHANNELS] += buffer[i] * str;
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i < FRAME_COUNT * CHANNELS; i++)
+			converted[i] = static_cast< short >(std::min(std::max(output[i] * 32768.f, -32768.f), 32767.f));
+
+		benchmark::DoNotOptimize(converted.data());
+	}
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_mixScalar)
+	->RangeMultiplier(SPEAKER_COUNT_MULTIPLIER)
+	->Range(SPEAKER_COUNT_BEGIN, SPEAKER_COUNT_END);
+
+BENCHMARK_DEFINE_F(Fixture, BM_mixKernels)(::benchmark::State &state) {
+	for (auto _ : state) {
+		std::fill(output.begin(), output.end(), 0.0f);
+
+		for (std::size_t source = 0; source < sources.size(); ++source) {
+			const float *buffer = sources[source].data();
+			const float str     = 0.5f;
+
+			if (source % 2 != 0) {
+				const float matrix[4] = { panningFactors[0] * str, panningFactors[1] * str, panningFactors[2] * str,
+										  panningFactors[3] * str };
+				AudioMixKernels::addStereoToStereo(output.data(), buffer, FRAME_COUNT, matrix);
+			} else {
+				AudioMixKernels::addMonoToStereo(output.data(), buffer, FRAME_COUNT, str, str);
+			}
+		}
+
+		AudioMixKernels::convertToShort(converted.data(), output.data(), FRAME_COUNT * CHANNELS);
+
+		benchmark::DoNotOptimize(converted.data());
+	}
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_mixKernels)
+	->RangeMultiplier(SPEAKER_COUNT_MULTIPLIER)
+	->Range(SPEAKER_COUNT_BEGIN, SPEAKER_COUNT_END);
+
+
+BENCHMARK_MAIN();
@@ -147,6 +147,52 @@ BENCHMARK_REGISTER_F(Fixture, BM_full)
 	->ArgsProduct({ benchmark::CreateRange(RECEIVER_COUNT_BEGIN, RECEIVER_COUNT_END, /*multi=*/MULTIPLIER),
 					{ 0, 10, 40, 80 } });
 
+BENCHMARK_DEFINE_F(Fixture, BM_cached)(::benchmark::State &state) {
+	AudioReceiverBuffer buffer;
+
+	ServerUser sender = users[users.size() - 1];
+
+	const AudioReceiverBuffer::PlanKey key = { 1, sender.uiSession, Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH,
+											   false };
+
+	// The first packet of a transmission determines the receivers, all further ones reuse them
+	for (std::size_t i = 0; i < selectedData.size(); ++i) {
+		ReceiverData &data = selectedData[i];
+
+		buffer.addReceiver(sender, *data.receiver, data.context, data.containsPositionalData, data.volumeAdjustment);
+	}
+	buffer.preprocessBuffer();
+	buffer.storePlan(key);
+
+	for (auto _ : state) {
+		buffer.clear();
+
+		if (!buffer.usePlan(key)) {
+			state.SkipWithError("No routing plan");
+			break;
+		}
+
+		std::vector< AudioReceiver > &receivers = buffer.getReceivers(false);
+		ReceiverRange< std::vector< AudioReceiver >::iterator > currentRange =
+			AudioReceiverBuffer::getReceiverRange(receivers.begin(), receivers.end());
+
+		while (currentRange.begin != currentRange.end) {
+			for (auto it = currentRange.begin; it != currentRange.end; ++it) {
+				benchmark::DoNotOptimize(dummyProcessing(*it));
+			}
+
+			// Find next range
+			currentRange = AudioReceiverBuffer::getReceiverRange(currentRange.end, receivers.end());
+		}
+	}
+
+	state.counters["unique receivers"] = getUniqueReceivers(selectedData);
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_cached)
+	->ArgsProduct({ benchmark::CreateRange(RECEIVER_COUNT_BEGIN, RECEIVER_COUNT_END, /*multi=*/MULTIPLIER),
+					{ 0, 10, 40, 80 } });
+
 
 int main(int argc, char **argv) {
 	globalInit();
@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include "RadioEffect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 rng(rd());
+std::uniform_real_distribution< float > random_sample(-1.0f, 1.0f);
+
+constexpr int FRAME_COUNT_RANGE = 0;
+
+constexpr int FROM_FRAME_COUNT       = 120;
+constexpr int TO_FRAME_COUNT         = 1920;
+constexpr int FRAME_COUNT_MULTIPLIER = 2;
+
+constexpr unsigned int SAMPLE_RATE = 48000;
+
+std::vector< float > input;
+std::vector< float > buffer;
+
+class Fixture : public ::benchmark::Fixture {
+public:
+	void SetUp(const ::benchmark::State &state) {
+		input.resize(state.range(FRAME_COUNT_RANGE));
+		std::generate(input.begin(), input.end(), []() { return random_sample(rng); });
+
+		buffer.resize(input.size());
+	}
+};
+
+BENCHMARK_DEFINE_F(Fixture, BM_libmPerSample)(::benchmark::State &state) {
+	// The radio effect as it used to be applied to the mixed output: pow, rand and sinf for every sample
+	for (auto _ : state) {
+		std::copy(input.begin(), input.end(), buffer.begin());
+
+		for (float &sample : buffer) {
+			float x = (sample > 0) ? std::pow(sample, 0.62) : -std::pow(-sample, 0.62);
+			sample  = std::min(std::max(x, -1.0f), 1.0f);
+		}
+		for (float &sample : buffer) {
+			sample += (std::rand() / static_cast< float >(RAND_MAX)) * 0.0080f - 0.0040f;
+		}
+		float phase = 0.0f;
+		for (float &sample : buffer) {
+			sample += 0.8f * sinf(phase);
+			phase += 2.0f * static_cast< float >(M_PI) * 100.0f / SAMPLE_RATE;
+			if (phase >= 2.0f * static_cast< float >(M_PI)) {
+				phase -= 2.0f * static_cast< float >(M_PI);
+			}
+			sample *= 0.8f;
+		}
+
+		benchmark::DoNotOptimize(buffer.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * buffer.size());
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_libmPerSample)
+	->RangeMultiplier(FRAME_COUNT_MULTIPLIER)
+	->Range(FROM_FRAME_COUNT, TO_FRAME_COUNT);
+
+BENCHMARK_DEFINE_F(Fixture, BM_radioEffect)(::benchmark::State &state) {
+	RadioEffect::Parameters parameters;
+	parameters.enabled = true;
+
+	RadioEffect effect;
+	RadioEffect::SourceState sourceState;
+	effect.prepare(parameters, SAMPLE_RATE);
+
+	for (auto _ : state) {
+		std::copy(input.begin(), input.end(), buffer.begin());
+
+		// Band pass and distortion of the source, then noise and (as two sources overlap) the heterodyne on the mix
+		effect.process(sourceState, buffer.data(), static_cast< unsigned int >(buffer.size()), 1);
+		effect.processMix(buffer.data(), static_cast< unsigned int >(buffer.size()), 1, 2);
+
+		benchmark::DoNotOptimize(buffer.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * buffer.size());
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_radioEffect)
+	->RangeMultiplier(FRAME_COUNT_MULTIPLIER)
+	->Range(FROM_FRAME_COUNT, TO_FRAME_COUNT);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include "Mumble.pb.h"
+#include "MumbleProtocol.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QByteArray>
+#include <QtCore/QtEndian>
+
+#include <vector>
+
+// The number of messages in the stream read per iteration
+constexpr int MESSAGE_COUNT = 1000;
+
+static void appendMessage(QByteArray &stream, const ::google::protobuf::Message &msg,
+						  Mumble::Protocol::TCPMessageType type) {
+	const std::string serialized = msg.SerializeAsString();
+
+	unsigned char header[6];
+	qToBigEndian< quint16 >(static_cast< quint16 >(type), &header[0]);
+	qToBigEndian< quint32 >(static_cast< quint32 >(serialized.size()), &header[2]);
+
+	stream.append(reinterpret_cast< const char * >(header), sizeof(header));
+	stream.append(serialized.data(), static_cast< int >(serialized.size()));
+}
+
+/// A stream of the messages a talking client sends most: pings and channel moves
+static QByteArray createStream() {
+	QByteArray stream;
+
+	for (int i = 0; i < MESSAGE_COUNT; ++i) {
+		if (i % 2 == 0) {
+			MumbleProto::Ping ping;
+			ping.set_timestamp(static_cast< quint64 >(i) * 5000);
+			ping.set_good(static_cast< quint32 >(i));
+			ping.set_udp_ping_avg(12.5f);
+			ping.set_tcp_ping_avg(14.0f);
+			appendMessage(stream, ping, Mumble::Protocol::TCPMessageType::Ping);
+		} else {
+			MumbleProto::UserState userState;
+			userState.set_session(42);
+			userState.set_channel_id(static_cast< quint32 >(i % 16));
+			userState.set_comment("Tuned to 121.500 and 118.325, monitoring the approach frequency");
+			appendMessage(stream, userState, Mumble::Protocol::TCPMessageType::UserState);
+		}
+	}
+
+	return stream;
+}
+
+/// Reads all messages from the given device like Connection::socketRead does, calling the given function for every
+/// message read
+template< bool reuseBuffer, typename Handler > static void readMessages(QIODevice &device, Handler handler) {
+	QByteArray buffer;
+
+	unsigned char header[6];
+	while (device.read(reinterpret_cast< char * >(header), sizeof(header)) == sizeof(header)) {
+		const auto type  = static_cast< Mumble::Protocol::TCPMessageType >(qFromBigEndian< quint16 >(&header[0]));
+		const int length = static_cast< int >(qFromBigEndian< quint32 >(&header[2]));
+
+		if (reuseBuffer) {
+			buffer.resize(length);
+			device.read(buffer.data(), length);
+			handler(type, buffer);
+		} else {
+			handler(type, device.read(length));
+		}
+	}
+}
+
+static void BM_parseAllocating(::benchmark::State &state) {
+	QByteArray stream = createStream();
+	QBuffer device(&stream);
+	device.open(QIODevice::ReadOnly);
+
+	for (auto _ : state) {
+		device.seek(0);
+
+		readMessages< false >(device, [](Mumble::Protocol::TCPMessageType type, const QByteArray &data) {
+			if (type == Mumble::Protocol::TCPMessageType::Ping) {
+				MumbleProto::Ping msg;
+				benchmark::DoNotOptimize(msg.ParseFromArray(data.constData(), data.size()));
+			} else {
+				MumbleProto::UserState msg;
+				benchmark::DoNotOptimize(msg.ParseFromArray(data.constData(), data.size()));
+			}
+		});
+	}
+
+	state.SetItemsProcessed(state.iterations() * MESSAGE_COUNT);
+	state.SetBytesProcessed(state.iterations() * stream.size());
+}
+
+static void BM_parseReusing(::benchmark::State &state) {
+	QByteArray stream = createStream();
+	QBuffer device(&stream);
+	device.open(QIODevice::ReadOnly);
+
+	MumbleProto::Ping ping;
+	MumbleProto::UserState userState;
+
+	for (auto _ : state) {
+		device.seek(0);
+
+		readMessages< true >(device, [&](Mumble::Protocol::TCPMessageType type, const QByteArray &data) {
+			if (type == Mumble::Protocol::TCPMessageType::Ping) {
+				benchmark::DoNotOptimize(ping.ParseFromArray(data.constData(), data.size()));
+			} else {
+				benchmark::DoNotOptimize(userState.ParseFromArray(data.constData(), data.size()));
+			}
+		});
+	}
+
+	state.SetItemsProcessed(state.iterations() * MESSAGE_COUNT);
+	state.SetBytesProcessed(state.iterations() * stream.size());
+}
+
+BENCHMARK(BM_parseAllocating);
+BENCHMARK(BM_parseReusing);
+
+BENCHMARK_MAIN();
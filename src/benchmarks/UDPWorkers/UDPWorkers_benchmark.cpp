@@ -0,0 +1,171 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+// Measures how the per-packet work of the UDP workers (peer lookup, entering a routing read section and walking the
+// receivers) scales with the number of workers. Socket I/O and crypto are left out on purpose.
+
+#include <benchmark/benchmark.h>
+
+#include "VoiceRouting.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QReadWriteLock>
+
+#include <memory>
+#include <vector>
+
+// NOTE: This is merely a mock of the ServerUser class
+class ServerUser {
+public:
+	unsigned int uiSession;
+};
+
+constexpr int USER_COUNT        = 256;
+constexpr int USERS_PER_CHANNEL = 16;
+constexpr int MAX_WORKERS       = static_cast< int >(VoiceRoutingPublisher::MAX_READERS);
+
+std::vector< ServerUser > users;
+VoiceRoutingPublisher publisher;
+
+// The peer table as it was before sharding: one table (and lock) shared by all threads
+QHash< unsigned int, ServerUser * > sharedPeers;
+QReadWriteLock sharedPeerLock;
+
+struct alignas(64) PeerShard {
+	QHash< unsigned int, ServerUser * > peers;
+	QReadWriteLock lock;
+};
+
+std::vector< std::unique_ptr< PeerShard > > peerShards;
+
+void globalInit() {
+	users.resize(USER_COUNT);
+
+	std::unique_ptr< VoiceRoutingSnapshot > snapshot(new VoiceRoutingSnapshot());
+	std::vector< std::vector< VoiceRoute > > channels(USER_COUNT / USERS_PER_CHANNEL);
+
+	for (unsigned int i = 0; i < USER_COUNT; ++i) {
+		users[i].uiSession = i;
+
+		const unsigned int channel = i / USERS_PER_CHANNEL;
+
+		VoiceRoutingSnapshot::User entry;
+		entry.user              = &users[i];
+		entry.positionalContext = 0;
+		entry.radioTuned        = false;
+		entry.transmitFrequency = 0;
+		entry.speechChannels.push_back(channel);
+
+		snapshot->users.emplace(i, std::move(entry));
+		channels[channel].push_back(
+			{ &users[i], Mumble::Protocol::AudioContext::NORMAL, VolumeAdjustment::fromFactor(1.0f), 0 });
+
+		sharedPeers.insert(i, &users[i]);
+	}
+
+	for (unsigned int channel = 0; channel < channels.size(); ++channel) {
+		snapshot->channels.emplace(channel,
+								   std::make_shared< const std::vector< VoiceRoute > >(std::move(channels[channel])));
+	}
+
+	publisher.publish(std::move(snapshot));
+
+	for (int i = 0; i < MAX_WORKERS; ++i) {
+		peerShards.emplace_back(new PeerShard());
+	}
+}
+
+void distributePeers(int workers) {
+	// Distribute the peers across the shards the way SO_REUSEPORT would (by hashing the source address)
+	for (std::unique_ptr< PeerShard > &shard : peerShards) {
+		shard->peers.clear();
+	}
+
+	for (unsigned int i = 0; i < USER_COUNT; ++i) {
+		peerShards[i % static_cast< unsigned int >(workers)]->peers.insert(i, &users[i]);
+	}
+}
+
+unsigned int routePacket(const VoiceRoutingSnapshot &routing, ServerUser *sender, std::vector< ServerUser * > &buffer) {
+	const VoiceRoutingSnapshot::User *entry = routing.findUser(sender, sender->uiSession);
+	if (!entry) {
+		return 0;
+	}
+
+	for (unsigned int channel : entry->speechChannels) {
+		for (const VoiceRoute &route : routing.channelRoutes(channel)) {
+			if (route.receiver != sender) {
+				buffer.push_back(route.receiver);
+			}
+		}
+	}
+
+	const unsigned int receivers = static_cast< unsigned int >(buffer.size());
+	buffer.clear();
+
+	return receivers;
+}
+
+static void BM_sharedPeerTable(::benchmark::State &state) {
+	std::vector< ServerUser * > buffer;
+	const std::size_t slot = static_cast< std::size_t >(state.thread_index());
+	unsigned int peer      = static_cast< unsigned int >(state.thread_index());
+
+	for (auto _ : state) {
+		VoiceRoutingPublisher::ReadGuard guard(publisher, slot);
+
+		ServerUser *sender;
+		{
+			QReadLocker rl(&sharedPeerLock);
+			sender = sharedPeers.value(peer);
+		}
+
+		benchmark::DoNotOptimize(routePacket(guard.snapshot(), sender, buffer));
+
+		peer = (peer + static_cast< unsigned int >(state.threads())) % USER_COUNT;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_sharedPeerTable)->ThreadRange(1, MAX_WORKERS)->UseRealTime();
+
+static void BM_shardedPeerTable(::benchmark::State &state) {
+	if (state.thread_index() == 0) {
+		distributePeers(state.threads());
+	}
+
+	std::vector< ServerUser * > buffer;
+	const std::size_t slot = static_cast< std::size_t >(state.thread_index());
+	PeerShard &shard       = *peerShards[slot];
+	// Only visit the peers the kernel delivers to this worker
+	unsigned int peer = static_cast< unsigned int >(state.thread_index());
+
+	for (auto _ : state) {
+		VoiceRoutingPublisher::ReadGuard guard(publisher, slot);
+
+		ServerUser *sender;
+		{
+			QReadLocker rl(&shard.lock);
+			sender = shard.peers.value(peer);
+		}
+
+		benchmark::DoNotOptimize(routePacket(guard.snapshot(), sender, buffer));
+
+		peer = (peer + static_cast< unsigned int >(state.threads())) % USER_COUNT;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_shardedPeerTable)->ThreadRange(1, MAX_WORKERS)->UseRealTime();
+
+
+int main(int argc, char **argv) {
+	globalInit();
+
+	::benchmark::Initialize(&argc, argv);
+	::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,131 @@
+#include <benchmark/benchmark.h>
+
+#include "crypto/CryptStateOCB2.h"
+
+#include <openssl/evp.h>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+std::random_device rd;
+std::mt19937 rng(rd());
+std::uniform_int_distribution< unsigned int > random_byte(0, std::numeric_limits< unsigned char >::max());
+
+constexpr int PAYLOAD_SIZE_RANGE = 0;
+
+constexpr int FROM_PAYLOAD_SIZE       = 16;
+constexpr int TO_PAYLOAD_SIZE         = 1024;
+constexpr int PAYLOAD_SIZE_MULTIPLIER = 2;
+
+std::vector< unsigned char > payload;
+std::vector< unsigned char > output;
+unsigned char key[AES_KEY_SIZE_BYTES];
+
+class Fixture : public ::benchmark::Fixture {
+public:
+	void SetUp(const ::benchmark::State &state) {
+		payload.resize(state.range(PAYLOAD_SIZE_RANGE));
+		// The encrypted packet has a 4 byte header
+		output.resize(payload.size() + 4);
+
+		for (std::size_t i = 0; i < payload.size(); ++i) {
+			payload[i] = static_cast< unsigned char >(random_byte(rng));
+		}
+		for (std::size_t i = 0; i < AES_KEY_SIZE_BYTES; ++i) {
+			key[i] = static_cast< unsigned char >(random_byte(rng));
+		}
+	}
+};
+
+// The way CryptStateOCB2 used to run AES: the cipher context is initialized with the key for every single block
+BENCHMARK_DEFINE_F(Fixture, BM_aesPerBlockInit)(::benchmark::State &state) {
+	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+
+	for (auto _ : state) {
+		for (std::size_t offset = 0; offset + AES_BLOCK_SIZE <= payload.size(); offset += AES_BLOCK_SIZE) {
+			int outlen = 0;
+			EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, key, nullptr);
+			EVP_CIPHER_CTX_set_padding(ctx, 0);
+			EVP_EncryptUpdate(ctx, &output[offset], &outlen, &payload[offset], AES_BLOCK_SIZE);
+			EVP_EncryptFinal_ex(ctx, &output[offset] + outlen, &outlen);
+		}
+
+		benchmark::DoNotOptimize(output.data());
+	}
+
+	EVP_CIPHER_CTX_free(ctx);
+
+	state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_aesPerBlockInit)
+	->RangeMultiplier(PAYLOAD_SIZE_MULTIPLIER)
+	->Range(FROM_PAYLOAD_SIZE, TO_PAYLOAD_SIZE);
+
+// The way CryptStateOCB2 runs AES now: the key is expanded once and all blocks are passed at once
+BENCHMARK_DEFINE_F(Fixture, BM_aesPipelined)(::benchmark::State &state) {
+	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+	EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, key, nullptr);
+	EVP_CIPHER_CTX_set_padding(ctx, 0);
+
+	for (auto _ : state) {
+		int outlen = 0;
+		EVP_EncryptUpdate(ctx, output.data(), &outlen, payload.data(),
+						  static_cast< int >(payload.size() / AES_BLOCK_SIZE * AES_BLOCK_SIZE));
+
+		benchmark::DoNotOptimize(output.data());
+	}
+
+	EVP_CIPHER_CTX_free(ctx);
+
+	state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_aesPipelined)
+	->RangeMultiplier(PAYLOAD_SIZE_MULTIPLIER)
+	->Range(FROM_PAYLOAD_SIZE, TO_PAYLOAD_SIZE);
+
+BENCHMARK_DEFINE_F(Fixture, BM_encrypt)(::benchmark::State &state) {
+	CryptStateOCB2 cs;
+	cs.genKey();
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(
+			cs.encrypt(payload.data(), output.data(), static_cast< unsigned int >(payload.size())));
+	}
+
+	state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_encrypt)
+	->RangeMultiplier(PAYLOAD_SIZE_MULTIPLIER)
+	->Range(FROM_PAYLOAD_SIZE, TO_PAYLOAD_SIZE);
+
+BENCHMARK_DEFINE_F(Fixture, BM_decrypt)(::benchmark::State &state) {
+	CryptStateOCB2 encState;
+	CryptStateOCB2 decState;
+	encState.genKey();
+
+	std::vector< unsigned char > plain(payload.size());
+
+	for (auto _ : state) {
+		// Decrypting requires a fresh packet every time (replays are rejected)
+		state.PauseTiming();
+		decState.setKey(encState.getRawKey(), encState.getDecryptIV(), encState.getEncryptIV());
+		encState.encrypt(payload.data(), output.data(), static_cast< unsigned int >(payload.size()));
+		state.ResumeTiming();
+
+		benchmark::DoNotOptimize(
+			decState.decrypt(output.data(), plain.data(), static_cast< unsigned int >(output.size())));
+	}
+
+	state.SetBytesProcessed(state.iterations() * payload.size());
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_decrypt)
+	->RangeMultiplier(PAYLOAD_SIZE_MULTIPLIER)
+	->Range(FROM_PAYLOAD_SIZE, TO_PAYLOAD_SIZE);
+
+
+BENCHMARK_MAIN();
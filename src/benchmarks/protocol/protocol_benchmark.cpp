@@ -122,5 +122,67 @@ BENCHMARK_REGISTER_F(Fixture, BM_encodeNew_UpdateOnly)
 	->RangeMultiplier(PAYLOAD_SIZE_MULTIPLIER)
 	->Range(FROM_PAYLOAD_SIZE, TO_PAYLOAD_SIZE);
 
+// Receivers as Server::processMsg sees them: grouped by protocol version, with and without positional data
+constexpr int RECEIVERS_PER_GROUP = 8;
+const std::vector< Version::full_t > receiverVersions = { Version::fromComponents(1, 3, 0),
+														  Mumble::Protocol::PROTOBUF_INTRODUCTION_VERSION };
+
+Mumble::Protocol::UDPServerAudioEncoder serverEncoder;
+
+BENCHMARK_DEFINE_F(Fixture, BM_encodeMixedVersions)(::benchmark::State &state) {
+	for (auto _ : state) {
+		bool isFirstIteration = true;
+
+		for (bool includePositionalData : { true, false }) {
+			Mumble::Protocol::AudioData data = audioData;
+			data.containsPositionalData      = includePositionalData;
+
+			for (Version::full_t version : receiverVersions) {
+				if (isFirstIteration
+					|| !Mumble::Protocol::protocolVersionsAreCompatible(encoder.getProtocolVersion(), version)) {
+					encoder.setProtocolVersion(version);
+					encoder.prepareAudioPacket(data);
+					if (includePositionalData) {
+						encoder.addPositionalData(data);
+					}
+
+					isFirstIteration = false;
+				}
+				if (!includePositionalData) {
+					encoder.dropPositionalData();
+				}
+
+				for (int i = 0; i < RECEIVERS_PER_GROUP; ++i) {
+					benchmark::DoNotOptimize(encoder.updateAudioPacket(data));
+				}
+			}
+		}
+	}
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_encodeMixedVersions)
+	->RangeMultiplier(PAYLOAD_SIZE_MULTIPLIER)
+	->Range(FROM_PAYLOAD_SIZE, TO_PAYLOAD_SIZE);
+
+BENCHMARK_DEFINE_F(Fixture, BM_encodeMixedVersions_Specialised)(::benchmark::State &state) {
+	for (auto _ : state) {
+		serverEncoder.prepareAudioPacket(audioData);
+
+		for (bool includePositionalData : { true, false }) {
+			for (Version::full_t version : receiverVersions) {
+				for (int i = 0; i < RECEIVERS_PER_GROUP; ++i) {
+					benchmark::DoNotOptimize(serverEncoder.updateAudioPacket(
+						version, Mumble::Protocol::AudioContext::NORMAL, audioData.volumeAdjustment,
+						includePositionalData));
+				}
+			}
+		}
+	}
+}
+
+BENCHMARK_REGISTER_F(Fixture, BM_encodeMixedVersions_Specialised)
+	->RangeMultiplier(PAYLOAD_SIZE_MULTIPLIER)
+	->Range(FROM_PAYLOAD_SIZE, TO_PAYLOAD_SIZE);
+
 
 BENCHMARK_MAIN();
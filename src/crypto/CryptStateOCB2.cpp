@@ -38,6 +38,7 @@ CryptStateOCB2::CryptStateOCB2()
 	memset(raw_key, 0, AES_KEY_SIZE_BYTES);
 	memset(encrypt_iv, 0, AES_BLOCK_SIZE);
 	memset(decrypt_iv, 0, AES_BLOCK_SIZE);
+	applyKey();
 }
 
 CryptStateOCB2::~CryptStateOCB2() noexcept {
@@ -55,6 +56,7 @@ void CryptStateOCB2::genKey() {
 	CryptographicRandom::fillBuffer(raw_key, AES_KEY_SIZE_BYTES);
 	CryptographicRandom::fillBuffer(encrypt_iv, AES_BLOCK_SIZE);
 	CryptographicRandom::fillBuffer(decrypt_iv, AES_BLOCK_SIZE);
+	applyKey();
 	bInit = true;
 }
 
@@ -63,6 +65,7 @@ bool CryptStateOCB2::setKey(const std::string &rkey, const std::string &eiv, con
 		memcpy(raw_key, rkey.data(), AES_KEY_SIZE_BYTES);
 		memcpy(encrypt_iv, eiv.data(), AES_BLOCK_SIZE);
 		memcpy(decrypt_iv, div.data(), AES_BLOCK_SIZE);
+		applyKey();
 		bInit = true;
 		return true;
 	}
@@ -72,6 +75,7 @@ bool CryptStateOCB2::setKey(const std::string &rkey, const std::string &eiv, con
 bool CryptStateOCB2::setRawKey(const std::string &rkey) {
 	if (rkey.length() == AES_KEY_SIZE_BYTES) {
 		memcpy(raw_key, rkey.data(), AES_KEY_SIZE_BYTES);
+		applyKey();
 		return true;
 	}
 	return false;
@@ -93,6 +97,19 @@ bool CryptStateOCB2::setDecryptIV(const std::string &iv) {
 	return false;
 }
 
+void CryptStateOCB2::applyKey() {
+	// Expanding the key is comparatively expensive, so it is done once per key instead of once per block. As ECB mode
+	// keeps no state between blocks, the contexts can be used for any number of EVP_*Update calls afterwards.
+	for (EVP_CIPHER_CTX *ctx : { enc_ctx_ocb_enc, enc_ctx_ocb_dec }) {
+		EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, raw_key, nullptr);
+		EVP_CIPHER_CTX_set_padding(ctx, 0);
+	}
+	for (EVP_CIPHER_CTX *ctx : { dec_ctx_ocb_enc, dec_ctx_ocb_dec }) {
+		EVP_DecryptInit_ex(ctx, EVP_aes_128_ecb(), nullptr, raw_key, nullptr);
+		EVP_CIPHER_CTX_set_padding(ctx, 0);
+	}
+}
+
 std::string CryptStateOCB2::getRawKey() {
 	return std::string(reinterpret_cast< const char * >(raw_key), AES_KEY_SIZE_BYTES);
 }
@@ -235,6 +252,9 @@ typedef subblock keyblock[BLOCKSIZE];
 
 #define HIGHBIT (1 << SHIFTBITS);
 
+/// The maximum number of blocks that are passed to AES at once
+#define PIPELINE_BLOCKS 16
+
 
 static void inline XOR(subblock *dst, const subblock *a, const subblock *b) {
 	for (int i = 0; i < BLOCKSIZE; i++) {
@@ -261,83 +281,94 @@ static void inline ZERO(keyblock &block) {
 		block[i] = 0;
 }
 
-#define AESencrypt_ctx(src, dst, key, enc_ctx)                                                      \
-	{                                                                                               \
-		int outlen = 0;                                                                             \
-		EVP_EncryptInit_ex(enc_ctx, EVP_aes_128_ecb(), NULL, key, NULL);                            \
-		EVP_CIPHER_CTX_set_padding(enc_ctx, 0);                                                     \
-		EVP_EncryptUpdate(enc_ctx, reinterpret_cast< unsigned char * >(dst), &outlen,               \
-						  reinterpret_cast< const unsigned char * >(src), AES_BLOCK_SIZE);          \
-		EVP_EncryptFinal_ex(enc_ctx, reinterpret_cast< unsigned char * >((dst) + outlen), &outlen); \
+// The contexts have been initialized with the key by applyKey(). Passing multiple blocks at once allows OpenSSL to
+// pipeline them (e.g. through AES-NI).
+#define AESencryptBlocks_ctx(src, dst, blocks, enc_ctx)                               \
+	{                                                                                 \
+		int outlen = 0;                                                               \
+		EVP_EncryptUpdate(enc_ctx, reinterpret_cast< unsigned char * >(dst), &outlen, \
+						  reinterpret_cast< const unsigned char * >(src),             \
+						  static_cast< int >(blocks) * AES_BLOCK_SIZE);               \
 	}
-#define AESdecrypt_ctx(src, dst, key, dec_ctx)                                                      \
-	{                                                                                               \
-		int outlen = 0;                                                                             \
-		EVP_DecryptInit_ex(dec_ctx, EVP_aes_128_ecb(), NULL, key, NULL);                            \
-		EVP_CIPHER_CTX_set_padding(dec_ctx, 0);                                                     \
-		EVP_DecryptUpdate(dec_ctx, reinterpret_cast< unsigned char * >(dst), &outlen,               \
-						  reinterpret_cast< const unsigned char * >(src), AES_BLOCK_SIZE);          \
-		EVP_DecryptFinal_ex(dec_ctx, reinterpret_cast< unsigned char * >((dst) + outlen), &outlen); \
+#define AESdecryptBlocks_ctx(src, dst, blocks, dec_ctx)                               \
+	{                                                                                 \
+		int outlen = 0;                                                               \
+		EVP_DecryptUpdate(dec_ctx, reinterpret_cast< unsigned char * >(dst), &outlen, \
+						  reinterpret_cast< const unsigned char * >(src),             \
+						  static_cast< int >(blocks) * AES_BLOCK_SIZE);               \
 	}
 
-#define AESencrypt(src, dst, key) AESencrypt_ctx(src, dst, key, enc_ctx_ocb_enc)
-#define AESdecrypt(src, dst, key) AESdecrypt_ctx(src, dst, key, dec_ctx_ocb_enc)
+#define AESencryptBlocks(src, dst, blocks) AESencryptBlocks_ctx(src, dst, blocks, enc_ctx_ocb_enc)
+#define AESencrypt(src, dst) AESencryptBlocks(src, dst, 1)
 
 bool CryptStateOCB2::ocb_encrypt(const unsigned char *plain, unsigned char *encrypted, unsigned int len,
 								 const unsigned char *nonce, unsigned char *tag, bool modifyPlainOnXEXStarAttack) {
 	keyblock checksum, delta, tmp, pad;
 	bool success = true;
 
+	keyblock deltas[PIPELINE_BLOCKS], blocks[PIPELINE_BLOCKS];
+
 	// Initialize
-	AESencrypt(nonce, delta, raw_key);
+	AESencrypt(nonce, delta);
 	ZERO(checksum);
 
 	while (len > AES_BLOCK_SIZE) {
-		// Counter-cryptanalysis described in section 9 of https://eprint.iacr.org/2019/311
-		// For an attack, the second to last block (i.e. the last iteration of this loop)
-		// must be all 0 except for the last byte (which may be 0 - 128).
-		bool flipABit = false; // *plain is const, so we can't directly modify it
-		if (len - AES_BLOCK_SIZE <= AES_BLOCK_SIZE) {
-			unsigned char sum = 0;
-			for (int i = 0; i < AES_BLOCK_SIZE - 1; ++i) {
-				sum |= plain[i];
-			}
-			if (sum == 0) {
-				if (modifyPlainOnXEXStarAttack) {
-					// The assumption that critical packets do not turn up by pure chance turned out to be incorrect
-					// since digital silence appears to produce them in mass.
-					// So instead we now modify the packet in a way which should not affect the audio but will
-					// prevent the attack.
-					flipABit = true;
-				} else {
-					// This option still exists but only to allow us to test ocb_decrypt's detection.
-					success = false;
+		// The offsets only depend on the nonce, so the full blocks are whitened first and then encrypted with a single
+		// call per chunk.
+		unsigned int count = 0;
+		while (len > AES_BLOCK_SIZE && count < PIPELINE_BLOCKS) {
+			// Counter-cryptanalysis described in section 9 of https://eprint.iacr.org/2019/311
+			// For an attack, the second to last block (i.e. the last iteration of this loop)
+			// must be all 0 except for the last byte (which may be 0 - 128).
+			bool flipABit = false; // *plain is const, so we can't directly modify it
+			if (len - AES_BLOCK_SIZE <= AES_BLOCK_SIZE) {
+				unsigned char sum = 0;
+				for (int i = 0; i < AES_BLOCK_SIZE - 1; ++i) {
+					sum |= plain[i];
+				}
+				if (sum == 0) {
+					if (modifyPlainOnXEXStarAttack) {
+						// The assumption that critical packets do not turn up by pure chance turned out to be
+						// incorrect since digital silence appears to produce them in mass.
+						// So instead we now modify the packet in a way which should not affect the audio but will
+						// prevent the attack.
+						flipABit = true;
+					} else {
+						// This option still exists but only to allow us to test ocb_decrypt's detection.
+						success = false;
+					}
 				}
 			}
-		}
 
-		S2(delta);
-		XOR(tmp, delta, reinterpret_cast< const subblock * >(plain));
-		if (flipABit) {
-			*reinterpret_cast< unsigned char * >(tmp) ^= 1;
-		}
-		AESencrypt(tmp, tmp, raw_key);
-		XOR(reinterpret_cast< subblock * >(encrypted), delta, tmp);
-		XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
-		if (flipABit) {
-			*reinterpret_cast< unsigned char * >(checksum) ^= 1;
+			S2(delta);
+			memcpy(deltas[count], delta, AES_BLOCK_SIZE);
+			XOR(blocks[count], delta, reinterpret_cast< const subblock * >(plain));
+			if (flipABit) {
+				*reinterpret_cast< unsigned char * >(blocks[count]) ^= 1;
+			}
+			XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
+			if (flipABit) {
+				*reinterpret_cast< unsigned char * >(checksum) ^= 1;
+			}
+
+			len -= AES_BLOCK_SIZE;
+			plain += AES_BLOCK_SIZE;
+			++count;
 		}
 
-		len -= AES_BLOCK_SIZE;
-		plain += AES_BLOCK_SIZE;
-		encrypted += AES_BLOCK_SIZE;
+		AESencryptBlocks(blocks, blocks, count);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			XOR(reinterpret_cast< subblock * >(encrypted), deltas[i], blocks[i]);
+			encrypted += AES_BLOCK_SIZE;
+		}
 	}
 
 	S2(delta);
 	ZERO(tmp);
 	tmp[BLOCKSIZE - 1] = SWAPPED(len * 8);
 	XOR(tmp, tmp, delta);
-	AESencrypt(tmp, pad, raw_key);
+	AESencrypt(tmp, pad);
 	memcpy(tmp, plain, len);
 	memcpy(reinterpret_cast< unsigned char * >(tmp) + len, reinterpret_cast< const unsigned char * >(pad) + len,
 		   AES_BLOCK_SIZE - len);
@@ -347,42 +378,53 @@ bool CryptStateOCB2::ocb_encrypt(const unsigned char *plain, unsigned char *encr
 
 	S3(delta);
 	XOR(tmp, delta, checksum);
-	AESencrypt(tmp, tag, raw_key);
+	AESencrypt(tmp, tag);
 
 	return success;
 }
 
+#undef AESencryptBlocks
 #undef AESencrypt
-#undef AESdecrypt
 
-#define AESencrypt(src, dst, key) AESencrypt_ctx(src, dst, key, enc_ctx_ocb_dec)
-#define AESdecrypt(src, dst, key) AESdecrypt_ctx(src, dst, key, dec_ctx_ocb_dec)
+#define AESencrypt(src, dst) AESencryptBlocks_ctx(src, dst, 1, enc_ctx_ocb_dec)
+#define AESdecryptBlocks(src, dst, blocks) AESdecryptBlocks_ctx(src, dst, blocks, dec_ctx_ocb_dec)
 
 bool CryptStateOCB2::ocb_decrypt(const unsigned char *encrypted, unsigned char *plain, unsigned int len,
 								 const unsigned char *nonce, unsigned char *tag) {
 	keyblock checksum, delta, tmp, pad;
 	bool success = true;
 
+	keyblock deltas[PIPELINE_BLOCKS], blocks[PIPELINE_BLOCKS];
+
 	// Initialize
-	AESencrypt(nonce, delta, raw_key);
+	AESencrypt(nonce, delta);
 	ZERO(checksum);
 
 	while (len > AES_BLOCK_SIZE) {
-		S2(delta);
-		XOR(tmp, delta, reinterpret_cast< const subblock * >(encrypted));
-		AESdecrypt(tmp, tmp, raw_key);
-		XOR(reinterpret_cast< subblock * >(plain), delta, tmp);
-		XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
-		len -= AES_BLOCK_SIZE;
-		plain += AES_BLOCK_SIZE;
-		encrypted += AES_BLOCK_SIZE;
+		unsigned int count = 0;
+		while (len > AES_BLOCK_SIZE && count < PIPELINE_BLOCKS) {
+			S2(delta);
+			memcpy(deltas[count], delta, AES_BLOCK_SIZE);
+			XOR(blocks[count], delta, reinterpret_cast< const subblock * >(encrypted));
+			len -= AES_BLOCK_SIZE;
+			encrypted += AES_BLOCK_SIZE;
+			++count;
+		}
+
+		AESdecryptBlocks(blocks, blocks, count);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			XOR(reinterpret_cast< subblock * >(plain), deltas[i], blocks[i]);
+			XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
+			plain += AES_BLOCK_SIZE;
+		}
 	}
 
 	S2(delta);
 	ZERO(tmp);
 	tmp[BLOCKSIZE - 1] = SWAPPED(len * 8);
 	XOR(tmp, tmp, delta);
-	AESencrypt(tmp, pad, raw_key);
+	AESencrypt(tmp, pad);
 	memset(tmp, 0, AES_BLOCK_SIZE);
 	memcpy(tmp, encrypted, len);
 	XOR(tmp, tmp, pad);
@@ -400,14 +442,15 @@ bool CryptStateOCB2::ocb_decrypt(const unsigned char *encrypted, unsigned char *
 
 	S3(delta);
 	XOR(tmp, delta, checksum);
-	AESencrypt(tmp, tag, raw_key);
+	AESencrypt(tmp, tag);
 
 	return success;
 }
 
 #undef AESencrypt
-#undef AESdecrypt
+#undef AESdecryptBlocks
 #undef BLOCKSIZE
 #undef SHIFTBITS
 #undef SWAPPED
 #undef HIGHBIT
+#undef PIPELINE_BLOCKS
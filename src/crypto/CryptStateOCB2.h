@@ -39,6 +39,9 @@ public:
 					 unsigned char *tag);
 
 private:
+	/// Initializes the cipher contexts with raw_key. Has to be called whenever raw_key changes.
+	void applyKey();
+
 	unsigned char raw_key[AES_KEY_SIZE_BYTES];
 	unsigned char encrypt_iv[AES_BLOCK_SIZE];
 	unsigned char decrypt_iv[AES_BLOCK_SIZE];
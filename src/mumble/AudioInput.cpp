@@ -10,6 +10,7 @@
 #include "MainWindow.h"
 #include "MumbleProtocol.h"
 #include "NetworkConfig.h"
+#include "OpusEncoderSettings.h"
 #include "PacketDataStream.h"
 #include "PluginManager.h"
 #include "ServerHandler.h"
@@ -39,128 +40,6 @@ static short clampFloatSample(float v) {
 }
 #endif
 
-void Resynchronizer::addMic(short *mic) {
-	bool drop = false;
-	{
-		std::unique_lock< std::mutex > l(m);
-		micQueue.push_back(mic);
-		switch (state) {
-			case S0:
-				state = S1a;
-				break;
-			case S1a:
-				state = S2;
-				break;
-			case S1b:
-				state = S2;
-				break;
-			case S2:
-				state = S3;
-				break;
-			case S3:
-				state = S4a;
-				break;
-			case S4a:
-				state = S5;
-				break;
-			case S4b:
-				drop = true;
-				break;
-			case S5:
-				drop = true;
-				break;
-		}
-		if (drop) {
-			delete[] micQueue.front();
-			micQueue.pop_front();
-		}
-	}
-	if (bDebugPrintQueue) {
-		if (drop)
-			qWarning("Resynchronizer::addMic(): dropped microphone chunk due to overflow");
-		printQueue('+');
-	}
-}
-
-AudioChunk Resynchronizer::addSpeaker(short *speaker) {
-	AudioChunk result;
-	bool drop = false;
-	{
-		std::unique_lock< std::mutex > l(m);
-		switch (state) {
-			case S0:
-				drop = true;
-				break;
-			case S1a:
-				drop = true;
-				break;
-			case S1b:
-				state = S0;
-				break;
-			case S2:
-				state = S1b;
-				break;
-			case S3:
-				state = S2;
-				break;
-			case S4a:
-				state = S3;
-				break;
-			case S4b:
-				state = S3;
-				break;
-			case S5:
-				state = S4b;
-				break;
-		}
-		if (drop == false) {
-			result = AudioChunk(micQueue.front(), speaker);
-			micQueue.pop_front();
-		}
-	}
-	if (drop)
-		delete[] speaker;
-	if (bDebugPrintQueue) {
-		if (drop)
-			qWarning("Resynchronizer::addSpeaker(): dropped speaker chunk due to underflow");
-		printQueue('-');
-	}
-	return result;
-}
-
-void Resynchronizer::reset() {
-	if (bDebugPrintQueue)
-		qWarning("Resetting echo queue");
-	std::unique_lock< std::mutex > l(m);
-	state = S0;
-	while (!micQueue.empty()) {
-		delete[] micQueue.front();
-		micQueue.pop_front();
-	}
-}
-
-Resynchronizer::~Resynchronizer() {
-	reset();
-}
-
-void Resynchronizer::printQueue(char who) {
-	unsigned int mic;
-	{
-		std::unique_lock< std::mutex > l(m);
-		mic = static_cast< unsigned int >(micQueue.size());
-	}
-	std::string line;
-	line.reserve(32);
-	line += who;
-	line += " Echo queue [";
-	for (unsigned int i = 0; i < 5; i++)
-		line += i < mic ? '#' : ' ';
-	line += "]\r";
-	// This relies on \r to retrace always on the same line, can't use qWarining
-	printf("%s", line.c_str());
-	fflush(stdout);
-}
-
 // Remember that we cannot use static member classes that are not pointers, as the constructor
 // for AudioInputRegistrar() might be called before they are initialized, as the constructor
 // is called from global initialization.
@@ -229,20 +108,20 @@ AudioInput::AudioInput() : opusBuffer(Global::get().s.iFramesPerPacket * (SAMPLE
 	m_codec = Mumble::Protocol::AudioCodec::Opus;
 
 	activityState = ActivityStateActive;
-	opusState     = nullptr;
-
-	if (bAllowLowDelay && iAudioQuality >= 64000) { // > 64 kbit/s bitrate and low delay allowed
-		opusState = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_RESTRICTED_LOWDELAY, nullptr);
-		qWarning("AudioInput: Opus encoder set for low delay");
-	} else if (iAudioQuality >= 32000) { // > 32 kbit/s bitrate
-		opusState = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_AUDIO, nullptr);
-		qWarning("AudioInput: Opus encoder set for high quality speech");
-	} else {
-		opusState = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, nullptr);
-		qWarning("AudioInput: Opus encoder set for low quality speech");
-	}
 
-	opus_encoder_ctl(opusState, OPUS_SET_VBR(0)); // CBR
+	bInBandFEC = Global::get().s.bInBandFEC;
+	opusState  = OpusEncoderSettings::create(SAMPLE_RATE, iAudioQuality, bAllowLowDelay, bInBandFEC);
+	switch (OpusEncoderSettings::getApplication(iAudioQuality, bAllowLowDelay)) {
+		case OPUS_APPLICATION_RESTRICTED_LOWDELAY:
+			qWarning("AudioInput: Opus encoder set for low delay");
+			break;
+		case OPUS_APPLICATION_AUDIO:
+			qWarning("AudioInput: Opus encoder set for high quality speech");
+			break;
+		default:
+			qWarning("AudioInput: Opus encoder set for low quality speech");
+			break;
+	}
 
 #ifdef USE_RNNOISE
 	denoiseState = rnnoise_create(nullptr);
@@ -522,6 +401,7 @@ void AudioInput::initializeMixer() {
 		iEchoMCLength  = bEchoMulti ? iEchoLength * iEchoChannels : iEchoLength;
 		iEchoFrameSize = bEchoMulti ? iFrameSize * iEchoChannels : iFrameSize;
 		pfEchoInput    = new float[iEchoMCLength];
+		resync.setFrameSizes(static_cast< std::size_t >(iFrameSize), static_cast< std::size_t >(iEchoFrameSize));
 	} else {
 		srsEcho     = nullptr;
 		pfEchoInput = nullptr;
@@ -581,9 +461,8 @@ void AudioInput::addMic(const void *data, unsigned int nsamp) {
 				speex_resampler_process_float(srsMic, 0, pfMicInput, &inlen, pfOutput, &outlen);
 			}
 
-			// If echo cancellation is enabled the pointer ends up in the resynchronizer queue
-			// and may need to outlive this function's frame
-			short *psMic = iEchoChannels > 0 ? new short[iFrameSize] : (short *) alloca(iFrameSize * sizeof(short));
+			// If echo cancellation is enabled the frame is written directly into the resynchronizer queue
+			short *psMic = iEchoChannels > 0 ? resync.micFrame() : (short *) alloca(iFrameSize * sizeof(short));
 
 			// Convert float to 16bit PCM
 			const float mul = 32768.f;
@@ -592,7 +471,7 @@ void AudioInput::addMic(const void *data, unsigned int nsamp) {
 
 			// If we have echo cancellation enabled...
 			if (iEchoChannels > 0) {
-				resync.addMic(psMic);
+				resync.addMic();
 			} else {
 				encodeAudioFrame(AudioChunk(psMic));
 			}
@@ -648,7 +527,7 @@ void AudioInput::addEcho(const void *data, unsigned int nsamp) {
 				speex_resampler_process_interleaved_float(srsEcho, pfEchoInput, &inlen, pfOutput, &outlen);
 			}
 
-			short *outbuff = new short[iEchoFrameSize];
+			short *outbuff = resync.speakerFrame();
 
 			// float -> 16bit PCM
 			const float mul = 32768.f;
@@ -656,11 +535,9 @@ void AudioInput::addEcho(const void *data, unsigned int nsamp) {
 				outbuff[j] = static_cast< short >(qBound(-32768.f, (ptr[j] * mul), 32767.f));
 			}
 
-			auto chunk = resync.addSpeaker(outbuff);
+			auto chunk = resync.addSpeaker();
 			if (!chunk.empty()) {
 				encodeAudioFrame(chunk);
-				delete[] chunk.mic;
-				delete[] chunk.speaker;
 			}
 		}
 	}
@@ -848,7 +725,8 @@ int AudioInput::encodeOpusFrame(short *source, int size, EncodingOutputBuffer &b
 		bResetEncoder = false;
 	}
 
-	opus_encoder_ctl(opusState, OPUS_SET_BITRATE(iAudioQuality));
+	ServerHandlerPtr sh = Global::get().sh;
+	OpusEncoderSettings::update(opusState, iAudioQuality, bInBandFEC, sh ? sh->getUplinkLossPercentage() : 0);
 
 	len = opus_encode(opusState, source, size, &buffer[0], static_cast< opus_int32 >(buffer.size()));
 	const int tenMsFrameCount = (size / iFrameSize);
@@ -0,0 +1,238 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioMixKernels.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define MIX_USE_SSE
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	define MIX_USE_NEON
+#	include <arm_neon.h>
+#endif
+
+namespace AudioMixKernels {
+
+#if defined(MIX_USE_SSE)
+/// @returns The gains of the 4 frames starting at the given frame
+static inline __m128 rampGains(float gain, float gainIncrement, unsigned int frame) {
+	const __m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	const __m128 index   = _mm_add_ps(_mm_set1_ps(static_cast< float >(frame)), offsets);
+
+	return _mm_add_ps(_mm_set1_ps(gain), _mm_mul_ps(_mm_set1_ps(gainIncrement), index));
+}
+
+/// Adds the given samples to 4 consecutive frames of the given channel (o) of an interleaved output
+static inline void accumulate(float *o, unsigned int channels, __m128 samples) {
+	if (channels == 1) {
+		_mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), samples));
+	} else {
+		// The frames aren't contiguous, so they are added one by one
+		alignas(16) float values[4];
+		_mm_store_ps(values, samples);
+		for (unsigned int k = 0; k < 4; ++k) {
+			o[k * channels] += values[k];
+		}
+	}
+}
+#elif defined(MIX_USE_NEON)
+static inline float32x4_t rampGains(float gain, float gainIncrement, unsigned int frame) {
+	const float offsetValues[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	const float32x4_t index     = vaddq_f32(vdupq_n_f32(static_cast< float >(frame)), vld1q_f32(offsetValues));
+
+	return vaddq_f32(vdupq_n_f32(gain), vmulq_f32(vdupq_n_f32(gainIncrement), index));
+}
+
+static inline void accumulate(float *o, unsigned int channels, float32x4_t samples) {
+	if (channels == 1) {
+		vst1q_f32(o, vaddq_f32(vld1q_f32(o), samples));
+	} else {
+		float values[4];
+		vst1q_f32(values, samples);
+		for (unsigned int k = 0; k < 4; ++k) {
+			o[k * channels] += values[k];
+		}
+	}
+}
+#endif
+
+void addMono(float *output, unsigned int channels, unsigned int channel, const float *input, unsigned int frames,
+			 float gain, float gainIncrement) {
+	float *o       = output + channel;
+	unsigned int i = 0;
+
+#if defined(MIX_USE_SSE)
+	for (; i + 4 <= frames; i += 4) {
+		accumulate(o + i * channels, channels, _mm_mul_ps(_mm_loadu_ps(input + i), rampGains(gain, gainIncrement, i)));
+	}
+#elif defined(MIX_USE_NEON)
+	for (; i + 4 <= frames; i += 4) {
+		accumulate(o + i * channels, channels, vmulq_f32(vld1q_f32(input + i), rampGains(gain, gainIncrement, i)));
+	}
+#endif
+
+	for (; i < frames; ++i) {
+		o[i * channels] += input[i] * (gain + gainIncrement * static_cast< float >(i));
+	}
+}
+
+void addStereo(float *output, unsigned int channels, unsigned int channel, const float *input, unsigned int frames,
+			   float leftFactor, float rightFactor, float gain, float gainIncrement) {
+	float *o       = output + channel;
+	unsigned int i = 0;
+
+#if defined(MIX_USE_SSE)
+	const __m128 left  = _mm_set1_ps(leftFactor);
+	const __m128 right = _mm_set1_ps(rightFactor);
+	for (; i + 4 <= frames; i += 4) {
+		// De-interleave 4 frames (LRLR LRLR -> LLLL RRRR)
+		const __m128 a  = _mm_loadu_ps(input + 2 * i);
+		const __m128 b  = _mm_loadu_ps(input + 2 * i + 4);
+		const __m128 ls = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 rs = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+		const __m128 mixed =
+			_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ls, left), _mm_mul_ps(rs, right)), rampGains(gain, gainIncrement, i));
+		accumulate(o + i * channels, channels, mixed);
+	}
+#elif defined(MIX_USE_NEON)
+	for (; i + 4 <= frames; i += 4) {
+		const float32x4x2_t frame = vld2q_f32(input + 2 * i);
+
+		accumulate(o + i * channels, channels,
+				   vmulq_f32(vaddq_f32(vmulq_n_f32(frame.val[0], leftFactor), vmulq_n_f32(frame.val[1], rightFactor)),
+							 rampGains(gain, gainIncrement, i)));
+	}
+#endif
+
+	for (; i < frames; ++i) {
+		o[i * channels] += (input[2 * i] * leftFactor + input[2 * i + 1] * rightFactor)
+						   * (gain + gainIncrement * static_cast< float >(i));
+	}
+}
+
+void addMonoToStereo(float *output, const float *input, unsigned int frames, float leftGain, float rightGain) {
+	unsigned int i = 0;
+
+#if defined(MIX_USE_SSE)
+	const __m128 gains = _mm_set_ps(rightGain, leftGain, rightGain, leftGain);
+	for (; i + 4 <= frames; i += 4) {
+		// Duplicate each sample into an LR pair
+		const __m128 samples = _mm_loadu_ps(input + i);
+		const __m128 low     = _mm_unpacklo_ps(samples, samples);
+		const __m128 high    = _mm_unpackhi_ps(samples, samples);
+
+		_mm_storeu_ps(output + 2 * i, _mm_add_ps(_mm_loadu_ps(output + 2 * i), _mm_mul_ps(low, gains)));
+		_mm_storeu_ps(output + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(output + 2 * i + 4), _mm_mul_ps(high, gains)));
+	}
+#elif defined(MIX_USE_NEON)
+	for (; i + 4 <= frames; i += 4) {
+		const float32x4_t samples = vld1q_f32(input + i);
+
+		float32x4x2_t frame = vld2q_f32(output + 2 * i);
+		frame.val[0]        = vaddq_f32(frame.val[0], vmulq_n_f32(samples, leftGain));
+		frame.val[1]        = vaddq_f32(frame.val[1], vmulq_n_f32(samples, rightGain));
+		vst2q_f32(output + 2 * i, frame);
+	}
+#endif
+
+	for (; i < frames; ++i) {
+		output[2 * i] += input[i] * leftGain;
+		output[2 * i + 1] += input[i] * rightGain;
+	}
+}
+
+void addStereoToStereo(float *output, const float *input, unsigned int frames, const float matrix[4]) {
+	unsigned int i = 0;
+
+#if defined(MIX_USE_SSE)
+	// out = LR * (leftFromLeft, rightFromRight) + RL * (leftFromRight, rightFromLeft)
+	const __m128 direct  = _mm_set_ps(matrix[3], matrix[0], matrix[3], matrix[0]);
+	const __m128 crossed = _mm_set_ps(matrix[2], matrix[1], matrix[2], matrix[1]);
+	for (; i + 2 <= frames; i += 2) {
+		const __m128 samples = _mm_loadu_ps(input + 2 * i);
+		const __m128 swapped = _mm_shuffle_ps(samples, samples, _MM_SHUFFLE(2, 3, 0, 1));
+
+		const __m128 mixed = _mm_add_ps(_mm_mul_ps(samples, direct), _mm_mul_ps(swapped, crossed));
+		_mm_storeu_ps(output + 2 * i, _mm_add_ps(_mm_loadu_ps(output + 2 * i), mixed));
+	}
+#elif defined(MIX_USE_NEON)
+	for (; i + 4 <= frames; i += 4) {
+		const float32x4x2_t samples = vld2q_f32(input + 2 * i);
+
+		float32x4x2_t frame = vld2q_f32(output + 2 * i);
+		frame.val[0] = vaddq_f32(frame.val[0], vaddq_f32(vmulq_n_f32(samples.val[0], matrix[0]),
+														 vmulq_n_f32(samples.val[1], matrix[1])));
+		frame.val[1] = vaddq_f32(frame.val[1], vaddq_f32(vmulq_n_f32(samples.val[0], matrix[2]),
+														 vmulq_n_f32(samples.val[1], matrix[3])));
+		vst2q_f32(output + 2 * i, frame);
+	}
+#endif
+
+	for (; i < frames; ++i) {
+		const float left  = input[2 * i];
+		const float right = input[2 * i + 1];
+
+		output[2 * i] += left * matrix[0] + right * matrix[1];
+		output[2 * i + 1] += left * matrix[2] + right * matrix[3];
+	}
+}
+
+void clip(float *buffer, unsigned int samples) {
+	unsigned int i = 0;
+
+#if defined(MIX_USE_SSE)
+	const __m128 lower = _mm_set1_ps(-1.0f);
+	const __m128 upper = _mm_set1_ps(1.0f);
+	for (; i + 4 <= samples; i += 4) {
+		_mm_storeu_ps(buffer + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(buffer + i), lower), upper));
+	}
+#elif defined(MIX_USE_NEON)
+	const float32x4_t lower = vdupq_n_f32(-1.0f);
+	const float32x4_t upper = vdupq_n_f32(1.0f);
+	for (; i + 4 <= samples; i += 4) {
+		vst1q_f32(buffer + i, vminq_f32(vmaxq_f32(vld1q_f32(buffer + i), lower), upper));
+	}
+#endif
+
+	for (; i < samples; ++i) {
+		buffer[i] = std::min(std::max(buffer[i], -1.0f), 1.0f);
+	}
+}
+
+void convertToShort(short *output, const float *input, unsigned int samples) {
+	unsigned int i = 0;
+
+#if defined(MIX_USE_SSE)
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	const __m128 lower = _mm_set1_ps(-32768.0f);
+	const __m128 upper = _mm_set1_ps(32767.0f);
+	for (; i + 8 <= samples; i += 8) {
+		const __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i), scale), lower), upper);
+		const __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale), lower), upper);
+
+		// Truncate (just like a static_cast) and pack into 16 bit integers
+		const __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+		_mm_storeu_si128(reinterpret_cast< __m128i * >(output + i), packed);
+	}
+#elif defined(MIX_USE_NEON)
+	const float32x4_t lower = vdupq_n_f32(-32768.0f);
+	const float32x4_t upper = vdupq_n_f32(32767.0f);
+	for (; i + 4 <= samples; i += 4) {
+		const float32x4_t scaled = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(input + i), 32768.0f), lower), upper);
+
+		// vcvtq_s32_f32 truncates (just like a static_cast)
+		vst1_s16(output + i, vmovn_s32(vcvtq_s32_f32(scaled)));
+	}
+#endif
+
+	for (; i < samples; ++i) {
+		output[i] = static_cast< short >(std::min(std::max(input[i] * 32768.0f, -32768.0f), 32767.0f));
+	}
+}
+
+}; // namespace AudioMixKernels
@@ -0,0 +1,36 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_AUDIOMIXKERNELS_H_
+#define MUMBLE_MUMBLE_AUDIOMIXKERNELS_H_
+
+/// The inner loops of AudioOutput::mix. They operate on interleaved float buffers, never allocate and use SIMD
+/// instructions (SSE or NEON) where available. Wherever a gain ramps from gain to gain + frames * gainIncrement, the
+/// gain applied to frame i is gain + gainIncrement * i.
+namespace AudioMixKernels {
+/// Adds a mono source to the given channel of an interleaved output
+void addMono(float *output, unsigned int channels, unsigned int channel, const float *input, unsigned int frames,
+			 float gain, float gainIncrement);
+
+/// Adds a stereo source to the given channel of an interleaved output. Each frame contributes
+/// (left * leftFactor + right * rightFactor) multiplied with the (ramped) gain.
+void addStereo(float *output, unsigned int channels, unsigned int channel, const float *input, unsigned int frames,
+			   float leftFactor, float rightFactor, float gain, float gainIncrement);
+
+/// Adds a mono source to both channels of a stereo output
+void addMonoToStereo(float *output, const float *input, unsigned int frames, float leftGain, float rightGain);
+
+/// Adds a stereo source to a stereo output. The given matrix { leftFromLeft, leftFromRight, rightFromLeft,
+/// rightFromRight } determines how the source's channels contribute to the output's channels.
+void addStereoToStereo(float *output, const float *input, unsigned int frames, const float matrix[4]);
+
+/// Clips all samples to [-1, 1]
+void clip(float *buffer, unsigned int samples);
+
+/// Converts the given samples (nominally in [-1, 1]) to 16 bit integers, clipping them in the process
+void convertToShort(short *output, const float *input, unsigned int samples);
+}; // namespace AudioMixKernels
+
+#endif // MUMBLE_MUMBLE_AUDIOMIXKERNELS_H_
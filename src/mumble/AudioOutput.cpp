@@ -6,6 +6,7 @@
 #include "AudioOutput.h"
 
 #include "AudioInput.h"
+#include "AudioMixKernels.h"
 #include "AudioOutputSample.h"
 #include "AudioOutputSpeech.h"
 #include "Channel.h"
@@ -18,7 +19,6 @@
 #include "Utils.h"
 #include "VoiceRecorder.h"
 #include "Global.h"
-#include "MainWindow.h"
 
 #include <cmath>
 
@@ -78,10 +78,14 @@ bool AudioOutputRegistrar::canExclusive() const {
 	return false;
 }
 
+AudioOutput::AudioOutput() : m_decoder([this](AudioOutputSpeech *speech) { deleteFinished(speech); }) {
+}
+
 AudioOutput::~AudioOutput() {
 	bRunning = false;
 	wait();
 	wipe();
+	m_decoder.stop();
 
 	delete[] fSpeakers;
 	delete[] fSpeakerVolume;
@@ -129,8 +133,24 @@ float AudioOutput::calcGain(float dotproduct, float distance) {
 }
 
 void AudioOutput::wipe() {
-	foreach (AudioOutputUser *aop, qmOutputs)
-		removeBuffer(aop);
+	// One source at a time, as qrwlOutputs can't be held while waiting for the decoder
+	while (true) {
+		AudioOutputUser *aop = nullptr;
+		bool owned           = false;
+		{
+			QWriteLocker locker(&qrwlOutputs);
+			if (qmOutputs.isEmpty()) {
+				return;
+			}
+
+			aop   = qmOutputs.begin().value();
+			owned = takeBuffer(aop);
+		}
+
+		if (owned) {
+			destroyBuffer(aop);
+		}
+	}
 }
 
 const float *AudioOutput::getSpeakerPos(unsigned int &speakers) {
@@ -152,10 +172,13 @@ void AudioOutput::addFrameToBuffer(ClientUser *sender, const Mumble::Protocol::A
 	// removed from this map.
 	AudioOutputSpeech *aop = qobject_cast< AudioOutputSpeech * >(qmOutputs.value(sender));
 
-	if (!aop || (aop->m_codec != audioData.usedCodec)) {
+	// A stream that has been played to its end only waits for the decoder to delete it, so new audio needs a new one.
+	// It is simply replaced below, as the decoder deletes it whenever it gets to it.
+	const bool finished = aop && aop->m_finished.load(std::memory_order_relaxed);
+	if (!aop || finished || (aop->m_codec != audioData.usedCodec)) {
 		qrwlOutputs.unlock();
 
-		if (aop) {
+		if (aop && !finished) {
 			removeBuffer(aop);
 		}
 
@@ -167,10 +190,20 @@ void AudioOutput::addFrameToBuffer(ClientUser *sender, const Mumble::Protocol::A
 			return;
 		}
 
-		qrwlOutputs.lockForWrite();
-
+		// Nobody else knows about the new source until it is published, so it doesn't need qrwlOutputs before that
 		aop = new AudioOutputSpeech(sender, iMixerFreq, audioData.usedCodec, iBufferSize);
+		aop->addFrameToBuffer(audioData);
+
+		// The local loopback feeds its packets from within the decoding and has to stay in step with the mixer, so it
+		// is decoded by the mixer itself
+		if (sender != &LoopUser::lpLoopy) {
+			m_decoder.add(aop);
+		}
+
+		QWriteLocker locker(&qrwlOutputs);
 		qmOutputs.replace(sender, aop);
+
+		return;
 	}
 
 	aop->addFrameToBuffer(audioData);
@@ -179,19 +212,66 @@ void AudioOutput::addFrameToBuffer(ClientUser *sender, const Mumble::Protocol::A
 }
 
 void AudioOutput::removeBuffer(const ClientUser *user) {
-	removeBuffer(qmOutputs.value(user));
+	AudioOutputUser *aop = nullptr;
+	{
+		QWriteLocker locker(&qrwlOutputs);
+		aop = qmOutputs.value(user);
+		if (!aop || !takeBuffer(aop)) {
+			return;
+		}
+	}
+
+	destroyBuffer(aop);
 }
 
 void AudioOutput::removeBuffer(AudioOutputUser *aop) {
-	QWriteLocker locker(&qrwlOutputs);
+	{
+		QWriteLocker locker(&qrwlOutputs);
+		if (!takeBuffer(aop)) {
+			return;
+		}
+	}
+
+	destroyBuffer(aop);
+}
+
+bool AudioOutput::takeBuffer(AudioOutputUser *aop) {
 	QMultiHash< const ClientUser *, AudioOutputUser * >::iterator i;
 	for (i = qmOutputs.begin(); i != qmOutputs.end(); ++i) {
 		if (i.value() == aop) {
 			qmOutputs.erase(i);
-			delete aop;
-			break;
+
+			// A stream that has been played to its end belongs to the decoder, which deletes it at any time
+			AudioOutputSpeech *speech = qobject_cast< AudioOutputSpeech * >(aop);
+			return !(speech && speech->m_finished.load(std::memory_order_relaxed));
+		}
+	}
+
+	return false;
+}
+
+void AudioOutput::destroyBuffer(AudioOutputUser *aop) {
+	// The decoder may still be working on it. This is waited for without holding qrwlOutputs, so that mix() isn't
+	// kept waiting as well.
+	m_decoder.remove(aop);
+
+	delete aop;
+}
+
+void AudioOutput::deleteFinished(AudioOutputSpeech *speech) {
+	{
+		// Nobody else deletes a stream that has been played to its end, but it may have been replaced or taken already
+		QWriteLocker locker(&qrwlOutputs);
+		QMultiHash< const ClientUser *, AudioOutputUser * >::iterator i;
+		for (i = qmOutputs.begin(); i != qmOutputs.end(); ++i) {
+			if (i.value() == speech) {
+				qmOutputs.erase(i);
+				break;
+			}
 		}
 	}
+
+	delete speech;
 }
 
 AudioOutputSample *AudioOutput::playSample(const QString &filename, float volume, bool loop) {
@@ -239,6 +319,10 @@ void AudioOutput::initializeMixer(const unsigned int *chanmasks, bool forceheadp
 	for (unsigned int i = 0; i < iChannels; ++i)
 		fSpeakerVolume[i] = 1.0f;
 
+	// Make room for a reasonable number of simultaneous sources up front so that mix() doesn't have to allocate
+	m_mixSources.reserve(64);
+	m_finishedSources.reserve(64);
+
 	if (iChannels > 1) {
 		for (unsigned int i = 0; i < iChannels; i++) {
 			float *s              = &fSpeakers[3 * i];
@@ -347,6 +431,10 @@ void AudioOutput::initializeMixer(const unsigned int *chanmasks, bool forceheadp
 	iSampleSize = static_cast< int >(iChannels * ((eSampleFormat == SampleFloat) ? sizeof(float) : sizeof(short)));
 	qWarning("AudioOutput: Initialized %d channel %d hz mixer", iChannels, iMixerFreq);
 
+	if (!m_decoder.isRunning()) {
+		m_decoder.start(QThread::HighPriority);
+	}
+
 	if (Global::get().s.bPositionalAudio && iChannels == 1) {
 		Global::get().l->logOrDefer(Log::Warning, tr("Positional audio cannot work with mono output devices!"));
 	}
@@ -357,10 +445,8 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 	positions.clear();
 #endif
 
-	// A list of users that have audio to contribute
-	QList< AudioOutputUser * > qlMix;
-	// A list of users that no longer have any audio to play and can thus be deleted
-	QList< AudioOutputUser * > qlDel;
+	m_mixSources.clear();
+	m_finishedSources.clear();
 
 	if (Global::get().s.fVolume < 0.01f) {
 		return false;
@@ -384,11 +470,16 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 	while (it != qmOutputs.constEnd()) {
 		AudioOutputUser *aop = it.value();
 		if (!aop->prepareSampleBuffer(frameCount)) {
-			qlDel.append(aop);
+			m_finishedSources.push_back(aop);
 		} else {
-			qlMix.append(aop);
-
-			const ClientUser *user = it.key();	
+			MixSource source;
+			source.aop    = aop;
+			source.speech = qobject_cast< AudioOutputSpeech * >(aop);
+			source.sample = source.speech ? nullptr : qobject_cast< AudioOutputSample * >(aop);
+			source.user   = source.speech ? source.speech->p : nullptr;
+			m_mixSources.push_back(source);
+
+			const ClientUser *user = it.key();
 			if (user && user->bPrioritySpeaker) {
 				prioritySpeakerActive = true;
 			}
@@ -406,18 +497,23 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 	float *output = (eSampleFormat == SampleFloat) ? reinterpret_cast< float * >(outbuff) : fOutput;
 	memset(output, 0, sizeof(float) * frameCount * iChannels);
 
-	if (!qlMix.isEmpty()) {
+	if (!m_mixSources.empty()) {
 		// There are audio sources available -> mix those sources together and feed them into the audio backend
 		STACKVAR(float, speaker, iChannels * 3);
 		STACKVAR(float, svol, iChannels);
+		// The per-channel gain of the current non-positional source
+		STACKVAR(float, gain, iChannels);
 
 		bool validListener = false;
 
-		// Initialize recorder if recording is enabled
+		// Initialize recorder if recording is enabled. The recorder takes ownership of every buffer handed to it, so
+		// outside of mix-down mode a buffer is only allocated once a speaking user actually needs one.
 		boost::shared_array< float > recbuff;
 		if (recorder) {
-			recbuff = boost::shared_array< float >(new float[frameCount]);
-			memset(recbuff.get(), 0, sizeof(float) * frameCount);
+			if (recorder->isInMixDownMode()) {
+				recbuff = boost::shared_array< float >(new float[frameCount]);
+				memset(recbuff.get(), 0, sizeof(float) * frameCount);
+			}
 			recorder->prepareBufferAdds();
 		}
 
@@ -493,19 +589,23 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 		}
 
 
-		foreach (AudioOutputUser *aop, qlMix) {
+		// Received transmissions are run through the radio effect before being mixed
+		const RadioEffect::Parameters radioParameters = RadioEffect::parameters();
+		m_radioEffect.prepare(radioParameters, SAMPLE_RATE);
+
+		for (const MixSource &source : m_mixSources) {
 			// Iterate through all audio sources and mix them together into the output (or the intermediate array)
+			AudioOutputUser *aop     = source.aop;
 			float *RESTRICT pfBuffer = aop->pfBuffer;
 			float volumeAdjustment   = 1;
+			float radioPan           = 0.0f;
 
 			// Check if the audio source is a user speaking or a sample playback and apply potential volume
 			// adjustments
-			AudioOutputSpeech *speech = qobject_cast< AudioOutputSpeech * >(aop);
-			AudioOutputSample *sample = qobject_cast< AudioOutputSample * >(aop);
-			const ClientUser *user    = nullptr;
+			AudioOutputSpeech *speech = source.speech;
+			AudioOutputSample *sample = source.sample;
+			const ClientUser *user    = source.user;
 			if (speech) {
-				user = speech->p;
-
 				volumeAdjustment *= user->getLocalVolumeAdjustments();
 
 				if (sh && sh->m_version >= Mumble::Protocol::PROTOBUF_INTRODUCTION_VERSION) {
@@ -525,6 +625,15 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 											.factor;
 				}
 
+				// Radio transmissions are levelled and panned according to the COM they have been received on
+				if (speech->m_audioContext == Mumble::Protocol::AudioContext::RADIO_COM1) {
+					volumeAdjustment *= Global::get().s.fCom1Volume;
+					radioPan = Global::get().s.fCom1Pan;
+				} else if (speech->m_audioContext == Mumble::Protocol::AudioContext::RADIO_COM2) {
+					volumeAdjustment *= Global::get().s.fCom2Volume;
+					radioPan = Global::get().s.fCom2Pan;
+				}
+
 				if (prioritySpeakerActive) {
 					if (user->tsState != Settings::Whispering && !user->bPrioritySpeaker) {
 						volumeAdjustment *= adjustFactor;
@@ -542,6 +651,11 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 			// If recording is enabled add the current audio source to the recording buffer
 			if (recorder) {
 				if (speech) {
+					if (!recbuff) {
+						recbuff = boost::shared_array< float >(new float[frameCount]);
+						memset(recbuff.get(), 0, sizeof(float) * frameCount);
+					}
+
 					if (speech->bStereo) {
 						// Mix down stereo to mono. TODO: stereo record support
 						// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
@@ -556,8 +670,7 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 
 					if (!recorder->isInMixDownMode()) {
 						recorder->addBuffer(speech->p, recbuff, frameCount);
-						recbuff = boost::shared_array< float >(new float[frameCount]);
-						memset(recbuff.get(), 0, sizeof(float) * frameCount);
+						recbuff.reset();
 					}
 
 					// Don't add the local audio to the real output
@@ -567,12 +680,15 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 				}
 			}
 
+			if (speech && radioParameters.enabled) {
+				m_radioEffect.process(speech->m_radioState, pfBuffer, frameCount,
+									  static_cast< unsigned int >(channels));
+			}
+
 			if (validListener && ((aop->fPos[0] != 0.0f) || (aop->fPos[1] != 0.0f) || (aop->fPos[2] != 0.0f))) {
 				// Add position to position map
-				AudioOutputSpeech *speech = qobject_cast< AudioOutputSpeech * >(aop);
 #ifdef USE_MANUAL_PLUGIN
 				if (speech) {
-					const ClientUser *user = speech->p;
 					// The coordinates in the plane are actually given by x and z instead of x and y (y is up)
 					positions.insert(user->uiSession, { aop->fPos[0], aop->fPos[2] });
 				}
@@ -644,16 +760,26 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 					   speaker[s*3+1], speaker[s*3+2], dot, len, str);
 					*/
 					if ((old >= 0.00000001f) || (str >= 0.00000001f)) {
-						for (unsigned int i = 0; i < frameCount; ++i) {
-							unsigned int currentOffset = oldOffset + incOffset * i;
+						if (offset == oldOffset) {
+							// The ITD offset is steady, so this is a plain gain ramp
 							if (speech && speech->bStereo) {
-								// Mix stereo user's stream into mono
-								// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
-								o[i * nchan] +=
-									(pfBuffer[2 * i + currentOffset] / 2.0 + pfBuffer[2 * i + currentOffset + 1] / 2.0)
-									* (old + inc * static_cast< float >(i));
+								AudioMixKernels::addStereo(output, nchan, s, pfBuffer + offset, frameCount, 0.5f,
+														   0.5f, old, inc);
 							} else {
-								o[i * nchan] += pfBuffer[i + currentOffset] * (old + inc * static_cast< float >(i));
+								AudioMixKernels::addMono(output, nchan, s, pfBuffer + offset, frameCount, old, inc);
+							}
+						} else {
+							for (unsigned int i = 0; i < frameCount; ++i) {
+								unsigned int currentOffset = oldOffset + incOffset * i;
+								if (speech && speech->bStereo) {
+									// Mix stereo user's stream into mono
+									// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
+									o[i * nchan] += (pfBuffer[2 * i + currentOffset] / 2.0
+													 + pfBuffer[2 * i + currentOffset + 1] / 2.0)
+													* (old + inc * static_cast< float >(i));
+								} else {
+									o[i * nchan] += pfBuffer[i + currentOffset] * (old + inc * static_cast< float >(i));
+								}
 							}
 						}
 					}
@@ -662,19 +788,37 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 				// Mix the current audio source into the output by adding it to the elements of the output buffer after
 				// having applied a volume adjustment
 				for (unsigned int s = 0; s < nchan; ++s) {
-					const float str   = svol[s] * volumeAdjustment;
-					float *RESTRICT o = output + s;
+					// Pan by attenuating the speakers on the side opposite to the pan direction (left speakers have
+					// a negative x coordinate)
+					const float panGain =
+						radioPan != 0.0f ? qBound(0.0f, 1.0f + radioPan * fSpeakers[3 * s + 0], 1.0f) : 1.0f;
+
+					gain[s] = svol[s] * volumeAdjustment * panGain;
+				}
+
+				// Linear-panning stereo stream according to the projection of fSpeaker vector on left-right
+				// direction.
+				// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
+				if (nchan == 2) {
+					// Stereo output is by far the most common case and has dedicated kernels that handle both
+					// channels at once
 					if (aop->bStereo) {
-						// Linear-panning stereo stream according to the projection of fSpeaker vector on left-right
-						// direction.
-						// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
-						for (unsigned int i = 0; i < frameCount; ++i)
-							o[i * nchan] += (pfBuffer[2 * i] * fStereoPanningFactor[2 * s + 0]
-											 + pfBuffer[2 * i + 1] * fStereoPanningFactor[2 * s + 1])
-											* str;
+						const float matrix[4] = { fStereoPanningFactor[0] * gain[0], fStereoPanningFactor[1] * gain[0],
+												  fStereoPanningFactor[2] * gain[1],
+												  fStereoPanningFactor[3] * gain[1] };
+						AudioMixKernels::addStereoToStereo(output, pfBuffer, frameCount, matrix);
 					} else {
-						for (unsigned int i = 0; i < frameCount; ++i)
-							o[i * nchan] += pfBuffer[i] * str;
+						AudioMixKernels::addMonoToStereo(output, pfBuffer, frameCount, gain[0], gain[1]);
+					}
+				} else {
+					for (unsigned int s = 0; s < nchan; ++s) {
+						if (aop->bStereo) {
+							AudioMixKernels::addStereo(output, nchan, s, pfBuffer, frameCount,
+													   fStereoPanningFactor[2 * s + 0], fStereoPanningFactor[2 * s + 1],
+													   gain[s], 0.0f);
+						} else {
+							AudioMixKernels::addMono(output, nchan, s, pfBuffer, frameCount, gain[s], 0.0f);
+						}
 					}
 				}
 			}
@@ -683,80 +827,11 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 		if (recorder && recorder->isInMixDownMode()) {
 			recorder->addBuffer(nullptr, recbuff, frameCount);
 		}
-	}
-	//=============================ߵЧ========================
-	if (Global::get().mw->qcbRadioEffect->isChecked()) {
-		//=============================Ա=============================
-		double distortion = 0.62;
-		if (eSampleFormat == SampleFloat) {
-			for (unsigned int s = 0; s < frameCount * iChannels; ++s) {
-				float x = output[s];
-				x       = (x > 0) ? pow(x, distortion) : -pow(-x, distortion); // Nonlinear distortion
-				if (x > 1.0f) {
-					x = 1.0f;
-				} else if (x < -1.0f) {
-					x = -1.0f;
-				}
-				output[s] = x;
-			}
-		} else if (eSampleFormat == SampleShort) {
-			for (unsigned int s = 0; s < frameCount * iChannels; ++s) {
-				float x   = output[s] / 32768.0f;                  // Convert to float and normalize to [-1, 1]
-				x         = (x > 0) ? pow(x, distortion) : -pow(-x, distortion); // Nonlinear distortion
-				output[s] = (short) (x * 32767.0f);                // Convert back to short
-			}
-		}
-		//=============================Ա=============================
-		//==========================================================
-		for (unsigned int s = 0; s < frameCount * iChannels; ++s) {
-			output[s] += (rand() / (float) RAND_MAX) * 0.0080f-0.0040f;
-		}
-		//==========================================================
-	}
-	//=============================ض=============================
-	if (eSampleFormat == SampleFloat) {
-		for (unsigned int s = 0; s < frameCount * iChannels; ++s) {
-			if (output[s] > 1.0f) {
-				output[s] = 1.0f;
-			} else if (output[s] < -1.0f) {
-				output[s] = -1.0f;
-			}
-		}
-	} else if (eSampleFormat == SampleShort) {
-		for (unsigned int s = 0; s < frameCount * iChannels; ++s) {
-			if (output[s] > SHRT_MAX) {
-				output[s] = SHRT_MAX;
-			} else if (output[s] < SHRT_MIN) {
-				output[s] = SHRT_MIN;
-			}
-		}
-	}
-	//=============================ض=============================
-	//====================Ч====================
-	if (qlMix.size() >= 2) {
-		float fFreq      = 100.0; // ཱུƵ
-		float fAmplitude = 0.8f; // ཱུķ
-		float fPhase     = 0.0f; // Ҳλ
-		for (unsigned int i = 0; i < frameCount * iChannels; i += 1) {
-			float fSample = output[i]; // ȡֵ
-
-			// ҲϵƵ
-			fSample += fAmplitude * sinf(fPhase);
-
-			// Ҳλ
-			fPhase += 2.0f * M_PI * fFreq / SAMPLE_RATE;
 
-			// ȷλ[0, 2*PI]֮
-			if (fPhase >= 2.0f * M_PI) {
-				fPhase -= 2.0f * M_PI;
-			}
-
-			// Ĳֵд
-			output[i] = fSample;
-			output[i] *= 0.8f;
-		}
+		// The static and the heterodyne of overlapping sources are part of what the mix sounds like
+		m_radioEffect.processMix(output, frameCount, nchan, static_cast< unsigned int >(m_mixSources.size()));
 	}
-	//====================Ч====================
+	//=============================ߵЧ========================
 	//====================TXԾ====================
 	if (Global::get().bTalking) {
 		for (unsigned int i = 0; i < frameCount * iChannels; i += 1) {
@@ -771,30 +846,41 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 	bool pluginModifiedAudio = false;
 	emit audioOutputAboutToPlay(output, frameCount, nchan, SAMPLE_RATE, &pluginModifiedAudio);
 
-	if (pluginModifiedAudio || (!qlMix.isEmpty())) {
+	if (pluginModifiedAudio || (!m_mixSources.empty())) {
 		// Clip the output audio
 		if (eSampleFormat == SampleFloat)
-			for (unsigned int i = 0; i < frameCount * iChannels; i++)
-				output[i] = qBound(-1.0f, output[i], 1.0f);
+			AudioMixKernels::clip(output, frameCount * iChannels);
 		else
 			// Also convert the intermediate float array into an array of shorts before writing it to the outbuff
-			for (unsigned int i = 0; i < frameCount * iChannels; i++)
-				reinterpret_cast< short * >(outbuff)[i] =
-					static_cast< short >(qBound(-32768.f, (output[i] * 32768.f), 32767.f));
+			AudioMixKernels::convertToShort(reinterpret_cast< short * >(outbuff), output, frameCount * iChannels);
+	}
+
+	// Speech decoded ahead that has been played to its end is left to the decoder, which may still be working on it
+	// and deletes it from then on. It is flagged while qrwlOutputs is still held, so that nobody else can have taken
+	// it in the meantime (see takeBuffer()).
+	for (AudioOutputUser *&aop : m_finishedSources) {
+		AudioOutputSpeech *speech = qobject_cast< AudioOutputSpeech * >(aop);
+		if (speech && speech->p != &LoopUser::lpLoopy) {
+			speech->m_finished.store(true, std::memory_order_relaxed);
+			aop = nullptr;
+		}
 	}
 
 	qrwlOutputs.unlock();
 
-	// Delete all AudioOutputUsers that no longer provide any new audio
-	foreach (AudioOutputUser *aop, qlDel)
-		removeBuffer(aop);
+	// Delete all other AudioOutputUsers that no longer provide any new audio
+	for (AudioOutputUser *aop : m_finishedSources) {
+		if (aop) {
+			removeBuffer(aop);
+		}
+	}
 
 #ifdef USE_MANUAL_PLUGIN
 	Manual::setSpeakerPositions(positions);
 #endif
 
 	// Return whether data has been written to the outbuff
-	return (pluginModifiedAudio || (!qlMix.isEmpty()));
+	return (pluginModifiedAudio || (!m_mixSources.empty()));
 }
 
 bool AudioOutput::isAlive() const {
@@ -10,8 +10,12 @@
 #include <QtCore/QThread>
 #include <boost/shared_ptr.hpp>
 
+#include <vector>
+
+#include "AudioOutputDecoder.h"
 #include "MumbleProtocol.h"
 #include "MainWindow.h"
+#include "RadioEffect.h"
 
 #ifdef USE_MANUAL_PLUGIN
 #	include "ManualPlugin.h"
@@ -50,6 +54,7 @@ class AudioOutput;
 class ClientUser;
 class AudioOutputUser;
 class AudioOutputSample;
+class AudioOutputSpeech;
 
 typedef boost::shared_ptr< AudioOutput > AudioOutputPtr;
 
@@ -87,6 +92,26 @@ private:
 	/// Used when panning stereo stream w.r.t. each speaker.
 	float *fStereoPanningFactor = nullptr;
 
+	/// An audio source that contributes to the current mix
+	struct MixSource {
+		AudioOutputUser *aop;
+		/// The source cast to its concrete type (only one of these is set)
+		AudioOutputSpeech *speech;
+		AudioOutputSample *sample;
+		const ClientUser *user;
+	};
+	/// The sources that have audio to contribute. The vectors are reused by every call to mix() in order to avoid
+	/// allocating memory on the audio thread.
+	std::vector< MixSource > m_mixSources;
+	/// The sources that no longer have any audio to play and can thus be deleted
+	std::vector< AudioOutputUser * > m_finishedSources;
+
+	/// Applied to every speech source while the radio effect is enabled
+	RadioEffect m_radioEffect;
+
+	/// Decodes the speech sources ahead of mix()
+	AudioOutputDecoder m_decoder;
+
 protected:
 	enum { SampleShort, SampleFloat } eSampleFormat = SampleFloat;
 	volatile bool bRunning                          = true;
@@ -103,6 +128,15 @@ protected:
 #endif
 
 	virtual void removeBuffer(AudioOutputUser *);
+	/// Removes the given source from qmOutputs, which must be locked for writing
+	///
+	/// @returns Whether the caller is to delete the source (see destroyBuffer()). Streams that have been played to
+	/// 	their end are deleted by m_decoder instead.
+	bool takeBuffer(AudioOutputUser *);
+	/// Deletes a source taken by takeBuffer() once m_decoder is done with it. qrwlOutputs must not be held.
+	void destroyBuffer(AudioOutputUser *);
+	/// Deletes a stream that has been played to its end. Only ever called by m_decoder, which is done with it.
+	void deleteFinished(AudioOutputSpeech *);
 	void initializeMixer(const unsigned int *chanmasks, bool forceheadphone = false);
 	bool mix(void *output, unsigned int frameCount);
 
@@ -113,7 +147,7 @@ public:
 	///
 	/// This constructor is only ever called by Audio::startOutput(), and is guaranteed
 	/// to be called on the application's main thread.
-	AudioOutput(){};
+	AudioOutput();
 
 	/// Destroy an AudioOutput.
 	///
@@ -0,0 +1,129 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioOutputCacheSlab.h"
+
+#include <cassert>
+
+AudioOutputCacheSlab::AudioOutputCacheSlab(std::size_t capacity)
+	: m_capacity(capacity < MAX_CAPACITY ? capacity : static_cast< std::size_t >(MAX_CAPACITY)),
+	  m_entries(new Entry[m_capacity]), m_freeList(0) {
+	// Chain all entries up in the free-list
+	for (std::size_t i = 0; i + 1 < m_capacity; ++i) {
+		m_entries[i].next.store(static_cast< std::uint32_t >(i + 1), std::memory_order_relaxed);
+	}
+
+	m_freeList.store(m_capacity > 0 ? 0 : END_OF_LIST, std::memory_order_release);
+}
+
+AudioOutputCacheSlab::Handle AudioOutputCacheSlab::store(const Mumble::Protocol::AudioData &audioData,
+														 const void *owner) {
+	const std::uint32_t index = pop();
+	if (index == END_OF_LIST) {
+		return INVALID_HANDLE;
+	}
+
+	// The entry is exclusively ours until the handle is passed on
+	Entry &entry = m_entries[index];
+	entry.cache.loadFrom(audioData);
+	entry.owner.store(owner, std::memory_order_relaxed);
+
+	m_size.fetch_add(1, std::memory_order_relaxed);
+
+	return makeHandle(index, entry.generation.load(std::memory_order_relaxed));
+}
+
+const AudioOutputCache *AudioOutputCacheSlab::get(Handle handle) const {
+	const std::uint32_t index = handle & INDEX_MASK;
+	if (index >= m_capacity) {
+		return nullptr;
+	}
+
+	const Entry &entry = m_entries[index];
+	if (entry.generation.load(std::memory_order_acquire) != (handle >> INDEX_BITS)) {
+		return nullptr;
+	}
+
+	return &entry.cache;
+}
+
+bool AudioOutputCacheSlab::release(Handle handle) {
+	const std::uint32_t index = handle & INDEX_MASK;
+	std::uint32_t generation  = handle >> INDEX_BITS;
+	if (index >= m_capacity || generation == 0) {
+		return false;
+	}
+
+	// Only one of several releases of the same handle gets to advance the generation and thus to free the entry
+	Entry &entry                 = m_entries[index];
+	const std::uint32_t advanced = generation == INDEX_MASK ? 1 : generation + 1;
+	if (!entry.generation.compare_exchange_strong(generation, advanced, std::memory_order_acq_rel)) {
+		return false;
+	}
+
+	entry.cache.clear();
+	entry.owner.store(nullptr, std::memory_order_relaxed);
+
+	m_size.fetch_sub(1, std::memory_order_relaxed);
+
+	push(index);
+
+	return true;
+}
+
+std::size_t AudioOutputCacheSlab::releaseAll(const void *owner) {
+	assert(owner);
+
+	std::size_t released = 0;
+	for (std::size_t i = 0; i < m_capacity; ++i) {
+		const Entry &entry = m_entries[i];
+		if (entry.owner.load(std::memory_order_acquire) != owner) {
+			continue;
+		}
+
+		const std::uint32_t generation = entry.generation.load(std::memory_order_acquire);
+		if (release(makeHandle(static_cast< std::uint32_t >(i), generation))) {
+			released++;
+		}
+	}
+
+	return released;
+}
+
+std::size_t AudioOutputCacheSlab::capacity() const {
+	return m_capacity;
+}
+
+std::size_t AudioOutputCacheSlab::size() const {
+	return m_size.load(std::memory_order_relaxed);
+}
+
+void AudioOutputCacheSlab::push(std::uint32_t index) {
+	std::uint64_t head = m_freeList.load(std::memory_order_relaxed);
+	std::uint64_t newHead;
+	// Release, so that whoever pops the entry next sees it cleared and linked
+	do {
+		m_entries[index].next.store(static_cast< std::uint32_t >(head), std::memory_order_relaxed);
+		newHead = (((head >> 32) + 1) << 32) | index;
+	} while (!m_freeList.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+std::uint32_t AudioOutputCacheSlab::pop() {
+	std::uint64_t head = m_freeList.load(std::memory_order_acquire);
+	while (true) {
+		const std::uint32_t index = static_cast< std::uint32_t >(head);
+		if (index == END_OF_LIST) {
+			return END_OF_LIST;
+		}
+
+		// If the entry has been popped by someone else in the meantime, this reads a stale link. The counter in the
+		// head makes the exchange fail in that case.
+		const std::uint32_t next    = m_entries[index].next.load(std::memory_order_relaxed);
+		const std::uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+		if (m_freeList.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+			return index;
+		}
+	}
+}
@@ -0,0 +1,94 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_AUDIOOUTPUTCACHESLAB_H_
+#define MUMBLE_MUMBLE_AUDIOOUTPUTCACHESLAB_H_
+
+#include "AudioOutputCache.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// A fixed number of AudioOutputCache entries, allocated up front and shared by all speech streams. Entries are taken
+/// and returned through a lock-free free-list, so that the threads storing received packets and the threads decoding
+/// them never wait for each other.
+///
+/// Entries are referred to by handles, which combine the index of an entry with its generation. The generation changes
+/// whenever an entry is released, so handles outliving their entry are detected as stale instead of referring to
+/// whatever packet the entry holds next. Handles are never 0, so that they can be stored in place of the data pointer
+/// of a speex jitter buffer packet (which considers packets with a null pointer to be empty).
+class AudioOutputCacheSlab {
+public:
+	using Handle = std::uint32_t;
+
+	static constexpr Handle INVALID_HANDLE = 0;
+	/// The largest possible capacity, limited by the bits of a handle reserved for the index
+	static constexpr std::size_t MAX_CAPACITY = 0xFFFF;
+
+	explicit AudioOutputCacheSlab(std::size_t capacity);
+
+	/// Copies the given audio data into a free entry. May be called from any thread.
+	///
+	/// @param owner The stream the entry belongs to (see releaseAll())
+	/// @returns The handle of the entry or INVALID_HANDLE if all entries are in use
+	Handle store(const Mumble::Protocol::AudioData &audioData, const void *owner);
+
+	/// @returns The entry the handle refers to or nullptr if the handle is stale. The entry stays valid until it is
+	/// released, which is up to whoever holds the handle.
+	const AudioOutputCache *get(Handle handle) const;
+
+	/// Returns the entry to the free-list. May be called from any thread.
+	///
+	/// @returns Whether the entry has been released. Releasing a stale handle has no effect.
+	bool release(Handle handle);
+
+	/// Releases all entries of the given stream. Covers entries that are lost track of, such as packets that a speex
+	/// jitter buffer drops for being too late without passing them to its destroy callback.
+	///
+	/// No other thread may store or release entries of the stream while it is called.
+	///
+	/// @returns The number of entries that have been released
+	std::size_t releaseAll(const void *owner);
+
+	std::size_t capacity() const;
+	/// @returns The number of entries in use
+	std::size_t size() const;
+
+private:
+	static constexpr unsigned int INDEX_BITS   = 16;
+	static constexpr std::uint32_t INDEX_MASK  = (1u << INDEX_BITS) - 1;
+	static constexpr std::uint32_t END_OF_LIST = 0xFFFFFFFF;
+
+	struct Entry {
+		AudioOutputCache cache;
+		/// The generation of the handle currently referring to the entry, in the range [1, INDEX_MASK]
+		std::atomic< std::uint32_t > generation = { 1 };
+		/// The stream the entry is in use by or nullptr if it is free
+		std::atomic< const void * > owner = { nullptr };
+		/// The index of the next free entry while the entry is on the free-list
+		std::atomic< std::uint32_t > next = { END_OF_LIST };
+	};
+
+	static Handle makeHandle(std::uint32_t index, std::uint32_t generation) {
+		return (generation << INDEX_BITS) | index;
+	}
+
+	/// Pushes the entry to the free-list
+	void push(std::uint32_t index);
+	/// @returns The index of the entry popped from the free-list or END_OF_LIST if it is empty
+	std::uint32_t pop();
+
+	const std::size_t m_capacity;
+	std::unique_ptr< Entry[] > m_entries;
+
+	/// The index of the first free entry in the lower 32 bits. The upper ones count the changes to the free-list, so
+	/// that a compare-exchange fails if the head has been popped and pushed again in the meantime (ABA problem).
+	std::atomic< std::uint64_t > m_freeList;
+	std::atomic< std::size_t > m_size = { 0 };
+};
+
+#endif // MUMBLE_MUMBLE_AUDIOOUTPUTCACHESLAB_H_
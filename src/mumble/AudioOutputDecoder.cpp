@@ -0,0 +1,133 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioOutputDecoder.h"
+
+#include "AudioOutputSpeech.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+AudioOutputDecoder::AudioOutputDecoder(std::function< void(AudioOutputSpeech *) > removeFinished)
+	: QThread(), m_removeFinished(std::move(removeFinished)) {
+}
+
+AudioOutputDecoder::~AudioOutputDecoder() {
+	stop();
+}
+
+void AudioOutputDecoder::add(AudioOutputSpeech *speech) {
+	std::shared_ptr< Source > source = std::make_shared< Source >(speech);
+
+	QMutexLocker lock(&m_sourcesMutex);
+
+	m_sources.push_back(std::move(source));
+	m_wakeCondition.wakeAll();
+}
+
+void AudioOutputDecoder::remove(const AudioOutputUser *source) {
+	std::shared_ptr< Source > removed;
+	{
+		QMutexLocker lock(&m_sourcesMutex);
+
+		// The source is forgotten before it can be deleted, so that a new source at the same address is never mistaken
+		// for it
+		auto it = std::find_if(m_sources.begin(), m_sources.end(),
+							   [source](const std::shared_ptr< Source > &entry) { return entry->speech == source; });
+		if (it == m_sources.end()) {
+			return;
+		}
+
+		removed = std::move(*it);
+		m_sources.erase(it);
+	}
+
+	// The worker marks the source as in use before it checks whether it has been removed, and this is the other way
+	// around. As both happen in a single total order, either the worker leaves the source alone or this waits for it.
+	removed->removed.store(true, std::memory_order_seq_cst);
+	while (removed->inUse.load(std::memory_order_seq_cst)) {
+		std::this_thread::yield();
+	}
+}
+
+void AudioOutputDecoder::stop() {
+	{
+		QMutexLocker lock(&m_sourcesMutex);
+
+		m_running = false;
+		m_wakeCondition.wakeAll();
+	}
+
+	wait();
+
+	std::vector< std::shared_ptr< Source > > sources;
+	{
+		QMutexLocker lock(&m_sourcesMutex);
+		sources.swap(m_sources);
+	}
+
+	// Finished sources the worker hasn't got to anymore are up to us
+	for (const std::shared_ptr< Source > &source : sources) {
+		if (source->speech->m_finished.load(std::memory_order_relaxed)) {
+			m_removeFinished(source->speech);
+		}
+	}
+}
+
+void AudioOutputDecoder::run() {
+	QMutexLocker lock(&m_sourcesMutex);
+
+	while (m_running) {
+		// Copying reuses the snapshot's memory, so it only allocates if there are more sources than ever before
+		m_snapshot = m_sources;
+
+		lock.unlock();
+
+		for (const std::shared_ptr< Source > &source : m_snapshot) {
+			source->inUse.store(true, std::memory_order_seq_cst);
+
+			if (!source->removed.load(std::memory_order_seq_cst)) {
+				if (source->speech->m_finished.load(std::memory_order_relaxed)) {
+					// Nobody else removes a finished source, so it doesn't have to be waited for
+					source->removed.store(true, std::memory_order_relaxed);
+					m_finished.push_back(source->speech);
+				} else {
+					source->speech->decodeAhead();
+				}
+			}
+
+			source->inUse.store(false, std::memory_order_release);
+		}
+		m_snapshot.clear();
+
+		lock.relock();
+
+		if (!m_finished.empty()) {
+			// As in remove(), the finished sources are forgotten before they are deleted
+			m_sources.erase(std::remove_if(m_sources.begin(), m_sources.end(),
+										   [](const std::shared_ptr< Source > &source) {
+											   return source->removed.load(std::memory_order_relaxed);
+										   }),
+							m_sources.end());
+
+			lock.unlock();
+
+			for (AudioOutputSpeech *speech : m_finished) {
+				m_removeFinished(speech);
+			}
+			m_finished.clear();
+
+			lock.relock();
+		}
+
+		// Waiting releases the mutex, so that sources can be added and removed in the meantime
+		if (m_sources.empty()) {
+			m_wakeCondition.wait(&m_sourcesMutex);
+		} else {
+			m_wakeCondition.wait(&m_sourcesMutex, REFILL_INTERVAL_MS);
+		}
+	}
+}
@@ -0,0 +1,82 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_AUDIOOUTPUTDECODER_H_
+#define MUMBLE_MUMBLE_AUDIOOUTPUTDECODER_H_
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class AudioOutputSpeech;
+class AudioOutputUser;
+
+/// Decodes the received speech ahead of the mixer on a thread of its own, so that the audio callback only has to copy
+/// and mix the decoded frames (see AudioOutputSpeech::decodeAhead()). Should the worker fall behind, the mixer decodes
+/// the missing frames itself.
+///
+/// The worker decodes a snapshot of the sources without holding any lock, so adding and removing sources never waits
+/// for a decoding pass. Removing a source only waits for the worker to finish the source itself, should it be decoding
+/// it right then. Sources the mixer has played to their end (see AudioOutputSpeech::m_finished) belong to the worker
+/// from then on: it is the only one to remove and delete them, so that the audio callback doesn't wait for it at all
+/// and nobody else can delete them while it still refers to them.
+///
+/// The local loopback, which feeds its packets from within the decoding, is left to the mixer.
+class AudioOutputDecoder : public QThread {
+private:
+	Q_OBJECT
+	Q_DISABLE_COPY(AudioOutputDecoder)
+
+	/// How often the worker refills the sources, in ms. Twice per frame keeps it ahead of any audio backend's period.
+	static constexpr unsigned long REFILL_INTERVAL_MS = 5;
+
+	/// A source as handed to the worker
+	struct Source {
+		AudioOutputSpeech *speech;
+		/// Set while the worker works on the source. The worker only touches the source while this is set and the
+		/// source hasn't been removed, so it can be deleted once it has been removed and this is unset.
+		std::atomic< bool > inUse   = { false };
+		std::atomic< bool > removed = { false };
+
+		explicit Source(AudioOutputSpeech *speech) : speech(speech) {}
+	};
+
+	/// Deletes sources that have been played to their end
+	std::function< void(AudioOutputSpeech *) > m_removeFinished;
+
+	/// Guards m_sources and m_running. It is only ever held briefly and never while decoding.
+	QMutex m_sourcesMutex;
+	QWaitCondition m_wakeCondition;
+	/// The sources that haven't been removed. Removed sources are dropped before they can be deleted.
+	std::vector< std::shared_ptr< Source > > m_sources;
+	bool m_running = true;
+
+	/// The sources of the current decoding pass. Only used by the worker.
+	std::vector< std::shared_ptr< Source > > m_snapshot;
+	/// The sources found to be played to their end in the current decoding pass. Only used by the worker.
+	std::vector< AudioOutputSpeech * > m_finished;
+
+public:
+	/// @param removeFinished Called by the worker to delete the sources that have been played to their end
+	explicit AudioOutputDecoder(std::function< void(AudioOutputSpeech *) > removeFinished);
+	~AudioOutputDecoder() Q_DECL_OVERRIDE;
+
+	void add(AudioOutputSpeech *speech);
+	/// Stops decoding for the given source (if it has been added). Only blocks while the worker is busy with the source
+	/// itself, which takes a single frame at most, so that the source can be deleted afterwards. Must not be called for
+	/// sources that have been played to their end.
+	void remove(const AudioOutputUser *source);
+	/// Stops the worker and waits for it to finish. Deletes the sources played to their end that are left.
+	void stop();
+
+	void run() Q_DECL_OVERRIDE;
+};
+
+#endif // MUMBLE_MUMBLE_AUDIOOUTPUTDECODER_H_
@@ -0,0 +1,80 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioOutputLookahead.h"
+
+#include <cstdint>
+
+AudioOutputLookahead::AudioOutputLookahead(const AudioOutputCacheSlab &caches, spx_uint32_t frameSize)
+	: m_caches(caches), m_frameSize(frameSize) {
+}
+
+void AudioOutputLookahead::put(JitterBuffer *jitter, AudioOutputCacheSlab::Handle handle, spx_uint32_t timestamp,
+							   spx_uint32_t span) {
+	// We cheat a bit and instead of storing the actual audio data in the jitter buffer, we store the handle of
+	// the cache entry in the buffer. Passing a length of 0 should ensure that this "pointer" will never
+	// be dereferenced.
+	JitterBufferPacket jbp;
+	jbp.data      = reinterpret_cast< char * >(static_cast< std::uintptr_t >(handle));
+	jbp.len       = 0;
+	jbp.span      = span;
+	jbp.timestamp = timestamp;
+
+	jitter_buffer_put(jitter, &jbp);
+
+	m_packets[(timestamp / m_frameSize) % FRAMES] = { timestamp, span, handle };
+}
+
+AudioOutputLookahead::Result AudioOutputLookahead::get(JitterBuffer *jitter, JitterBufferPacket &packet) const {
+	const spx_uint32_t due = static_cast< spx_uint32_t >(jitter_buffer_get_pointer_timestamp(jitter));
+
+	const Packet *recoveryPacket = findRecoveryPacket(due);
+	const spx_uint32_t span      = recoveryPacket ? recoveryPacket->timestamp - due : m_frameSize;
+
+	Result result;
+
+	spx_int32_t startofs = 0;
+	result.status        = jitter_buffer_get(jitter, &packet, static_cast< spx_int32_t >(span), &startofs);
+	if (result.status == JITTER_BUFFER_OK) {
+		// The "data pointer" that is stored in the buffer is actually the handle of a cache entry
+		result.handle = static_cast< AudioOutputCacheSlab::Handle >(reinterpret_cast< std::uintptr_t >(packet.data));
+	} else if (recoveryPacket && result.status == JITTER_BUFFER_MISSING && packet.timestamp == due
+			   && packet.span == span) {
+		// The jitter buffer has skipped all of the missing audio, rather than only part of it
+		result.recoverySpan   = span;
+		result.recoveryHandle = recoveryPacket->handle;
+	}
+
+	return result;
+}
+
+const AudioOutputLookahead::Packet *AudioOutputLookahead::findRecoveryPacket(spx_uint32_t timestamp) const {
+	// An Opus packet holds up to 60 ms of audio, which is as far as the FEC data of a packet reaches back as well
+	constexpr unsigned int MAX_PACKET_FRAMES = 6;
+
+	const spx_uint32_t frame = timestamp / m_frameSize;
+
+	// Nothing is missing if there is a packet covering the timestamp
+	for (unsigned int i = 0; i < MAX_PACKET_FRAMES; ++i) {
+		const Packet &packet      = m_packets[(frame - i) % FRAMES];
+		const spx_uint32_t offset = timestamp - packet.timestamp;
+
+		if (offset < packet.span && m_caches.get(packet.handle)) {
+			return nullptr;
+		}
+	}
+
+	for (unsigned int i = 1; i <= MAX_PACKET_FRAMES; ++i) {
+		const Packet &packet = m_packets[(frame + i) % FRAMES];
+
+		if (packet.timestamp == timestamp + i * m_frameSize && m_caches.get(packet.handle)) {
+			// The FEC data covers as much audio as the packet itself. If more is missing, the packets in between might
+			// still arrive.
+			return i * m_frameSize <= packet.span ? &packet : nullptr;
+		}
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,74 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_AUDIOOUTPUTLOOKAHEAD_H_
+#define MUMBLE_MUMBLE_AUDIOOUTPUTLOOKAHEAD_H_
+
+#include "AudioOutputCacheSlab.h"
+
+#include <speex/speex_jitter.h>
+
+#include <array>
+
+/// Keeps track of the packets most recently added to a speex jitter buffer. The jitter buffer doesn't let us look at
+/// the packets it holds, but that is what it takes to recover a lost packet from the in-band FEC data of the packet
+/// after it.
+///
+/// The packets are stored as handles to entries of an AudioOutputCacheSlab. Packets that have been played or dropped
+/// since they were added are recognized by their stale handles.
+class AudioOutputLookahead {
+public:
+	/// The number of frames kept track of
+	static constexpr unsigned int FRAMES = 32;
+
+	/// A packet that has been added to the jitter buffer
+	struct Packet {
+		spx_uint32_t timestamp              = 0;
+		spx_uint32_t span                   = 0;
+		AudioOutputCacheSlab::Handle handle = AudioOutputCacheSlab::INVALID_HANDLE;
+	};
+
+	/// The outcome of get()
+	struct Result {
+		/// The return value of jitter_buffer_get()
+		int status = JITTER_BUFFER_MISSING;
+		/// The packet taken from the jitter buffer if status is JITTER_BUFFER_OK. It is up to the caller to release it.
+		AudioOutputCacheSlab::Handle handle = AudioOutputCacheSlab::INVALID_HANDLE;
+		/// The missing audio (in samples of all channels) that can be restored from the FEC data of the packet after
+		/// it or 0 if there is none
+		spx_uint32_t recoverySpan = 0;
+		/// The packet carrying the FEC data if recoverySpan is set. It stays in the jitter buffer.
+		AudioOutputCacheSlab::Handle recoveryHandle = AudioOutputCacheSlab::INVALID_HANDLE;
+	};
+
+	/// @param caches The cache the packets are stored in
+	/// @param frameSize The span of a frame (in samples of all channels), which the jitter buffer steps by
+	AudioOutputLookahead(const AudioOutputCacheSlab &caches, spx_uint32_t frameSize);
+
+	/// Adds the packet stored in the given cache entry to the jitter buffer
+	void put(JitterBuffer *jitter, AudioOutputCacheSlab::Handle handle, spx_uint32_t timestamp, spx_uint32_t span);
+
+	/// Takes the audio due next from the jitter buffer. If it is missing while the packet after it has arrived
+	/// already, the jitter buffer is asked for all the audio in between at once, so that it can be restored from the
+	/// FEC data of the latter. Otherwise a missing packet is asked for one frame at a time, in case it still arrives.
+	///
+	/// @param packet Set to the packet returned by jitter_buffer_get()
+	Result get(JitterBuffer *jitter, JitterBufferPacket &packet) const;
+
+	/// Checks whether the audio due to be played at the given timestamp is missing from the jitter buffer, while the
+	/// packet after it has arrived already.
+	///
+	/// @returns The packet whose FEC data covers the missing audio or nullptr if there is no audio to recover
+	const Packet *findRecoveryPacket(spx_uint32_t timestamp) const;
+
+private:
+	const AudioOutputCacheSlab &m_caches;
+	const spx_uint32_t m_frameSize;
+
+	/// Indexed by the frame number of the packets modulo FRAMES
+	std::array< Packet, FRAMES > m_packets;
+};
+
+#endif // MUMBLE_MUMBLE_AUDIOOUTPUTLOOKAHEAD_H_
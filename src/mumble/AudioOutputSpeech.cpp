@@ -16,48 +16,25 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 
-std::mutex AudioOutputSpeech::s_audioCachesMutex;
-std::vector< AudioOutputCache > AudioOutputSpeech::s_audioCaches(100);
+// The frame counters of the ring of decoded frames wrap around, which only works out for a power of two
+static_assert((AudioOutputSpeech::DECODE_AHEAD_FRAMES & (AudioOutputSpeech::DECODE_AHEAD_FRAMES - 1)) == 0,
+			  "DECODE_AHEAD_FRAMES must be a power of two");
 
-void AudioOutputSpeech::invalidateAudioOutputCache(void *maskedIndex) {
-	// The given "pointer" actually is to be understood as an index
-	std::size_t index = reinterpret_cast< std::size_t >(maskedIndex);
+// A speex jitter buffer holds up to 200 packets, but it takes a lot of packet reordering to get there
+AudioOutputCacheSlab AudioOutputSpeech::s_audioCaches(2048);
 
-	std::lock_guard< std::mutex > lock(s_audioCachesMutex);
-
-	if (index < s_audioCaches.size()) {
-		s_audioCaches[index].clear();
-	}
-}
-
-std::size_t AudioOutputSpeech::storeAudioOutputCache(const Mumble::Protocol::AudioData &audioData) {
-	std::lock_guard< std::mutex > lock(s_audioCachesMutex);
-
-	// Find free spot in s_audioCaches
-	auto it = std::find_if(s_audioCaches.begin(), s_audioCaches.end(),
-						   [](const AudioOutputCache &chunk) { return !chunk.isValid(); });
-
-	if (it != s_audioCaches.end()) {
-		// Write audio data to that free (currently unused) chunk
-		it->loadFrom(audioData);
-
-		return std::distance(s_audioCaches.begin(), it);
-	} else {
-		// The list of audio chunks is full -> extend it
-		AudioOutputCache chunk;
-		chunk.loadFrom(audioData);
-
-		s_audioCaches.push_back(std::move(chunk));
-
-		return s_audioCaches.size() - 1;
-	}
+void AudioOutputSpeech::invalidateAudioOutputCache(void *handle) {
+	// The given "pointer" actually is to be understood as a handle
+	s_audioCaches.release(static_cast< AudioOutputCacheSlab::Handle >(reinterpret_cast< std::uintptr_t >(handle)));
 }
 
-
 AudioOutputSpeech::AudioOutputSpeech(ClientUser *user, unsigned int freq, Mumble::Protocol::AudioCodec codec,
 									 unsigned int systemMaxBufferSize)
-	: AudioOutputUser(user->qsName), iMixerFreq(freq), m_codec(codec), p(user) {
+	: AudioOutputUser(user->qsName), iMixerFreq(freq),
+	  // Frames of 10 ms of interleaved stereo audio, which is what iFrameSize is set to below
+	  m_lookahead(s_audioCaches, 2 * SAMPLE_RATE / 100), m_codec(codec), p(user) {
 	int err;
 
 	opusState = nullptr;
@@ -122,6 +99,12 @@ AudioOutputSpeech::AudioOutputSpeech(ClientUser *user, unsigned int freq, Mumble
 		fResamplerBuffer = new float[iAudioBufferSize];
 	}
 
+	// Allocate the frames to decode ahead up front, so that the mixer never has to allocate them
+	m_decodedFrames.resize(DECODE_AHEAD_FRAMES);
+	for (DecodedFrame &frame : m_decodedFrames) {
+		frame.samples.resize(iOutputSize);
+	}
+
 	iBufferOffset = iBufferFilled = iLastConsume = 0;
 	bLastAlive                                   = true;
 
@@ -161,6 +144,8 @@ AudioOutputSpeech::~AudioOutputSpeech() {
 		speex_resampler_destroy(srs);
 
 	jitter_buffer_destroy(jbJitter);
+	// The jitter buffer drops packets that arrive too late without letting us know, so release what it has left behind
+	s_audioCaches.releaseAll(this);
 
 	if (p) {
 		p->setTalking(Settings::Passive);
@@ -195,243 +180,333 @@ void AudioOutputSpeech::addFrameToBuffer(const Mumble::Protocol::AudioData &audi
 		return;
 	}
 
-	// Copy the audio data to an AudioOutputCache instance and store that in our global chunk list
-	std::size_t storageIndex = storeAudioOutputCache(audioData);
+	// Copy the audio data into an entry of our global cache
+	const AudioOutputCacheSlab::Handle handle = s_audioCaches.store(audioData, this);
+	if (handle == AudioOutputCacheSlab::INVALID_HANDLE) {
+		qWarning("AudioOutputSpeech: Dropping audio packet, because all %d cache entries are in use",
+				 static_cast< int >(s_audioCaches.capacity()));
+		return;
+	}
+
+	m_lookahead.put(jbJitter, handle, iFrameSize * audioData.frameNumber, static_cast< spx_uint32_t >(samples));
+}
+
+void AudioOutputSpeech::decodeAhead() {
+	// Take the lock for one frame at a time, so that the mixer is never kept waiting for long if it needs it as well
+	while (true) {
+		std::lock_guard< std::mutex > lock(m_decodeMutex);
 
-	// We cheat a bit and instead of storing the actual audio data in the jitter buffer, we store the index to
-	// the created audio chunk in the buffer. Passing a length of 0 should ensure that this "pointer" will never
-	// be dereferenced.
-	JitterBufferPacket jbp;
-	jbp.data      = reinterpret_cast< char * >(storageIndex);
-	jbp.len       = 0;
-	jbp.span      = samples;
-	jbp.timestamp = iFrameSize * audioData.frameNumber;
+		const unsigned int ready =
+			m_decodedTail.load(std::memory_order_relaxed) - m_decodedHead.load(std::memory_order_acquire);
+		// Once the stream has ended, there is nothing left to decode ahead
+		if (ready >= DECODE_AHEAD_FRAMES || !m_decoderState.alive) {
+			return;
+		}
 
-	jitter_buffer_put(jbJitter, &jbp);
+		decodeFrame();
+	}
 }
 
-bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
+void AudioOutputSpeech::decodeFrame() {
 	unsigned int channels = bStereo ? 2 : 1;
 	// Note: all stereo supports are crafted for opus, since other codecs are deprecated and will soon be removed.
 
-	unsigned int sampleCount = frameCount * channels;
-
-	// we can not control exactly how many frames decoder returns
-	// so we need a buffer to keep unused frames
-	// shift the buffer, remove decoded and played frames
-	for (unsigned int i = iLastConsume; i < iBufferFilled; ++i)
-		pfBuffer[i - iLastConsume] = pfBuffer[i];
-
-	iBufferFilled -= iLastConsume;
+	const unsigned int tail = m_decodedTail.load(std::memory_order_relaxed);
+	DecodedFrame &frame     = m_decodedFrames[tail % m_decodedFrames.size()];
 
-	iLastConsume = sampleCount;
+	int decodedSamples = iFrameSize;
+	bool nextalive     = m_decoderState.alive;
 
-	// Maximum interaural delay is accounted for to prevent audio glitches
-	if (iBufferFilled >= sampleCount + INTERAURAL_DELAY)
-		return bLastAlive;
+	if (!m_decoderState.alive) {
+		// The stream has ended, but the mixer might still need a bit of silence before it removes it
+		const unsigned int outlen = static_cast< unsigned int >(
+			ceilf(static_cast< float >(iFrameSizePerChannel * iMixerFreq) / static_cast< float >(iSampleRate)));
+		std::fill_n(frame.samples.begin(), outlen * channels, 0.0f);
+		frame.sampleCount = outlen * channels;
+		frame.state       = m_decoderState;
 
-	float *pOut;
-	bool nextalive = bLastAlive;
-
-	while (iBufferFilled < sampleCount + INTERAURAL_DELAY) {
-		int decodedSamples = iFrameSize;
-		resizeBuffer(iBufferFilled + iOutputSize + INTERAURAL_DELAY);
-		// TODO: allocating memory in the audio callback will crash mumble in some cases.
-		//       we need to initialize the buffer with an appropriate size when initializing
-		//       this class. See #4250.
+		m_decodedTail.store(tail + 1, std::memory_order_release);
+		return;
+	}
 
-		pOut = (srs) ? fResamplerBuffer : (pfBuffer + iBufferFilled);
+	float *pOut = (srs) ? fResamplerBuffer : frame.samples.data();
 
-		if (!bLastAlive) {
-			memset(pOut, 0, iFrameSize * sizeof(float));
-		} else {
-			if (p == &LoopUser::lpLoopy) {
-				LoopUser::lpLoopy.fetchFrames();
-			}
+	if (p == &LoopUser::lpLoopy) {
+		LoopUser::lpLoopy.fetchFrames();
+	}
 
-			int avail = 0;
-			int ts    = jitter_buffer_get_pointer_timestamp(jbJitter);
-			jitter_buffer_ctl(jbJitter, JITTER_BUFFER_GET_AVAILABLE_COUNT, &avail);
-
-			if (p && (ts == 0)) {
-				int want = iroundf(p->fAverageAvailable);
-				if (avail < want) {
-					++iMissCount;
-					if (iMissCount < 20) {
-						memset(pOut, 0, iFrameSize * sizeof(float));
-						goto nextframe;
-					}
-				}
+	int avail = 0;
+	int ts    = jitter_buffer_get_pointer_timestamp(jbJitter);
+	jitter_buffer_ctl(jbJitter, JITTER_BUFFER_GET_AVAILABLE_COUNT, &avail);
+
+	if (p && (ts == 0)) {
+		int want = iroundf(p->fAverageAvailable);
+		if (avail < want) {
+			++iMissCount;
+			if (iMissCount < 20) {
+				memset(pOut, 0, iFrameSize * sizeof(float));
+				goto nextframe;
 			}
+		}
+	}
 
-			if (qlFrames.isEmpty()) {
-				QMutexLocker lock(&qmJitter);
-
-				JitterBufferPacket jbp;
+	// The audio (in samples of all channels) restored from the FEC data in recoveryData
+	spx_int32_t recoverySpan = 0;
+	QByteArray recoveryData;
 
-				spx_int32_t startofs = 0;
-				if (jitter_buffer_get(jbJitter, &jbp, iFrameSize, &startofs) == JITTER_BUFFER_OK) {
-					std::lock_guard< std::mutex > audioChunkLock(s_audioCachesMutex);
+	if (qlFrames.isEmpty()) {
+		QMutexLocker lock(&qmJitter);
 
-					iMissCount = 0;
+		JitterBufferPacket jbp;
+		const AudioOutputLookahead::Result result = m_lookahead.get(jbJitter, jbp);
+		if (result.status == JITTER_BUFFER_OK) {
+			iMissCount = 0;
 
-					// The "data pointer" that is stored in the buffer is actually just an index to s_audioCaches
-					std::size_t index = reinterpret_cast< std::size_t >(jbp.data);
-					assert(jbp.len == 0);
-					assert(index < s_audioCaches.size());
+			// The jitter buffer has passed the entry in s_audioCaches on to us, so it is up to us to release it
+			assert(jbp.len == 0);
 
-					const AudioOutputCache &cache = s_audioCaches[index];
-					assert(cache.isValid());
+			const AudioOutputCache *cache = s_audioCaches.get(result.handle);
 
-					bHasTerminator = cache.isLastFrame();
+			assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
 
-					assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
+			if (cache && cache->isValid()) {
+				bHasTerminator = cache->isLastFrame();
 
-					// Copy audio data into qlFrames
-					qlFrames << QByteArray(reinterpret_cast< const char * >(cache.getAudioData().data()),
-										   cache.getAudioData().size());
+				// Copy audio data into qlFrames
+				qlFrames << QByteArray(reinterpret_cast< const char * >(cache->getAudioData().data()),
+									   cache->getAudioData().size());
 
-					if (cache.containsPositionalInformation()) {
-						assert(cache.getPositionalInformation().size() == 3);
-						assert(fPos.size() == 3);
+				if (cache->containsPositionalInformation()) {
+					assert(cache->getPositionalInformation().size() == 3);
 
-						for (int i = 0; i < 3; ++i) {
-							fPos[i] = cache.getPositionalInformation()[i];
-						}
-					} else {
-						fPos[0] = fPos[1] = fPos[2] = 0.0f;
+					for (int i = 0; i < 3; ++i) {
+						m_decoderState.position[i] = cache->getPositionalInformation()[i];
 					}
+				} else {
+					m_decoderState.position = { 0.0f, 0.0f, 0.0f };
+				}
 
-					m_suggestedVolumeAdjustment = cache.getVolumeAdjustment();
-					m_audioContext              = cache.getContext();
+				m_decoderState.volumeAdjustment = cache->getVolumeAdjustment();
+				m_decoderState.context          = cache->getContext();
 
-					if (p) {
-						float a = static_cast< float >(avail);
-						if (avail >= p->fAverageAvailable)
-							p->fAverageAvailable = a;
-						else
-							p->fAverageAvailable *= 0.99f;
-					}
-				} else {
-					// Let the jitter buffer know it's the right time to adjust the buffering delay to the network
-					// conditions.
-					jitter_buffer_update_delay(jbJitter, &jbp, nullptr);
+				s_audioCaches.release(result.handle);
+			} else {
+				// A stale handle, which should never happen. Conceal the packet as if it had been lost.
+				qWarning("AudioOutputSpeech: Jitter buffer returned a stale audio cache entry");
+				qlFrames << QByteArray();
+			}
 
-					iMissCount++;
-					if (iMissCount > 10)
-						nextalive = false;
+			if (p) {
+				float a = static_cast< float >(avail);
+				if (avail >= p->fAverageAvailable)
+					p->fAverageAvailable = a;
+				else
+					p->fAverageAvailable *= 0.99f;
+			}
+		} else {
+			if (result.recoverySpan > 0) {
+				recoverySpan = static_cast< spx_int32_t >(result.recoverySpan);
+
+				const AudioOutputCache *cache = s_audioCaches.get(result.recoveryHandle);
+				if (cache && cache->isValid()) {
+					recoveryData = QByteArray(reinterpret_cast< const char * >(cache->getAudioData().data()),
+											  cache->getAudioData().size());
 				}
 			}
 
-			if (!qlFrames.isEmpty()) {
-				QByteArray qba = qlFrames.takeFirst();
+			// Let the jitter buffer know it's the right time to adjust the buffering delay to the network
+			// conditions.
+			jitter_buffer_update_delay(jbJitter, &jbp, nullptr);
 
-				assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
+			if (recoverySpan > 0) {
+				// The stream goes on, as the packet after the missing audio is there
+				iMissCount = 0;
+			} else {
+				iMissCount++;
+				if (iMissCount > 10)
+					nextalive = false;
+			}
+		}
+	}
 
-				if (qba.isEmpty() || !(p && p->bLocalMute)) {
-					// If qba is empty, we have to let Opus know about the packet loss
-					// Otherwise if the associated user is not locally muted, we want to decode the audio
-					// packet normally in order to be able to play it.
-					decodedSamples = opus_decode_float(
-						opusState, qba.isEmpty() ? nullptr : reinterpret_cast< const unsigned char * >(qba.constData()),
-						qba.size(), pOut, iAudioBufferSize, 0);
-				} else {
-					// If the packet is non-empty, but the associated user is locally muted,
-					// we don't have to decode the packet. Instead it is enough to know how many
-					// samples it contained so that we can then mute the appropriate output length
-					decodedSamples = opus_packet_get_samples_per_frame(
-						reinterpret_cast< const unsigned char * >(qba.constData()), SAMPLE_RATE);
-				}
+	if (!qlFrames.isEmpty()) {
+		QByteArray qba = qlFrames.takeFirst();
 
-				// The returned sample count we get from the Opus functions refer to samples per channel.
-				// Thus in order to get the total amount, we have to multiply by the channel count.
-				decodedSamples *= channels;
+		assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
 
-				if (decodedSamples < 0) {
-					decodedSamples = iFrameSize;
-					memset(pOut, 0, iFrameSize * sizeof(float));
-				}
+		if (qba.isEmpty() || !(p && p->bLocalMute)) {
+			// If qba is empty, we have to let Opus know about the packet loss
+			// Otherwise if the associated user is not locally muted, we want to decode the audio
+			// packet normally in order to be able to play it.
+			decodedSamples = opus_decode_float(
+				opusState, qba.isEmpty() ? nullptr : reinterpret_cast< const unsigned char * >(qba.constData()),
+				qba.size(), pOut, iAudioBufferSize, 0);
+		} else {
+			// If the packet is non-empty, but the associated user is locally muted,
+			// we don't have to decode the packet. Instead it is enough to know how many
+			// samples it contained so that we can then mute the appropriate output length
+			decodedSamples = opus_packet_get_samples_per_frame(
+				reinterpret_cast< const unsigned char * >(qba.constData()), SAMPLE_RATE);
+		}
 
-				bool update = true;
-				if (p) {
-					float &fPowerMax = p->fPowerMax;
-					float &fPowerMin = p->fPowerMin;
+		// The returned sample count we get from the Opus functions refer to samples per channel.
+		// Thus in order to get the total amount, we have to multiply by the channel count.
+		decodedSamples *= channels;
 
-					float pow = 0.0f;
-					for (int i = 0; i < decodedSamples; ++i) {
-						pow += pOut[i] * pOut[i];
-					}
-					pow = sqrtf(pow / static_cast< float >(decodedSamples)); // Average over both L and R channel.
-
-					if (pow >= fPowerMax) {
-						fPowerMax = pow;
-					} else {
-						if (pow <= fPowerMin) {
-							fPowerMin = pow;
-						} else {
-							fPowerMax = 0.99f * fPowerMax;
-							fPowerMin += 0.0001f * pow;
-						}
-					}
+		if (decodedSamples < 0) {
+			decodedSamples = iFrameSize;
+			memset(pOut, 0, iFrameSize * sizeof(float));
+		}
 
-					update = (pow < (fPowerMin + 0.01f * (fPowerMax - fPowerMin))); // Update jitter buffer when quiet.
-				}
+		bool update = true;
+		if (p) {
+			float &fPowerMax = p->fPowerMax;
+			float &fPowerMin = p->fPowerMin;
 
-				if (qlFrames.isEmpty() && update) {
-					jitter_buffer_update_delay(jbJitter, nullptr, nullptr);
-				}
+			float pow = 0.0f;
+			for (int i = 0; i < decodedSamples; ++i) {
+				pow += pOut[i] * pOut[i];
+			}
+			pow = sqrtf(pow / static_cast< float >(decodedSamples)); // Average over both L and R channel.
 
-				if (qlFrames.isEmpty() && bHasTerminator) {
-					nextalive = false;
-				}
+			if (pow >= fPowerMax) {
+				fPowerMax = pow;
 			} else {
-				assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
-				decodedSamples = opus_decode_float(opusState, nullptr, 0, pOut, iFrameSize, 0);
-				decodedSamples *= channels;
-
-				if (decodedSamples < 0) {
-					decodedSamples = iFrameSize;
-					memset(pOut, 0, iFrameSize * sizeof(float));
+				if (pow <= fPowerMin) {
+					fPowerMin = pow;
+				} else {
+					fPowerMax = 0.99f * fPowerMax;
+					fPowerMin += 0.0001f * pow;
 				}
 			}
 
-			if (!nextalive) {
-				for (unsigned int i = 0; i < static_cast< unsigned int >(iFrameSizePerChannel); ++i) {
-					for (unsigned int s = 0; s < channels; ++s)
-						pOut[i * channels + s] *= fFadeOut[i];
-				}
-			} else if (ts == 0) {
-				for (unsigned int i = 0; i < static_cast< unsigned int >(iFrameSizePerChannel); ++i) {
-					for (unsigned int s = 0; s < channels; ++s)
-						pOut[i * channels + s] *= fFadeIn[i];
-				}
-			}
+			update = (pow < (fPowerMin + 0.01f * (fPowerMax - fPowerMin))); // Update jitter buffer when quiet.
+		}
 
-			for (int i = decodedSamples / iFrameSize; i > 0; --i) {
-				jitter_buffer_tick(jbJitter);
-			}
+		if (qlFrames.isEmpty() && update) {
+			jitter_buffer_update_delay(jbJitter, nullptr, nullptr);
 		}
-	nextframe:
-		if (p && p->bLocalMute) {
-			// Overwrite the output with zeros as this user is muted
-			// NOTE: If Opus is used, then in this case no samples have actually been decoded and thus
-			// we don't discard previously done work (in form of decoding the audio stream) by overwriting
-			// it with zeros.
-			memset(pOut, 0, decodedSamples * sizeof(float));
+
+		if (qlFrames.isEmpty() && bHasTerminator) {
+			nextalive = false;
 		}
+	} else if (recoverySpan > 0) {
+		assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
+		// Opus restores as much of the missing audio as the FEC data covers and conceals the rest (or all of it, if
+		// the packet doesn't carry any FEC data)
+		decodedSamples = opus_decode_float(
+			opusState,
+			recoveryData.isEmpty() ? nullptr : reinterpret_cast< const unsigned char * >(recoveryData.constData()),
+			recoveryData.size(), pOut, recoverySpan / static_cast< int >(channels), 1);
+		decodedSamples *= channels;
+
+		if (decodedSamples < 0) {
+			decodedSamples = recoverySpan;
+			memset(pOut, 0, recoverySpan * sizeof(float));
+		}
+	} else {
+		assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
+		decodedSamples = opus_decode_float(opusState, nullptr, 0, pOut, iFrameSize, 0);
+		decodedSamples *= channels;
+
+		if (decodedSamples < 0) {
+			decodedSamples = iFrameSize;
+			memset(pOut, 0, iFrameSize * sizeof(float));
+		}
+	}
+
+	if (!nextalive) {
+		for (unsigned int i = 0; i < static_cast< unsigned int >(iFrameSizePerChannel); ++i) {
+			for (unsigned int s = 0; s < channels; ++s)
+				pOut[i * channels + s] *= fFadeOut[i];
+		}
+	} else if (ts == 0) {
+		for (unsigned int i = 0; i < static_cast< unsigned int >(iFrameSizePerChannel); ++i) {
+			for (unsigned int s = 0; s < channels; ++s)
+				pOut[i * channels + s] *= fFadeIn[i];
+		}
+	}
+
+	for (int i = decodedSamples / iFrameSize; i > 0; --i) {
+		jitter_buffer_tick(jbJitter);
+	}
+
+nextframe:
+	if (p && p->bLocalMute) {
+		// Overwrite the output with zeros as this user is muted
+		// NOTE: If Opus is used, then in this case no samples have actually been decoded and thus
+		// we don't discard previously done work (in form of decoding the audio stream) by overwriting
+		// it with zeros.
+		memset(pOut, 0, decodedSamples * sizeof(float));
+	}
+
+	spx_uint32_t inlen  = decodedSamples / channels; // per channel
+	spx_uint32_t outlen = static_cast< unsigned int >(
+		ceilf(static_cast< float >(decodedSamples / channels * iMixerFreq) / static_cast< float >(iSampleRate)));
+	if (srs) {
+		if (channels == 1) {
+			speex_resampler_process_float(srs, 0, fResamplerBuffer, &inlen, frame.samples.data(), &outlen);
+		} else if (channels == 2) {
+			speex_resampler_process_interleaved_float(srs, fResamplerBuffer, &inlen, frame.samples.data(), &outlen);
+		}
+	}
 
-		spx_uint32_t inlen  = decodedSamples / channels; // per channel
-		spx_uint32_t outlen = static_cast< unsigned int >(
-			ceilf(static_cast< float >(decodedSamples / channels * iMixerFreq) / static_cast< float >(iSampleRate)));
-		if (srs && bLastAlive) {
-			if (channels == 1) {
-				speex_resampler_process_float(srs, 0, fResamplerBuffer, &inlen, pfBuffer + iBufferFilled, &outlen);
-			} else if (channels == 2) {
-				speex_resampler_process_interleaved_float(srs, fResamplerBuffer, &inlen, pfBuffer + iBufferFilled,
-														  &outlen);
+	m_decoderState.alive = nextalive;
+	frame.sampleCount    = outlen * channels;
+	frame.state          = m_decoderState;
+
+	// Publish the frame to the mixer
+	m_decodedTail.store(tail + 1, std::memory_order_release);
+}
+
+bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
+	unsigned int channels = bStereo ? 2 : 1;
+
+	unsigned int sampleCount = frameCount * channels;
+
+	// we can not control exactly how many frames decoder returns
+	// so we need a buffer to keep unused frames
+	// shift the buffer, remove decoded and played frames
+	for (unsigned int i = iLastConsume; i < iBufferFilled; ++i)
+		pfBuffer[i - iLastConsume] = pfBuffer[i];
+
+	iBufferFilled -= iLastConsume;
+
+	iLastConsume = sampleCount;
+
+	// Maximum interaural delay is accounted for to prevent audio glitches
+	if (iBufferFilled >= sampleCount + INTERAURAL_DELAY)
+		return bLastAlive;
+
+	bool nextalive = bLastAlive;
+
+	while (iBufferFilled < sampleCount + INTERAURAL_DELAY) {
+		resizeBuffer(iBufferFilled + iOutputSize + INTERAURAL_DELAY);
+		// TODO: allocating memory in the audio callback will crash mumble in some cases.
+		//       we need to initialize the buffer with an appropriate size when initializing
+		//       this class. See #4250.
+
+		const unsigned int head = m_decodedHead.load(std::memory_order_relaxed);
+		if (m_decodedTail.load(std::memory_order_acquire) == head) {
+			// The decode-ahead worker has fallen behind (or doesn't handle this stream), so decode the frame right away
+			std::lock_guard< std::mutex > lock(m_decodeMutex);
+			if (m_decodedTail.load(std::memory_order_relaxed) == head) {
+				decodeFrame();
 			}
 		}
-		iBufferFilled += outlen * channels;
+
+		const DecodedFrame &frame = m_decodedFrames[head % m_decodedFrames.size()];
+		std::copy(frame.samples.begin(), frame.samples.begin() + frame.sampleCount, pfBuffer + iBufferFilled);
+		iBufferFilled += frame.sampleCount;
+
+		// The stream's state changes along with the audio that is played
+		fPos                        = frame.state.position;
+		m_suggestedVolumeAdjustment = frame.state.volumeAdjustment;
+		m_audioContext              = frame.state.context;
+		nextalive                   = frame.state.alive;
+
+		// Hand the frame back to the decoder
+		m_decodedHead.store(head + 1, std::memory_order_release);
 	}
 
 	if (p) {
@@ -443,6 +518,10 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 		switch (m_audioContext) {
 			case Mumble::Protocol::AudioContext::LISTEN:
 				// Fallthrough
+			case Mumble::Protocol::AudioContext::RADIO_COM1:
+				// Fallthrough
+			case Mumble::Protocol::AudioContext::RADIO_COM2:
+				// Fallthrough
 			case Mumble::Protocol::AudioContext::NORMAL:
 				ts = Settings::Talking;
 				break;
@@ -11,10 +11,14 @@
 
 #include <QtCore/QMutex>
 
-#include "AudioOutputCache.h"
+#include "AudioOutputCacheSlab.h"
+#include "AudioOutputLookahead.h"
 #include "AudioOutputUser.h"
 #include "MumbleProtocol.h"
+#include "RadioEffect.h"
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <vector>
 
@@ -26,11 +30,11 @@ private:
 	Q_OBJECT
 	Q_DISABLE_COPY(AudioOutputSpeech)
 protected:
-	static std::mutex s_audioCachesMutex;
-	static std::vector< AudioOutputCache > s_audioCaches;
+	/// The received packets of all streams. The jitter buffers only hold handles to its entries.
+	static AudioOutputCacheSlab s_audioCaches;
 
-	static void invalidateAudioOutputCache(void *maskedIndex);
-	static std::size_t storeAudioOutputCache(const Mumble::Protocol::AudioData &audioData);
+	/// The destroy callback of the jitter buffers, called for packets they drop
+	static void invalidateAudioOutputCache(void *handle);
 
 	unsigned int iAudioBufferSize;
 	unsigned int iBufferOffset;
@@ -54,21 +58,73 @@ protected:
 	JitterBuffer *jbJitter;
 	int iMissCount;
 
+	/// The packets most recently added to jbJitter, from which lost packets are recovered. Guarded by qmJitter.
+	AudioOutputLookahead m_lookahead;
+
 	OpusDecoder *opusState;
 
 	QList< QByteArray > qlFrames;
 
+	/// The state of the stream a decoded frame belongs to. It is applied once the frame is played.
+	struct StreamState {
+		std::array< float, 3 > position           = { 0.0f, 0.0f, 0.0f };
+		float volumeAdjustment                    = 1.0f;
+		Mumble::Protocol::audio_context_t context = Mumble::Protocol::AudioContext::INVALID;
+		/// Whether the stream goes on after this frame
+		bool alive = true;
+	};
+
+	/// A decoded and resampled frame (or, for longer packets, several of them)
+	struct DecodedFrame {
+		std::vector< float > samples;
+		/// The number of samples (of all channels) in samples
+		unsigned int sampleCount = 0;
+		StreamState state;
+	};
+
+	/// Guards the decoder state (the jitter buffer, the decoder, the resampler and everything used by decodeFrame()),
+	/// which is used by the decode-ahead worker and, whenever the worker falls behind, by the mixer
+	std::mutex m_decodeMutex;
+	/// The state of the stream as far as it has been decoded, which is ahead of the state played by the mixer
+	StreamState m_decoderState;
+
+	/// A single-producer single-consumer ring of decoded frames: frames are added by whoever holds m_decodeMutex and
+	/// removed by the mixer. All frames are allocated up front, so that the mixer never allocates.
+	std::vector< DecodedFrame > m_decodedFrames;
+	/// The number of frames ever added and removed. The difference is the number of frames ready to be played.
+	std::atomic< unsigned int > m_decodedTail = { 0 };
+	std::atomic< unsigned int > m_decodedHead = { 0 };
+
+	/// Decodes the next frame into the ring. m_decodeMutex must be held and the ring must not be full.
+	void decodeFrame();
+
 public:
 	Mumble::Protocol::audio_context_t m_audioContext;
 	Mumble::Protocol::AudioCodec m_codec;
 	int iMissedFrames;
 	ClientUser *p;
+	/// The state of the radio effect for this user's audio stream
+	RadioEffect::SourceState m_radioState;
+
+	/// Set by the mixer (while holding AudioOutput::qrwlOutputs) once the stream has been played to its end. From then
+	/// on only the AudioOutputDecoder deletes the stream, so that the audio callback doesn't have to wait for the
+	/// worker.
+	std::atomic< bool > m_finished = { false };
 
-	/// Fetch and decode frames from the jitter buffer. Called in mix().
+	/// The number of frames decoded ahead of the mixer at most. Every frame decoded ahead adds 10 ms of latency, but
+	/// saves the audio callback from decoding it.
+	static constexpr unsigned int DECODE_AHEAD_FRAMES = 2;
+
+	/// Fetch the frames decoded ahead into the sample buffer. Frames which haven't been decoded ahead are decoded from
+	/// the jitter buffer right away. Called in mix().
 	///
-	/// @param frameCount Number of frames to decode. frame means a bundle of one sample from each channel.
+	/// @param frameCount Number of frames to fetch. frame means a bundle of one sample from each channel.
 	virtual bool prepareSampleBuffer(unsigned int frameCount) Q_DECL_OVERRIDE;
 
+	/// Decode frames from the jitter buffer until DECODE_AHEAD_FRAMES frames are ready to be played. Called by the
+	/// AudioOutputDecoder worker.
+	void decodeAhead();
+
 	void addFrameToBuffer(const Mumble::Protocol::AudioData &audioData);
 
 	/// @param systemMaxBufferSize maximum number of samples the system audio play back may request each time
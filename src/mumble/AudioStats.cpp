@@ -332,6 +332,16 @@ void AudioStats::on_Tick_timeout() {
 	FORMAT_TO_TXT("%06.2f dB", ai->dPeakSignal);
 	qlSignalLevel->setText(txt);
 
+	if (ai->sesEcho) {
+		const Resynchronizer::Statistics resync = ai->resync.statistics();
+		qlEchoQueue->setText(tr("%1 ms, %2 / %3 frames dropped")
+								 .arg(resync.queued * 10)
+								 .arg(resync.micDrops)
+								 .arg(resync.speakerDrops));
+	} else {
+		qlEchoQueue->setText(tr("Off"));
+	}
+
 	spx_int32_t ps_size = 0;
 	speex_preprocess_ctl(ai->sppPreprocess, SPEEX_PREPROCESS_GET_PSD_SIZE, &ps_size);
 
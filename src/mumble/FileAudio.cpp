@@ -0,0 +1,437 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "FileAudio.h"
+
+#include "Global.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QtEndian>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/// Settings::qsFileInput starting with this prefix selects a sine tone, followed by its frequency in Hz
+static const QString TONE_PREFIX = QStringLiteral("tone:");
+/// The amplitude of the sine tone, leaving some headroom for the audio processing
+static constexpr float TONE_AMPLITUDE = 0.5f;
+
+class FileInputRegistrar : public AudioInputRegistrar {
+public:
+	FileInputRegistrar();
+	virtual AudioInput *create();
+	virtual const QVariant getDeviceChoice();
+	virtual const QList< audioDevice > getDeviceChoices();
+	virtual void setDeviceChoice(const QVariant &, Settings &);
+	virtual bool canEcho(EchoCancelOptionID echoCancelID, const QString &outputSystem) const;
+	virtual bool isMicrophoneAccessDeniedByOS() { return false; };
+};
+
+class FileOutputRegistrar : public AudioOutputRegistrar {
+public:
+	FileOutputRegistrar();
+	virtual AudioOutput *create();
+	virtual const QVariant getDeviceChoice();
+	virtual const QList< audioDevice > getDeviceChoices();
+	virtual void setDeviceChoice(const QVariant &, Settings &);
+};
+
+// A lower priority than any real backend, so that it is never picked by default
+static FileInputRegistrar airFile;
+static FileOutputRegistrar aorFile;
+
+FileInputRegistrar::FileInputRegistrar() : AudioInputRegistrar(QLatin1String("File"), -1) {
+}
+
+AudioInput *FileInputRegistrar::create() {
+	return new FileInput();
+}
+
+const QVariant FileInputRegistrar::getDeviceChoice() {
+	return Global::get().s.qsFileInput;
+}
+
+const QList< audioDevice > FileInputRegistrar::getDeviceChoices() {
+	QList< audioDevice > choices;
+
+	choices << audioDevice(QLatin1String("Silence"), QString());
+	choices << audioDevice(QLatin1String("Tone (440 Hz)"), QString(TONE_PREFIX + QLatin1String("440")));
+
+	// Files can't be browsed for in the audio wizard, but one configured in the settings is kept
+	const QString &current = Global::get().s.qsFileInput;
+	if (!current.isEmpty() && !current.startsWith(TONE_PREFIX)) {
+		choices << audioDevice(QFileInfo(current).fileName(), current);
+	}
+
+	return choices;
+}
+
+void FileInputRegistrar::setDeviceChoice(const QVariant &choice, Settings &s) {
+	s.qsFileInput = choice.toString();
+}
+
+bool FileInputRegistrar::canEcho(EchoCancelOptionID, const QString &) const {
+	return false;
+}
+
+FileOutputRegistrar::FileOutputRegistrar() : AudioOutputRegistrar(QLatin1String("File"), -1) {
+}
+
+AudioOutput *FileOutputRegistrar::create() {
+	return new FileOutput();
+}
+
+const QVariant FileOutputRegistrar::getDeviceChoice() {
+	return Global::get().s.qsFileOutput;
+}
+
+const QList< audioDevice > FileOutputRegistrar::getDeviceChoices() {
+	QList< audioDevice > choices;
+
+	choices << audioDevice(QLatin1String("Discard"), QString());
+
+	const QString &current = Global::get().s.qsFileOutput;
+	if (!current.isEmpty()) {
+		choices << audioDevice(QFileInfo(current).fileName(), current);
+	}
+
+	return choices;
+}
+
+void FileOutputRegistrar::setDeviceChoice(const QVariant &choice, Settings &s) {
+	s.qsFileOutput = choice.toString();
+}
+
+/// Paces the File backends, so that they process one frame after the other at the speed of
+/// Settings::fFileAudioSpeed. Once behind (e.g. on an overloaded machine), the frames are processed without waiting
+/// until the backend has caught up again, so that the number of frames per time stays the same.
+class FileAudioClock {
+public:
+	explicit FileAudioClock(double frameMilliseconds)
+		: m_frameMilliseconds(frameMilliseconds), m_speed(Global::get().s.fFileAudioSpeed),
+		  m_start(std::chrono::steady_clock::now()) {}
+
+	/// Waits until the given number of frames is due. Returns immediately if the speed isn't throttled.
+	void waitFor(std::uint64_t frames) const {
+		if (m_speed <= 0.0f) {
+			return;
+		}
+
+		const std::chrono::duration< double, std::milli > elapsed(frames * m_frameMilliseconds / m_speed);
+		std::this_thread::sleep_until(m_start
+									  + std::chrono::duration_cast< std::chrono::steady_clock::duration >(elapsed));
+	}
+
+private:
+	double m_frameMilliseconds;
+	float m_speed;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+/// Reads the samples of a WAV file with 16 bit integer or 32 bit float samples, starting over at its end
+class WaveReader {
+public:
+	/// @returns Whether the file could be opened and has a supported format
+	bool open(const QString &path);
+	bool isOpen() const { return m_dataSize > 0; }
+
+	unsigned int sampleRate() const { return m_sampleRate; }
+	unsigned int channels() const { return m_channels; }
+	bool isFloat() const { return m_isFloat; }
+
+	/// Reads the given number of frames (one sample per channel each) into the buffer
+	void read(char *buffer, std::size_t frames);
+
+private:
+	QFile m_file;
+	unsigned int m_sampleRate = 0;
+	unsigned int m_channels   = 0;
+	bool m_isFloat            = false;
+	qint64 m_dataStart        = 0;
+	qint64 m_dataSize         = 0;
+	qint64 m_position         = 0;
+};
+
+bool WaveReader::open(const QString &path) {
+	m_file.setFileName(path);
+	if (!m_file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	const QByteArray header = m_file.read(12);
+	if (header.size() != 12 || !header.startsWith("RIFF") || header.mid(8, 4) != "WAVE") {
+		return false;
+	}
+
+	bool hasFormat = false;
+	while (true) {
+		const QByteArray chunk = m_file.read(8);
+		if (chunk.size() != 8) {
+			return false;
+		}
+		const quint32 size = qFromLittleEndian< quint32 >(reinterpret_cast< const uchar * >(chunk.constData() + 4));
+
+		if (chunk.startsWith("fmt ")) {
+			const QByteArray format = m_file.read(size);
+			if (format.size() < 16) {
+				return false;
+			}
+
+			const uchar *data  = reinterpret_cast< const uchar * >(format.constData());
+			quint16 tag        = qFromLittleEndian< quint16 >(data);
+			m_channels         = qFromLittleEndian< quint16 >(data + 2);
+			m_sampleRate       = qFromLittleEndian< quint32 >(data + 4);
+			const quint16 bits = qFromLittleEndian< quint16 >(data + 14);
+
+			// WAVE_FORMAT_EXTENSIBLE stores the actual format at the start of its sub-format GUID
+			if (tag == 0xFFFE && format.size() >= 26) {
+				tag = qFromLittleEndian< quint16 >(data + 24);
+			}
+
+			if (tag == 1 && bits == 16) {
+				m_isFloat = false;
+			} else if (tag == 3 && bits == 32) {
+				m_isFloat = true;
+			} else {
+				qWarning("FileInput: Unsupported WAV format %d with %d bits", tag, bits);
+				return false;
+			}
+			hasFormat = true;
+		} else if (chunk.startsWith("data")) {
+			if (!hasFormat || m_channels == 0 || m_sampleRate == 0) {
+				return false;
+			}
+
+			const qint64 frameSize = m_channels * (m_isFloat ? sizeof(float) : sizeof(short));
+			m_dataStart            = m_file.pos();
+			m_dataSize             = std::min< qint64 >(size, m_file.size() - m_dataStart);
+			m_dataSize -= m_dataSize % frameSize;
+			m_position = 0;
+
+			return m_dataSize > 0;
+		} else {
+			m_file.seek(m_file.pos() + size);
+		}
+
+		// Chunks are padded to an even size
+		if (size % 2 == 1) {
+			m_file.seek(m_file.pos() + 1);
+		}
+	}
+}
+
+void WaveReader::read(char *buffer, std::size_t frames) {
+	qint64 remaining = static_cast< qint64 >(frames * m_channels * (m_isFloat ? sizeof(float) : sizeof(short)));
+
+	while (remaining > 0) {
+		if (m_position == m_dataSize) {
+			m_file.seek(m_dataStart);
+			m_position = 0;
+		}
+
+		const qint64 read = m_file.read(buffer, std::min(remaining, m_dataSize - m_position));
+		if (read <= 0) {
+			// The file has been truncated while reading it, continue with silence
+			std::fill(buffer, buffer + remaining, 0);
+			return;
+		}
+
+		buffer += read;
+		remaining -= read;
+		m_position += read;
+	}
+}
+
+/// Writes 16 bit integer samples into a WAV file
+class WaveWriter {
+public:
+	~WaveWriter() { close(); }
+
+	bool open(const QString &path, unsigned int sampleRate, unsigned int channels);
+	/// Writes the interleaved samples, if the file has been opened
+	void write(const short *samples, std::size_t count);
+	/// Fills in the sizes of the header, so that the file is valid
+	void close();
+
+private:
+	void writeHeader();
+
+	QFile m_file;
+	unsigned int m_sampleRate = 0;
+	unsigned int m_channels   = 0;
+	quint32 m_dataSize        = 0;
+};
+
+bool WaveWriter::open(const QString &path, unsigned int sampleRate, unsigned int channels) {
+	m_file.setFileName(path);
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return false;
+	}
+
+	m_sampleRate = sampleRate;
+	m_channels   = channels;
+	m_dataSize   = 0;
+	writeHeader();
+
+	return true;
+}
+
+void WaveWriter::write(const short *samples, std::size_t count) {
+	if (!m_file.isOpen()) {
+		return;
+	}
+
+	m_file.write(reinterpret_cast< const char * >(samples), static_cast< qint64 >(count * sizeof(short)));
+	m_dataSize += static_cast< quint32 >(count * sizeof(short));
+}
+
+void WaveWriter::close() {
+	if (!m_file.isOpen()) {
+		return;
+	}
+
+	m_file.seek(0);
+	writeHeader();
+	m_file.close();
+}
+
+void WaveWriter::writeHeader() {
+	uchar header[44];
+	const auto put16 = [&header](std::size_t offset, quint16 value) { qToLittleEndian(value, header + offset); };
+	const auto put32 = [&header](std::size_t offset, quint32 value) { qToLittleEndian(value, header + offset); };
+
+	std::copy_n("RIFF", 4, header);
+	put32(4, 36 + m_dataSize);
+	std::copy_n("WAVEfmt ", 8, header + 8);
+	put32(16, 16);
+	put16(20, 1);
+	put16(22, static_cast< quint16 >(m_channels));
+	put32(24, m_sampleRate);
+	put32(28, m_sampleRate * m_channels * sizeof(short));
+	put16(32, static_cast< quint16 >(m_channels * sizeof(short)));
+	put16(34, 16);
+	std::copy_n("data", 4, header + 36);
+	put32(40, m_dataSize);
+
+	m_file.write(reinterpret_cast< const char * >(header), sizeof(header));
+}
+
+FileInput::FileInput() {
+	bRunning = true;
+}
+
+FileInput::~FileInput() {
+	// Signal input thread to end
+	bRunning = false;
+	wait();
+}
+
+void FileInput::run() {
+	const QString source = Global::get().s.qsFileInput;
+
+	const bool isTone         = source.startsWith(TONE_PREFIX);
+	const float toneFrequency = isTone ? source.mid(TONE_PREFIX.size()).toFloat() : 0.0f;
+	WaveReader wave;
+
+	if (isTone && (toneFrequency <= 0.0f || toneFrequency >= SAMPLE_RATE / 2)) {
+		qWarning("FileInput: Invalid tone %s", qPrintable(source));
+		return;
+	}
+
+	if (source.isEmpty() || isTone) {
+		iMicFreq     = SAMPLE_RATE;
+		iMicChannels = 1;
+		eMicFormat   = SampleFloat;
+	} else if (wave.open(source)) {
+		iMicFreq     = wave.sampleRate();
+		iMicChannels = wave.channels();
+		eMicFormat   = wave.isFloat() ? SampleFloat : SampleShort;
+	} else {
+		qWarning("FileInput: Failed to open %s", qPrintable(source));
+		return;
+	}
+
+	qWarning("FileInput: Starting audio capture from %s", source.isEmpty() ? "silence" : qPrintable(source));
+
+	initializeMixer();
+
+	// Large enough for either sample format. All bits zero is silence in both.
+	std::vector< float > buffer(iMicLength * iMicChannels, 0.0f);
+
+	const double phaseIncrement = 2.0 * M_PI * toneFrequency / SAMPLE_RATE;
+	double phase                = 0.0;
+
+	const FileAudioClock clock(iMicLength * 1000.0 / iMicFreq);
+	for (std::uint64_t frame = 1; bRunning; ++frame) {
+		if (isTone) {
+			for (float &sample : buffer) {
+				sample = TONE_AMPLITUDE * static_cast< float >(std::sin(phase));
+				phase  = std::fmod(phase + phaseIncrement, 2.0 * M_PI);
+			}
+		} else if (wave.isOpen()) {
+			wave.read(reinterpret_cast< char * >(buffer.data()), iMicLength);
+		}
+
+		addMic(buffer.data(), iMicLength);
+		clock.waitFor(frame);
+	}
+
+	qWarning("FileInput: Releasing.");
+}
+
+FileOutput::FileOutput() {
+	bRunning = true;
+
+	qWarning("FileOutput: Initialized");
+}
+
+FileOutput::~FileOutput() {
+	bRunning = false;
+	// Call destructor of all children
+	wipe();
+	// Wait for terminate
+	wait();
+	qWarning("FileOutput: Destroyed");
+}
+
+void FileOutput::run() {
+	const QString path = Global::get().s.qsFileOutput;
+
+	iChannels     = 2;
+	iMixerFreq    = SAMPLE_RATE;
+	eSampleFormat = SampleShort;
+
+	const unsigned int chanmasks[32] = { SPEAKER_FRONT_LEFT, SPEAKER_FRONT_RIGHT };
+	initializeMixer(chanmasks);
+
+	WaveWriter wave;
+	if (!path.isEmpty() && !wave.open(path, iMixerFreq, iChannels)) {
+		qWarning("FileOutput: Failed to open %s, discarding the audio", qPrintable(path));
+	}
+
+	const unsigned int frames = (iFrameSize * iMixerFreq) / SAMPLE_RATE;
+	std::vector< short > buffer(frames * iChannels);
+
+	qWarning("FileOutput: Starting audio playback to %s", path.isEmpty() ? "nowhere" : qPrintable(path));
+
+	const FileAudioClock clock(frames * 1000.0 / iMixerFreq);
+	for (std::uint64_t frame = 1; bRunning; ++frame) {
+		// Silence is written as well, so that the file keeps the timing of the received audio
+		if (!mix(buffer.data(), frames)) {
+			std::fill(buffer.begin(), buffer.end(), 0);
+		}
+
+		wave.write(buffer.data(), buffer.size());
+		clock.waitFor(frame);
+	}
+
+	wave.close();
+	qWarning("FileOutput: Releasing.");
+}
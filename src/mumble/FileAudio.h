@@ -0,0 +1,41 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_FILEAUDIO_H_
+#define MUMBLE_MUMBLE_FILEAUDIO_H_
+
+#include "AudioInput.h"
+#include "AudioOutput.h"
+
+/// An audio input that doesn't need a sound device: it captures silence, a sine tone or a WAV file (played in a loop)
+/// as configured by Settings::qsFileInput.
+///
+/// Together with FileOutput, this allows running clients on machines without any sound server (e.g. to generate
+/// load for a server with real Opus traffic). The audio is produced at the pace set by Settings::fFileAudioSpeed.
+class FileInput : public AudioInput {
+private:
+	Q_OBJECT
+	Q_DISABLE_COPY(FileInput)
+
+public:
+	FileInput();
+	~FileInput() Q_DECL_OVERRIDE;
+	void run() Q_DECL_OVERRIDE;
+};
+
+/// An audio output that mixes the received audio in the pace set by Settings::fFileAudioSpeed and writes it into the
+/// WAV file configured by Settings::qsFileOutput (or discards it).
+class FileOutput : public AudioOutput {
+private:
+	Q_OBJECT
+	Q_DISABLE_COPY(FileOutput)
+
+public:
+	FileOutput();
+	~FileOutput() Q_DECL_OVERRIDE;
+	void run() Q_DECL_OVERRIDE;
+};
+
+#endif
@@ -35,6 +35,7 @@
 #include "PluginManager.h"
 #include "PositionalAudioViewer.h"
 #include "QtWidgetUtils.h"
+#include "RadioEffect.h"
 #include "RichTextEditor.h"
 #include "Screen.h"
 #include "SearchDialog.h"
@@ -236,6 +237,12 @@ MainWindow::MainWindow(QWidget *p)
 		this->setOnTop(qcbOnTop->isChecked());
 		this->setWindowOpacity(qcbOnTop->isChecked() ? 0.7 : 1.0);
 	});
+	// The audio thread must not touch any widgets, so it reads the radio effect's state from a snapshot
+	connect(qcbRadioEffect, &QCheckBox::toggled, [](bool checked) {
+		RadioEffect::Parameters parameters = RadioEffect::parameters();
+		parameters.enabled                 = checked;
+		RadioEffect::setParameters(parameters);
+	});
 	qtIconToolbar->setVisible(true);
 }
 
@@ -1130,99 +1137,15 @@ void MainWindow::enableRecording(bool recordingAllowed) {
 }
 
 void MainWindow::on_Simconnect_Updated() {
-	if (sim->own->com1ActiveMHz - 118 < 0)
-		return;
-	if (sim->own->com2ActiveMHz - 118 < 0)
-		return;
-	QString orgNum1 = QString::number(sim->own->com1ActiveMHz);
-	QString orgNum2  = QString::number(sim->own->com2ActiveMHz);
-	if (qcbSimulator->isChecked()) {
-		switch (orgNum1.length()) {
-			case 3:
-				orgNum1 += ".000";
-				break;
-			case 4:
-				orgNum1 += "000";
-				break;
-			case 5:
-				orgNum1 += "00";
-				break;
-			case 6:
-				orgNum1 += "0";
-				break;
-		}
-		switch (orgNum2.length()) {
-			case 3:
-				orgNum2 += ".000";
-				break;
-			case 4:
-				orgNum2 += "000";
-				break;
-			case 5:
-				orgNum2 += "00";
-				break;
-			case 6:
-				orgNum2 += "0";
-				break;
-		}
-		qlncom1->display(orgNum1);
-		qlncom2->display(orgNum2);
-	}
-	/*if (getContextMenuChannel() == NULL)
-		return;
-	 Global::get().l->log(Log::DebugInfo, QString::number(own->com1ActiveMHz) + QString::number(own->com2ActiveMHz));
-	QString Freq = QString::number(sim->own->com1ActiveMHz);
-	if (getContextMenuChannel()->qsDesc == Freq) {
-		return;
-	}
-	
-	Channel *root              = Channel::get(0);
-	if (root == NULL) {
-		qDebug() << "\n=====================\nNULL\n=====================\n";
-		return;
-	}
-	QSet< Channel * > children = root->allChildren();
-	QSetIterator< Channel * > iter(children);
-	while (iter.hasNext()) {
-		Channel *c = iter.next();
-		if (Freq == c->qsDesc) {
-			Global::get().sh->joinChannel(Global::get().uiSession, c->iId);
-			return;
-		}
-	}
-	QString numFreq = Freq;
-	switch (Freq.length()) {
-		case 3:
-			Freq += ".000";
-			break;
-		case 4:
-			Freq += "000";
-			break;
-		case 5:
-			Freq += "00";
-			break;
-		case 6:
-			Freq += "0";
-			break;
-	}
-
-	Global::get().sh->createChannel(0, Freq, numFreq, 0, true, 50);
-	while (iter.hasNext()) {
-		Channel *c = iter.next();
-		if (numFreq == c->qsDesc) {
-			Global::get().sh->joinChannel(Global::get().uiSession, c->iId);
-			break;
-		}
-	}*/
-
+	// Retune right away instead of waiting for the next run of the switch timer
+	on_switchTimerElapsed();
 
+	const SimulatorComState &state = sim->comState;
+	if (!qcbSimulator->isChecked() || !state.com1Active.isValid() || !state.com2Active.isValid())
+		return;
 
-	// for (int i = 0; Channel::get(i) != NULL; i++) {
-	//	//Global::get().l->log(Log::DebugInfo, Freq + "   " + mapChannel(i)->getPath());
-	//	//if (Freq == Channel::get(i)->getPath()) {
-	//	//	Global::get().sh->joinChannel(Global::get().uiSession, i);
-	//	//}
-	// }
+	qlncom1->display(state.com1Active.toString());
+	qlncom2->display(state.com2Active.toString());
 }
 
 static void recreateServerHandler() {
@@ -3553,6 +3476,10 @@ void MainWindow::serverDisconnected(QAbstractSocket::SocketError err, QString re
 	Global::get().uiSession        = 0;
 	Global::get().pPermissions     = ChanACL::None;
 	Global::get().bAttenuateOthers = false;
+	tunedFrequencies               = {};
+	uiTransmitRadio                = 0;
+	requestedFrequencies           = {};
+	uiRequestedTransmitRadio       = 0;
 	qaServerDisconnect->setEnabled(false);
 //	qaServerInformation->setEnabled(false);
 	qaServerBanList->setEnabled(false);
@@ -4044,53 +3971,23 @@ void MainWindow::destroyUserInformation() {
 
 
 void MainWindow::on_qdialCom1Changed() {
-	QString orgNum;
-	if (qcbSimulator->isChecked()) {
-		if (sim->own->com1ActiveMHz - 118 < 0)
-			return;
-		orgNum = QString::number(sim->own->com1ActiveMHz);
-	}
-	else
-		orgNum = QString::number(118 + qdialCom1->value() * 0.025);
-	switch (orgNum.length()) {
-		case 3:
-			orgNum += ".000";
-			break;
-		case 4:
-			orgNum += "000";
-			break;
-		case 5:
-			orgNum += "00";
-			break;
-		case 6:
-			orgNum += "0";
-			break;
-	}
-	qlncom1->display(orgNum);
-	
+	const Frequency frequency = qcbSimulator->isChecked()
+									? sim->comState.com1Active
+									: Frequency::fromChannel(static_cast< unsigned int >(qdialCom1->value()));
+	if (!frequency.isValid())
+		return;
+
+	qlncom1->display(frequency.toString());
 }
 
 void MainWindow::on_qdialCom2Changed() {
-	QString orgNum;
-	if (qcbSimulator->isChecked())
-		orgNum = QString::number(sim->own->com2ActiveMHz);
-	else 
-		orgNum = QString::number(118 + qdialCom2->value() * 0.025);
-	switch (orgNum.length()) {
-		case 3:
-			orgNum += ".000";
-			break;
-		case 4:
-			orgNum += "000";
-			break;
-		case 5:
-			orgNum += "00";
-			break;
-		case 6:
-			orgNum += "0";
-			break;
-	}
-	qlncom2->display(orgNum);
+	const Frequency frequency = qcbSimulator->isChecked()
+									? sim->comState.com2Active
+									: Frequency::fromChannel(static_cast< unsigned int >(qdialCom2->value()));
+	if (!frequency.isValid())
+		return;
+
+	qlncom2->display(frequency.toString());
 }
 
 void MainWindow::on_switchTimerElapsed() {
@@ -4115,58 +4012,39 @@ void MainWindow::on_switchTimerElapsed() {
 		}
 		
 	}
-	QString Freq;
+	std::array< Frequency, 2 > frequencies;
+	unsigned int transmitRadio = 0;
 	if (qcbSimulator->isChecked()) {
-		if (sim->own->com1ActiveMHz - 118 < 0)
+		const SimulatorComState &state = sim->comState;
+		// Transmitting on a COM implies receiving on it. The other COM is only monitored if receive all is on.
+		transmitRadio       = state.transmit2 ? 1 : 0;
+		const bool receive2 = transmitRadio == 1 || state.receiveAll;
+		const bool receive1 = transmitRadio == 0 || state.receiveAll;
+
+		// Only the radios in use need a valid frequency, an unused one is left untuned whatever it is set to
+		if ((receive1 && !state.com1Active.isValid()) || (receive2 && !state.com2Active.isValid()))
 			return;
-		Freq = QString::number(sim->own->com1ActiveMHz);
+
+		frequencies[0] = receive1 ? state.com1Active : Frequency();
+		frequencies[1] = receive2 ? state.com2Active : Frequency();
 	} else {
-		Freq = QString::number(118 + qdialCom1->value() * 0.025);
-	}
-	// Channel
-	if (getContextMenuChannel() == NULL)
-		return;
-	if (getContextMenuChannel()->qsDesc == Freq) {
-		return;
+		frequencies[0] = Frequency::fromChannel(static_cast< unsigned int >(qdialCom1->value()));
+		frequencies[1] = Frequency::fromChannel(static_cast< unsigned int >(qdialCom2->value()));
 	}
 
-	Channel *root = Channel::get(0);
-	if (root == NULL) {
-		qDebug() << "\n=====================\nNULL\n=====================\n";
+	if (!Global::get().sh || !Global::get().sh->hasSynchronized()
+		|| (frequencies == tunedFrequencies && transmitRadio == uiTransmitRadio))
 		return;
-	}
-	QSet< Channel * > children = root->allChildren();
-	QSetIterator< Channel * > iter(children);
-	while (iter.hasNext()) {
-		Channel *c = iter.next();
-		if (Freq == c->qsDesc) {
-			Global::get().sh->joinChannel(Global::get().uiSession, c->iId);
-			return;
-		}
-	}
-	QString numFreq = Freq;
-	switch (Freq.length()) {
-		case 3:
-			Freq += ".000";
-			break;
-		case 4:
-			Freq += "000";
-			break;
-		case 5:
-			Freq += "00";
-			break;
-		case 6:
-			Freq += "0";
-			break;
-	}
 
-	Global::get().sh->createChannel(0, Freq, numFreq, 0, true, 50);
-	while (iter.hasNext()) {
-		Channel *c = iter.next();
-		if (numFreq == c->qsDesc) {
-			Global::get().sh->joinChannel(Global::get().uiSession, c->iId);
-			break;
-		}
-	}
+	// Wait for the server to confirm a request before repeating it
+	if (frequencies == requestedFrequencies && transmitRadio == uiRequestedTransmitRadio
+		&& tTuneRequest.elapsed() < TUNE_RETRY_INTERVAL_US)
+		return;
 
+	// The server routes our speech by frequency, so there is no need to look up or create a channel for it. Our radios
+	// only count as tuned once the server has echoed the request back (see msgRadioTune).
+	Global::get().sh->tuneRadio(frequencies, transmitRadio);
+	requestedFrequencies     = frequencies;
+	uiRequestedTransmitRadio = transmitRadio;
+	tTuneRequest.restart();
 }
@@ -20,8 +20,11 @@
 #include "Usage.h"
 #include "UserLocalNicknameDialog.h"
 #include "Simulator.h"
+#include "Timer.h"
 #include "ui_MainWindow.h"
 
+#include <array>
+
 #define MB_QEVENT (QEvent::User + 939)
 #define OU_QEVENT (QEvent::User + 940)
 
@@ -141,8 +144,17 @@ public:
 	void updateChatBar();
 	void openTextMessageDialog(ClientUser *p);
 	void openUserLocalNicknameDialog(const ClientUser &p);
-	double Com1 = 118.0;
-	double Com2 = 118.0;
+	/// The frequencies COM1 and COM2 have last been tuned to on the server
+	std::array< Frequency, 2 > tunedFrequencies = {};
+	/// The radio (0 = COM1, 1 = COM2) we last selected for transmitting on the server
+	unsigned int uiTransmitRadio = 0;
+	/// The tuning last requested from the server, which only counts once the server has confirmed it. The server
+	/// doesn't answer requests it refuses (e.g. when they are rate limited), so these are sent again after a while.
+	std::array< Frequency, 2 > requestedFrequencies = {};
+	unsigned int uiRequestedTransmitRadio           = 0;
+	Timer tTuneRequest;
+	/// How long to wait for the server to confirm a tuning request before sending it again (in microseconds)
+	static constexpr quint64 TUNE_RETRY_INTERVAL_US = 2000000;
 	QTimer switchTimer;
 	QTimer commentSyncTimer;
 
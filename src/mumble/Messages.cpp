@@ -1308,6 +1308,16 @@ void MainWindow::msgPluginDataTransmission(const MumbleProto::PluginDataTransmis
 	}
 }
 
+void MainWindow::msgRadioTune(const MumbleProto::RadioTune &msg) {
+	if (msg.session() != Global::get().uiSession) {
+		return;
+	}
+
+	// The server confirmed the frequencies our radios are tuned to
+	tunedFrequencies = { Frequency(msg.frequency_com1()), Frequency(msg.frequency_com2()) };
+	uiTransmitRadio  = static_cast< unsigned int >(msg.transmit_radio());
+}
+
 #undef ACTOR_INIT
 #undef VICTIM_INIT
 #undef SELF_INIT
@@ -0,0 +1,49 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "OpusEncoderSettings.h"
+
+#include <opus.h>
+
+namespace OpusEncoderSettings {
+int getApplication(int bitrate, bool allowLowDelay) {
+	if (allowLowDelay && bitrate >= 64000) { // > 64 kbit/s bitrate and low delay allowed
+		return OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+	} else if (bitrate >= 32000) { // > 32 kbit/s bitrate
+		return OPUS_APPLICATION_AUDIO;
+	} else {
+		return OPUS_APPLICATION_VOIP;
+	}
+}
+
+OpusEncoder *create(int sampleRate, int bitrate, bool allowLowDelay, bool inBandFEC) {
+	OpusEncoder *encoder = opus_encoder_create(sampleRate, 1, getApplication(bitrate, allowLowDelay), nullptr);
+	if (!encoder) {
+		return nullptr;
+	}
+
+	opus_encoder_ctl(encoder, OPUS_SET_VBR(0)); // CBR
+
+	// With in-band FEC, every packet also carries a low-bitrate copy of the audio of the packet before it, from which
+	// the receivers restore that packet if it got lost. Only the speech codec of Opus (SILK) provides such copies, so
+	// Opus is told to expect voice. How many bits go into them depends on the expected packet loss, which update()
+	// keeps up to date. In low delay mode, Opus only uses CELT and hence never adds any.
+	if (inBandFEC) {
+		opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(1));
+		opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+	}
+
+	return encoder;
+}
+
+void update(OpusEncoder *encoder, int bitrate, bool inBandFEC, int lossPercentage) {
+	opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate));
+
+	if (inBandFEC) {
+		// Without any loss to expect, Opus doesn't spend any bits on redundancy
+		opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(lossPercentage));
+	}
+}
+}; // namespace OpusEncoderSettings
@@ -0,0 +1,27 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_OPUSENCODERSETTINGS_H_
+#define MUMBLE_MUMBLE_OPUSENCODERSETTINGS_H_
+
+struct OpusEncoder;
+
+/// How AudioInput sets up its Opus encoder
+namespace OpusEncoderSettings {
+/// @returns The Opus application (OPUS_APPLICATION_*) the encoder is created for at the given bitrate
+int getApplication(int bitrate, bool allowLowDelay);
+
+/// Creates an encoder for mono audio at the given sample rate
+///
+/// @returns The encoder or nullptr on failure
+OpusEncoder *create(int sampleRate, int bitrate, bool allowLowDelay, bool inBandFEC);
+
+/// Applies the settings that are kept up to date for every packet
+///
+/// @param lossPercentage The expected packet loss, which determines how many bits go into the in-band FEC data
+void update(OpusEncoder *encoder, int bitrate, bool inBandFEC, int lossPercentage);
+}; // namespace OpusEncoderSettings
+
+#endif // MUMBLE_MUMBLE_OPUSENCODERSETTINGS_H_
@@ -0,0 +1,40 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "PacketLossEstimator.h"
+
+#include <cmath>
+
+void PacketLossEstimator::update(unsigned int good, unsigned int late, unsigned int lost) {
+	if (good >= m_good && late >= m_late && lost >= m_lost) {
+		// Late packets have reached the server after all, so only the ones that never arrived count as lost
+		const unsigned int sent   = (good - m_good) + (late - m_late) + (lost - m_lost);
+		const unsigned int missed = lost - m_lost;
+
+		// Without any packets sent in the meantime (e.g. while not talking), there is nothing new to learn
+		if (sent > 0) {
+			m_sentWeight = m_sentWeight * DECAY + static_cast< float >(sent);
+			m_lostWeight = m_lostWeight * DECAY + static_cast< float >(missed);
+		}
+	}
+
+	m_good = good;
+	m_late = late;
+	m_lost = lost;
+}
+
+int PacketLossEstimator::getLossPercentage() const {
+	if (m_sentWeight <= 0.0f) {
+		return 0;
+	}
+
+	const int percentage = static_cast< int >(std::lround(m_lostWeight * 100.0f / m_sentWeight));
+
+	return percentage < 100 ? percentage : 100;
+}
+
+void PacketLossEstimator::reset() {
+	*this = PacketLossEstimator();
+}
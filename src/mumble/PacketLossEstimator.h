@@ -0,0 +1,39 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_PACKETLOSSESTIMATOR_H_
+#define MUMBLE_MUMBLE_PACKETLOSSESTIMATOR_H_
+
+/// Estimates the share of our UDP packets that get lost on their way to the server. With every reply to our pings, the
+/// server reports how many of our packets it has received so far (good or late) and how many it has missed (lost).
+///
+/// The estimate follows recent replies and forgets older ones gradually, so that it keeps up with changing network
+/// conditions without jumping around whenever a single packet goes missing.
+class PacketLossEstimator {
+public:
+	/// Takes the cumulative counters of a ping reply into account. If the counters went backwards (which they do
+	/// whenever the crypt state is reset), they are only taken as the new baseline.
+	void update(unsigned int good, unsigned int late, unsigned int lost);
+
+	/// @returns The estimated packet loss in percent, as expected by OPUS_SET_PACKET_LOSS_PERC
+	int getLossPercentage() const;
+
+	void reset();
+
+private:
+	/// The share of the packets counted so far that is kept with every ping reply. With the default ping interval of
+	/// 5 s, the packets counted by a reply lose half of their weight after about 12 s.
+	static constexpr float DECAY = 0.75f;
+
+	unsigned int m_good = 0;
+	unsigned int m_late = 0;
+	unsigned int m_lost = 0;
+
+	/// The decayed number of packets sent and lost
+	float m_sentWeight = 0.0f;
+	float m_lostWeight = 0.0f;
+};
+
+#endif // MUMBLE_MUMBLE_PACKETLOSSESTIMATOR_H_
@@ -0,0 +1,264 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "RadioEffect.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+/// The published parameters. Every field is an atomic of its own, so reading a snapshot never blocks the audio thread.
+/// A snapshot taken while the parameters are being changed may mix old and new values, which is harmless.
+struct SharedParameters {
+	std::atomic< bool > enabled;
+	std::atomic< float > lowCutoff;
+	std::atomic< float > highCutoff;
+	std::atomic< float > distortion;
+	std::atomic< float > noiseLevel;
+	std::atomic< float > heterodyneFrequency;
+	std::atomic< float > heterodyneAmplitude;
+	std::atomic< float > overlapGain;
+
+	SharedParameters() { store(RadioEffect::Parameters()); }
+
+	void store(const RadioEffect::Parameters &parameters) {
+		lowCutoff.store(parameters.lowCutoff, std::memory_order_relaxed);
+		highCutoff.store(parameters.highCutoff, std::memory_order_relaxed);
+		distortion.store(parameters.distortion, std::memory_order_relaxed);
+		noiseLevel.store(parameters.noiseLevel, std::memory_order_relaxed);
+		heterodyneFrequency.store(parameters.heterodyneFrequency, std::memory_order_relaxed);
+		heterodyneAmplitude.store(parameters.heterodyneAmplitude, std::memory_order_relaxed);
+		overlapGain.store(parameters.overlapGain, std::memory_order_relaxed);
+		enabled.store(parameters.enabled, std::memory_order_release);
+	}
+
+	RadioEffect::Parameters load() const {
+		RadioEffect::Parameters parameters;
+		parameters.enabled             = enabled.load(std::memory_order_acquire);
+		parameters.lowCutoff           = lowCutoff.load(std::memory_order_relaxed);
+		parameters.highCutoff          = highCutoff.load(std::memory_order_relaxed);
+		parameters.distortion          = distortion.load(std::memory_order_relaxed);
+		parameters.noiseLevel          = noiseLevel.load(std::memory_order_relaxed);
+		parameters.heterodyneFrequency = heterodyneFrequency.load(std::memory_order_relaxed);
+		parameters.heterodyneAmplitude = heterodyneAmplitude.load(std::memory_order_relaxed);
+		parameters.overlapGain         = overlapGain.load(std::memory_order_relaxed);
+
+		return parameters;
+	}
+};
+
+SharedParameters &sharedParameters() {
+	static SharedParameters parameters;
+
+	return parameters;
+}
+
+constexpr double PI = 3.14159265358979323846;
+
+/// Fits |x|^exponent on [0, 1] with c0 * u + c1 * u^2 + c2 * u^3 + c3 * u^4 where u = sqrt(|x|) (least squares)
+void fitCurve(float exponent, std::array< float, 4 > &coefficients) {
+	constexpr int POINTS = 257;
+
+	// Normal equations
+	double matrix[4][5] = {};
+	for (int point = 0; point < POINTS; ++point) {
+		const double u        = static_cast< double >(point) / (POINTS - 1);
+		const double target   = std::pow(u, 2.0 * exponent);
+		const double basis[4] = { u, u * u, u * u * u, u * u * u * u };
+
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				matrix[row][column] += basis[row] * basis[column];
+			}
+			matrix[row][4] += basis[row] * target;
+		}
+	}
+
+	// Gaussian elimination (the matrix is symmetric positive definite, so no pivoting is needed)
+	for (int pivot = 0; pivot < 4; ++pivot) {
+		for (int row = pivot + 1; row < 4; ++row) {
+			const double factor = matrix[row][pivot] / matrix[pivot][pivot];
+			for (int column = pivot; column < 5; ++column) {
+				matrix[row][column] -= factor * matrix[pivot][column];
+			}
+		}
+	}
+	for (int row = 3; row >= 0; --row) {
+		double value = matrix[row][4];
+		for (int column = row + 1; column < 4; ++column) {
+			value -= matrix[row][column] * coefficients[column];
+		}
+		coefficients[row] = static_cast< float >(value / matrix[row][row]);
+	}
+}
+
+/// sin(pi * t) for t in [-1, 1)
+inline float sinePi(float t) {
+	// Fold into [-0.5, 0.5] where sin(pi * t) = sin(pi * (+-1 - t)). This is done without branches, so that the loops
+	// calling this can be vectorized.
+	t = std::min(t, 1.0f - t);
+	t = std::max(t, -1.0f - t);
+
+	// Taylor series up to x^7 (the error stays below 2e-4)
+	const float x  = static_cast< float >(PI) * t;
+	const float x2 = x * x;
+	return x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f))));
+}
+} // namespace
+
+void RadioEffect::setParameters(const Parameters &parameters) {
+	sharedParameters().store(parameters);
+}
+
+RadioEffect::Parameters RadioEffect::parameters() {
+	return sharedParameters().load();
+}
+
+RadioEffect::SourceState::SourceState() : m_filterMemory() {
+}
+
+RadioEffect::RadioEffect() : m_curve(), m_noise({ 0x9E3779B9u, 0x85EBCA6Bu, 0xC2B2AE35u, 0x27D4EB2Fu }) {
+}
+
+void RadioEffect::prepare(const Parameters &parameters, unsigned int sampleRate) {
+	const bool filtersChanged = !m_prepared || sampleRate != m_sampleRate
+								|| parameters.lowCutoff != m_parameters.lowCutoff
+								|| parameters.highCutoff != m_parameters.highCutoff;
+	const bool curveChanged = !m_prepared || parameters.distortion != m_parameters.distortion;
+
+	if (filtersChanged) {
+		// Second order Butterworth sections (see Robert Bristow-Johnson's "Audio EQ Cookbook")
+		const double q = 1.0 / std::sqrt(2.0);
+
+		const double highOmega = 2.0 * PI * parameters.lowCutoff / sampleRate;
+		const double highAlpha = std::sin(highOmega) / (2.0 * q);
+		const double highA0    = 1.0 + highAlpha;
+		m_highPass.b0          = static_cast< float >((1.0 + std::cos(highOmega)) / 2.0 / highA0);
+		m_highPass.b1          = static_cast< float >(-(1.0 + std::cos(highOmega)) / highA0);
+		m_highPass.b2          = m_highPass.b0;
+		m_highPass.a1          = static_cast< float >(-2.0 * std::cos(highOmega) / highA0);
+		m_highPass.a2          = static_cast< float >((1.0 - highAlpha) / highA0);
+
+		const double lowOmega = 2.0 * PI * parameters.highCutoff / sampleRate;
+		const double lowAlpha = std::sin(lowOmega) / (2.0 * q);
+		const double lowA0    = 1.0 + lowAlpha;
+		m_lowPass.b0          = static_cast< float >((1.0 - std::cos(lowOmega)) / 2.0 / lowA0);
+		m_lowPass.b1          = static_cast< float >((1.0 - std::cos(lowOmega)) / lowA0);
+		m_lowPass.b2          = m_lowPass.b0;
+		m_lowPass.a1          = static_cast< float >(-2.0 * std::cos(lowOmega) / lowA0);
+		m_lowPass.a2          = static_cast< float >((1.0 - lowAlpha) / lowA0);
+	}
+
+	if (curveChanged) {
+		fitCurve(parameters.distortion, m_curve);
+	}
+
+	m_phaseIncrement =
+		static_cast< std::uint32_t >(parameters.heterodyneFrequency / static_cast< float >(sampleRate) * 4294967296.0);
+
+	m_parameters = parameters;
+	m_sampleRate = sampleRate;
+	m_prepared   = true;
+}
+
+void RadioEffect::process(SourceState &state, float *buffer, unsigned int frames, unsigned int channels) const {
+	// Band pass: high pass followed by low pass
+	for (unsigned int channel = 0; channel < channels; ++channel) {
+		float *memory = &state.m_filterMemory[4 * channel];
+		float hp1     = memory[0];
+		float hp2     = memory[1];
+		float lp1     = memory[2];
+		float lp2     = memory[3];
+
+		for (unsigned int i = 0; i < frames; ++i) {
+			float &sample = buffer[i * channels + channel];
+
+			const float high = m_highPass.b0 * sample + hp1;
+			hp1              = m_highPass.b1 * sample - m_highPass.a1 * high + hp2;
+			hp2              = m_highPass.b2 * sample - m_highPass.a2 * high;
+
+			const float low = m_lowPass.b0 * high + lp1;
+			lp1             = m_lowPass.b1 * high - m_lowPass.a1 * low + lp2;
+			lp2             = m_lowPass.b2 * high - m_lowPass.a2 * low;
+
+			sample = low;
+		}
+
+		memory[0] = hp1;
+		memory[1] = hp2;
+		memory[2] = lp1;
+		memory[3] = lp2;
+	}
+
+	const unsigned int samples = frames * channels;
+
+	// Distortion. Beyond full scale the curve is clipped to 1.
+	const float c0 = m_curve[0];
+	const float c1 = m_curve[1];
+	const float c2 = m_curve[2];
+	const float c3 = m_curve[3];
+	for (unsigned int i = 0; i < samples; ++i) {
+		const float u     = std::sqrt(std::min(std::abs(buffer[i]), 1.0f));
+		const float value = std::min(u * (c0 + u * (c1 + u * (c2 + u * c3))), 1.0f);
+
+		buffer[i] = std::copysign(value, buffer[i]);
+	}
+}
+
+void RadioEffect::processMix(float *buffer, unsigned int frames, unsigned int channels, unsigned int sources) {
+	const unsigned int samples = frames * channels;
+
+	if (m_parameters.enabled) {
+		// Static: the generators are advanced in lock-step, which lets the compiler vectorize this loop
+		const float noiseScale = m_parameters.noiseLevel / 2147483648.0f;
+		std::uint32_t noise[4] = { m_noise[0], m_noise[1], m_noise[2], m_noise[3] };
+		unsigned int i         = 0;
+		for (; i + 4 <= samples; i += 4) {
+			for (unsigned int lane = 0; lane < 4; ++lane) {
+				noise[lane] ^= noise[lane] << 13;
+				noise[lane] ^= noise[lane] >> 17;
+				noise[lane] ^= noise[lane] << 5;
+
+				buffer[i + lane] += static_cast< float >(static_cast< std::int32_t >(noise[lane])) * noiseScale;
+			}
+		}
+		for (unsigned int lane = 0; i < samples; ++i, ++lane) {
+			noise[lane] ^= noise[lane] << 13;
+			noise[lane] ^= noise[lane] >> 17;
+			noise[lane] ^= noise[lane] << 5;
+
+			buffer[i] += static_cast< float >(static_cast< std::int32_t >(noise[lane])) * noiseScale;
+		}
+		for (unsigned int lane = 0; lane < 4; ++lane) {
+			m_noise[lane] = noise[lane];
+		}
+	}
+
+	if (sources >= 2) {
+		// The tone is added to the clipped mix, so that loud sources don't drown it out
+		for (unsigned int i = 0; i < samples; ++i) {
+			buffer[i] = std::min(std::max(buffer[i], -1.0f), 1.0f);
+		}
+
+		const float amplitude          = m_parameters.heterodyneAmplitude;
+		const float gain               = m_parameters.overlapGain;
+		const std::uint32_t startPhase = m_phase;
+		const std::uint32_t increment  = m_phaseIncrement;
+
+		// Interpreting the phase as a signed number maps it to [-1, 1)
+		for (unsigned int frame = 0; frame < frames; ++frame) {
+			const std::int32_t phase = static_cast< std::int32_t >(startPhase + increment * frame);
+			const float tone         = amplitude * sinePi(static_cast< float >(phase) / 2147483648.0f);
+
+			for (unsigned int channel = 0; channel < channels; ++channel) {
+				float &sample = buffer[frame * channels + channel];
+				sample        = (sample + tone) * gain;
+			}
+		}
+	}
+
+	m_phase += m_phaseIncrement * frames;
+}
@@ -0,0 +1,99 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_RADIOEFFECT_H_
+#define MUMBLE_MUMBLE_RADIOEFFECT_H_
+
+#include <array>
+#include <cstdint>
+
+/// Makes received transmissions sound like they came out of a VHF AM receiver: the audio is band-limited to the voice
+/// band, distorted and overlaid with static. If several sources play at once, the mix also carries the heterodyne tone
+/// caused by their carriers beating against each other, whether the effect is enabled or not.
+///
+/// The band pass and the distortion are applied to every source separately, the static and the heterodyne once to the
+/// mix. Both run on the audio thread and thus never allocate, lock or call into libm per sample.
+class RadioEffect {
+public:
+	struct Parameters {
+		bool enabled = false;
+		/// The voice band in Hz
+		float lowCutoff  = 300.0f;
+		float highCutoff = 3400.0f;
+		/// The exponent of the distortion curve sign(x) * |x|^distortion
+		float distortion = 0.62f;
+		/// The peak amplitude of the static
+		float noiseLevel = 0.004f;
+		/// The tone heard while sources overlap
+		float heterodyneFrequency = 100.0f;
+		float heterodyneAmplitude = 0.8f;
+		/// The gain applied to the mix while sources overlap
+		float overlapGain = 0.8f;
+	};
+
+	/// Publishes new parameters. May be called from any thread.
+	static void setParameters(const Parameters &parameters);
+	/// @returns A snapshot of the currently published parameters
+	static Parameters parameters();
+
+	/// The state the effect keeps for every source (filter memory)
+	class SourceState {
+	public:
+		SourceState();
+
+	private:
+		friend class RadioEffect;
+
+		/// Transposed direct form II memory of the high pass and the low pass for up to two channels
+		std::array< float, 8 > m_filterMemory;
+	};
+
+	RadioEffect();
+
+	/// Updates the filters and tables to the given parameters. Called once before processing any sources.
+	void prepare(const Parameters &parameters, unsigned int sampleRate);
+
+	/// Applies the band pass and the distortion to a source in place. Only called while the effect is enabled.
+	///
+	/// @param buffer The interleaved samples of the source
+	/// @param channels The number of channels of the source (1 or 2)
+	void process(SourceState &state, float *buffer, unsigned int frames, unsigned int channels) const;
+
+	/// Adds the static (while the effect is enabled) and the heterodyne to the mix of all sources in place. The
+	/// heterodyne is kept phase-continuous across calls.
+	///
+	/// @param buffer The interleaved samples of the mix
+	/// @param sources The number of sources in the mix
+	void processMix(float *buffer, unsigned int frames, unsigned int channels, unsigned int sources);
+
+private:
+	struct Biquad {
+		float b0 = 1.0f;
+		float b1 = 0.0f;
+		float b2 = 0.0f;
+		float a1 = 0.0f;
+		float a2 = 0.0f;
+	};
+
+	Parameters m_parameters;
+	unsigned int m_sampleRate = 0;
+	bool m_prepared           = false;
+
+	Biquad m_highPass;
+	Biquad m_lowPass;
+
+	/// The distortion curve |x|^distortion, fitted as a polynomial in u = sqrt(|x|) (u, u^2, u^3, u^4). Unlike pow or a
+	/// table lookup, this can be evaluated for several samples at once.
+	std::array< float, 4 > m_curve;
+
+	/// Independent xorshift generators for the static, so that it can be computed for several samples at once
+	std::array< std::uint32_t, 4 > m_noise;
+
+	/// The phase of the heterodyne oscillator as a fraction of 2^32
+	std::uint32_t m_phase          = 0;
+	std::uint32_t m_phaseIncrement = 0;
+};
+
+#endif // MUMBLE_MUMBLE_RADIOEFFECT_H_
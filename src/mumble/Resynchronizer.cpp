@@ -0,0 +1,120 @@
+// Copyright 2007-2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "Resynchronizer.h"
+
+#include <QtCore/QtGlobal>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+void Resynchronizer::setFrameSizes(std::size_t micFrameSize, std::size_t speakerFrameSize) {
+	m_micFrameSize = micFrameSize;
+	m_micFrames.assign(SLOTS * micFrameSize, 0);
+	m_micChunk.assign(micFrameSize, 0);
+	m_speakerFrame.assign(speakerFrameSize, 0);
+
+	m_tail.store(0, std::memory_order_relaxed);
+	m_head.store(0, std::memory_order_relaxed);
+	m_overflowed = false;
+	m_filled     = false;
+}
+
+void Resynchronizer::addMic() {
+	const std::uint32_t tail = m_tail.load(std::memory_order_relaxed);
+	// Acquire, so that the speaker side is done copying the frames it has removed before their slots are reused
+	const std::uint32_t queued = tail - m_head.load(std::memory_order_acquire);
+
+	bool drop = false;
+	if (queued >= MAX_QUEUED) {
+		m_overflowed = true;
+		drop         = true;
+	} else if (queued == MAX_QUEUED - 1) {
+		// Once the queue has overflowed, keep it from growing back to its maximum until it has drained
+		drop         = m_overflowed;
+		m_overflowed = true;
+	} else {
+		m_overflowed = false;
+	}
+
+	// The speaker side owns the head of the queue, so instead of the oldest frame, the new one is dropped. This keeps
+	// the fill level (and thus the lag) the same.
+	if (drop) {
+		increment(m_micDrops);
+	} else {
+		m_tail.store(tail + 1, std::memory_order_release);
+	}
+
+	if (bDebugPrintQueue) {
+		if (drop)
+			qWarning("Resynchronizer::addMic(): dropped microphone chunk due to overflow");
+		printQueue('+');
+	}
+}
+
+AudioChunk Resynchronizer::addSpeaker() {
+	const std::uint32_t head   = m_head.load(std::memory_order_relaxed);
+	const std::uint32_t queued = m_tail.load(std::memory_order_acquire) - head;
+
+	if (queued >= static_cast< std::uint32_t >(getNominalLag())) {
+		m_filled = true;
+	}
+
+	AudioChunk result;
+	if (m_filled) {
+		const short *frame = &m_micFrames[(head % SLOTS) * m_micFrameSize];
+		std::copy(frame, frame + m_micFrameSize, m_micChunk.begin());
+
+		m_head.store(head + 1, std::memory_order_release);
+
+		if (queued == 1) {
+			m_filled = false;
+		}
+
+		result = AudioChunk(m_micChunk.data(), m_speakerFrame.data());
+	} else {
+		increment(m_speakerDrops);
+	}
+
+	if (bDebugPrintQueue) {
+		if (result.empty())
+			qWarning("Resynchronizer::addSpeaker(): dropped speaker chunk due to underflow");
+		printQueue('-');
+	}
+	return result;
+}
+
+void Resynchronizer::reset() {
+	if (bDebugPrintQueue)
+		qWarning("Resetting echo queue");
+	m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release);
+	m_filled = false;
+}
+
+Resynchronizer::Statistics Resynchronizer::statistics() const {
+	Statistics statistics;
+	statistics.micDrops     = m_micDrops.load(std::memory_order_relaxed);
+	statistics.speakerDrops = m_speakerDrops.load(std::memory_order_relaxed);
+	// Load the head first, so that the difference can't be negative
+	const std::uint32_t head = m_head.load(std::memory_order_acquire);
+	statistics.queued        = m_tail.load(std::memory_order_acquire) - head;
+
+	return statistics;
+}
+
+void Resynchronizer::printQueue(char who) {
+	const unsigned int mic = statistics().queued;
+	std::string line;
+	line.reserve(32);
+	line += who;
+	line += " Echo queue [";
+	for (unsigned int i = 0; i < MAX_QUEUED; i++)
+		line += i < mic ? '#' : ' ';
+	line += "]\r";
+	// This relies on \r to retrace always on the same line, can't use qWarining
+	printf("%s", line.c_str());
+	fflush(stdout);
+}
@@ -0,0 +1,170 @@
+// Copyright 2007-2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_RESYNCHRONIZER_H_
+#define MUMBLE_MUMBLE_RESYNCHRONIZER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A chunk of audio data to process
+ * This struct wraps pointers to two arrays, containing PCM samples of
+ * microphone and speaker readback data (for echo cancellation).
+ * Does not handle pointer ownership: chunks returned by the Resynchronizer
+ * point into its buffers and are only valid until the next call to
+ * Resynchronizer::addSpeaker() or Resynchronizer::reset().
+ */
+struct AudioChunk {
+	AudioChunk() : mic(nullptr), speaker(nullptr) {}
+	explicit AudioChunk(short *mic) : mic(mic), speaker(nullptr) {}
+	AudioChunk(short *mic, short *speaker) : mic(mic), speaker(speaker) {}
+	bool empty() const { return mic == nullptr; }
+
+	short *mic;     ///< Pointer to microphone samples
+	short *speaker; ///< Pointer to speaker samples, nullptr if echo cancellation is disabled
+};
+
+/*
+ * According to https://www.speex.org/docs/manual/speex-manual/node7.html
+ * "It is important that, at any time, any echo that is present in the input
+ * has already been sent to the echo canceller as echo_frame."
+ * Thus, we artificially introduce a small lag in the microphone by means of
+ * a queue, so as to be sure the speaker data always precedes the microphone.
+ *
+ * There are conflicting requirements for the queue:
+ * - it has to be small enough not to cause a noticeable lag in the voice
+ * - it has to be large enough not to force us to drop packets frequently
+ *   when the addMic() and addEcho() callbacks are called in a jittery way
+ * - its fill level must be controlled so it does not operate towards zero
+ *   elements size, as this would not provide the lag required for the
+ *   echo canceller to work properly.
+ *
+ * The current implementation uses a 5 elements queue, with a control
+ * statemachine that introduces packet drops to control the fill level
+ * to at least 2 (plus or minus one) and less than 4 elements.
+ * With a 10ms chunk, this queue should introduce a ~20ms lag to the voice.
+ *
+ * The microphone and the speaker callbacks may run on different threads, so
+ * the queue is a single-producer single-consumer ring: the microphone side
+ * only ever advances its tail and the speaker side only ever advances its head.
+ * Each side keeps the part of the statemachine it acts on (whether the queue
+ * has been filled up and whether it has overflowed) and derives the rest from
+ * the fill level. All frames are allocated up front and recycled, so neither
+ * side allocates (or locks) while audio is running.
+ */
+class Resynchronizer {
+public:
+	/// The number of microphone frames that are queued at most
+	static constexpr unsigned int MAX_QUEUED = 5;
+
+	/// Counters describing how far the microphone and the speaker clocks have drifted apart
+	struct Statistics {
+		/// Microphone frames dropped because the queue overflowed (the microphone runs faster than the speakers)
+		std::uint64_t micDrops = 0;
+		/// Speaker frames dropped because the queue hadn't been filled up (the speakers run faster than the microphone)
+		std::uint64_t speakerDrops = 0;
+		/// The number of microphone frames currently queued
+		unsigned int queued = 0;
+	};
+
+	/**
+	 * Allocate the frames and empty the queue
+	 * Must be called before the frames are used and while neither the
+	 * microphone nor the speaker side is running.
+	 *
+	 * \param micFrameSize number of samples in a microphone frame
+	 * \param speakerFrameSize number of samples in a speaker frame
+	 */
+	void setFrameSizes(std::size_t micFrameSize, std::size_t speakerFrameSize);
+
+	/**
+	 * \return the buffer the next microphone frame has to be written into
+	 * before calling addMic(). May only be called by the microphone side.
+	 */
+	short *micFrame() { return &m_micFrames[(m_tail.load(std::memory_order_relaxed) % SLOTS) * m_micFrameSize]; }
+
+	/**
+	 * Add the microphone frame written into micFrame() to the resynchronizer queue
+	 * The resynchronizer may decide to drop the frame, in which case the
+	 * buffer is simply reused for the next one.
+	 */
+	void addMic();
+
+	/**
+	 * \return the buffer the next speaker frame has to be written into
+	 * before calling addSpeaker(). May only be called by the speaker side.
+	 */
+	short *speakerFrame() { return m_speakerFrame.data(); }
+
+	/**
+	 * Add the speaker frame written into speakerFrame() to the resynchronizer
+	 * The resynchronizer may decide to drop the frame.
+	 *
+	 * \return If microphone data is available, the resynchronizer will return a
+	 * valid audio chunk to encode, otherwise an empty chunk will be returned
+	 */
+	AudioChunk addSpeaker();
+
+	/**
+	 * Reinitialize the resynchronizer, emptying the queue in the process.
+	 * May only be called by the speaker side.
+	 */
+	void reset();
+
+	/**
+	 * \return the nominal lag that the resynchronizer tries to enforce on the
+	 * microphone data, in order to make sure the speaker data is always passed
+	 * first to the echo canceller
+	 */
+	int getNominalLag() const { return 2; }
+
+	/// \return The drift statistics. May be called from any thread.
+	Statistics statistics() const;
+
+	bool bDebugPrintQueue = false; ///< Enables printing queue fill level stats
+
+private:
+	/// The queued frames and the one being written by the microphone side have to fit, rounded up to a power of two
+	static constexpr unsigned int SLOTS = 8;
+
+	/**
+	 * Print queue level stats for debugging purposes
+	 * \param mic used to distinguish between addMic() and addSpeaker()
+	 */
+	void printQueue(char who);
+
+	/// There is a single writer, so a relaxed load and store suffices
+	static void increment(std::atomic< std::uint64_t > &counter) {
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	std::size_t m_micFrameSize = 0;
+	/// SLOTS microphone frames of m_micFrameSize samples each
+	std::vector< short > m_micFrames;
+	/// The microphone frame handed out by addSpeaker(). It is copied out of the queue, so that the queue can be reset
+	/// while the chunk is still being processed.
+	std::vector< short > m_micChunk;
+	std::vector< short > m_speakerFrame;
+
+	/// The number of frames ever added (written by the microphone side) and removed (written by the speaker side). The
+	/// difference is the fill level of the queue.
+	std::atomic< std::uint32_t > m_tail = { 0 };
+	std::atomic< std::uint32_t > m_head = { 0 };
+
+	/// Whether the queue has overflowed and microphone frames are dropped until it has drained to 3 frames. Only
+	/// accessed by the microphone side.
+	bool m_overflowed = false;
+	/// Whether the queue has been filled up to the nominal lag since it has last been empty. Speaker frames are dropped
+	/// until it is. Only accessed by the speaker side.
+	bool m_filled = false;
+
+	std::atomic< std::uint64_t > m_micDrops     = { 0 };
+	std::atomic< std::uint64_t > m_speakerDrops = { 0 };
+};
+
+#endif // MUMBLE_MUMBLE_RESYNCHRONIZER_H_
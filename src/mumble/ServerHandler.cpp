@@ -351,6 +351,10 @@ void ServerHandler::setServerSynchronized(bool synchronized) {
 	serverSynchronized = synchronized;
 }
 
+int ServerHandler::getUplinkLossPercentage() const {
+	return m_uplinkLossPercentage.load(std::memory_order_relaxed);
+}
+
 void ServerHandler::hostnameResolved() {
 	ServerResolver *sr                    = qobject_cast< ServerResolver * >(QObject::sender());
 	QList< ServerResolverRecord > records = sr->records();
@@ -459,6 +463,8 @@ void ServerHandler::run() {
 		Global::get().mw->rtLast = MumbleProto::Reject_RejectType_None;
 
 		accUDP = accTCP = accClean;
+		m_uplinkLoss.reset();
+		m_uplinkLossPercentage.store(0, std::memory_order_relaxed);
 
 		m_version   = Version::UNKNOWN;
 		qsRelease   = QString();
@@ -673,6 +679,11 @@ void ServerHandler::message(Mumble::Protocol::TCPMessageType type, const QByteAr
 					database->setUdp(qbaDigest, true);
 				}
 			}
+
+			// The counters only cover the packets sent via UDP. Audio tunneled through TCP always arrives.
+			m_uplinkLoss.update(msg.good(), msg.late(), msg.lost());
+			const bool viaUdp = bUdp && !NetworkConfig::TcpModeEnabled();
+			m_uplinkLossPercentage.store(viaUdp ? m_uplinkLoss.getLossPercentage() : 0, std::memory_order_relaxed);
 		}
 	} else {
 		ServerHandlerMessageEvent *shme = new ServerHandlerMessageEvent(qbaMsg, type, false);
@@ -964,6 +975,14 @@ void ServerHandler::createChannel(unsigned int parent_id, const QString &name, c
 	sendMessage(mpcs);
 }
 
+void ServerHandler::tuneRadio(const std::array< Frequency, 2 > &frequencies, unsigned int transmitRadio) {
+	MumbleProto::RadioTune mprt;
+	mprt.set_frequency_com1(frequencies[0].kHz());
+	mprt.set_frequency_com2(frequencies[1].kHz());
+	mprt.set_transmit_radio(static_cast< MumbleProto::RadioTune_Radio >(transmitRadio));
+	sendMessage(mprt);
+}
+
 void ServerHandler::requestBanList() {
 	MumbleProto::BanList mpbl;
 	mpbl.set_query(true);
@@ -32,11 +32,16 @@
 
 #define SERVERSEND_EVENT 3501
 
+#include "Frequency.h"
 #include "Mumble.pb.h"
 #include "MumbleProtocol.h"
+#include "PacketLossEstimator.h"
 #include "ServerAddress.h"
 #include "Timer.h"
 
+#include <array>
+#include <atomic>
+
 class Connection;
 class Database;
 class PacketDataStream;
@@ -91,6 +96,11 @@ protected:
 	QUdpSocket *qusUdp;
 	QMutex qmUdp;
 
+	/// Follows the loss of our packets as reported back by the server
+	PacketLossEstimator m_uplinkLoss;
+	/// The latest estimate of m_uplinkLoss, for the audio input thread to pick up
+	std::atomic< int > m_uplinkLossPercentage = { 0 };
+
 	void handleVoicePacket(const Mumble::Protocol::AudioData &audioData);
 
 public:
@@ -147,6 +157,10 @@ public:
 	/// @param synchronized Whether the server has finished synchronization
 	void setServerSynchronized(bool synchronized);
 
+	/// @returns The estimated share of our audio packets (in percent) that don't make it to the server. May be called
+	/// 	from any thread.
+	int getUplinkLossPercentage() const;
+
 #define PROCESS_MUMBLE_TCP_MESSAGE(name, value) \
 	void sendMessage(const MumbleProto::name &msg) { sendProtoMessage(msg, Mumble::Protocol::TCPMessageType::name); }
 	MUMBLE_ALL_TCP_MESSAGES
@@ -161,6 +175,8 @@ public:
 	void stopListeningToChannels(const QList< int > &channelIDs);
 	void createChannel(unsigned int parent_id, const QString &name, const QString &description, unsigned int position,
 					   bool temporary, unsigned int maxUsers);
+	/// Tunes COM1 and COM2 to the given frequencies (a null frequency untunes) and selects the radio to transmit on
+	void tuneRadio(const std::array< Frequency, 2 > &frequencies, unsigned int transmitRadio);
 	void requestBanList();
 	void requestUserList();
 	void requestACL(unsigned int channel);
@@ -260,6 +260,8 @@ struct Settings {
 	int iVoiceHold                  = 20;
 	int iJitterBufferSize           = 1;
 	bool bAllowLowDelay             = true;
+	/// Whether to add redundancy to the audio packets, depending on how many of them get lost on their way
+	bool bInBandFEC                 = true;
 	NoiseCancel noiseCancelMode     = NoiseCancelSpeex;
 	int iSpeexNoiseCancelStrength   = -30;
 	quint64 uiAudioInputChannelMask = 0xffffffffffffffffULL;
@@ -284,6 +286,12 @@ struct Settings {
 	bool bAttenuateLoopbacks            = false;
 	int iOutputDelay                    = 5;
 
+	// Volume and stereo panning (-1 = left, 1 = right) of radio transmissions received on COM1 and COM2
+	float fCom1Volume = 1.0f;
+	float fCom2Volume = 1.0f;
+	float fCom1Pan    = 0.0f;
+	float fCom2Pan    = 0.0f;
+
 	QString qsALSAInput        = QStringLiteral("default");
 	QString qsALSAOutput       = QStringLiteral("default");
 	uint8_t pipeWireInput      = 1;
@@ -296,8 +304,11 @@ struct Settings {
 	bool bJackAutoConnect      = true;
 	QString qsOSSInput         = {};
 	QString qsOSSOutput        = {};
-	int iPortAudioInput        = -1; // default device
-	int iPortAudioOutput       = -1; // default device
+	int iPortAudioInput        = -1;   // default device
+	int iPortAudioOutput       = -1;   // default device
+	QString qsFileInput        = {};   // silence, "tone:<Hz>" or the path of a WAV file
+	QString qsFileOutput       = {};   // discard or the path of a WAV file
+	float fFileAudioSpeed      = 1.0f; // 1 = real time, <= 0 = as fast as possible
 
 	bool bASIOEnable                = true;
 	QString qsASIOclass             = {};
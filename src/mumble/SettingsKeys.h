@@ -61,6 +61,7 @@ const SettingsKey NOISE_CANCEL_MODE_KEY                       = { "noise_cancel_
 const SettingsKey SPEEX_NOISE_CANCEL_STRENGTH_KEY             = { "speex_noise_cancel_strength" };
 const SettingsKey INPUT_CHANNEL_MASK_KEY                      = { "input_channel_mask" };
 const SettingsKey ALLOW_LOW_DELAY_MODE_KEY                    = { "allow_low_delay_mode" };
+const SettingsKey IN_BAND_FEC_KEY                             = { "in_band_fec" };
 const SettingsKey VOICE_HOLD_KEY                              = { "voice_hold" };
 const SettingsKey OUTPUT_DELAY_KEY                            = { "output_delay" };
 const SettingsKey ECHO_CANCEL_MODE_KEY                        = { "echo_cancel_mode" };
@@ -72,6 +73,10 @@ const SettingsKey NOTIFICATION_VOLUME_KEY                     = { "notification_
 const SettingsKey CUE_VOLUME_KEY                              = { "cue_volume" };
 const SettingsKey RESTRICT_WHISPERS_TO_FRIENDS_KEY            = { "restrict_whispers_to_friends" };
 const SettingsKey NOTIFICATION_USER_LIMIT_KEY                 = { "notification_user_limit" };
+const SettingsKey COM1_VOLUME_KEY                             = { "com1_volume" };
+const SettingsKey COM2_VOLUME_KEY                             = { "com2_volume" };
+const SettingsKey COM1_PAN_KEY                                = { "com1_pan" };
+const SettingsKey COM2_PAN_KEY                                = { "com2_pan" };
 
 // Idle settings
 const SettingsKey IDLE_TIME_KEY                  = { "idle_time" };
@@ -149,6 +154,11 @@ const SettingsKey COREAUDIO_OUTPUT_KEY = { "coreaudio_output" };
 const SettingsKey PORTAUDIO_INPUT_KEY  = { "portaudio_input" };
 const SettingsKey PORTAUDIO_OUTPUT_KEY = { "portaudio_output" };
 
+// File
+const SettingsKey FILE_AUDIO_INPUT_KEY  = { "file_audio_input" };
+const SettingsKey FILE_AUDIO_OUTPUT_KEY = { "file_audio_output" };
+const SettingsKey FILE_AUDIO_SPEED_KEY  = { "file_audio_speed" };
+
 // TTS
 const SettingsKey TTS_ENABLE_KEY        = { "enable_tts" };
 const SettingsKey TTS_VOLUME_KEY        = { "tts_volume" };
@@ -45,6 +45,7 @@
 	PROCESS(audio, SPEEX_NOISE_CANCEL_STRENGTH_KEY, iSpeexNoiseCancelStrength)              \
 	PROCESS(audio, INPUT_CHANNEL_MASK_KEY, uiAudioInputChannelMask)                         \
 	PROCESS(audio, ALLOW_LOW_DELAY_MODE_KEY, bAllowLowDelay)                                \
+	PROCESS(audio, IN_BAND_FEC_KEY, bInBandFEC)                                             \
 	PROCESS(audio, VOICE_HOLD_KEY, iVoiceHold)                                              \
 	PROCESS(audio, OUTPUT_DELAY_KEY, iOutputDelay)                                          \
 	PROCESS(audio, ECHO_CANCEL_MODE_KEY, echoOption)                                        \
@@ -55,7 +56,11 @@
 	PROCESS(audio, NOTIFICATION_VOLUME_KEY, notificationVolume)                             \
 	PROCESS(audio, CUE_VOLUME_KEY, cueVolume)                                               \
 	PROCESS(audio, RESTRICT_WHISPERS_TO_FRIENDS_KEY, bWhisperFriends)                       \
-	PROCESS(audio, NOTIFICATION_USER_LIMIT_KEY, iMessageLimitUserThreshold)
+	PROCESS(audio, NOTIFICATION_USER_LIMIT_KEY, iMessageLimitUserThreshold)                 \
+	PROCESS(audio, COM1_VOLUME_KEY, fCom1Volume)                                            \
+	PROCESS(audio, COM2_VOLUME_KEY, fCom2Volume)                                            \
+	PROCESS(audio, COM1_PAN_KEY, fCom1Pan)                                                  \
+	PROCESS(audio, COM2_PAN_KEY, fCom2Pan)
 
 
 #define IDLE_SETTINGS                             \
@@ -119,7 +124,10 @@
 	PROCESS(audio_backend, COREAUDIO_INPUT_KEY, qsCoreAudioInput)     \
 	PROCESS(audio_backend, COREAUDIO_OUTPUT_KEY, qsCoreAudioOutput)   \
 	PROCESS(audio_backend, PORTAUDIO_INPUT_KEY, iPortAudioInput)      \
-	PROCESS(audio_backend, PORTAUDIO_OUTPUT_KEY, iPortAudioOutput)
+	PROCESS(audio_backend, PORTAUDIO_OUTPUT_KEY, iPortAudioOutput)    \
+	PROCESS(audio_backend, FILE_AUDIO_INPUT_KEY, qsFileInput)         \
+	PROCESS(audio_backend, FILE_AUDIO_OUTPUT_KEY, qsFileOutput)       \
+	PROCESS(audio_backend, FILE_AUDIO_SPEED_KEY, fFileAudioSpeed)
 
 
 #define TTS_SETTINGS                                    \
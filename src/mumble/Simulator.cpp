@@ -1,156 +1,189 @@
 #include "Simulator.h"
 #include "MainWindow.h"
 
+#include <QtCore/QElapsedTimer>
 
+SimulatorAcquisition::SimulatorAcquisition(QObject *parent) : QThread(parent) {
+}
 
-void CALLBACK MyDispatchProc1(SIMCONNECT_RECV *pData, DWORD cbData, void *pContext) {
-	switch (pData->dwID) {
-		case SIMCONNECT_RECV_ID_SIMOBJECT_DATA: {
-			SIMCONNECT_RECV_SIMOBJECT_DATA *pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA *) pData;
+SimulatorAcquisition::~SimulatorAcquisition() {
+	stop();
+	wait();
+}
 
-			switch (pObjData->dwRequestID) {
-				case REQUEST_OWN_AIRCRAFT:
-					DataOwnAircraft *pS = (DataOwnAircraft *) &pObjData->dwData;
-					pThis->packetCount  = 0;
-					pThis->own                    = pS;
-					emit pThis->RaiseSimdataUpdated();
-					//qDebug()<<"\n======================\n" << pS->com1ActiveMHz << pS->com2ActiveMHz << pS->comReceiveAll << "\n======================\n";
-					break;
+void SimulatorAcquisition::stop() {
+	m_running.store(false);
+}
+
+void SimulatorAcquisition::run() {
+	// A single socket is used for as long as the thread runs instead of opening a new one for every attempt
+	m_xplane = std::make_unique< XPlaneComPoller >("127.0.0.1");
+
+	QElapsedTimer connectTimer;
+	bool attempted = false;
+
+	while (m_running.load()) {
+		if (m_mode == 0) {
+			if (!attempted || connectTimer.hasExpired(CONNECT_INTERVAL)) {
+				attempted = true;
+				connectTimer.start();
+
+				if (connectSimulator()) {
+					continue;
+				}
 			}
-			break;
+
+			// Sleep in small steps so that stop() takes effect quickly
+			QThread::msleep(100);
+			continue;
 		}
 
-		case SIMCONNECT_RECV_ID_QUIT: {
-			//        pThis->quit = 1;
-			break;
+		QElapsedTimer pollTimer;
+		pollTimer.start();
+
+		SimulatorComState state;
+		const bool received = (m_mode == 1) ? pollXPlane(state) : pollMSFS(state);
+
+		if (received) {
+			m_missedPolls = 0;
+
+			// Only actual changes are reported
+			if (!m_stateReported || state != m_state) {
+				m_state         = state;
+				m_stateReported = true;
+				emit comStateChanged(state);
+			}
+		} else if (m_msfsQuit || ++m_missedPolls >= MAX_MISSED_POLLS) {
+			qDebug() << "\n========================\nLost\n=============================\n";
+			closeSimConnect();
+			setMode(0);
+			attempted = false;
+			continue;
 		}
 
-		default:
-			break;
+		if (m_mode == 1) {
+			const qint64 elapsed = pollTimer.elapsed();
+			if (elapsed < static_cast< qint64 >(POLL_INTERVAL)) {
+				QThread::msleep(POLL_INTERVAL - static_cast< unsigned long >(elapsed));
+			}
+		}
 	}
+
+	closeSimConnect();
+	m_xplane.reset();
 }
 
-SimulatorSimConnect::SimulatorSimConnect() {
-	own = new DataOwnAircraft();
-	pThis = this;
-	connectTimer = new QTimer();
-	connectTimer->setInterval(5000);
-	connectTimer->start();
-	connect(connectTimer, &QTimer::timeout, this, &SimulatorSimConnect::onConnectTimerElipsed);
-	timer = new QTimer();
-	timer->setInterval(1000);
-	timer->start();
-	connect(timer, &QTimer::timeout, this, &SimulatorSimConnect::onPosTimerElipsed);
-}
-
-void SimulatorSimConnect::onConnectTimerElipsed() {
-	if (mode != 0)
-	{
-		return;
-	}
+bool SimulatorAcquisition::connectSimulator() {
 	qDebug() << "========================\nTrying XPlane\n=============================";
-	XPCsock = openUDP(XPCIP);
-	float tVal[1];
-	int tSize = 1;
-	if (!(getDREF(XPCsock, "sim/test/test_float", tVal, &tSize) < 0)) {
+	if (m_xplane->probe()) {
 		qDebug() << "========================\nGOOD FOR XPLANE!!!!!!!!!!!!!\n=============================";
-		mode = 1;
-		return;
+		setMode(1);
+		return true;
 	}
 	qDebug() << "========================\nTrying MSFS2020\n=============================";
-	if (this->initSimEvents()) {
+	if (openSimConnect()) {
 		qDebug() << "========================\nGOOD FOR MSFS20220!!!!!!!!!!!!!\n=============================";
-		mode = 2;
-		return;
+		setMode(2);
+		return true;
 	}
+
+	return false;
 }
 
-bool SimulatorSimConnect::initSimEvents() {
-	HRESULT hr;
-	if (SUCCEEDED(SimConnect_Open(&hSimConnect, "SkylineVoice", NULL, 0, NULL, 0))) {
+void SimulatorAcquisition::setMode(int mode) {
+	m_mode          = mode;
+	m_missedPolls   = 0;
+	m_stateReported = false;
+
+	emit modeChanged(mode);
+}
+
+bool SimulatorAcquisition::openSimConnect() {
+	// SimConnect signals this event whenever new data is available, so we don't have to poll it
+	m_simConnectEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	if (SUCCEEDED(SimConnect_Open(&m_simConnect, "SkylineVoice", NULL, 0, m_simConnectEvent, 0))) {
 		// DATA
 		qDebug() << "\nSimConnect Connected!\n";
-		initOwnAircraft(hSimConnect);
-		// EVERY SECOND REQUEST DATA FOR DEFINITION 1 ON THE CURRENT USER AIRCRAFT (SIMCONNECT_OBJECT_ID_USER)
-		hr += SimConnect_RequestDataOnSimObject(hSimConnect, REQUEST_OWN_AIRCRAFT, DEFINITION_OWN_AIRCRAFT,
-			SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_SIM_FRAME);
+		initOwnAircraft(m_simConnect);
+		// EVERY SIMULATION FRAME REQUEST DATA FOR DEFINITION 1 ON THE CURRENT USER AIRCRAFT (SIMCONNECT_OBJECT_ID_USER)
+		SimConnect_RequestDataOnSimObject(m_simConnect, REQUEST_OWN_AIRCRAFT, DEFINITION_OWN_AIRCRAFT,
+										  SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_SIM_FRAME);
+		m_msfsQuit = false;
 		return true;
 	} else {
 		qDebug() << "\nFailed to Connect!!!!\n";
+		CloseHandle(m_simConnectEvent);
+		m_simConnectEvent = NULL;
 		return false;
 	}
-	return false;
 }
 
-void SimulatorSimConnect::getFromXplane() {
-	const char *drefs[4] = { "sim/cockpit/radios/com1_freq_hz", // indicated airspeed
-							 "sim/cockpit/radios/com2_freq_hz", // fuel quantity in each tank, a float array of size 10
-							 "sim/cockpit/radios/com1_stdby_freq_hz", // pitch reading displayed on attitude indicator
-							 "sim/cockpit/radios/com2_stdby_freq_hz" };
-	float *values[4];
-	unsigned char count = 4;
-	values[0] = (float *) malloc(1 * sizeof(float));
-	values[1] = (float *) malloc(
-		1 * sizeof(float));
-	values[2] = (float *) malloc(1 * sizeof(float));
-	values[3] = (float *) malloc(1 * sizeof(float));
-
-	int sizes[4] = { 1, 1, 1, 1 };
-	if (getDREFs(XPCsock, drefs, values, count, sizes) < 0) {
-		qDebug() << " XPC::An error occured.\n";
-	} else {
-		qDebug() << "XPC: Successfully got freqData\n";
-		int com1a = (int) *values[0]*10;
-		int com2a = (int) *values[1]*10;
-		int com1s = (int) *values[2]*10;
-		int com2s = (int) *values[3] * 10;
-		com1a     = (com1a / 25 * 25 + ((com1a % 25 == 0) ? 0 : 25));
-		com2a     = (com2a / 25 * 25 + ((com2a % 25 == 0) ? 0 : 25));
-		com1s     = (com1s / 25 * 25 + ((com1s % 25 == 0) ? 0 : 25));
-		com2s     = (com2s / 25 * 25 + ((com2s % 25 == 0) ? 0 : 25));
-		own->com1ActiveMHz = com1a/1000.0;
-		own->com2ActiveMHz  = com2a / 1000.0;
-		own->com1StandbyMHz = com1s / 1000.0;
-		own->com2StandbyMHz = com2s / 1000.0;
-		packetCount = 0;
-		emit RaiseSimdataUpdated();
+void SimulatorAcquisition::closeSimConnect() {
+	if (m_simConnect) {
+		SimConnect_Close(m_simConnect);
+		m_simConnect = NULL;
 	}
+	if (m_simConnectEvent) {
+		CloseHandle(m_simConnectEvent);
+		m_simConnectEvent = NULL;
+	}
+}
 
+bool SimulatorAcquisition::pollXPlane(SimulatorComState &state) {
+	return m_xplane->poll(state);
+}
 
-	delete values[0], values[1], values[2], values[3];
-
+bool SimulatorAcquisition::pollMSFS(SimulatorComState &state) {
+	// Wake up as soon as SimConnect has got new data for us (or after the poll interval at the latest)
+	WaitForSingleObject(m_simConnectEvent, POLL_INTERVAL);
 
-}
+	m_msfsStateReceived = false;
+	SimConnect_CallDispatch(m_simConnect, &SimulatorAcquisition::dispatch, this);
 
-void SimulatorSimConnect::onPosTimerElipsed() {
-	if (mode == 0) {
-		return;
+	if (m_msfsStateReceived) {
+		state = m_msfsState;
 	}
-	if (mode == 1)
-	{
-		getFromXplane();
-	}else if (mode == 2){
-		callProc();
-	}
-	
-	packetCount++;
-	if (packetCount >= 10) {
-		mode = 0;
-		qDebug() << "\n========================\nLost\n=============================\n";
-		closeSimconnect();
-		connectTimer->start();
-	}
-}
 
-void SimulatorSimConnect::closeSimconnect() {
-	SimConnect_Close(hSimConnect);
+	return m_msfsStateReceived;
 }
 
-void SimulatorSimConnect::callProc() {
-	SimConnect_CallDispatch(hSimConnect, MyDispatchProc1, NULL);
+void CALLBACK SimulatorAcquisition::dispatch(SIMCONNECT_RECV *pData, DWORD cbData, void *pContext) {
+	SimulatorAcquisition *self = static_cast< SimulatorAcquisition * >(pContext);
+
+	switch (pData->dwID) {
+		case SIMCONNECT_RECV_ID_SIMOBJECT_DATA: {
+			SIMCONNECT_RECV_SIMOBJECT_DATA *pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA *) pData;
+
+			switch (pObjData->dwRequestID) {
+				case REQUEST_OWN_AIRCRAFT:
+					// The data only lives as long as this callback, so take a copy of what we need
+					const DataOwnAircraft *pS = (const DataOwnAircraft *) &pObjData->dwData;
+
+					self->m_msfsState.com1Active  = Frequency::fromMHz(pS->com1ActiveMHz);
+					self->m_msfsState.com2Active  = Frequency::fromMHz(pS->com2ActiveMHz);
+					self->m_msfsState.com1Standby = Frequency::fromMHz(pS->com1StandbyMHz);
+					self->m_msfsState.com2Standby = Frequency::fromMHz(pS->com2StandbyMHz);
+					self->m_msfsState.transmit1   = pS->comTransmit1 != 0;
+					self->m_msfsState.transmit2   = pS->comTransmit2 != 0;
+					self->m_msfsState.receiveAll  = pS->comReceiveAll != 0;
+					self->m_msfsStateReceived     = true;
+					break;
+			}
+			break;
+		}
+
+		case SIMCONNECT_RECV_ID_QUIT: {
+			self->m_msfsQuit = true;
+			break;
+		}
+
+		default:
+			break;
+	}
 }
 
-bool SimulatorSimConnect::initOwnAircraft(const HANDLE hSimConnect) {
+bool SimulatorAcquisition::initOwnAircraft(const HANDLE hSimConnect) {
 	HRESULT hr = S_OK;
 	hr += SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_OWN_AIRCRAFT, "PLANE LATITUDE", "Degrees");
 	hr += SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_OWN_AIRCRAFT, "PLANE LONGITUDE", "Degrees");
@@ -169,3 +202,26 @@ bool SimulatorSimConnect::initOwnAircraft(const HANDLE hSimConnect) {
 	hr += SimConnect_AddToDataDefinition(hSimConnect, DEFINITION_OWN_AIRCRAFT, "COM STATUS:2", "Enum");
 	return hr == S_OK;
 }
+
+
+SimulatorSimConnect::SimulatorSimConnect() {
+	qRegisterMetaType< SimulatorComState >();
+	connect(&m_acquisition, &SimulatorAcquisition::modeChanged, this, &SimulatorSimConnect::onModeChanged);
+	connect(&m_acquisition, &SimulatorAcquisition::comStateChanged, this, &SimulatorSimConnect::onComStateChanged);
+	m_acquisition.start();
+}
+
+SimulatorSimConnect::~SimulatorSimConnect() {
+	m_acquisition.stop();
+	m_acquisition.wait();
+}
+
+void SimulatorSimConnect::onModeChanged(int mode) {
+	this->mode = mode;
+}
+
+void SimulatorSimConnect::onComStateChanged(SimulatorComState state) {
+	comState = state;
+
+	emit RaiseSimdataUpdated();
+}
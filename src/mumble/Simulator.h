@@ -2,10 +2,15 @@
 #define SIMULATOR_H
 #include "SimConnect/include/SimConnect.h"
 #include <QtCore/QObject>
-#include <QtCore/qtimer.h>
+#include <QtCore/QThread>
 #include <QtCore/qdebug.h>
 #include "Global.h"
-#include "XPC/xplaneConnect.h"
+#include "SimulatorComState.h"
+#include "XPlaneComPoller.h"
+
+#include <atomic>
+#include <memory>
+
 enum DATA_DEFINE_ID {
 	DEFINITION_OWN_AIRCRAFT,
 };
@@ -33,7 +38,62 @@ struct DataOwnAircraft {
 
 };
 
+/// Looks for a running simulator and polls the state of its COM radios on a thread of its own. Changes are reported
+/// through comStateChanged() as soon as they are noticed.
+class SimulatorAcquisition : public QThread {
+	Q_OBJECT
+
+public:
+	/// The interval (in ms) in which a connected simulator is polled. This bounds the latency of tuning a radio.
+	static constexpr unsigned long POLL_INTERVAL = 50;
+	/// The interval (in ms) in which we look for a running simulator
+	static constexpr unsigned long CONNECT_INTERVAL = 5000;
+	/// The number of consecutive polls without any data after which the simulator is considered gone (10 s)
+	static constexpr unsigned int MAX_MISSED_POLLS = 10000 / POLL_INTERVAL;
+
+	SimulatorAcquisition(QObject *parent = nullptr);
+	~SimulatorAcquisition() override;
+
+	/// Makes the thread exit. Use wait() to wait for it to have finished.
+	void stop();
+
+signals:
+	/// @param mode 0 if no simulator is connected, 1 for X-Plane and 2 for MSFS
+	void modeChanged(int mode);
+	void comStateChanged(SimulatorComState state);
+
+protected:
+	void run() override;
 
+private:
+	std::atomic< bool > m_running = { true };
+	int m_mode                    = 0;
+	unsigned int m_missedPolls    = 0;
+
+	/// The state last reported through comStateChanged()
+	SimulatorComState m_state;
+	bool m_stateReported = false;
+
+	/// Created by the thread itself, so that the socket is only ever used by it
+	std::unique_ptr< XPlaneComPoller > m_xplane;
+
+	HANDLE m_simConnect      = NULL;
+	HANDLE m_simConnectEvent = NULL;
+	/// Written by the dispatch callback
+	SimulatorComState m_msfsState;
+	bool m_msfsStateReceived = false;
+	bool m_msfsQuit          = false;
+
+	bool connectSimulator();
+	bool openSimConnect();
+	void closeSimConnect();
+	bool initOwnAircraft(const HANDLE hSimConnect);
+	bool pollXPlane(SimulatorComState &state);
+	bool pollMSFS(SimulatorComState &state);
+	void setMode(int mode);
+
+	static void CALLBACK dispatch(SIMCONNECT_RECV *pData, DWORD cbData, void *pContext);
+};
 
 class SimulatorSimConnect : public QObject {
 
@@ -41,35 +101,22 @@ Q_OBJECT
 
 public:
 	SimulatorSimConnect();
+	~SimulatorSimConnect() override;
 
-	bool initSimEvents();
-	void closeSimconnect();
-	void callProc();
-	void getFromXplane();
-	DataOwnAircraft *own;
-	QTimer *timer;
-	QTimer *connectTimer;
-	int packetCount = 0;
-	const char *XPCIP  = "127.0.0.1"; // IP Address of computer running X-Plane
-	XPCSocket XPCsock;
+	/// The latest state reported by the simulator. Only ever accessed from the main thread.
+	SimulatorComState comState;
+	/// 0 if no simulator is connected, 1 for X-Plane and 2 for MSFS
 	int mode = 0;
 
 signals:
 	void RaiseSimconnectConnected();
 	void RaiseSimdataUpdated();
 private slots:
-	void onPosTimerElipsed();
-	void onConnectTimerElipsed();
+	void onModeChanged(int mode);
+	void onComStateChanged(SimulatorComState state);
 
 private:
-	
-	bool initOwnAircraft(const HANDLE hSimConnect);
-	HANDLE hSimConnect = NULL;
-
-
-
+	SimulatorAcquisition m_acquisition;
 };
 
-static SimulatorSimConnect *pThis = NULL;
-
-#endif
\ No newline at end of file
+#endif
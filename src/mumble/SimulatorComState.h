@@ -0,0 +1,43 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_SIMULATORCOMSTATE_H_
+#define MUMBLE_MUMBLE_SIMULATORCOMSTATE_H_
+
+#include "Frequency.h"
+
+#include <QtCore/QMetaType>
+
+/// The state of the aircraft's COM radios as reported by the simulator
+struct SimulatorComState {
+	Frequency com1Active;
+	Frequency com2Active;
+	Frequency com1Standby;
+	Frequency com2Standby;
+	bool transmit1  = false;
+	bool transmit2  = false;
+	bool receiveAll = false;
+
+	/// X-Plane reports frequencies in units of 10 kHz (e.g. 11832 for 118.325 MHz). The frequency is rounded up to
+	/// the 25 kHz channel it belongs to.
+	static Frequency fromXPlane(float frequency10KHz) {
+		const unsigned int frequencyKHz = static_cast< unsigned int >(frequency10KHz) * 10;
+
+		return Frequency((frequencyKHz + Frequency::CHANNEL_SPACING_KHZ - 1) / Frequency::CHANNEL_SPACING_KHZ
+						 * Frequency::CHANNEL_SPACING_KHZ);
+	}
+
+	bool operator==(const SimulatorComState &other) const {
+		return com1Active == other.com1Active && com2Active == other.com2Active && com1Standby == other.com1Standby
+			   && com2Standby == other.com2Standby && transmit1 == other.transmit1 && transmit2 == other.transmit2
+			   && receiveAll == other.receiveAll;
+	}
+
+	bool operator!=(const SimulatorComState &other) const { return !(*this == other); }
+};
+
+Q_DECLARE_METATYPE(SimulatorComState)
+
+#endif // MUMBLE_MUMBLE_SIMULATORCOMSTATE_H_
@@ -0,0 +1,47 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "XPlaneComPoller.h"
+
+static const char *COM_DATAREFS[] = { "sim/cockpit/radios/com1_freq_hz", "sim/cockpit/radios/com2_freq_hz",
+									  "sim/cockpit/radios/com1_stdby_freq_hz",
+									  "sim/cockpit/radios/com2_stdby_freq_hz" };
+
+XPlaneComPoller::XPlaneComPoller(const char *address, unsigned short port)
+	: m_socket(aopenUDP(address, port, 0)), m_values() {
+	for (unsigned char i = 0; i < DATAREF_COUNT; ++i) {
+		m_valuePointers[i] = &m_values[i];
+	}
+}
+
+XPlaneComPoller::~XPlaneComPoller() {
+	closeUDP(m_socket);
+}
+
+bool XPlaneComPoller::probe() {
+	float value = 0;
+	int size    = 1;
+
+	return getDREF(m_socket, "sim/test/test_float", &value, &size) >= 0;
+}
+
+bool XPlaneComPoller::poll(SimulatorComState &state) {
+	m_sizes.fill(1);
+
+	if (getDREFs(m_socket, COM_DATAREFS, m_valuePointers.data(), DATAREF_COUNT, m_sizes.data()) < 0) {
+		return false;
+	}
+
+	state.com1Active  = SimulatorComState::fromXPlane(m_values[0]);
+	state.com2Active  = SimulatorComState::fromXPlane(m_values[1]);
+	state.com1Standby = SimulatorComState::fromXPlane(m_values[2]);
+	state.com2Standby = SimulatorComState::fromXPlane(m_values[3]);
+	// The audio panel is not queried from X-Plane: receive on both COMs and transmit on COM1
+	state.transmit1  = true;
+	state.transmit2  = false;
+	state.receiveAll = true;
+
+	return true;
+}
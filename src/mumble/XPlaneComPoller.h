@@ -0,0 +1,44 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_XPLANECOMPOLLER_H_
+#define MUMBLE_MUMBLE_XPLANECOMPOLLER_H_
+
+#include "SimulatorComState.h"
+
+#include "XPC/xplaneConnect.h"
+
+#include <array>
+
+/// Queries the COM radios from X-Plane through the XPC plugin. A single UDP socket is kept open for the poller's
+/// entire lifetime and all values are read into fixed buffers.
+class XPlaneComPoller {
+public:
+	/// @param address The IPv4 address of the computer running X-Plane
+	/// @param port The port the XPC plugin listens on
+	XPlaneComPoller(const char *address = "127.0.0.1", unsigned short port = 49009);
+	~XPlaneComPoller();
+
+	XPlaneComPoller(const XPlaneComPoller &) = delete;
+	XPlaneComPoller &operator=(const XPlaneComPoller &) = delete;
+
+	/// @returns Whether X-Plane answers our requests
+	bool probe();
+
+	/// Reads the current state of the COM radios. Blocks for at most 50 ms while waiting for X-Plane's answer.
+	///
+	/// @returns Whether the state could be read
+	bool poll(SimulatorComState &state);
+
+protected:
+	static constexpr unsigned char DATAREF_COUNT = 4;
+
+	XPCSocket m_socket;
+	std::array< float, DATAREF_COUNT > m_values;
+	std::array< float *, DATAREF_COUNT > m_valuePointers;
+	std::array< int, DATAREF_COUNT > m_sizes;
+};
+
+#endif // MUMBLE_MUMBLE_XPLANECOMPOLLER_H_
@@ -100,13 +100,66 @@ void AudioReceiverBuffer::preprocessBuffer() {
 }
 
 void AudioReceiverBuffer::clear() {
+	m_activePlan = nullptr;
+
 	m_regularReceivers.clear();
 	m_regularReceiverIndices.clear();
 	m_positionalReceivers.clear();
 	m_positionalReceiverIndices.clear();
 }
 
+bool AudioReceiverBuffer::PlanKey::operator==(const PlanKey &other) const {
+	return generation == other.generation && senderSession == other.senderSession && target == other.target
+		   && containsPositionalData == other.containsPositionalData;
+}
+
+std::size_t AudioReceiverBuffer::PlanKeyHash::operator()(const PlanKey &key) const {
+	// The generation is the same for all plans that are kept
+	return std::hash< unsigned int >()((key.senderSession << 8) ^ (key.target << 1)
+									   ^ static_cast< unsigned int >(key.containsPositionalData));
+}
+
+bool AudioReceiverBuffer::usePlan(const PlanKey &key) {
+	ZoneScoped;
+
+	if (key.generation != m_planGeneration) {
+		// The plans reference receivers that might not even exist anymore
+		m_plans.clear();
+		m_planGeneration = key.generation;
+
+		return false;
+	}
+
+	auto it = m_plans.find(key);
+	if (it == m_plans.end()) {
+		return false;
+	}
+
+	m_activePlan = &it->second;
+
+	return true;
+}
+
+void AudioReceiverBuffer::storePlan(const PlanKey &key) {
+	ZoneScoped;
+
+	if (key.generation != m_planGeneration) {
+		m_plans.clear();
+		m_planGeneration = key.generation;
+	} else if (m_plans.size() >= MAX_PLANS) {
+		m_plans.clear();
+	}
+
+	Plan &plan = m_plans[key];
+	plan.regularReceivers.assign(m_regularReceivers.begin(), m_regularReceivers.end());
+	plan.positionalReceivers.assign(m_positionalReceivers.begin(), m_positionalReceivers.end());
+}
+
 std::vector< AudioReceiver > &AudioReceiverBuffer::getReceivers(bool receivePositionalData) {
+	if (m_activePlan) {
+		return receivePositionalData ? m_activePlan->positionalReceivers : m_activePlan->regularReceivers;
+	}
+
 	if (receivePositionalData) {
 		return m_positionalReceivers;
 	} else {
@@ -10,6 +10,7 @@
 #include "ServerUser.h"
 #include "VolumeAdjustment.h"
 
+#include <cstdint>
 #include <functional>
 #include <unordered_map>
 #include <vector>
@@ -47,6 +48,18 @@ template< typename Iterator > struct ReceiverRange {
 
 class AudioReceiverBuffer {
 public:
+	/// Identifies the receivers of an audio packet. As long as the routing data doesn't change (and with it the
+	/// generation), all packets a user sends to the same target go to the same receivers.
+	struct PlanKey {
+		/// The generation of the routing data the receivers were determined from
+		std::uint64_t generation;
+		unsigned int senderSession;
+		Mumble::Protocol::audio_context_t target;
+		bool containsPositionalData;
+
+		bool operator==(const PlanKey &other) const;
+	};
+
 	AudioReceiverBuffer();
 
 	void addReceiver(const ServerUser &sender, ServerUser &receiver, Mumble::Protocol::audio_context_t context,
@@ -59,6 +72,14 @@ public:
 
 	void clear();
 
+	/// Makes the receivers stored for the given key (see storePlan()) the current ones, instead of the ones added to
+	/// this buffer. Stays in effect until clear() is called. All plans of other generations are discarded.
+	///
+	/// @returns Whether there was a plan for the given key
+	bool usePlan(const PlanKey &key);
+	/// Stores the receivers added to this buffer (which must have been preprocessed) as plan for the given key
+	void storePlan(const PlanKey &key);
+
 	std::vector< AudioReceiver > &getReceivers(bool receivePositionalData);
 
 
@@ -90,6 +111,23 @@ public:
 	}
 
 protected:
+	/// The maximum number of plans that are kept (all of them are discarded once there are more)
+	static constexpr std::size_t MAX_PLANS = 256;
+
+	struct Plan {
+		std::vector< AudioReceiver > regularReceivers;
+		std::vector< AudioReceiver > positionalReceivers;
+	};
+
+	struct PlanKeyHash {
+		std::size_t operator()(const PlanKey &key) const;
+	};
+
+	std::unordered_map< PlanKey, Plan, PlanKeyHash > m_plans;
+	std::uint64_t m_planGeneration = 0;
+	/// The plan currently in use or nullptr if the receivers added to the buffer are used
+	Plan *m_activePlan = nullptr;
+
 	std::vector< AudioReceiver > m_regularReceivers;
 	std::unordered_map< const ServerUser *, std::size_t > m_regularReceiverIndices;
 	std::vector< AudioReceiver > m_positionalReceivers;
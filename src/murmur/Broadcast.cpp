@@ -0,0 +1,164 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "Broadcast.h"
+
+#include "Connection.h"
+
+#include <algorithm>
+#include <cassert>
+
+static std::size_t framedSize(const ::google::protobuf::Message &msg) {
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+	return msg.ByteSizeLong() + 6;
+#else
+	// ByteSize() has been deprecated as of protobuf v3.4
+	return static_cast< std::size_t >(msg.ByteSize()) + 6;
+#endif
+}
+
+bool BroadcastQueue::Entry::isFor(unsigned int session, Version::full_t receiverVersion) const {
+	assert(mode == Version::CompareMode::AtLeast || mode == Version::CompareMode::LessThan);
+
+	if (exceptSession != 0 && session == exceptSession) {
+		return false;
+	}
+
+	const bool isUnknown = version == Version::UNKNOWN;
+	const bool fulfillsVersionRequirement =
+		mode == Version::CompareMode::AtLeast ? receiverVersion >= version : receiverVersion < version;
+
+	return isUnknown || fulfillsVersionRequirement;
+}
+
+bool BroadcastQueue::isCoalescible(const MumbleProto::UserState &msg) {
+	// Merging concatenates repeated fields, which would change the order in which the client applies them
+	return msg.has_session() && msg.temporary_access_tokens_size() == 0 && msg.listening_channel_add_size() == 0
+		   && msg.listening_channel_remove_size() == 0 && msg.listening_volume_adjustment_size() == 0;
+}
+
+bool BroadcastQueue::add(const ::google::protobuf::Message &msg, Mumble::Protocol::TCPMessageType type,
+						 unsigned int exceptSession, Version::full_t version, Version::CompareMode mode) {
+	// Batches that have already been built don't contain this message
+	m_batches.clear();
+	m_framed = false;
+
+	if (exceptSession != 0
+		&& std::find(m_exceptSessions.begin(), m_exceptSessions.end(), exceptSession) == m_exceptSessions.end()) {
+		m_exceptSessions.push_back(exceptSession);
+	}
+
+	if (type != Mumble::Protocol::TCPMessageType::UserState) {
+		Entry entry = { type, exceptSession, version, mode, nullptr, QByteArray(), 0 };
+		Connection::messageToNetwork(msg, type, entry.framed);
+		entry.mergedSize = static_cast< std::size_t >(entry.framed.size());
+
+		m_entries.push_back(std::move(entry));
+
+		return false;
+	}
+
+	const MumbleProto::UserState &update = static_cast< const MumbleProto::UserState & >(msg);
+	const bool coalescible               = isCoalescible(update);
+
+	if (coalescible) {
+		auto it = m_lastUserState.find(update.session());
+
+		if (it != m_lastUserState.end()) {
+			Entry &previous = m_entries[it->second];
+
+			// Updates of different actors are kept apart, as the clients log who changed what
+			if (previous.userState && previous.exceptSession == exceptSession && previous.version == version
+				&& previous.mode == mode && previous.userState->has_actor() == update.has_actor()
+				&& previous.userState->actor() == update.actor()) {
+				previous.userState->MergeFrom(update);
+				previous.mergedSize += framedSize(update);
+
+				m_statistics.messagesCoalesced++;
+
+				return true;
+			}
+		}
+	}
+
+	Entry entry = { type, exceptSession, version, mode, nullptr, QByteArray(), framedSize(update) };
+	if (coalescible) {
+		entry.userState = std::make_unique< MumbleProto::UserState >(update);
+	} else {
+		Connection::messageToNetwork(update, type, entry.framed);
+	}
+
+	if (update.has_session()) {
+		// Later updates must not be merged into an entry that is followed by another one for the same session
+		m_lastUserState[update.session()] = m_entries.size();
+	}
+
+	m_entries.push_back(std::move(entry));
+
+	return coalescible;
+}
+
+bool BroadcastQueue::isEmpty() const {
+	return m_entries.empty();
+}
+
+void BroadcastQueue::frame() {
+	for (Entry &entry : m_entries) {
+		if (entry.userState) {
+			Connection::messageToNetwork(*entry.userState, entry.type, entry.framed);
+			entry.userState.reset();
+		}
+	}
+
+	m_framed = true;
+}
+
+BroadcastQueue::Batch BroadcastQueue::buildBatch(unsigned int session, Version::full_t version) const {
+	Batch batch = { QByteArray(), 0 };
+
+	for (const Entry &entry : m_entries) {
+		// Messages exceeding the maximum size are not framed at all
+		if (!entry.framed.isEmpty() && entry.isFor(session, version)) {
+			batch.data.append(entry.framed);
+			batch.bytesSaved += entry.mergedSize - static_cast< std::size_t >(entry.framed.size());
+		}
+	}
+
+	return batch;
+}
+
+QByteArray BroadcastQueue::batchFor(unsigned int session, Version::full_t version) {
+	if (!m_framed) {
+		frame();
+	}
+
+	if (std::find(m_exceptSessions.begin(), m_exceptSessions.end(), session) != m_exceptSessions.end()) {
+		const Batch batch = buildBatch(session, version);
+		m_statistics.bytesSaved += batch.bytesSaved;
+
+		return batch.data;
+	}
+
+	auto it = m_batches.find(version);
+	if (it == m_batches.end()) {
+		it = m_batches.emplace(version, buildBatch(0, version)).first;
+	}
+
+	m_statistics.bytesSaved += it->second.bytesSaved;
+
+	return it->second.data;
+}
+
+void BroadcastQueue::clear() {
+	m_entries.clear();
+	m_lastUserState.clear();
+	m_exceptSessions.clear();
+	m_batches.clear();
+	m_framed = false;
+}
+
+const BroadcastQueue::Statistics &BroadcastQueue::statistics() const {
+	return m_statistics;
+}
@@ -0,0 +1,94 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_BROADCAST_H_
+#define MUMBLE_MURMUR_BROADCAST_H_
+
+#include "Mumble.pb.h"
+#include "MumbleProtocol.h"
+#include "Version.h"
+
+#include <QtCore/QByteArray>
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/// The control messages the server broadcasts to its users.
+///
+/// Every message is serialized once, no matter how many users receive it. The messages are then handed out as a
+/// single batch per user, which is the same for all users of a version (unless a user is excluded from one of the
+/// messages).
+///
+/// Successive UserState updates for the same session are merged as long as they haven't been sent yet, so that e.g.
+/// a user being moved through several channels in quick succession results in a single message. Updates are only
+/// merged if this does not change what the clients end up with.
+class BroadcastQueue {
+public:
+	struct Statistics {
+		/// The number of messages that were merged into a previous one instead of being sent on their own
+		quint64 messagesCoalesced = 0;
+		/// The number of bytes that did not have to be sent thanks to coalescing (summed up over all receivers)
+		quint64 bytesSaved = 0;
+	};
+
+	/// Adds a message for all users (except the one with the given session, if it is not 0) whose version fulfils
+	/// the given requirement (any version if it is Version::UNKNOWN).
+	///
+	/// @returns Whether sending the message may be deferred in order to merge further updates into it. If not, the
+	/// queue should be flushed right away in order to not delay the message.
+	bool add(const ::google::protobuf::Message &msg, Mumble::Protocol::TCPMessageType type, unsigned int exceptSession,
+			 Version::full_t version, Version::CompareMode mode);
+
+	bool isEmpty() const;
+
+	/// @returns All queued messages for the given receiver, framed and concatenated. May be empty.
+	QByteArray batchFor(unsigned int session, Version::full_t version);
+
+	/// Removes all messages. Has to be called once all receivers got their batch.
+	void clear();
+
+	const Statistics &statistics() const;
+
+private:
+	struct Entry {
+		Mumble::Protocol::TCPMessageType type;
+		unsigned int exceptSession;
+		Version::full_t version;
+		Version::CompareMode mode;
+		/// The update further updates are merged into (only set for UserStates until they are framed)
+		std::unique_ptr< MumbleProto::UserState > userState;
+		QByteArray framed;
+		/// The total size of all framed updates that were merged into this message
+		std::size_t mergedSize;
+
+		bool isFor(unsigned int session, Version::full_t receiverVersion) const;
+	};
+
+	struct Batch {
+		QByteArray data;
+		quint64 bytesSaved;
+	};
+
+	/// @returns Whether the given update may be merged with other ones
+	static bool isCoalescible(const MumbleProto::UserState &msg);
+
+	/// Frames the messages that are still open for updates
+	void frame();
+	Batch buildBatch(unsigned int session, Version::full_t version) const;
+
+	std::vector< Entry > m_entries;
+	/// The index of the last UserState entry for each session
+	std::unordered_map< unsigned int, std::size_t > m_lastUserState;
+	/// The sessions excluded from any of the messages (these get a batch of their own)
+	std::vector< unsigned int > m_exceptSessions;
+	/// The batches built so far, per receiver version
+	std::unordered_map< Version::full_t, Batch > m_batches;
+	bool m_framed = false;
+	Statistics m_statistics;
+};
+
+#endif // MUMBLE_MURMUR_BROADCAST_H_
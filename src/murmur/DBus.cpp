@@ -361,6 +361,13 @@ void MurmurDBus::getChannels(QList< ChannelInfo > &a) {
 	}
 }
 
+void MurmurDBus::getVoiceStatistics(QVariantMap &statistics) {
+	statistics.clear();
+	for (const std::pair< const char *, std::uint64_t > &entry : server->voiceStatistics().entries()) {
+		statistics.insert(QString::fromLatin1(entry.first), static_cast< qulonglong >(entry.second));
+	}
+}
+
 void MurmurDBus::kickPlayer(unsigned int session, const QString &reason, const QDBusMessage &msg) {
 	PLAYER_SETUP;
 	Connection *c = server->qhUsers.value(session);
@@ -402,12 +409,7 @@ void MurmurDBus::sendMessageChannel(int id, bool tree, const QString &text, cons
 void MurmurDBus::addChannel(const QString &name, int chanparent, const QDBusMessage &msg, int &newid) {
 	CHANNEL_SETUP_VAR(chanparent);
 
-	Channel *nc;
-
-	{
-		QWriteLocker wl(&server->qrwlVoiceThread);
-		nc = server->addChannel(cChannel, name);
-	}
+	Channel *nc = server->addChannel(cChannel, name);
 
 	server->updateChannel(nc);
 	newid = nc->iId;
@@ -426,7 +428,6 @@ void MurmurDBus::removeChannel(int id, const QDBusMessage &msg) {
 		return;
 	}
 
-	QWriteLocker wl(&server->qrwlVoiceThread);
 	server->removeChannel(cChannel);
 }
 
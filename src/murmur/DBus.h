@@ -156,6 +156,7 @@ public slots:
 
 	void getPlayers(QList< PlayerInfoExtended > &player_list);
 	void getChannels(QList< ChannelInfo > &channel_list);
+	void getVoiceStatistics(QVariantMap &statistics);
 
 	void getACL(int channel, const QDBusMessage &, QList< ACLInfo > &acls, QList< GroupInfo > &groups, bool &inherit);
 	void setACL(int channel, const QList< ACLInfo > &acls, const QList< GroupInfo > &groups, bool inherit,
@@ -0,0 +1,434 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "FrequencyMixer.h"
+
+#include <QtCore/QtGlobal>
+
+#include <opus.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// The largest number of samples a single Opus packet can contain (120 ms)
+constexpr std::size_t MAX_PACKET_SAMPLES = FrequencyMixer::SAMPLE_RATE / 1000 * 120;
+// The client counts frames in units of 10 ms
+constexpr std::uint64_t FRAME_NUMBER_INCREMENT = FrequencyMixer::FRAME_SIZE / (FrequencyMixer::SAMPLE_RATE / 100);
+constexpr std::uint32_t HETERODYNE_PHASE_INCREMENT = static_cast< std::uint32_t >(
+	static_cast< double >(FrequencyMixer::HETERODYNE_FREQUENCY) / FrequencyMixer::SAMPLE_RATE * 4294967296.0);
+constexpr double PI = 3.14159265358979323846;
+
+FrequencyMixer::Transmission::Transmission() {
+	samples.reserve(MAX_BUFFERED_FRAMES * FRAME_SIZE + MAX_PACKET_SAMPLES);
+}
+
+FrequencyMixer::Transmission::~Transmission() {
+	if (decoder) {
+		opus_decoder_destroy(decoder);
+	}
+}
+
+FrequencyMixer::Frequency::Frequency(unsigned int frequency) : frequency(frequency) {
+}
+
+FrequencyMixer::Frequency::~Frequency() {
+	if (encoder) {
+		opus_encoder_destroy(encoder);
+	}
+}
+
+FrequencyMixer::FrequencyMixer(std::size_t workerCount, Output output)
+	: m_output(std::move(output)), m_scratch(std::max< std::size_t >(workerCount, 1)) {
+	for (Scratch &scratch : m_scratch) {
+		scratch.packets.reserve(4 * MAX_PENDING_PACKETS);
+		scratch.decoded.resize(MAX_PACKET_SAMPLES);
+	}
+}
+
+FrequencyMixer::~FrequencyMixer() {
+	stop();
+}
+
+void FrequencyMixer::start() {
+	{
+		std::lock_guard< std::mutex > lock(m_lock);
+
+		if (m_running) {
+			return;
+		}
+
+		m_running = true;
+	}
+
+	for (std::size_t i = 0; i < m_scratch.size(); ++i) {
+		m_workers.emplace_back([this, i]() { runWorker(i); });
+	}
+	m_scheduler = std::thread([this]() { runScheduler(); });
+}
+
+void FrequencyMixer::stop() {
+	{
+		std::lock_guard< std::mutex > lock(m_lock);
+
+		if (!m_running) {
+			return;
+		}
+
+		m_running = false;
+	}
+
+	m_stopRequested.notify_all();
+	m_jobAvailable.notify_all();
+
+	m_scheduler.join();
+	for (std::thread &worker : m_workers) {
+		worker.join();
+	}
+	m_workers.clear();
+
+	for (Frequency *frequency : m_jobs) {
+		frequency->scheduled = false;
+	}
+	m_jobs.clear();
+}
+
+void FrequencyMixer::submit(unsigned int frequency, const Mumble::Protocol::AudioData &data) {
+	if (data.usedCodec != Mumble::Protocol::AudioCodec::Opus || data.payload.empty()
+		|| data.payload.size() > Mumble::Protocol::MAX_UDP_PACKET_SIZE) {
+		return;
+	}
+
+	std::lock_guard< std::mutex > lock(m_lock);
+
+	std::unique_ptr< Frequency > &entry = m_frequencies[frequency];
+	if (!entry) {
+		entry = std::make_unique< Frequency >(frequency);
+	}
+
+	std::lock_guard< std::mutex > frequencyLock(entry->lock);
+
+	PendingPackets &pending = entry->pending[data.senderSession];
+	if (pending.count == MAX_PENDING_PACKETS) {
+		// The worker can't keep up - drop the oldest packet
+		pending.first = (pending.first + 1) % MAX_PENDING_PACKETS;
+		pending.count--;
+	}
+
+	Packet &packet = pending.packets[(pending.first + pending.count) % MAX_PENDING_PACKETS];
+	std::memcpy(packet.data.data(), data.payload.data(), data.payload.size());
+	packet.size        = data.payload.size();
+	packet.frameNumber = data.frameNumber;
+	packet.isLastFrame = data.isLastFrame;
+
+	pending.count++;
+}
+
+void FrequencyMixer::mixAll() {
+	{
+		std::lock_guard< std::mutex > lock(m_lock);
+		scheduleFrames();
+	}
+
+	while (true) {
+		Frequency *frequency;
+		{
+			std::lock_guard< std::mutex > lock(m_lock);
+
+			if (m_jobs.empty()) {
+				break;
+			}
+
+			frequency = m_jobs.back();
+			m_jobs.pop_back();
+		}
+
+		mix(0, *frequency);
+
+		std::lock_guard< std::mutex > lock(m_lock);
+		frequency->scheduled = false;
+	}
+}
+
+void FrequencyMixer::scheduleFrames() {
+	for (auto it = m_frequencies.begin(); it != m_frequencies.end();) {
+		Frequency &frequency = *it->second;
+
+		if (frequency.scheduled) {
+			// The previous frame is still being mixed. Skip this one rather than letting the jobs pile up.
+			++it;
+			continue;
+		}
+
+		if (frequency.idleFrames >= IDLE_FRAMES && frequency.transmissions.empty()) {
+			std::lock_guard< std::mutex > frequencyLock(frequency.lock);
+
+			if (frequency.pending.empty()) {
+				it = m_frequencies.erase(it);
+				continue;
+			}
+		}
+
+		frequency.scheduled = true;
+		m_jobs.push_back(&frequency);
+
+		++it;
+	}
+}
+
+void FrequencyMixer::mix(std::size_t worker, Frequency &frequency) {
+	Scratch &scratch = m_scratch[worker];
+
+	// Take the pending packets, so that the voice threads don't have to wait while they are decoded
+	scratch.packets.clear();
+	{
+		std::lock_guard< std::mutex > lock(frequency.lock);
+
+		for (auto &entry : frequency.pending) {
+			PendingPackets &pending = entry.second;
+
+			for (; pending.count > 0; pending.count--) {
+				const Packet &packet = pending.packets[pending.first];
+
+				scratch.packets.emplace_back();
+				scratch.packets.back().first = entry.first;
+
+				Packet &copy     = scratch.packets.back().second;
+				copy.size        = packet.size;
+				copy.frameNumber = packet.frameNumber;
+				copy.isLastFrame = packet.isLastFrame;
+				std::memcpy(copy.data.data(), packet.data.data(), packet.size);
+
+				pending.first = (pending.first + 1) % MAX_PENDING_PACKETS;
+			}
+		}
+	}
+
+	for (const std::pair< unsigned int, Packet > &entry : scratch.packets) {
+		const Packet &packet       = entry.second;
+		Transmission &transmission = frequency.transmissions[entry.first];
+
+		if (!transmission.decoder) {
+			int error            = OPUS_OK;
+			transmission.decoder = opus_decoder_create(SAMPLE_RATE, 1, &error);
+
+			if (error != OPUS_OK) {
+				qWarning("FrequencyMixer: Failed to create Opus decoder: %s", opus_strerror(error));
+				transmission.decoder = nullptr;
+				continue;
+			}
+		}
+
+		if (transmission.hasFrameNumber && !transmission.ended && packet.frameNumber <= transmission.lastFrameNumber) {
+			// Duplicated or late packet
+			continue;
+		}
+
+		transmission.lastFrameNumber = packet.frameNumber;
+		transmission.hasFrameNumber  = true;
+		transmission.ended           = packet.isLastFrame;
+		transmission.idleFrames      = 0;
+
+		const int samples = opus_decode_float(transmission.decoder, packet.data.data(),
+											  static_cast< opus_int32 >(packet.size), scratch.decoded.data(),
+											  static_cast< int >(scratch.decoded.size()), 0);
+		if (samples > 0) {
+			transmission.samples.insert(transmission.samples.end(), scratch.decoded.begin(),
+										scratch.decoded.begin() + samples);
+		}
+
+		if (transmission.samples.size() > MAX_BUFFERED_FRAMES * FRAME_SIZE) {
+			// Keep the latency bounded if the sender sends faster than real-time
+			transmission.samples.erase(transmission.samples.begin(),
+									   transmission.samples.end() - MAX_BUFFERED_FRAMES * FRAME_SIZE);
+		}
+	}
+
+	// Mix the next frame of every transmission that is buffered far enough
+	scratch.mix.fill(0.0f);
+	scratch.transmitters.clear();
+
+	for (auto it = frequency.transmissions.begin(); it != frequency.transmissions.end();) {
+		Transmission &transmission = it->second;
+
+		if (!transmission.mixing
+			&& (transmission.samples.size() >= PREBUFFER_FRAMES * FRAME_SIZE
+				|| (transmission.ended && !transmission.samples.empty()))) {
+			transmission.mixing = true;
+		}
+
+		if (transmission.mixing) {
+			const std::size_t available = std::min< std::size_t >(transmission.samples.size(), FRAME_SIZE);
+
+			for (std::size_t i = 0; i < available; ++i) {
+				scratch.mix[i] += transmission.samples[i];
+			}
+			transmission.samples.erase(transmission.samples.begin(), transmission.samples.begin() + available);
+
+			scratch.transmitters.push_back(it->first);
+
+			if (transmission.samples.empty()) {
+				// Either the transmission ended or it ran dry (in which case it is buffered again)
+				transmission.mixing = false;
+			}
+		}
+
+		transmission.idleFrames++;
+
+		if (transmission.samples.empty() && (transmission.ended || transmission.idleFrames >= IDLE_FRAMES)) {
+			{
+				std::lock_guard< std::mutex > lock(frequency.lock);
+
+				auto pending = frequency.pending.find(it->first);
+				if (pending != frequency.pending.end() && pending->second.count == 0) {
+					frequency.pending.erase(pending);
+				}
+			}
+
+			it = frequency.transmissions.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	if (scratch.transmitters.size() >= 2) {
+		// The carriers of the overlapping transmissions beat against each other (see RadioEffect::process). As every
+		// transmission carries its share of the tone there, the shares add up to the full amplitude.
+		for (unsigned int i = 0; i < FRAME_SIZE; ++i) {
+			const std::uint32_t phase = frequency.phase + HETERODYNE_PHASE_INCREMENT * i;
+			const float tone =
+				HETERODYNE_AMPLITUDE * static_cast< float >(std::sin(2.0 * PI * phase / 4294967296.0));
+
+			scratch.mix[i] = (scratch.mix[i] + tone) * OVERLAP_GAIN;
+		}
+	}
+	// Keep the tone phase-continuous across frames
+	frequency.phase += HETERODYNE_PHASE_INCREMENT * FRAME_SIZE;
+
+	for (float &sample : scratch.mix) {
+		sample = std::max(-1.0f, std::min(sample, 1.0f));
+	}
+
+	if (scratch.transmitters.empty()) {
+		if (frequency.session != 0) {
+			// Properly end the stream (the mix is silent at this point)
+			send(worker, frequency, true);
+			frequency.session = 0;
+		}
+
+		frequency.idleFrames++;
+
+		return;
+	}
+
+	frequency.idleFrames = 0;
+
+	bool isLastFrame = false;
+	if (frequency.session == 0) {
+		// Start a new stream
+		frequency.session     = scratch.transmitters.front();
+		frequency.frameNumber = 0;
+
+		if (frequency.encoder) {
+			opus_encoder_ctl(frequency.encoder, OPUS_RESET_STATE);
+		}
+	} else if (std::find(scratch.transmitters.begin(), scratch.transmitters.end(), frequency.session)
+			   == scratch.transmitters.end()) {
+		// The station the mix is sent as stopped transmitting. End its stream, the next frame starts a new one as
+		// coming from one of the remaining stations.
+		isLastFrame = true;
+	}
+
+	send(worker, frequency, isLastFrame);
+
+	if (isLastFrame) {
+		frequency.session = 0;
+	}
+}
+
+void FrequencyMixer::send(std::size_t worker, Frequency &frequency, bool isLastFrame) {
+	Scratch &scratch = m_scratch[worker];
+
+	if (!frequency.encoder) {
+		int error         = OPUS_OK;
+		frequency.encoder = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, &error);
+
+		if (error != OPUS_OK) {
+			qWarning("FrequencyMixer: Failed to create Opus encoder: %s", opus_strerror(error));
+			frequency.encoder = nullptr;
+			return;
+		}
+
+		opus_encoder_ctl(frequency.encoder, OPUS_SET_VBR(0));
+		opus_encoder_ctl(frequency.encoder, OPUS_SET_BITRATE(BITRATE));
+	}
+
+	const opus_int32 size =
+		opus_encode_float(frequency.encoder, scratch.mix.data(), static_cast< int >(FRAME_SIZE), scratch.encoded.data(),
+						  static_cast< opus_int32 >(scratch.encoded.size()));
+	if (size <= 0) {
+		qWarning("FrequencyMixer: Failed to encode the mix of frequency %u", frequency.frequency);
+		return;
+	}
+
+	Mumble::Protocol::AudioData data;
+	data.usedCodec       = Mumble::Protocol::AudioCodec::Opus;
+	data.targetOrContext = Mumble::Protocol::AudioContext::NORMAL;
+	data.senderSession   = frequency.session;
+	data.frameNumber     = frequency.frameNumber;
+	data.payload         = { scratch.encoded.data(), static_cast< std::size_t >(size) };
+	data.isLastFrame     = isLastFrame;
+
+	frequency.frameNumber += FRAME_NUMBER_INCREMENT;
+
+	m_output(worker, frequency.frequency, data, scratch.transmitters);
+}
+
+void FrequencyMixer::runScheduler() {
+	constexpr std::chrono::microseconds FRAME_DURATION(1000000 / (SAMPLE_RATE / FRAME_SIZE));
+
+	std::unique_lock< std::mutex > lock(m_lock);
+
+	// Frames are scheduled at fixed points in time, so that the processing time doesn't add up
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+	while (true) {
+		deadline += FRAME_DURATION;
+
+		if (m_stopRequested.wait_until(lock, deadline, [this]() { return !m_running; })) {
+			break;
+		}
+
+		scheduleFrames();
+		m_jobAvailable.notify_all();
+
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - deadline > FRAME_DURATION) {
+			// Don't try to catch up after having been suspended
+			deadline = now;
+		}
+	}
+}
+
+void FrequencyMixer::runWorker(std::size_t worker) {
+	std::unique_lock< std::mutex > lock(m_lock);
+
+	while (true) {
+		m_jobAvailable.wait(lock, [this]() { return !m_running || !m_jobs.empty(); });
+
+		if (!m_running) {
+			break;
+		}
+
+		Frequency *frequency = m_jobs.back();
+		m_jobs.pop_back();
+
+		lock.unlock();
+		mix(worker, *frequency);
+		lock.lock();
+
+		frequency->scheduled = false;
+	}
+}
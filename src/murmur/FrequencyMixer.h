@@ -0,0 +1,182 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_FREQUENCYMIXER_H_
+#define MUMBLE_MURMUR_FREQUENCYMIXER_H_
+
+#include "MumbleProtocol.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct OpusDecoder;
+struct OpusEncoder;
+
+/// Mixes all transmissions on a radio frequency into a single stream.
+///
+/// Without mixing, every transmitter is forwarded to every listener of a frequency separately. On frequencies with
+/// hundreds of listeners, several overlapping transmissions (e.g. a stuck microphone blocking the frequency) thus
+/// multiply the bandwidth as well as the decoding work of the clients. For such frequencies, the voice threads hand
+/// the Opus packets to the mixer instead, which merely copies them.
+///
+/// A scheduler thread starts a mixing job for every active frequency in a fixed cadence of one frame, no matter when
+/// the packets arrive. The jobs are run by a pool of worker threads, which decode the pending packets, mix the
+/// transmissions (adding the heterodyne tone the clients' radio effect produces for overlapping transmissions), encode
+/// the mix once and pass it on to the output function. Transmissions are buffered for a few frames before they are
+/// mixed in, which absorbs the network jitter.
+///
+/// As on a real radio, the stations that are transmitting don't receive the mix.
+class FrequencyMixer {
+public:
+	static constexpr unsigned int SAMPLE_RATE = 48000;
+	/// The length of a mixed frame in samples (20 ms)
+	static constexpr unsigned int FRAME_SIZE = SAMPLE_RATE / 50;
+	/// The number of frames a transmission is buffered for before it is mixed in
+	static constexpr unsigned int PREBUFFER_FRAMES = 2;
+	/// The number of frames that are buffered per transmission at most. Older audio is dropped.
+	static constexpr unsigned int MAX_BUFFERED_FRAMES = 10;
+	/// The number of packets per transmission that may be waiting for being decoded. Older packets are dropped.
+	static constexpr std::size_t MAX_PENDING_PACKETS = 8;
+	/// The number of frames after which a transmission (or a frequency) without any packets is dropped
+	static constexpr unsigned int IDLE_FRAMES = 50;
+	/// The bitrate of the mixed stream in bit/s
+	static constexpr int BITRATE = 40000;
+
+	/// The heterodyne tone and the gain applied while transmissions overlap. These match the defaults of the client's
+	/// RadioEffect, which only adds the tone itself if it plays several transmissions at once.
+	static constexpr float HETERODYNE_FREQUENCY = 100.0f;
+	static constexpr float HETERODYNE_AMPLITUDE = 0.8f;
+	static constexpr float OVERLAP_GAIN         = 0.8f;
+
+	/// Receives the mixed packets. Called by the worker threads.
+	///
+	/// @param worker The index of the calling worker (0 <= worker < workerCount)
+	/// @param frequency The frequency the packet has been mixed for
+	/// @param data The mixed packet. It is sent as coming from one of the stations contributing to the mix, so that
+	/// 	the clients have a user to play it back for.
+	/// @param transmitters The sessions of all stations contributing to the packet
+	using Output = std::function< void(std::size_t worker, unsigned int frequency,
+									   const Mumble::Protocol::AudioData &data,
+									   const std::vector< unsigned int > &transmitters) >;
+
+	FrequencyMixer(std::size_t workerCount, Output output);
+	~FrequencyMixer();
+
+	FrequencyMixer(const FrequencyMixer &) = delete;
+	FrequencyMixer &operator=(const FrequencyMixer &) = delete;
+
+	/// Starts the scheduler and the worker threads
+	void start();
+	/// Stops all threads. Frames that have not been mixed yet are kept for when the mixer is started again.
+	void stop();
+
+	/// Queues the given Opus packet for being mixed into the given frequency. Only copies the packet, so it is safe to
+	/// call this from the voice threads.
+	void submit(unsigned int frequency, const Mumble::Protocol::AudioData &data);
+
+	/// Mixes the next frame of every frequency on the calling thread (as worker 0). Must not be called while the
+	/// threads are running.
+	void mixAll();
+
+private:
+	struct Packet {
+		std::array< Mumble::Protocol::byte, Mumble::Protocol::MAX_UDP_PACKET_SIZE > data;
+		std::size_t size;
+		std::uint64_t frameNumber;
+		bool isLastFrame;
+	};
+
+	/// The packets of a transmission that have not been decoded yet (a ring buffer)
+	struct PendingPackets {
+		std::array< Packet, MAX_PENDING_PACKETS > packets;
+		std::size_t first = 0;
+		std::size_t count = 0;
+	};
+
+	/// A transmission as seen by the worker mixing the frequency
+	struct Transmission {
+		OpusDecoder *decoder = nullptr;
+		/// Decoded audio that has not been mixed yet
+		std::vector< float > samples;
+		std::uint64_t lastFrameNumber = 0;
+		bool hasFrameNumber           = false;
+		/// Whether the transmission is being mixed (or still being buffered)
+		bool mixing = false;
+		/// Whether the last packet of the transmission has been received
+		bool ended              = false;
+		unsigned int idleFrames = 0;
+
+		Transmission();
+		~Transmission();
+		Transmission(const Transmission &) = delete;
+		Transmission &operator=(const Transmission &) = delete;
+	};
+
+	struct Frequency {
+		unsigned int frequency;
+
+		/// Guards pending
+		std::mutex lock;
+		std::unordered_map< unsigned int, PendingPackets > pending;
+
+		// The following members are only accessed by the worker mixing the frequency
+		std::unordered_map< unsigned int, Transmission > transmissions;
+		OpusEncoder *encoder = nullptr;
+		/// The session the mix is sent as or 0 if no mix is being sent
+		unsigned int session      = 0;
+		std::uint64_t frameNumber = 0;
+		/// The phase of the heterodyne tone as a fraction of 2^32
+		std::uint32_t phase     = 0;
+		unsigned int idleFrames = 0;
+
+		/// Whether a job for the frequency is queued or running. Guarded by FrequencyMixer::m_lock.
+		bool scheduled = false;
+
+		explicit Frequency(unsigned int frequency);
+		~Frequency();
+	};
+
+	/// What a worker needs for mixing a frame, allocated once per worker
+	struct Scratch {
+		std::vector< std::pair< unsigned int, Packet > > packets;
+		std::vector< float > decoded;
+		std::array< float, FRAME_SIZE > mix;
+		std::vector< unsigned int > transmitters;
+		std::array< Mumble::Protocol::byte, Mumble::Protocol::MAX_UDP_PACKET_SIZE > encoded;
+	};
+
+	/// Queues a job for every frequency that doesn't have one yet and drops idle frequencies. m_lock must be held.
+	void scheduleFrames();
+	void mix(std::size_t worker, Frequency &frequency);
+	void send(std::size_t worker, Frequency &frequency, bool isLastFrame);
+
+	void runScheduler();
+	void runWorker(std::size_t worker);
+
+	Output m_output;
+	std::vector< Scratch > m_scratch;
+
+	/// Guards m_frequencies, m_jobs and m_running
+	std::mutex m_lock;
+	std::condition_variable m_jobAvailable;
+	std::condition_variable m_stopRequested;
+	std::unordered_map< unsigned int, std::unique_ptr< Frequency > > m_frequencies;
+	std::vector< Frequency * > m_jobs;
+	bool m_running = false;
+
+	std::thread m_scheduler;
+	std::vector< std::thread > m_workers;
+};
+
+#endif // MUMBLE_MURMUR_FREQUENCYMIXER_H_
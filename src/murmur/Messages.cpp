@@ -191,15 +191,15 @@ void Server::msgAuthenticate(ServerUser *uSource, MumbleProto::Authenticate &msg
 	// the authentication procedure we can be sure that this is not just a random TCP connection.
 	// Thus it is about time we assign the ID to this client in order to be able to reference it
 	// in the following.
+	uSource->uiSession = qqIds.dequeue();
+	qhUsers.insert(uSource->uiSession, uSource);
+	scheduleTimeout(uSource);
 	{
-		QWriteLocker wl(&qrwlVoiceThread);
-		uSource->uiSession = qqIds.dequeue();
-		qhUsers.insert(uSource->uiSession, uSource);
+		QWriteLocker wl(&qrwlPeers);
 		qhHostUsers[uSource->haAddress].insert(uSource);
 	}
 
 	Channel *root = qhChannels.value(0);
-	Channel *c;
 
 	uSource->qsName = u8(msg.username()).trimmed();
 
@@ -343,55 +343,12 @@ void Server::msgAuthenticate(ServerUser *uSource, MumbleProto::Authenticate &msg
 						  "talk to or hear most clients. Please make sure your client was built with CELT support."));
 	}
 
-	// Transmit channel tree
-	QQueue< Channel * > q;
-	QSet< Channel * > chans;
-	q << root;
-	MumbleProto::ChannelState mpcs;
-	while (!q.isEmpty()) {
-		c = q.dequeue();
-		chans.insert(c);
-
-		mpcs.Clear();
-
-		mpcs.set_channel_id(c->iId);
-		if (c->cParent)
-			mpcs.set_parent(c->cParent->iId);
-		if (c->iId == 0)
-			mpcs.set_name(u8(qsRegName.isEmpty() ? QLatin1String("Root") : qsRegName));
-		else
-			mpcs.set_name(u8(c->qsName));
-
-		mpcs.set_position(c->iPosition);
-
-		if ((uSource->m_version >= Version::fromComponents(1, 2, 2)) && !c->qbaDescHash.isEmpty())
-			mpcs.set_description_hash(blob(c->qbaDescHash));
-		else if (!c->qsDesc.isEmpty())
-			mpcs.set_description(u8(c->qsDesc));
-
-		mpcs.set_max_users(c->uiMaxUsers);
-
-		// Include info about enter restrictions of this channel
-		mpcs.set_is_enter_restricted(isChannelEnterRestricted(c));
-		mpcs.set_can_enter(ChanACL::hasPermission(uSource, c, ChanACL::Enter, &acCache));
-
-		sendMessage(uSource, mpcs);
+	// The broadcasts still queued describe changes the channel tree and the user states sent below already include.
+	// They are meant for the users that were connected when they were made, so they are sent before the sync starts.
+	flushBroadcasts();
 
-		foreach (c, c->qlChannels)
-			q.enqueue(c);
-	}
-
-	// Transmit links
-	foreach (c, chans) {
-		if (c->qhLinks.count() > 0) {
-			mpcs.Clear();
-			mpcs.set_channel_id(c->iId);
-
-			foreach (Channel *l, c->qhLinks.keys())
-				mpcs.add_links(l->iId);
-			sendMessage(uSource, mpcs);
-		}
-	}
+	// Transmit channel tree
+	sendChannelTree(uSource);
 
 	loadChannelListenersOf(*uSource);
 
@@ -400,10 +357,11 @@ void Server::msgAuthenticate(ServerUser *uSource, MumbleProto::Authenticate &msg
 
 	userEnterChannel(uSource, lc, mpus);
 
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-		uSource->sState = ServerUser::Authenticated;
-	}
+	// Likewise, what has been queued during the sync is not meant for the user
+	flushBroadcasts();
+
+	uSource->sState = ServerUser::Authenticated;
+	invalidateVoiceRouting(*uSource);
 
 	mpus.set_session(uSource->uiSession);
 	mpus.set_name(u8(uSource->qsName));
@@ -442,66 +400,7 @@ void Server::msgAuthenticate(ServerUser *uSource, MumbleProto::Authenticate &msg
 	sendAll(mpus, Version::fromComponents(1, 2, 2), Version::CompareMode::LessThan);
 
 	// Transmit other users profiles
-	foreach (ServerUser *u, qhUsers) {
-		if (u->sState != ServerUser::Authenticated)
-			continue;
-
-		if (u == uSource)
-			continue;
-
-		mpus.Clear();
-		mpus.set_session(u->uiSession);
-		mpus.set_name(u8(u->qsName));
-		if (u->iId >= 0)
-			mpus.set_user_id(u->iId);
-		if (uSource->m_version >= Version::fromComponents(1, 2, 2)) {
-			if (!u->qbaTextureHash.isEmpty())
-				mpus.set_texture_hash(blob(u->qbaTextureHash));
-			else if (!u->qbaTexture.isEmpty())
-				mpus.set_texture(blob(u->qbaTexture));
-		} else if ((uSource->qbaTexture.length() >= 4)
-				   && (qFromBigEndian< unsigned int >(
-						   reinterpret_cast< const unsigned char * >(uSource->qbaTexture.constData()))
-					   == 600 * 60 * 4)) {
-			mpus.set_texture(blob(u->qbaTexture));
-		}
-		if (u->cChannel->iId != 0)
-			mpus.set_channel_id(u->cChannel->iId);
-		if (u->bDeaf)
-			mpus.set_deaf(true);
-		else if (u->bMute)
-			mpus.set_mute(true);
-		if (u->bSuppress)
-			mpus.set_suppress(true);
-		if (u->bPrioritySpeaker)
-			mpus.set_priority_speaker(true);
-		if (u->bRecording)
-			mpus.set_recording(true);
-		if (u->bSelfDeaf)
-			mpus.set_self_deaf(true);
-		else if (u->bSelfMute)
-			mpus.set_self_mute(true);
-		if ((uSource->m_version >= Version::fromComponents(1, 2, 2)) && !u->qbaCommentHash.isEmpty())
-			mpus.set_comment_hash(blob(u->qbaCommentHash));
-		else if (!u->qsComment.isEmpty())
-			mpus.set_comment(u8(u->qsComment));
-		if (!u->qsHash.isEmpty())
-			mpus.set_hash(u8(u->qsHash));
-
-
-		for (int channelID : m_channelListenerManager.getListenedChannelsForUser(u->uiSession)) {
-			mpus.add_listening_channel_add(channelID);
-
-			if (broadcastListenerVolumeAdjustments) {
-				VolumeAdjustment volume = m_channelListenerManager.getListenerVolumeAdjustment(u->uiSession, channelID);
-				MumbleProto::UserState::VolumeAdjustment *adjustment = mpus.add_listening_volume_adjustment();
-				adjustment->set_listening_channel(channelID);
-				adjustment->set_volume_adjustment(volume.factor);
-			}
-		}
-
-		sendMessage(uSource, mpus);
-	}
+	sendUserStates(uSource);
 
 	// Send syncronisation packet
 	MumbleProto::ServerSync mpss;
@@ -909,33 +808,34 @@ void Server::msgUserState(ServerUser *uSource, MumbleProto::UserState &msg) {
 		bBroadcast = true;
 	}
 
-	// Writing to bSelfMute, bSelfDeaf and ssContext
-	// requires holding a write lock on qrwlVoiceThread.
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
+	if (msg.has_self_deaf()) {
+		pDstServerUser->bSelfDeaf = msg.self_deaf();
+		if (pDstServerUser->bSelfDeaf)
+			msg.set_self_mute(true);
+		bBroadcast = true;
+	}
 
-		if (msg.has_self_deaf()) {
-			pDstServerUser->bSelfDeaf = msg.self_deaf();
-			if (pDstServerUser->bSelfDeaf)
-				msg.set_self_mute(true);
-			bBroadcast = true;
+	if (msg.has_self_mute()) {
+		pDstServerUser->bSelfMute = msg.self_mute();
+		if (!pDstServerUser->bSelfMute) {
+			msg.set_self_deaf(false);
+			pDstServerUser->bSelfDeaf = false;
 		}
+		bBroadcast = true;
+	}
 
-		if (msg.has_self_mute()) {
-			pDstServerUser->bSelfMute = msg.self_mute();
-			if (!pDstServerUser->bSelfMute) {
-				msg.set_self_deaf(false);
-				pDstServerUser->bSelfDeaf = false;
-			}
-			bBroadcast = true;
-		}
+	if (msg.has_plugin_context()) {
+		pDstServerUser->ssContext = msg.plugin_context();
 
-		if (msg.has_plugin_context()) {
-			pDstServerUser->ssContext = msg.plugin_context();
+		// Make sure to clear this from the packet so we don't broadcast it
+		msg.clear_plugin_context();
 
-			// Make sure to clear this from the packet so we don't broadcast it
-			msg.clear_plugin_context();
-		}
+		invalidateVoiceRouting(*pDstServerUser);
+	}
+
+	if (msg.has_self_deaf() || msg.has_self_mute()) {
+		// bSelfMute and bSelfDeaf are part of the voice routing
+		invalidateVoiceRouting(*pDstServerUser);
 	}
 
 	if (msg.has_plugin_identity()) {
@@ -958,10 +858,6 @@ void Server::msgUserState(ServerUser *uSource, MumbleProto::UserState &msg) {
 
 
 	if (msg.has_mute() || msg.has_deaf() || msg.has_suppress() || msg.has_priority_speaker()) {
-		// Writing to bDeaf, bMute and bSuppress requires
-		// holding a write lock on qrwlVoiceThread.
-		QWriteLocker wl(&qrwlVoiceThread);
-
 		if (msg.has_deaf()) {
 			pDstServerUser->bDeaf = msg.deaf();
 			if (pDstServerUser->bDeaf)
@@ -980,6 +876,9 @@ void Server::msgUserState(ServerUser *uSource, MumbleProto::UserState &msg) {
 		if (msg.has_priority_speaker())
 			pDstServerUser->bPrioritySpeaker = msg.priority_speaker();
 
+		// bDeaf, bMute and bSuppress are part of the voice routing
+		invalidateVoiceRouting(*pDstServerUser);
+
 		log(uSource, QString("Changed speak-state of %1 (%2 %3 %4 %5)")
 						 .arg(QString(*pDstServerUser), QString::number(pDstServerUser->bMute),
 							  QString::number(pDstServerUser->bDeaf), QString::number(pDstServerUser->bSuppress),
@@ -1080,9 +979,8 @@ void Server::msgUserState(ServerUser *uSource, MumbleProto::UserState &msg) {
 	bBroadcast                             = bBroadcast || listenerChanged || listenerVolumeChanged;
 
 	if (listenerChanged || listenerVolumeChanged) {
-		// As whisper targets also contain information about ChannelListeners and
-		// their associated volume adjustment, we have to clear the target cache
-		clearWhisperTargetCache();
+		// Listeners and their associated volume adjustments are part of the voice routing
+		invalidateVoiceRouting(*pDstServerUser);
 	}
 
 
@@ -1152,8 +1050,8 @@ void Server::msgUserState(ServerUser *uSource, MumbleProto::UserState &msg) {
 			clearACLCache(pDstServerUser);
 		} else if (listenerChanged || listenerVolumeChanged) {
 			// We only have to do this if the ACLs didn't change as
-			// clearACLCache calls clearWhisperTargetChache anyways
-			clearWhisperTargetCache();
+			// clearACLCache invalidates the voice routing anyways
+			invalidateVoiceRouting(*pDstServerUser);
 		}
 	}
 
@@ -1449,11 +1347,10 @@ void Server::msgChannelState(ServerUser *uSource, MumbleProto::ChannelState &msg
 		if (p) {
 			log(uSource, QString("Moved channel %1 from %2 to %3").arg(QString(*c), QString(*c->cParent), QString(*p)));
 
-			{
-				QWriteLocker wl(&qrwlVoiceThread);
-				c->cParent->removeChannel(c);
-				p->addChannel(c);
-			}
+			c->cParent->removeChannel(c);
+			p->addChannel(c);
+
+			invalidateVoiceRouting();
 		}
 		if (!qsName.isNull()) {
 			log(uSource, QString("Renamed channel %1 to %2").arg(QString(*c), QString(qsName)));
@@ -1816,95 +1713,87 @@ void Server::msgACL(ServerUser *uSource, MumbleProto::ACL &msg) {
 		Group *g;
 		ChanACL *a;
 
-		{
-			QWriteLocker wl(&qrwlVoiceThread);
+		QHash< QString, QSet< int > > hOldTemp;
 
-			QHash< QString, QSet< int > > hOldTemp;
+		if (Meta::mp.bLogGroupChanges || Meta::mp.bLogACLChanges) {
+			log(uSource, QString::fromLatin1("Updating ACL in channel %1").arg(*c));
+		}
 
-			if (Meta::mp.bLogGroupChanges || Meta::mp.bLogACLChanges) {
-				log(uSource, QString::fromLatin1("Updating ACL in channel %1").arg(*c));
-			}
+		if (Meta::mp.bLogGroupChanges) {
+			logGroups(this, c, QLatin1String("These are the groups before applying the change:"));
+		}
 
-			if (Meta::mp.bLogGroupChanges) {
-				logGroups(this, c, QLatin1String("These are the groups before applying the change:"));
-			}
+		foreach (g, c->qhGroups) {
+			hOldTemp.insert(g->qsName, g->qsTemporary);
+			delete g;
+		}
 
-			foreach (g, c->qhGroups) {
-				hOldTemp.insert(g->qsName, g->qsTemporary);
-				delete g;
-			}
+		if (Meta::mp.bLogACLChanges) {
+			logACLs(this, c, QLatin1String("These are the ACLs before applying the changed:"));
+		}
 
-			if (Meta::mp.bLogACLChanges) {
-				logACLs(this, c, QLatin1String("These are the ACLs before applying the changed:"));
-			}
+		// Clear old ACLs
+		foreach (a, c->qlACL) { delete a; }
 
-			// Clear old ACLs
-			foreach (a, c->qlACL) { delete a; }
+		c->qhGroups.clear();
+		c->qlACL.clear();
 
-			c->qhGroups.clear();
-			c->qlACL.clear();
+		c->bInheritACL = msg.inherit_acls();
 
-			c->bInheritACL = msg.inherit_acls();
+		// Add new groups
+		for (int i = 0; i < msg.groups_size(); ++i) {
+			const MumbleProto::ACL_ChanGroup &group = msg.groups(i);
+			g                                       = new Group(c, u8(group.name()));
+			g->bInherit                             = group.inherit();
+			g->bInheritable                         = group.inheritable();
+			for (int j = 0; j < group.add_size(); ++j)
+				if (!getUserName(group.add(j)).isEmpty())
+					g->qsAdd << group.add(j);
+			for (int j = 0; j < group.remove_size(); ++j)
+				if (!getUserName(group.remove(j)).isEmpty())
+					g->qsRemove << group.remove(j);
 
-			// Add new groups
-			for (int i = 0; i < msg.groups_size(); ++i) {
-				const MumbleProto::ACL_ChanGroup &group = msg.groups(i);
-				g                                       = new Group(c, u8(group.name()));
-				g->bInherit                             = group.inherit();
-				g->bInheritable                         = group.inheritable();
-				for (int j = 0; j < group.add_size(); ++j)
-					if (!getUserName(group.add(j)).isEmpty())
-						g->qsAdd << group.add(j);
-				for (int j = 0; j < group.remove_size(); ++j)
-					if (!getUserName(group.remove(j)).isEmpty())
-						g->qsRemove << group.remove(j);
+			g->qsTemporary = hOldTemp.value(g->qsName);
+		}
 
-				g->qsTemporary = hOldTemp.value(g->qsName);
-			}
+		if (Meta::mp.bLogGroupChanges) {
+			logGroups(this, c, QLatin1String("And these are the new groups:"));
+		}
 
-			if (Meta::mp.bLogGroupChanges) {
-				logGroups(this, c, QLatin1String("And these are the new groups:"));
-			}
+		// Add new ACLs
+		for (int i = 0; i < msg.acls_size(); ++i) {
+			const MumbleProto::ACL_ChanACL &mpacl = msg.acls(i);
+			if (mpacl.has_user_id() && getUserName(mpacl.user_id()).isEmpty())
+				continue;
 
-			// Add new ACLs
-			for (int i = 0; i < msg.acls_size(); ++i) {
-				const MumbleProto::ACL_ChanACL &mpacl = msg.acls(i);
-				if (mpacl.has_user_id() && getUserName(mpacl.user_id()).isEmpty())
-					continue;
-
-				a             = new ChanACL(c);
-				a->bApplyHere = mpacl.apply_here();
-				a->bApplySubs = mpacl.apply_subs();
-				if (mpacl.has_user_id())
-					a->iUserId = mpacl.user_id();
-				else
-					a->qsGroup = u8(mpacl.group());
-				a->pDeny  = static_cast< ChanACL::Permissions >(mpacl.deny()) & ChanACL::All;
-				a->pAllow = static_cast< ChanACL::Permissions >(mpacl.grant()) & ChanACL::All;
-			}
+			a             = new ChanACL(c);
+			a->bApplyHere = mpacl.apply_here();
+			a->bApplySubs = mpacl.apply_subs();
+			if (mpacl.has_user_id())
+				a->iUserId = mpacl.user_id();
+			else
+				a->qsGroup = u8(mpacl.group());
+			a->pDeny  = static_cast< ChanACL::Permissions >(mpacl.deny()) & ChanACL::All;
+			a->pAllow = static_cast< ChanACL::Permissions >(mpacl.grant()) & ChanACL::All;
+		}
 
-			if (Meta::mp.bLogACLChanges) {
-				logACLs(this, c, QLatin1String("And these are the new ACLs:"));
-			}
+		if (Meta::mp.bLogACLChanges) {
+			logACLs(this, c, QLatin1String("And these are the new ACLs:"));
 		}
 
 		clearACLCache();
 
 		if (!hasPermission(uSource, c, ChanACL::Write) && ((uSource->iId >= 0) || !uSource->qsHash.isEmpty())) {
-			{
-				QWriteLocker wl(&qrwlVoiceThread);
-
-				a             = new ChanACL(c);
-				a->bApplyHere = true;
-				a->bApplySubs = false;
-				if (uSource->iId >= 0)
-					a->iUserId = uSource->iId;
-				else
-					a->qsGroup = QLatin1Char('$') + uSource->qsHash;
+			a             = new ChanACL(c);
+			a->bApplyHere = true;
+			a->bApplySubs = false;
+			if (uSource->iId >= 0)
 				a->iUserId = uSource->iId;
-				a->pDeny   = ChanACL::None;
-				a->pAllow  = ChanACL::Write | ChanACL::Traverse;
-			}
+			else
+				a->qsGroup = QLatin1Char('$') + uSource->qsHash;
+			a->iUserId = uSource->iId;
+			a->pDeny   = ChanACL::None;
+			a->pAllow  = ChanACL::Write | ChanACL::Traverse;
 
 			clearACLCache();
 		}
@@ -2148,10 +2037,6 @@ void Server::msgVoiceTarget(ServerUser *uSource, MumbleProto::VoiceTarget &msg)
 	if ((target < 1) || (target >= 0x1f))
 		return;
 
-	QWriteLocker lock(&qrwlVoiceThread);
-
-	uSource->qmTargetCache.remove(target);
-
 	int count = msg.targets_size();
 	if (count == 0) {
 		uSource->qmTargets.remove(target);
@@ -2182,6 +2067,8 @@ void Server::msgVoiceTarget(ServerUser *uSource, MumbleProto::VoiceTarget &msg)
 		else
 			uSource->qmTargets.insert(target, wt);
 	}
+
+	invalidateVoiceRouting(*uSource);
 }
 
 void Server::msgPermissionQuery(ServerUser *uSource, MumbleProto::PermissionQuery &msg) {
@@ -2400,6 +2287,32 @@ void Server::msgPluginDataTransmission(ServerUser *sender, MumbleProto::PluginDa
 	}
 }
 
+void Server::msgRadioTune(ServerUser *uSource, MumbleProto::RadioTune &msg) {
+	ZoneScoped;
+
+	MSG_SETUP(ServerUser::Authenticated);
+
+	RATELIMIT(uSource);
+
+	const std::array< unsigned int, 2 > frequencies = { msg.frequency_com1(), msg.frequency_com2() };
+	for (unsigned int frequency : frequencies) {
+		if (frequency != 0 && !isValidFrequency(frequency)) {
+			log(uSource, QString("Refusing to tune to invalid frequency %1").arg(frequency));
+			return;
+		}
+	}
+
+	// Listening on a frequency is what entering a channel is for speech. Whether the user may transmit as well is
+	// determined by the Speak permission when routing the speech.
+	Channel *radio = radioChannel();
+	if ((frequencies[0] != 0 || frequencies[1] != 0) && !hasPermission(uSource, radio, ChanACL::Enter)) {
+		PERM_DENIED(uSource, radio, ChanACL::Enter);
+		return;
+	}
+
+	tuneUser(uSource, frequencies, static_cast< unsigned int >(msg.transmit_radio()));
+}
+
 #undef RATELIMIT
 #undef MSG_SETUP
 #undef MSG_SETUP_NO_UNIDLE
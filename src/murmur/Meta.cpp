@@ -97,6 +97,11 @@ MetaParams::MetaParams() {
 	iChannelNestingLimit = 10;
 	iChannelCountLimit   = 1000;
 
+	iUdpWorkers              = 1;
+	iMixingThreshold         = 0;
+	iRadioChannel            = 0;
+	iVoiceStatisticsInterval = 3600;
+
 	qrUserName    = QRegExp(QLatin1String("[ -=\\w\\[\\]\\{\\}\\(\\)\\@\\|\\.]+"));
 	qrChannelName = QRegExp(QLatin1String("[ -=\\w\\#\\[\\]\\{\\}\\(\\)\\@\\|]+"));
 
@@ -341,6 +346,11 @@ void MetaParams::read(QString fname) {
 	iChannelNestingLimit = typeCheckedFromSettings("channelnestinglimit", iChannelNestingLimit);
 	iChannelCountLimit   = typeCheckedFromSettings("channelcountlimit", iChannelCountLimit);
 
+	iUdpWorkers              = typeCheckedFromSettings("udpworkers", iUdpWorkers);
+	iMixingThreshold         = typeCheckedFromSettings("mixingthreshold", iMixingThreshold);
+	iRadioChannel            = typeCheckedFromSettings("radiochannel", iRadioChannel);
+	iVoiceStatisticsInterval = typeCheckedFromSettings("voicestatisticsinterval", iVoiceStatisticsInterval);
+
 #ifdef Q_OS_UNIX
 	qsName = qsSettings->value("uname").toString();
 	if (geteuid() == 0) {
@@ -431,6 +441,10 @@ void MetaParams::read(QString fname) {
 	qmConfig.insert(QLatin1String("opusthreshold"), QString::number(iOpusThreshold));
 	qmConfig.insert(QLatin1String("channelnestinglimit"), QString::number(iChannelNestingLimit));
 	qmConfig.insert(QLatin1String("channelcountlimit"), QString::number(iChannelCountLimit));
+	qmConfig.insert(QLatin1String("udpworkers"), QString::number(iUdpWorkers));
+	qmConfig.insert(QLatin1String("mixingthreshold"), QString::number(iMixingThreshold));
+	qmConfig.insert(QLatin1String("radiochannel"), QString::number(iRadioChannel));
+	qmConfig.insert(QLatin1String("voicestatisticsinterval"), QString::number(iVoiceStatisticsInterval));
 	qmConfig.insert(QLatin1String("sslCiphers"), qsCiphers);
 	qmConfig.insert(QLatin1String("sslDHParams"), QString::fromLatin1(qbaDHParams.constData()));
 }
@@ -631,7 +645,15 @@ bool MetaParams::loadSSLSettings() {
 	return true;
 }
 
-Meta::Meta() {
+/// The resolution of the per-user timers (in ms)
+constexpr int TIMER_TICK = 250;
+
+Meta::Meta() : m_timers(std::chrono::milliseconds(TIMER_TICK)) {
+	// The wheel only touches the timers that are about to expire, so advancing it is cheap no matter how many users
+	// are connected to all the virtual servers
+	connect(&m_timersTick, &QTimer::timeout, this, [this]() { m_timers.advance(TimingWheel::Clock::now()); });
+	m_timersTick.start(TIMER_TICK);
+
 #ifdef Q_OS_WIN
 	QOS_VERSION qvVer;
 	qvVer.MajorVersion = 1;
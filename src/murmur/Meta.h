@@ -7,6 +7,7 @@
 #define MUMBLE_MURMUR_META_H_
 
 #include "Timer.h"
+#include "TimingWheel.h"
 
 #include "Version.h"
 
@@ -16,6 +17,7 @@
 
 #include <QtCore/QDir>
 #include <QtCore/QList>
+#include <QtCore/QTimer>
 #include <QtCore/QUrl>
 #include <QtCore/QVariant>
 #include <QtNetwork/QHostAddress>
@@ -46,6 +48,14 @@ public:
 	int iOpusThreshold;
 	int iChannelNestingLimit;
 	int iChannelCountLimit;
+	/// The number of threads processing UDP (voice) packets. 0 means one per CPU core.
+	int iUdpWorkers;
+	/// Radio frequencies with at least this many listeners are mixed on the server. 0 disables mixing.
+	int iMixingThreshold;
+	/// The channel whose Enter and Speak permissions are required for listening and transmitting on radio frequencies
+	int iRadioChannel;
+	/// The interval (in seconds) in which the voice statistics are written to the log. 0 disables logging them.
+	int iVoiceStatisticsInterval;
 	/// If true the old SHA1 password hashing is used instead of PBKDF2
 	bool legacyPasswordHash;
 	/// Contains the default number of PBKDF2 iterations to use
@@ -192,6 +202,10 @@ public:
 	Meta();
 	~Meta();
 
+	/// @returns The timing wheel shared by all virtual servers for their per-user timers (e.g. the connection
+	/// 	timeouts). It may only be used by the main thread.
+	TimingWheel &timers() { return m_timers; }
+
 	/// reloadSSLSettings reloads Murmur's MetaParams's
 	/// SSL settings, and updates the certificate and
 	/// private key for all virtual servers that use the
@@ -214,6 +228,10 @@ public:
 signals:
 	void started(Server *);
 	void stopped(Server *);
+
+private:
+	TimingWheel m_timers;
+	QTimer m_timersTick;
 };
 
 extern Meta *meta;
@@ -143,6 +143,9 @@ public:
 
 	virtual void getUptime_async(const ::MumbleServer::AMD_Server_getUptimePtr &, const Ice::Current &);
 
+	virtual void getVoiceStatistics_async(const ::MumbleServer::AMD_Server_getVoiceStatisticsPtr &,
+										  const Ice::Current &);
+
 	virtual void updateCertificate_async(const ::MumbleServer::AMD_Server_updateCertificatePtr &, const std::string &,
 										 const std::string &, const std::string &, const Ice::Current &);
 
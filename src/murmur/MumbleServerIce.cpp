@@ -1011,7 +1011,6 @@ static void impl_Server_setConf(const ::MumbleServer::AMD_Server_setConfPtr cb,
 	QString v = u8(value);
 	ServerDB::setConf(server_id, k, v);
 	if (server) {
-		QWriteLocker wl(&server->qrwlVoiceThread);
 		server->setLiveConf(k, v);
 	}
 	cb->ice_response();
@@ -1146,14 +1145,11 @@ static void impl_Server_getBans(const ::MumbleServer::AMD_Server_getBansPtr cb,
 static void impl_Server_setBans(const ::MumbleServer::AMD_Server_setBansPtr cb, int server_id,
 								const ::MumbleServer::BanList &bans) {
 	NEED_SERVER;
-	{
-		QWriteLocker wl(&server->qrwlVoiceThread);
-		server->qlBans.clear();
-		foreach (const ::MumbleServer::Ban &mb, bans) {
-			::Ban ban;
-			banToBan(mb, ban);
-			server->qlBans << ban;
-		}
+	server->qlBans.clear();
+	foreach (const ::MumbleServer::Ban &mb, bans) {
+		::Ban ban;
+		banToBan(mb, ban);
+		server->qlBans << ban;
 	}
 
 	server->saveBans();
@@ -1462,51 +1458,47 @@ static void impl_Server_setACL(const ::MumbleServer::AMD_Server_setACLPtr cb, in
 	NEED_SERVER;
 	NEED_CHANNEL;
 
-	{
-		QWriteLocker locker(&server->qrwlVoiceThread);
+	::Group *g;
+	ChanACL *acl;
+
+	QHash< QString, QSet< int > > hOldTemp;
+	foreach (g, channel->qhGroups) {
+		hOldTemp.insert(g->qsName, g->qsTemporary);
+		delete g;
+	}
+	foreach (acl, channel->qlACL)
+		delete acl;
 
-		::Group *g;
-		ChanACL *acl;
+	channel->qhGroups.clear();
+	channel->qlACL.clear();
 
-		QHash< QString, QSet< int > > hOldTemp;
-		foreach (g, channel->qhGroups) {
-			hOldTemp.insert(g->qsName, g->qsTemporary);
-			delete g;
-		}
-		foreach (acl, channel->qlACL)
-			delete acl;
-
-		channel->qhGroups.clear();
-		channel->qlACL.clear();
-
-		channel->bInheritACL = inherit;
-		foreach (const ::MumbleServer::Group &gi, groups) {
-			QString name    = u8(gi.name);
-			g               = new ::Group(channel, name);
-			g->bInherit     = gi.inherit;
-			g->bInheritable = gi.inheritable;
+	channel->bInheritACL = inherit;
+	foreach (const ::MumbleServer::Group &gi, groups) {
+		QString name    = u8(gi.name);
+		g               = new ::Group(channel, name);
+		g->bInherit     = gi.inherit;
+		g->bInheritable = gi.inheritable;
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-			QVector< int > addVec(gi.add.begin(), gi.add.end());
-			QVector< int > removeVec(gi.remove.begin(), gi.remove.end());
+		QVector< int > addVec(gi.add.begin(), gi.add.end());
+		QVector< int > removeVec(gi.remove.begin(), gi.remove.end());
 
-			g->qsAdd    = QSet< int >(addVec.begin(), addVec.end());
-			g->qsRemove = QSet< int >(removeVec.begin(), removeVec.end());
+		g->qsAdd    = QSet< int >(addVec.begin(), addVec.end());
+		g->qsRemove = QSet< int >(removeVec.begin(), removeVec.end());
 #else
-			// Qt 5.14 prefers to use the new range-based constructor for vectors and sets
-			g->qsAdd    = QVector< int >::fromStdVector(gi.add).toList().toSet();
-			g->qsRemove = QVector< int >::fromStdVector(gi.remove).toList().toSet();
+		// Qt 5.14 prefers to use the new range-based constructor for vectors and sets
+		g->qsAdd    = QVector< int >::fromStdVector(gi.add).toList().toSet();
+		g->qsRemove = QVector< int >::fromStdVector(gi.remove).toList().toSet();
 #endif
-			g->qsTemporary = hOldTemp.value(name);
-		}
-		foreach (const ::MumbleServer::ACL &ai, acls) {
-			acl             = new ChanACL(channel);
-			acl->bApplyHere = ai.applyHere;
-			acl->bApplySubs = ai.applySubs;
-			acl->iUserId    = ai.userid;
-			acl->qsGroup    = u8(ai.group);
-			acl->pDeny      = static_cast< ChanACL::Permissions >(ai.deny) & ChanACL::All;
-			acl->pAllow     = static_cast< ChanACL::Permissions >(ai.allow) & ChanACL::All;
-		}
+		g->qsTemporary = hOldTemp.value(name);
+	}
+	foreach (const ::MumbleServer::ACL &ai, acls) {
+		acl             = new ChanACL(channel);
+		acl->bApplyHere = ai.applyHere;
+		acl->bApplySubs = ai.applySubs;
+		acl->iUserId    = ai.userid;
+		acl->qsGroup    = u8(ai.group);
+		acl->pDeny      = static_cast< ChanACL::Permissions >(ai.deny) & ChanACL::All;
+		acl->pAllow     = static_cast< ChanACL::Permissions >(ai.allow) & ChanACL::All;
 	}
 
 	server->clearACLCache();
@@ -1693,6 +1685,17 @@ static void impl_Server_getUptime(const ::MumbleServer::AMD_Server_getUptimePtr
 	cb->ice_response(static_cast< int >(server->tUptime.elapsed() / 1000000LL));
 }
 
+#define ACCESS_Server_getVoiceStatistics_READ
+static void impl_Server_getVoiceStatistics(const ::MumbleServer::AMD_Server_getVoiceStatisticsPtr cb, int server_id) {
+	NEED_SERVER;
+
+	::MumbleServer::StatisticsMap sm;
+	for (const std::pair< const char *, std::uint64_t > &entry : server->voiceStatistics().entries()) {
+		sm[entry.first] = static_cast< ::Ice::Long >(entry.second);
+	}
+	cb->ice_response(sm);
+}
+
 static void impl_Server_updateCertificate(const ::MumbleServer::AMD_Server_updateCertificatePtr cb, int server_id,
 										  const ::std::string &certificate, const ::std::string &privateKey,
 										  const ::std::string &passphrase) {
@@ -1732,10 +1735,7 @@ static void impl_Server_updateCertificate(const ::MumbleServer::AMD_Server_updat
 	server->setConf("certificate", u8(certificate));
 	server->setConf("key", u8(privateKey));
 	server->setConf("passphrase", u8(passphrase));
-	{
-		QWriteLocker wl(&server->qrwlVoiceThread);
-		server->initializeCert();
-	}
+	server->initializeCert();
 
 	cb->ice_response();
 }
@@ -1843,15 +1843,11 @@ static void impl_Server_addUserToGroup(const ::MumbleServer::AMD_Server_addUserT
 		return;
 	}
 
-	{
-		QWriteLocker wl(&server->qrwlVoiceThread);
+	::Group *g = channel->qhGroups.value(qsgroup);
+	if (!g)
+		g = new ::Group(channel, qsgroup);
 
-		::Group *g = channel->qhGroups.value(qsgroup);
-		if (!g)
-			g = new ::Group(channel, qsgroup);
-
-		g->qsTemporary.insert(-session);
-	}
+	g->qsTemporary.insert(-session);
 
 	server->clearACLCache(user);
 
@@ -1870,15 +1866,11 @@ static void impl_Server_removeUserFromGroup(const ::MumbleServer::AMD_Server_rem
 		return;
 	}
 
-	{
-		QWriteLocker qrwl(&server->qrwlVoiceThread);
+	::Group *g = channel->qhGroups.value(qsgroup);
+	if (!g)
+		g = new ::Group(channel, qsgroup);
 
-		::Group *g = channel->qhGroups.value(qsgroup);
-		if (!g)
-			g = new ::Group(channel, qsgroup);
-
-		g->qsTemporary.remove(-session);
-	}
+	g->qsTemporary.remove(-session);
 
 	server->clearACLCache(user);
 
@@ -1894,14 +1886,10 @@ static void impl_Server_redirectWhisperGroup(const ::MumbleServer::AMD_Server_re
 	QString qssource = u8(source);
 	QString qstarget = u8(target);
 
-	{
-		QWriteLocker wl(&server->qrwlVoiceThread);
-
-		if (qstarget.isEmpty())
-			user->qmWhisperRedirect.remove(qssource);
-		else
-			user->qmWhisperRedirect.insert(qssource, qstarget);
-	}
+	if (qstarget.isEmpty())
+		user->qmWhisperRedirect.remove(qssource);
+	else
+		user->qmWhisperRedirect.insert(qssource, qstarget);
 
 	server->clearACLCache(user);
 
@@ -2028,6 +2016,7 @@ static void impl_Meta_getUptime(const ::MumbleServer::AMD_Meta_getUptimePtr cb,
 #undef ACCESS_Server_verifyPassword_READ
 #undef ACCESS_Server_getTexture_READ
 #undef ACCESS_Server_getUptime_READ
+#undef ACCESS_Server_getVoiceStatistics_READ
 #undef ACCESS_Meta_getSliceChecksums_ALL
 #undef ACCESS_Meta_getServer_READ
 #undef ACCESS_Meta_getAllServers_READ
@@ -64,12 +64,11 @@ void Server::setUserState(User *pUser, Channel *cChannel, bool mute, bool deaf,
 		mpus.set_name(u8(name));
 	}
 
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-		pUser->bDeaf     = deaf;
-		pUser->bMute     = mute;
-		pUser->bSuppress = suppressed;
-	}
+	pUser->bDeaf     = deaf;
+	pUser->bMute     = mute;
+	pUser->bSuppress = suppressed;
+
+	invalidateVoiceRouting(*pUser);
 
 	pUser->bPrioritySpeaker = prioritySpeaker;
 	pUser->qsName           = name;
@@ -120,11 +119,10 @@ bool Server::setChannelState(Channel *cChannel, Channel *cParent, const QString
 			return false;
 		}
 
-		{
-			QWriteLocker wl(&qrwlVoiceThread);
-			cChannel->cParent->removeChannel(cChannel);
-			cParent->addChannel(cChannel);
-		}
+		cChannel->cParent->removeChannel(cChannel);
+		cParent->addChannel(cChannel);
+
+		invalidateVoiceRouting();
 
 		mpcs.set_parent(cParent->iId);
 
@@ -227,26 +225,22 @@ void Server::setTempGroups(int userid, int sessionId, Channel *cChannel, const Q
 	if (!cChannel)
 		cChannel = qhChannels.value(0);
 
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-
-		Group *g;
-		foreach (g, cChannel->qhGroups) {
-			g->qsTemporary.remove(userid);
-			if (sessionId != 0)
-				g->qsTemporary.remove(-sessionId);
-		}
+	Group *g;
+	foreach (g, cChannel->qhGroups) {
+		g->qsTemporary.remove(userid);
+		if (sessionId != 0)
+			g->qsTemporary.remove(-sessionId);
+	}
 
-		QString gname;
-		foreach (gname, groups) {
-			g = cChannel->qhGroups.value(gname);
-			if (!g) {
-				g = new Group(cChannel, gname);
-			}
-			g->qsTemporary.insert(userid);
-			if (sessionId != 0)
-				g->qsTemporary.insert(-sessionId);
+	QString gname;
+	foreach (gname, groups) {
+		g = cChannel->qhGroups.value(gname);
+		if (!g) {
+			g = new Group(cChannel, gname);
 		}
+		g->qsTemporary.insert(userid);
+		if (sessionId != 0)
+			g->qsTemporary.insert(-sessionId);
 	}
 
 	User *p = qhUsers.value(userid);
@@ -265,20 +259,16 @@ void Server::clearTempGroups(User *user, Channel *cChannel, bool recurse) {
 
 	qlChans.append(cChannel);
 
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-
-		while (!qlChans.isEmpty()) {
-			Channel *chan = qlChans.takeLast();
-			Group *g;
-			foreach (g, chan->qhGroups) {
-				g->qsTemporary.remove(user->iId);
-				g->qsTemporary.remove(-static_cast< int >(user->uiSession));
-			}
-
-			if (recurse)
-				qlChans << chan->qlChannels;
+	while (!qlChans.isEmpty()) {
+		Channel *chan = qlChans.takeLast();
+		Group *g;
+		foreach (g, chan->qhGroups) {
+			g->qsTemporary.remove(user->iId);
+			g->qsTemporary.remove(-static_cast< int >(user->uiSession));
 		}
+
+		if (recurse)
+			qlChans << chan->qlChannels;
 	}
 
 	clearACLCache(user);
@@ -10,6 +10,7 @@
 #include "ClientType.h"
 #include "Connection.h"
 #include "EnvUtils.h"
+#include "Frequency.h"
 #include "Group.h"
 #include "HTMLFilter.h"
 #include "HostAddress.h"
@@ -19,8 +20,10 @@
 #include "QtUtils.h"
 #include "ServerDB.h"
 #include "ServerUser.h"
+#include "UDPWorker.h"
 #include "User.h"
 #include "Version.h"
+#include "VoiceTunnel.h"
 
 #ifdef USE_ZEROCONF
 #	include "Zeroconf.h"
@@ -77,10 +80,21 @@ QSslSocket *SslServer::nextPendingSSLConnection() {
 }
 
 
-Server::Server(int snum, QObject *p) : QThread(p) {
+Server::Server(int snum, QObject *p)
+	: QObject(p)
+#ifdef USE_SERVER_MIXING
+	  ,
+	  m_frequencyMixer(MIXING_WORKERS,
+					   [this](std::size_t worker, unsigned int frequency, const Mumble::Protocol::AudioData &audioData,
+							  const std::vector< unsigned int > &transmitters) {
+						   sendMixedAudio(worker, frequency, audioData, transmitters);
+					   })
+#endif
+{
 	tracy::SetThreadName("Main");
 
 	bValid     = true;
+	bRunning   = false;
 	iServerNum = snum;
 #ifdef USE_ZEROCONF
 	zeroconf = nullptr;
@@ -92,7 +106,13 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 #else
 	hNotify = nullptr;
 #endif
-	qtTimeout = new QTimer(this);
+	m_voiceRoutingTimer.setSingleShot(true);
+	connect(&m_voiceRoutingTimer, &QTimer::timeout, this, &Server::updateVoiceRouting);
+
+	m_broadcastTimer.setSingleShot(true);
+	connect(&m_broadcastTimer, &QTimer::timeout, this, &Server::flushBroadcasts);
+
+	connect(&m_voiceStatisticsTimer, &QTimer::timeout, this, &Server::logVoiceStatistics);
 
 	iCodecAlpha = iCodecBeta = 0;
 	bPreferAlpha             = false;
@@ -120,6 +140,26 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 	if (!bValid)
 		return;
 
+	int udpWorkerCount = iUdpWorkers > 0 ? iUdpWorkers : QThread::idealThreadCount();
+#if !defined(Q_OS_LINUX) || !defined(SO_REUSEPORT)
+	if (udpWorkerCount > 1) {
+		// Other platforms either lack SO_REUSEPORT or don't balance the load among the sockets
+		log("Server: Multiple UDP workers are only supported on Linux, using a single one");
+		udpWorkerCount = 1;
+	}
+#endif
+#ifdef USE_SERVER_MIXING
+	// The last reader slots are taken by the mixing threads
+	udpWorkerCount =
+		qBound(1, udpWorkerCount, static_cast< int >(VoiceRoutingPublisher::MAX_READERS - MIXING_WORKERS));
+#else
+	udpWorkerCount = qBound(1, udpWorkerCount, static_cast< int >(VoiceRoutingPublisher::MAX_READERS));
+#endif
+
+	for (int i = 0; i < udpWorkerCount; ++i) {
+		m_udpWorkers << new UDPWorker(*this, static_cast< std::size_t >(i));
+	}
+
 	foreach (SslServer *ss, qlServer) {
 		sockaddr_storage addr;
 #ifdef Q_OS_UNIX
@@ -131,80 +171,95 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 #endif
 		memset(&addr, 0, sizeof(addr));
 		getsockname(tcpsock, reinterpret_cast< struct sockaddr * >(&addr), &len);
+		foreach (UDPWorker *worker, m_udpWorkers) {
 #ifdef Q_OS_UNIX
-		int sock = ::socket(addr.ss_family, SOCK_DGRAM, 0);
+			int sock = ::socket(addr.ss_family, SOCK_DGRAM, 0);
 #	ifdef Q_OS_LINUX
-		int sockopt = 1;
-		if (setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &sockopt, sizeof(sockopt)))
-			log(QString("Failed to set IP_PKTINFO for %1").arg(addressToString(ss->serverAddress(), usPort)));
-		sockopt = 1;
-		if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &sockopt, sizeof(sockopt)))
-			log(QString("Failed to set IPV6_RECVPKTINFO for %1").arg(addressToString(ss->serverAddress(), usPort)));
+			int sockopt = 1;
+			if (setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &sockopt, sizeof(sockopt)))
+				log(QString("Failed to set IP_PKTINFO for %1").arg(addressToString(ss->serverAddress(), usPort)));
+			sockopt = 1;
+			if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &sockopt, sizeof(sockopt)))
+				log(QString("Failed to set IPV6_RECVPKTINFO for %1").arg(addressToString(ss->serverAddress(), usPort)));
 #	endif
 #else
 #	ifndef SIO_UDP_CONNRESET
 #		define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR, 12)
 #	endif
-		SOCKET sock           = ::WSASocket(addr.ss_family, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_OVERLAPPED);
-		DWORD dwBytesReturned = 0;
-		BOOL bNewBehaviour    = FALSE;
-		if (WSAIoctl(sock, SIO_UDP_CONNRESET, &bNewBehaviour, sizeof(bNewBehaviour), nullptr, 0, &dwBytesReturned,
-					 nullptr, nullptr)
-			== SOCKET_ERROR) {
-			log(QString("Failed to set SIO_UDP_CONNRESET: %1").arg(WSAGetLastError()));
-		}
+			SOCKET sock           = ::WSASocket(addr.ss_family, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0,
+												WSA_FLAG_OVERLAPPED);
+			DWORD dwBytesReturned = 0;
+			BOOL bNewBehaviour    = FALSE;
+			if (WSAIoctl(sock, SIO_UDP_CONNRESET, &bNewBehaviour, sizeof(bNewBehaviour), nullptr, 0, &dwBytesReturned,
+						 nullptr, nullptr)
+				== SOCKET_ERROR) {
+				log(QString("Failed to set SIO_UDP_CONNRESET: %1").arg(WSAGetLastError()));
+			}
 #endif
-		if (sock == INVALID_SOCKET) {
-			log("Failed to create UDP Socket");
-			bValid = false;
-			return;
-		} else {
-			if (addr.ss_family == AF_INET6) {
-				// Copy IPV6_V6ONLY attribute from tcp socket, it defaults to nonzero on Windows
-				// See https://msdn.microsoft.com/en-us/library/windows/desktop/ms738574%28v=vs.85%29.aspx
-				// This will fail for WindowsXP which is ok. Our TCP code will have split that up
-				// into two sockets.
-				int ipv6only     = 0;
-				socklen_t optlen = sizeof(ipv6only);
-				if (::getsockopt(tcpsock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< char * >(&ipv6only), &optlen)
-					== 0) {
-					if (::setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< const char * >(&ipv6only),
-									 optlen)
-						== SOCKET_ERROR) {
-						log(QString("Failed to copy IPV6_V6ONLY socket attribute from tcp to udp socket"));
+			if (sock == INVALID_SOCKET) {
+				log("Failed to create UDP Socket");
+				bValid = false;
+				return;
+			} else {
+				if (addr.ss_family == AF_INET6) {
+					// Copy IPV6_V6ONLY attribute from tcp socket, it defaults to nonzero on Windows
+					// See https://msdn.microsoft.com/en-us/library/windows/desktop/ms738574%28v=vs.85%29.aspx
+					// This will fail for WindowsXP which is ok. Our TCP code will have split that up
+					// into two sockets.
+					int ipv6only     = 0;
+					socklen_t optlen = sizeof(ipv6only);
+					if (::getsockopt(tcpsock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< char * >(&ipv6only), &optlen)
+						== 0) {
+						if (::setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< const char * >(&ipv6only),
+										 optlen)
+							== SOCKET_ERROR) {
+							log(QString("Failed to copy IPV6_V6ONLY socket attribute from tcp to udp socket"));
+						}
 					}
 				}
-			}
 
-			if (::bind(sock, reinterpret_cast< sockaddr * >(&addr), len) == SOCKET_ERROR) {
-				log(QString("Failed to bind UDP Socket to %1").arg(addressToString(ss->serverAddress(), usPort)));
-			} else {
-#ifdef Q_OS_UNIX
-				int val = 0xe0;
-				if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val))) {
-					val = 0x80;
-					if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val)))
-						log("Server: Failed to set TOS for UDP Socket");
+#if defined(Q_OS_LINUX) && defined(SO_REUSEPORT)
+				if (m_udpWorkers.count() > 1) {
+					// Let the kernel distribute the incoming datagrams among the workers' sockets
+					int reuse = 1;
+					if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)))
+						log(QString("Failed to set SO_REUSEPORT for %1")
+								.arg(addressToString(ss->serverAddress(), usPort)));
 				}
+#endif
+
+				if (::bind(sock, reinterpret_cast< sockaddr * >(&addr), len) == SOCKET_ERROR) {
+					log(QString("Failed to bind UDP Socket to %1").arg(addressToString(ss->serverAddress(), usPort)));
+				} else {
+#ifdef Q_OS_UNIX
+					int val = 0xe0;
+					if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val))) {
+						val = 0x80;
+						if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val)))
+							log("Server: Failed to set TOS for UDP Socket");
+					}
 #	if defined(SO_PRIORITY)
-				socklen_t optlen = sizeof(val);
-				if (getsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, &optlen) == 0) {
-					if (val == 0) {
-						val = 6;
-						setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, sizeof(val));
+					socklen_t optlen = sizeof(val);
+					if (getsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, &optlen) == 0) {
+						if (val == 0) {
+							val = 6;
+							setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, sizeof(val));
+						}
 					}
-				}
 #	endif
 #endif
+				}
+				QSocketNotifier *qsn = new QSocketNotifier(sock, QSocketNotifier::Read, this);
+				connect(qsn, SIGNAL(activated(int)), this, SLOT(udpActivated(int)));
+				qlUdpSocket << sock;
+				worker->m_sockets << sock;
+				qlUdpNotifier << qsn;
 			}
-			QSocketNotifier *qsn = new QSocketNotifier(sock, QSocketNotifier::Read, this);
-			connect(qsn, SIGNAL(activated(int)), this, SLOT(udpActivated(int)));
-			qlUdpSocket << sock;
-			qlUdpNotifier << qsn;
 		}
 	}
 
-	bValid = bValid && (qlServer.count() == qlBind.count()) && (qlUdpSocket.count() == qlBind.count());
+	bValid = bValid && (qlServer.count() == qlBind.count())
+			 && (qlUdpSocket.count() == qlBind.count() * m_udpWorkers.count());
 	if (!bValid)
 		return;
 
@@ -215,23 +270,24 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 		return;
 	}
 #else
-	hNotify = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	// Manual-reset, so that the event wakes up every worker
+	hNotify = CreateEvent(nullptr, TRUE, FALSE, nullptr);
 #endif
 
-	connect(this, SIGNAL(tcpTransmit(QByteArray, unsigned int)), this, SLOT(tcpTransmitData(QByteArray, unsigned int)),
-			Qt::QueuedConnection);
 	connect(this, SIGNAL(reqSync(unsigned int)), this, SLOT(doSync(unsigned int)));
+	connect(this, &Server::reqRouteAudio, this, &Server::routeAudio);
 
 	for (int i = 1; i < iMaxUsers * 2; ++i)
 		qqIds.enqueue(i);
 
-	connect(qtTimeout, SIGNAL(timeout()), this, SLOT(checkTimeout()));
-
 	getBans();
 	readChannels();
 	readLinks();
 	initializeCert();
 
+	// Publish the initial voice routing right away, so that it is in place before the first UDP packet arrives
+	m_voiceRouting.publish(buildVoiceRouting());
+
 	if (bValid) {
 #ifdef USE_ZEROCONF
 		if (bBonjour)
@@ -242,13 +298,17 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 }
 
 void Server::startThread() {
-	if (!isRunning()) {
-		log("Starting voice thread");
+	if (!bRunning) {
+		log(QString("Starting %1 voice thread(s)").arg(m_udpWorkers.count()));
 		bRunning = true;
 
 		foreach (QSocketNotifier *qsn, qlUdpNotifier)
 			qsn->setEnabled(false);
-		start(QThread::HighestPriority);
+		foreach (UDPWorker *worker, m_udpWorkers)
+			worker->start(QThread::HighestPriority);
+#ifdef USE_SERVER_MIXING
+		m_frequencyMixer.start();
+#endif
 #ifdef Q_OS_LINUX
 		// QThread::HighestPriority == Same as everything else...
 		int policy;
@@ -262,15 +322,20 @@ void Server::startThread() {
 		}
 #endif
 	}
-	if (!qtTimeout->isActive())
-		qtTimeout->start(15500);
+	if (!m_voiceStatisticsTimer.isActive() && iVoiceStatisticsInterval > 0)
+		m_voiceStatisticsTimer.start(iVoiceStatisticsInterval * 1000);
 }
 
 void Server::stopThread() {
+	bool wasRunning = false;
+	foreach (UDPWorker *worker, m_udpWorkers)
+		wasRunning = wasRunning || worker->isRunning();
+
 	bRunning = false;
-	if (isRunning()) {
-		log("Ending voice thread");
+	if (wasRunning) {
+		log("Ending voice thread(s)");
 
+		// The notification stays pending until all workers have seen it
 #ifdef Q_OS_UNIX
 		unsigned char val = 0;
 		if (::write(aiNotify[1], &val, 1) != 1)
@@ -278,12 +343,26 @@ void Server::stopThread() {
 #else
 		SetEvent(hNotify);
 #endif
-		wait();
+		foreach (UDPWorker *worker, m_udpWorkers)
+			worker->wait();
+#ifdef USE_SERVER_MIXING
+		m_frequencyMixer.stop();
+#endif
+
+#ifdef Q_OS_UNIX
+		while (::recv(aiNotify[0], &val, 1, MSG_DONTWAIT) == 1) {
+		};
+#else
+		ResetEvent(hNotify);
+#endif
 
 		foreach (QSocketNotifier *qsn, qlUdpNotifier)
 			qsn->setEnabled(true);
+
+		// The voice thread can't reference anything anymore
+		m_voiceRouting.reclaim();
 	}
-	qtTimeout->stop();
+	m_voiceStatisticsTimer.stop();
 }
 
 Server::~Server() {
@@ -312,6 +391,12 @@ Server::~Server() {
 #endif
 	clearACLCache();
 
+	const BroadcastQueue::Statistics &broadcastStatistics = m_broadcasts.statistics();
+	log(QString("Broadcasts: %1 UserState updates coalesced, %2 bytes saved")
+			.arg(broadcastStatistics.messagesCoalesced)
+			.arg(broadcastStatistics.bytesSaved));
+	log(QString("Voice (total): %1").arg(formatVoiceStatistics(voiceStatistics())));
+
 	log("Stopped");
 }
 
@@ -354,6 +439,10 @@ void Server::readParams() {
 	iOpusThreshold                     = Meta::mp.iOpusThreshold;
 	iChannelNestingLimit               = Meta::mp.iChannelNestingLimit;
 	iChannelCountLimit                 = Meta::mp.iChannelCountLimit;
+	iUdpWorkers                        = Meta::mp.iUdpWorkers;
+	iMixingThreshold                   = Meta::mp.iMixingThreshold;
+	iRadioChannel                      = Meta::mp.iRadioChannel;
+	iVoiceStatisticsInterval           = Meta::mp.iVoiceStatisticsInterval;
 
 	QString qsHost = getConf("host", QString()).toString();
 	if (!qsHost.isEmpty()) {
@@ -444,6 +533,12 @@ void Server::readParams() {
 	iChannelNestingLimit = getConf("channelnestinglimit", iChannelNestingLimit).toInt();
 	iChannelCountLimit   = getConf("channelcountlimit", iChannelCountLimit).toInt();
 
+	iUdpWorkers      = getConf("udpworkers", iUdpWorkers).toInt();
+	iMixingThreshold = getConf("mixingthreshold", iMixingThreshold).toInt();
+	iRadioChannel    = getConf("radiochannel", iRadioChannel).toInt();
+
+	iVoiceStatisticsInterval = getConf("voicestatisticsinterval", iVoiceStatisticsInterval).toInt();
+
 	qrUserName    = QRegExp(getConf("username", qrUserName.pattern()).toString());
 	qrChannelName = QRegExp(getConf("channelname", qrChannelName.pattern()).toString());
 
@@ -473,9 +568,12 @@ void Server::setLiveConf(const QString &key, const QString &value) {
 	int i     = v.toInt();
 	if ((key == "password") || (key == "serverpassword"))
 		qsPassword = !v.isNull() ? v : Meta::mp.qsPassword;
-	else if (key == "timeout")
+	else if (key == "timeout") {
 		iTimeout = i ? i : Meta::mp.iTimeout;
-	else if (key == "bandwidth") {
+		// The timers that have been scheduled already expire according to the previous timeout
+		foreach (ServerUser *u, qhUsers)
+			scheduleTimeout(u);
+	} else if (key == "bandwidth") {
 		int length = i ? i : Meta::mp.iMaxBandwidth;
 		if (length != iMaxBandwidth) {
 			iMaxBandwidth = length;
@@ -541,6 +639,8 @@ void Server::setLiveConf(const QString &key, const QString &value) {
 		QString text = !v.isNull() ? v : Meta::mp.qsRegName;
 		if (text != qsRegName) {
 			qsRegName = text;
+			// The root channel is named after the server
+			invalidateChannelTreeSync();
 			if (!qsRegName.isEmpty()) {
 				MumbleProto::ChannelState mpcs;
 				mpcs.set_channel_id(0);
@@ -589,7 +689,19 @@ void Server::setLiveConf(const QString &key, const QString &value) {
 		iChannelNestingLimit = (i >= 0 && !v.isNull()) ? i : Meta::mp.iChannelNestingLimit;
 	else if (key == "channelcountlimit")
 		iChannelCountLimit = (i >= 0 && !v.isNull()) ? i : Meta::mp.iChannelCountLimit;
-	else if (key == "messagelimit") {
+	else if (key == "mixingthreshold") {
+		iMixingThreshold = (i >= 0 && !v.isNull()) ? i : Meta::mp.iMixingThreshold;
+		invalidateVoiceRouting();
+	} else if (key == "radiochannel") {
+		iRadioChannel = (i >= 0 && !v.isNull()) ? i : Meta::mp.iRadioChannel;
+	} else if (key == "voicestatisticsinterval") {
+		iVoiceStatisticsInterval = (i >= 0 && !v.isNull()) ? i : Meta::mp.iVoiceStatisticsInterval;
+		if (iVoiceStatisticsInterval > 0 && bRunning) {
+			m_voiceStatisticsTimer.start(iVoiceStatisticsInterval * 1000);
+		} else {
+			m_voiceStatisticsTimer.stop();
+		}
+	} else if (key == "messagelimit") {
 		iMessageLimit = (!v.isNull()) ? v.toUInt() : Meta::mp.iMessageLimit;
 		if (iMessageLimit < 1) {
 			iMessageLimit = 1;
@@ -602,7 +714,12 @@ void Server::setLiveConf(const QString &key, const QString &value) {
 	} else if (key == "broadcastlistenervolumeadjustments") {
 		broadcastListenerVolumeAdjustments =
 			(!v.isNull() ? QVariant(v).toBool() : Meta::mp.broadcastListenerVolumeAdjustments);
+		// Joining clients only get to know the listener volumes if they are broadcast
+		m_userStateSync.clear();
 	}
+
+	// Parts of the configuration are used by the voice thread
+	invalidateVoiceRouting();
 }
 
 #ifdef USE_ZEROCONF
@@ -634,17 +751,17 @@ void Server::removeZeroconf() {
 
 gsl::span< const Mumble::Protocol::byte >
 	Server::handlePing(const Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > &decoder,
-					   Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > &encoder,
-					   bool expectExtended) {
+					   Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > &encoder, bool expectExtended,
+					   const VoiceRoutingSnapshot &routing) {
 	Mumble::Protocol::PingData pingData = decoder.getPingData();
 
 	if (pingData.requestAdditionalInformation) {
 		pingData.requestAdditionalInformation = false;
 
 		pingData.serverVersion                 = Version::get();
-		pingData.userCount                     = qhUsers.size() - m_botCount;
-		pingData.maxUserCount                  = iMaxUsers;
-		pingData.maxBandwidthPerUser           = iMaxBandwidth;
+		pingData.userCount                     = routing.userCount;
+		pingData.maxUserCount                  = routing.maxUsers;
+		pingData.maxBandwidthPerUser           = routing.maxBandwidth;
 		pingData.containsAdditionalInformation = true;
 	} else if (expectExtended) {
 		// Return zero-length span
@@ -708,7 +825,8 @@ void Server::udpActivated(int socket) {
 
 	if (bAllowPing && m_udpDecoder.decodePing(inputData)
 		&& m_udpDecoder.getMessageType() == Mumble::Protocol::UDPMessageType::Ping) {
-		gsl::span< const Mumble::Protocol::byte > encodedPing = handlePing(m_udpDecoder, m_udpPingEncoder, true);
+		gsl::span< const Mumble::Protocol::byte > encodedPing =
+			handlePing(m_udpDecoder, m_udpPingEncoder, true, m_voiceRouting.current());
 
 		if (!encodedPing.empty()) {
 #ifdef Q_OS_LINUX
@@ -725,27 +843,16 @@ void Server::udpActivated(int socket) {
 	}
 }
 
-void Server::run() {
+void Server::processUDP(UDPWorker &worker) {
 	tracy::SetThreadName("Audio");
 
-	qint32 len;
-#if defined(__LP64__)
-	unsigned char encbuff[Mumble::Protocol::MAX_UDP_PACKET_SIZE + 8];
-	unsigned char *encrypt = encbuff + 4;
-#else
-	unsigned char encrypt[Mumble::Protocol::MAX_UDP_PACKET_SIZE];
-#endif
-	unsigned char buffer[Mumble::Protocol::MAX_UDP_PACKET_SIZE];
-
-	sockaddr_storage from;
-	int nfds = qlUdpSocket.count();
+	int nfds = worker.m_sockets.count();
 
 #ifdef Q_OS_UNIX
-	socklen_t fromlen;
 	STACKVAR(struct pollfd, fds, nfds + 1);
 
 	for (int i = 0; i < nfds; ++i) {
-		fds[i].fd      = qlUdpSocket.at(i);
+		fds[i].fd      = worker.m_sockets.at(i);
 		fds[i].events  = POLLIN;
 		fds[i].revents = 0;
 	}
@@ -754,11 +861,10 @@ void Server::run() {
 	fds[nfds].events  = POLLIN;
 	fds[nfds].revents = 0;
 #else
-	int fromlen;
 	STACKVAR(SOCKET, fds, nfds);
 	STACKVAR(HANDLE, events, nfds + 1);
 	for (int i = 0; i < nfds; ++i) {
-		fds[i]    = qlUdpSocket.at(i);
+		fds[i]    = worker.m_sockets.at(i);
 		events[i] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 		::WSAEventSelect(fds[i], events[i], FD_READ);
 	}
@@ -781,10 +887,7 @@ void Server::run() {
 		}
 
 		if (fds[nfds - 1].revents) {
-			// Drain pipe
-			unsigned char val;
-			while (::recv(aiNotify[0], &val, 1, MSG_DONTWAIT) == 1) {
-			};
+			// Server::stopThread drains the pipe once all workers have stopped
 			break;
 		}
 
@@ -812,177 +915,192 @@ void Server::run() {
 				SOCKET sock = fds[ret - WAIT_OBJECT_0];
 #endif
 
-				fromlen = sizeof(from);
+				// Read as many of the pending datagrams as possible with a single system call
+				const int count = worker.m_receiveBatch.receive(sock);
+				if (count <= 0) {
+					break;
+				}
+
+				const VoiceStatistics::Clock::time_point received = VoiceStatistics::Clock::now();
+				worker.m_statistics.countReceived(static_cast< std::uint64_t >(count));
+
+				std::uint64_t audioPackets = 0;
+				for (int j = 0; j < count; ++j) {
+					if (processDatagram(worker, sock, static_cast< std::size_t >(j))) {
+						audioPackets++;
+					}
+				}
+
+				// Send out the audio of all received datagrams in as few system calls as possible
+				worker.m_sendBatch.flush();
+
+				if (audioPackets > 0) {
+					worker.m_statistics.latency.record(
+						VoiceStatistics::elapsed(received, VoiceStatistics::Clock::now()), audioPackets);
+				}
+#ifdef Q_OS_UNIX
+				fds[i].revents = 0;
+#endif
+			}
+		}
+	}
 #ifdef Q_OS_WIN
-				len = ::recvfrom(sock, reinterpret_cast< char * >(encrypt), Mumble::Protocol::MAX_UDP_PACKET_SIZE, 0,
-								 reinterpret_cast< struct sockaddr * >(&from), &fromlen);
+	for (int i = 0; i < nfds - 1; ++i) {
+		::WSAEventSelect(fds[i], nullptr, 0);
+		CloseHandle(events[i]);
+	}
+#endif
+}
+
+#ifdef Q_OS_UNIX
+bool Server::processDatagram(UDPWorker &worker, int sock, std::size_t index) {
 #else
-#	ifdef Q_OS_LINUX
-				struct msghdr msg;
-				struct iovec iov[1];
+bool Server::processDatagram(UDPWorker &worker, SOCKET sock, std::size_t index) {
+#endif
+	// Capture only the processing without the polling
+	ZoneScopedN(TracyConstants::UDP_PACKET_PROCESSING_ZONE);
 
-				iov[0].iov_base = encrypt;
-				iov[0].iov_len  = Mumble::Protocol::MAX_UDP_PACKET_SIZE;
+	unsigned char *encrypt       = worker.m_receiveBatch.data(index);
+	qint32 len                   = worker.m_receiveBatch.length(index);
+	const sockaddr_storage &from = worker.m_receiveBatch.address(index);
+	unsigned char buffer[Mumble::Protocol::MAX_UDP_PACKET_SIZE];
 
-				uint8_t controldata[CMSG_SPACE(std::max(sizeof(struct in6_pktinfo), sizeof(struct in_pktinfo)))];
+	if (len < 5) {
+		// 4 bytes crypt header + type + session
+		return false;
+	} else if (static_cast< unsigned int >(len) > Mumble::Protocol::MAX_UDP_PACKET_SIZE) {
+		// The datagram has been truncated
+		return false;
+	}
 
-				memset(&msg, 0, sizeof(msg));
-				msg.msg_name       = reinterpret_cast< struct sockaddr * >(&from);
-				msg.msg_namelen    = sizeof(from);
-				msg.msg_iov        = iov;
-				msg.msg_iovlen     = 1;
-				msg.msg_control    = controldata;
-				msg.msg_controllen = sizeof(controldata);
+	// Everything needed for routing the packet is taken from an immutable snapshot, so processing the
+	// packet never has to wait for the main thread. Objects reachable through the snapshot (or looked up
+	// while the guard is alive) are guaranteed to stay alive until the guard is destroyed.
+	VoiceRoutingPublisher::ReadGuard routingGuard(m_voiceRouting, worker.m_index);
+	const VoiceRoutingSnapshot &routing = routingGuard.snapshot();
 
-				len = static_cast< quint32 >(::recvmsg(sock, &msg, MSG_TRUNC));
-				Q_UNUSED(fromlen);
-#	else
-				len = static_cast< qint32 >(::recvfrom(sock, encrypt, Mumble::Protocol::MAX_UDP_PACKET_SIZE, MSG_TRUNC,
-													   reinterpret_cast< struct sockaddr * >(&from), &fromlen));
-#	endif
-#endif
+	quint16 port = (from.ss_family == AF_INET6) ? (reinterpret_cast< const sockaddr_in6 * >(&from)->sin6_port)
+												: (reinterpret_cast< const sockaddr_in * >(&from)->sin_port);
+	const HostAddress &ha = HostAddress(from);
 
-				// Capture only the processing without the polling
-				ZoneScopedN(TracyConstants::UDP_PACKET_PROCESSING_ZONE);
+	const QPair< HostAddress, quint16 > &key = QPair< HostAddress, quint16 >(ha, port);
 
-				if (len == 0) {
-					break;
-				} else if (len == SOCKET_ERROR) {
-					break;
-				} else if (len < 5) {
-					// 4 bytes crypt header + type + session
-					continue;
-				} else if (static_cast< unsigned int >(len) > Mumble::Protocol::MAX_UDP_PACKET_SIZE) {
-					// This will also catch the len == -1 case (indicating error)
-					static_assert(static_cast< unsigned int >(-1) > Mumble::Protocol::MAX_UDP_PACKET_SIZE,
-								  "Invalid assumption");
-					continue;
-				}
+	ServerUser *u;
+	{
+		ZoneScopedN(TracyConstants::UDP_PEER_LOOKUP_ZONE);
 
-				QReadLocker rl(&qrwlVoiceThread);
+		QReadLocker rl(&worker.m_peerLock);
+		u = worker.m_peerUsers.value(key);
+	}
 
-				quint16 port = (from.ss_family == AF_INET6) ? (reinterpret_cast< sockaddr_in6 * >(&from)->sin6_port)
-															: (reinterpret_cast< sockaddr_in * >(&from)->sin_port);
-				const HostAddress &ha = HostAddress(from);
+	if (u) {
+		worker.m_udpDecoder.setProtocolVersion(u->m_version);
+	} else {
+		worker.m_udpDecoder.setProtocolVersion(Version::UNKNOWN);
+	}
+	// This may be a general ping requesting server details, unencrypted.
+	if (routing.allowPing && worker.m_udpDecoder.decodePing(gsl::span< Mumble::Protocol::byte >(encrypt, len))
+		&& worker.m_udpDecoder.getMessageType() == Mumble::Protocol::UDPMessageType::Ping) {
+		ZoneScopedN(TracyConstants::PING_PROCESSING_ZONE);
 
-				const QPair< HostAddress, quint16 > &key = QPair< HostAddress, quint16 >(ha, port);
+		gsl::span< const Mumble::Protocol::byte > encodedPing =
+			handlePing(worker.m_udpDecoder, worker.m_udpPingEncoder, true, routing);
 
-				ServerUser *u = qhPeerUsers.value(key);
+		if (!encodedPing.empty()) {
+			worker.m_receiveBatch.reply(index, sock, encodedPing.data(), encodedPing.size());
+		}
 
-				if (u) {
-					m_udpDecoder.setProtocolVersion(u->m_version);
-				} else {
-					m_udpDecoder.setProtocolVersion(Version::UNKNOWN);
-				}
-				// This may be a general ping requesting server details, unencrypted.
-				if (bAllowPing && m_udpDecoder.decodePing(gsl::span< Mumble::Protocol::byte >(encrypt, len))
-					&& m_udpDecoder.getMessageType() == Mumble::Protocol::UDPMessageType::Ping) {
-					ZoneScopedN(TracyConstants::PING_PROCESSING_ZONE);
+		return false;
+	}
 
-					gsl::span< const Mumble::Protocol::byte > encodedPing =
-						handlePing(m_udpDecoder, m_udpPingEncoder, true);
 
-					if (!encodedPing.empty()) {
-#ifdef Q_OS_LINUX
-						// We are only reading from the buffer and thus the const_cast should be fine
-						iov[0].iov_base = const_cast< Mumble::Protocol::byte * >(encodedPing.data());
-						iov[0].iov_len  = encodedPing.size();
-						::sendmsg(sock, &msg, 0);
-#else
-						::sendto(sock, reinterpret_cast< const char * >(encodedPing.data()), encodedPing.size(), 0,
-								 reinterpret_cast< struct sockaddr * >(&from), fromlen);
-#endif
-					}
+	if (u) {
+		const VoiceStatistics::Clock::time_point decryptStart = VoiceStatistics::Clock::now();
+		const bool decrypted                                  = checkDecrypt(u, encrypt, buffer, len);
+		worker.m_statistics.decrypt.record(VoiceStatistics::elapsed(decryptStart, VoiceStatistics::Clock::now()));
+
+		if (!decrypted) {
+			worker.m_statistics.countDecryptFailure();
+			return false;
+		}
+	} else {
+		ZoneScopedN(TracyConstants::DECRYPT_UNKNOWN_PEER_ZONE);
 
-					continue;
+		QSet< ServerUser * > candidates;
+		{
+			QReadLocker rl(&qrwlPeers);
+			candidates = qhHostUsers.value(ha);
+		}
+
+		// Unknown peer
+		for (ServerUser *usr : candidates) {
+			if (checkDecrypt(usr, encrypt, buffer, len)) { // checkDecrypt takes the User's qrwlCrypt lock.
+				// The main thread might have disconnected the user in the meantime (it won't be deleted
+				// while we are holding the routing guard though).
+				QWriteLocker wl(&qrwlPeers);
+				auto it = qhHostUsers.find(ha);
+				if (it != qhHostUsers.end() && it->contains(usr)) {
+					u             = usr;
+					u->sUdpSocket = sock;
+					memcpy(&u->saiUdpAddress, &from, sizeof(from));
+					it->remove(u);
+
+					// The kernel will deliver all further packets of this peer to this worker
+					QWriteLocker peerLock(&worker.m_peerLock);
+					worker.m_peerUsers.insert(key, u);
 				}
+				break;
+			}
+		}
+		if (!u) {
+			worker.m_statistics.countDecryptFailure();
+			return false;
+		}
+	}
+	len -= 4;
 
+	if (worker.m_udpDecoder.decode(gsl::span< Mumble::Protocol::byte >(buffer, len))) {
+		switch (worker.m_udpDecoder.getMessageType()) {
+			case Mumble::Protocol::UDPMessageType::Audio: {
+				Mumble::Protocol::AudioData audioData = worker.m_udpDecoder.getAudioData();
 
-				if (u) {
-					if (!checkDecrypt(u, encrypt, buffer, len)) {
-						continue;
-					}
-				} else {
-					ZoneScopedN(TracyConstants::DECRYPT_UNKNOWN_PEER_ZONE);
-
-					// Unknown peer
-					foreach (ServerUser *usr, qhHostUsers.value(ha)) {
-						if (checkDecrypt(usr, encrypt, buffer, len)) { // checkDecrypt takes the User's qrwlCrypt lock.
-							// Every time we relock, reverify users' existence.
-							// The main thread might delete the user while the lock isn't held.
-							unsigned int uiSession = usr->uiSession;
-							rl.unlock();
-							qrwlVoiceThread.lockForWrite();
-							if (qhUsers.contains(uiSession)) {
-								u             = usr;
-								u->sUdpSocket = sock;
-								memcpy(&u->saiUdpAddress, &from, sizeof(from));
-								qhHostUsers[from].remove(u);
-								qhPeerUsers.insert(key, u);
-							}
-							qrwlVoiceThread.unlock();
-							rl.relock();
-							if (u && !qhUsers.contains(uiSession))
-								u = nullptr;
-							break;
-						}
-					}
-					if (!u) {
-						continue;
-					}
+				// Allow all voice packets through by default.
+				bool ok = true;
+				// ...Unless we're in Opus mode. In Opus mode, only Opus packets are allowed.
+				if (routing.opus && audioData.usedCodec != Mumble::Protocol::AudioCodec::Opus) {
+					ok = false;
 				}
-				len -= 4;
-
-				if (m_udpDecoder.decode(gsl::span< Mumble::Protocol::byte >(buffer, len))) {
-					switch (m_udpDecoder.getMessageType()) {
-						case Mumble::Protocol::UDPMessageType::Audio: {
-							Mumble::Protocol::AudioData audioData = m_udpDecoder.getAudioData();
-
-							// Allow all voice packets through by default.
-							bool ok = true;
-							// ...Unless we're in Opus mode. In Opus mode, only Opus packets are allowed.
-							if (bOpus && audioData.usedCodec != Mumble::Protocol::AudioCodec::Opus) {
-								ok = false;
-							}
 
-							if (ok) {
-								u->aiUdpFlag = 1;
+				if (ok) {
+					u->aiUdpFlag = 1;
 
-								// Add session id
-								audioData.senderSession = u->uiSession;
+					// Add session id
+					audioData.senderSession = u->uiSession;
 
-								processMsg(u, audioData, m_udpAudioReceivers, m_udpAudioEncoder);
-							}
-							break;
-						}
-						case Mumble::Protocol::UDPMessageType::Ping: {
-							ZoneScopedN(TracyConstants::UDP_PING_PROCESSING_ZONE);
+					return processMsg(u, audioData, routing, gsl::span< const Mumble::Protocol::byte >(buffer, len),
+									  worker.m_udpAudioReceivers, worker.m_udpAudioEncoder, worker.m_sendBatch,
+									  worker.m_statistics);
+				}
+				break;
+			}
+			case Mumble::Protocol::UDPMessageType::Ping: {
+				ZoneScopedN(TracyConstants::UDP_PING_PROCESSING_ZONE);
 
-							Mumble::Protocol::PingData pingData = m_udpDecoder.getPingData();
-							if (!pingData.requestAdditionalInformation && !pingData.containsAdditionalInformation) {
-								// At this point here, we only want to handle connectivity pings
-								gsl::span< const Mumble::Protocol::byte > encodedPing =
-									handlePing(m_udpDecoder, m_udpPingEncoder, false);
+				Mumble::Protocol::PingData pingData = worker.m_udpDecoder.getPingData();
+				if (!pingData.requestAdditionalInformation && !pingData.containsAdditionalInformation) {
+					// At this point here, we only want to handle connectivity pings
+					gsl::span< const Mumble::Protocol::byte > encodedPing =
+						handlePing(worker.m_udpDecoder, worker.m_udpPingEncoder, false, routing);
 
-								QByteArray cache;
-								sendMessage(*u, encodedPing.data(), encodedPing.size(), cache, true);
-							}
-							break;
-						}
-					}
+					QByteArray cache;
+					sendMessage(*u, encodedPing.data(), encodedPing.size(), cache, true, &worker.m_sendBatch);
 				}
-#ifdef Q_OS_UNIX
-				fds[i].revents = 0;
-#endif
+				break;
 			}
 		}
 	}
-#ifdef Q_OS_WIN
-	for (int i = 0; i < nfds - 1; ++i) {
-		::WSAEventSelect(fds[i], nullptr, 0);
-		CloseHandle(events[i]);
-	}
-#endif
+
+	return false;
 }
 
 bool Server::checkDecrypt(ServerUser *u, const unsigned char *encrypt, unsigned char *plain, unsigned int len) {
@@ -1003,7 +1121,8 @@ bool Server::checkDecrypt(ServerUser *u, const unsigned char *encrypt, unsigned
 	return false;
 }
 
-void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache, bool force) {
+Server::VoiceSendResult Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache,
+											bool force, UDPSendBatch *batch) {
 	ZoneScoped;
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
@@ -1017,19 +1136,34 @@ void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByt
 		char *buffer = reinterpret_cast< char * >(((reinterpret_cast< quint64 >(ebuffer) + 8) & ~7) + 4);
 #else
 		STACKVAR(char, buffer, len + 4);
+#endif
+#ifdef Q_OS_LINUX
+		if (batch) {
+			// Encrypt right into the batch, which sends the datagram once it is flushed
+			buffer = reinterpret_cast< char * >(batch->nextBuffer());
+		}
 #endif
 		{
 			QMutexLocker wl(&u.qmCrypt);
 
 			if (!u.csCrypt->isValid()) {
-				return;
+				return VoiceSendResult::UDP;
 			}
 
 			if (!u.csCrypt->encrypt(reinterpret_cast< const unsigned char * >(data),
 									reinterpret_cast< unsigned char * >(buffer), len)) {
-				return;
+				return VoiceSendResult::UDP;
 			}
 		}
+#ifdef Q_OS_LINUX
+		if (batch) {
+			batch->push(u, len + 4);
+			return VoiceSendResult::UDP;
+		}
+#else
+		// Other platforms lack sendmmsg, so there is nothing to be gained from batching
+		Q_UNUSED(batch);
+#endif
 #ifdef Q_OS_WIN
 		DWORD dwFlow = 0;
 		if (Meta::hQoS)
@@ -1038,44 +1172,13 @@ void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByt
 #endif
 #ifdef Q_OS_LINUX
 		struct msghdr msg;
-		struct iovec iov[1];
-
-		iov[0].iov_base = buffer;
-		iov[0].iov_len  = len + 4;
-
-		uint8_t controldata[CMSG_SPACE(std::max(sizeof(struct in6_pktinfo), sizeof(struct in_pktinfo)))];
-		memset(controldata, 0, sizeof(controldata));
-
-		memset(&msg, 0, sizeof(msg));
-		msg.msg_name    = reinterpret_cast< struct sockaddr * >(&u.saiUdpAddress);
-		msg.msg_namelen = static_cast< socklen_t >(
-			(u.saiUdpAddress.ss_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
-		msg.msg_iov        = iov;
-		msg.msg_iovlen     = 1;
-		msg.msg_control    = controldata;
-		msg.msg_controllen = CMSG_SPACE((u.saiUdpAddress.ss_family == AF_INET6) ? sizeof(struct in6_pktinfo)
-																				: sizeof(struct in_pktinfo));
-
-		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
-		HostAddress tcpha(u.saiTcpLocalAddress);
-		if (u.saiUdpAddress.ss_family == AF_INET6) {
-			cmsg->cmsg_level            = IPPROTO_IPV6;
-			cmsg->cmsg_type             = IPV6_PKTINFO;
-			cmsg->cmsg_len              = CMSG_LEN(sizeof(struct in6_pktinfo));
-			struct in6_pktinfo *pktinfo = reinterpret_cast< struct in6_pktinfo * >(CMSG_DATA(cmsg));
-			memset(pktinfo, 0, sizeof(*pktinfo));
-			memcpy(&pktinfo->ipi6_addr.s6_addr[0], &tcpha.qip6.c[0], sizeof(pktinfo->ipi6_addr.s6_addr));
-		} else {
-			cmsg->cmsg_level           = IPPROTO_IP;
-			cmsg->cmsg_type            = IP_PKTINFO;
-			cmsg->cmsg_len             = CMSG_LEN(sizeof(struct in_pktinfo));
-			struct in_pktinfo *pktinfo = reinterpret_cast< struct in_pktinfo * >(CMSG_DATA(cmsg));
-			memset(pktinfo, 0, sizeof(*pktinfo));
-			if (tcpha.isV6())
-				return;
-			pktinfo->ipi_spec_dst.s_addr = tcpha.hash[3];
-		}
+		struct iovec iov;
+		unsigned char controldata[UDPSendBatch::CONTROL_DATA_SIZE];
 
+		if (!UDPSendBatch::prepareHeader(msg, iov, controldata, u, reinterpret_cast< unsigned char * >(buffer),
+										 len + 4)) {
+			return VoiceSendResult::UDP;
+		}
 
 		::sendmsg(u.sUdpSocket, &msg, 0);
 #else
@@ -1088,16 +1191,67 @@ void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByt
 #else
 #endif
 	} else {
+		// The message is framed once and then shared by all receivers of the same packet
 		if (cache.isEmpty())
-			cache = QByteArray(reinterpret_cast< const char * >(data), len);
-		emit tcpTransmit(cache, u.uiSession);
+			cache = VoiceTunnelQueue::frame(data, len);
+
+		return queueTunnelMessage(u, cache) ? VoiceSendResult::Tunnelled : VoiceSendResult::TunnelFull;
+	}
+
+	return VoiceSendResult::UDP;
+}
+
+bool Server::queueTunnelMessage(ServerUser &u, const QByteArray &message) {
+	if (!u.m_voiceTunnel.push(message)) {
+		// The connection doesn't keep up, so there is no point in queueing even more audio for it
+		return false;
+	}
+
+	if (u.m_voiceTunnel.markPending()) {
+		{
+			QMutexLocker l(&m_tunnelLock);
+			m_tunnelUsers.push_back(u.uiSession);
+		}
+
+		// A single flush takes care of all users that got audio queued in the meantime. It is posted with a high
+		// priority, so that it doesn't have to wait for control messages queued before it.
+		if (!m_tunnelFlushScheduled.exchange(true)) {
+			QCoreApplication::postEvent(this, new ExecEvent(boost::bind(&Server::flushTunnelMessages, this)),
+										Qt::HighEventPriority);
+		}
 	}
+
+	return true;
 }
 
-void Server::addListener(QHash< ServerUser *, VolumeAdjustment > &listeners, ServerUser &user, const Channel &channel) {
-	const VolumeAdjustment &volumeAdjustment =
-		m_channelListenerManager.getListenerVolumeAdjustment(user.uiSession, channel.iId);
+void Server::flushTunnelMessages() {
+	m_tunnelFlushScheduled.store(false);
+
+	{
+		QMutexLocker l(&m_tunnelLock);
+		std::swap(m_tunnelUsers, m_flushedTunnelUsers);
+	}
+
+	QByteArray message;
+	for (unsigned int session : m_flushedTunnelUsers) {
+		ServerUser *u = qhUsers.value(session);
+		if (!u)
+			continue;
+
+		u->m_voiceTunnel.clearPending();
 
+		while (u->m_voiceTunnel.pop(message)) {
+			u->sendMessage(message);
+		}
+		u->forceFlush();
+	}
+	message.clear();
+
+	m_flushedTunnelUsers.clear();
+}
+
+void Server::addListener(QHash< ServerUser *, VolumeAdjustment > &listeners, ServerUser &user,
+						 const VolumeAdjustment &volumeAdjustment) {
 	auto it = listeners.find(&user);
 
 	if (it == listeners.end() || it->factor < volumeAdjustment.factor) {
@@ -1105,17 +1259,56 @@ void Server::addListener(QHash< ServerUser *, VolumeAdjustment > &listeners, Ser
 	}
 }
 
-void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, AudioReceiverBuffer &buffer,
-						Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > &encoder) {
+/// Adds all given routes (except the one leading back to the sender) to the given buffer
+static void addRoutes(AudioReceiverBuffer &buffer, const ServerUser *sender,
+					  const VoiceRoutingSnapshot::User &senderRouting, const std::vector< VoiceRoute > &routes,
+					  bool containsPositionalData) {
+	for (const VoiceRoute &route : routes) {
+		if (route.receiver == sender) {
+			continue;
+		}
+
+		buffer.forceAddReceiver(*route.receiver, route.context,
+								containsPositionalData && route.positionalContext == senderRouting.positionalContext,
+								route.volumeAdjustment);
+	}
+}
+
+bool Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, const VoiceRoutingSnapshot &routing,
+						gsl::span< const Mumble::Protocol::byte > packet, AudioReceiverBuffer &buffer,
+						Mumble::Protocol::UDPServerAudioEncoder &encoder,
+						UDPSendBatch &sendBatch,
+						VoiceStatistics &statistics) {
 	ZoneScoped;
 
-	// Note that in this function we never have to acquire a read-lock on qrwlVoiceThread
-	// as all places that call this function will hold that lock at the point of calling
-	// this function.
-	// This function is currently called from Server::msgUDPTunnel, Server::run and
-	// Server::message
-	if (u->sState != ServerUser::Authenticated || u->bMute || u->bSuppress || u->bSelfMute)
-		return;
+	// Note that this function doesn't need any locks as all data required for routing the audio is taken from the
+	// given routing snapshot, which is immutable.
+	// This function is currently called from Server::processUDP (voice threads) and Server::message (main thread)
+	const VoiceRoutingSnapshot::User *sender = routing.findUser(u, u->uiSession);
+	if (!sender)
+		return false;
+
+	const std::vector< VoiceRoute > *whisperRoutes = nullptr;
+	if (audioData.targetOrContext != Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH
+		&& audioData.targetOrContext != Mumble::Protocol::ReservedTargetIDs::SERVER_LOOPBACK) {
+		auto it = sender->whisperTargets.find(static_cast< int >(audioData.targetOrContext));
+		if (it != sender->whisperTargets.end()) {
+			whisperRoutes = it->second.routes.load(std::memory_order_acquire);
+
+			if (!whisperRoutes) {
+				if (QThread::currentThread() != thread()) {
+					// Only the main thread can resolve the target. It takes over the packet (which thus doesn't
+					// count towards the bandwidth limit twice).
+					emit reqRouteAudio(u->uiSession,
+									   QByteArray(reinterpret_cast< const char * >(packet.data()),
+												  static_cast< int >(packet.size())));
+					return false;
+				}
+
+				whisperRoutes = &resolveWhisperRoutes(*sender, it->first, it->second);
+			}
+		}
+	}
 
 	// Check the voice data rate limit.
 	{
@@ -1124,239 +1317,527 @@ void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, Au
 		// IP + UDP + Crypt + Data
 		const int packetsize = 20 + 8 + 4 + audioData.payload.size();
 
-		if (!bw->addFrame(packetsize, iMaxBandwidth / 8)) {
+		if (!bw->addFrame(packetsize, routing.maxBandwidth / 8)) {
 			// Suppress packet.
-			return;
+			statistics.countBandwidthDrop();
+			return false;
 		}
 	}
 
+#ifdef USE_SERVER_MIXING
+	if (audioData.targetOrContext == Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH && sender->radioTuned
+		&& sender->transmitFrequency != 0 && audioData.usedCodec == Mumble::Protocol::AudioCodec::Opus
+		&& routing.mixedFrequencies.count(sender->transmitFrequency) > 0) {
+		// The transmission reaches its listeners as part of the frequency's mix
+		m_frequencyMixer.submit(sender->transmitFrequency, audioData);
+		return false;
+	}
+#endif
+
+	const VoiceStatistics::Clock::time_point routeStart = VoiceStatistics::Clock::now();
+
 	buffer.clear();
 
-	if (audioData.targetOrContext == Mumble::Protocol::ReservedTargetIDs::SERVER_LOOPBACK) {
-		buffer.forceAddReceiver(*u, Mumble::Protocol::AudioContext::NORMAL, audioData.containsPositionalData);
-	} else if (audioData.targetOrContext == Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH) {
-		Channel *c = u->cChannel;
+	// The receivers only change along with the routing snapshot, so they are determined once per snapshot and kept
+	// for all further packets the sender sends to the same target (e.g. for the rest of a transmission)
+	const bool cachePlan = audioData.targetOrContext != Mumble::Protocol::ReservedTargetIDs::SERVER_LOOPBACK;
+
+	const AudioReceiverBuffer::PlanKey planKey = { routing.generation, u->uiSession, audioData.targetOrContext,
+												   audioData.containsPositionalData };
+
+	if (!cachePlan || !buffer.usePlan(planKey)) {
+		if (audioData.targetOrContext == Mumble::Protocol::ReservedTargetIDs::SERVER_LOOPBACK) {
+			buffer.forceAddReceiver(*u, Mumble::Protocol::AudioContext::NORMAL, audioData.containsPositionalData);
+		} else if (audioData.targetOrContext == Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH
+				   && sender->radioTuned) {
+			ZoneScopedN(TracyConstants::AUDIO_FREQUENCY_ROUTING_ZONE);
+
+			// Radio transmission: send audio to everyone that has one of its radios tuned to the sender's transmit
+			// frequency. The routes are already tagged with the radio the receiver receives the transmission on.
+			if (sender->transmitFrequency != 0) {
+				addRoutes(buffer, u, *sender, routing.frequencyRoutes(sender->transmitFrequency),
+						  audioData.containsPositionalData);
+			}
+		} else if (audioData.targetOrContext == Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH) {
+			// Send audio to all users in (and listening to) the user's channel and the linked channels the user has
+			// speak-permission in
+			for (unsigned int channelID : sender->speechChannels) {
+				addRoutes(buffer, u, *sender, routing.channelRoutes(channelID), audioData.containsPositionalData);
+			}
+		} else { // Whisper/Shout
+			ZoneScopedN(TracyConstants::AUDIO_WHISPER_ROUTING_ZONE);
 
-		// Send audio to all users that are listening to the channel
-		foreach (unsigned int currentSession, m_channelListenerManager.getListenersForChannel(c->iId)) {
-			ServerUser *pDst = static_cast< ServerUser * >(qhUsers.value(currentSession));
-			if (pDst) {
-				buffer.addReceiver(*u, *pDst, Mumble::Protocol::AudioContext::LISTEN, audioData.containsPositionalData,
-								   m_channelListenerManager.getListenerVolumeAdjustment(pDst->uiSession, c->iId));
+			if (whisperRoutes) {
+				addRoutes(buffer, u, *sender, *whisperRoutes, audioData.containsPositionalData);
 			}
 		}
 
-		// Send audio to all users in the same channel
-		for (User *p : c->qlUsers) {
-			ServerUser *pDst = static_cast< ServerUser * >(p);
+		buffer.preprocessBuffer();
 
-			buffer.addReceiver(*u, *pDst, Mumble::Protocol::AudioContext::NORMAL, audioData.containsPositionalData);
+		if (cachePlan) {
+			buffer.storePlan(planKey);
 		}
+	}
 
-		// Send audio to all linked channels the user has speak-permission
-		if (!c->qhLinks.isEmpty()) {
-			QSet< Channel * > chans = c->allLinks();
-			chans.remove(c);
+	statistics.route.record(VoiceStatistics::elapsed(routeStart, VoiceStatistics::Clock::now()));
 
-			QMutexLocker qml(&qmCache);
+	sendAudio(audioData, buffer, encoder, sendBatch, statistics);
 
-			for (Channel *l : chans) {
-				if (ChanACL::hasPermission(u, l, ChanACL::Speak, &acCache)) {
-					// Send the audio stream to all users that are listening to the linked channel
-					for (unsigned int currentSession : m_channelListenerManager.getListenersForChannel(l->iId)) {
-						ServerUser *pDst = static_cast< ServerUser * >(qhUsers.value(currentSession));
-						if (pDst) {
-							buffer.addReceiver(
-								*u, *pDst, Mumble::Protocol::AudioContext::LISTEN, audioData.containsPositionalData,
-								m_channelListenerManager.getListenerVolumeAdjustment(pDst->uiSession, l->iId));
-						}
-					}
+	return true;
+}
 
-					// Send audio to users in the linked channel
-					for (User *p : l->qlUsers) {
-						ServerUser *pDst = static_cast< ServerUser * >(p);
+void Server::sendAudio(const Mumble::Protocol::AudioData &audioData, AudioReceiverBuffer &buffer,
+					   Mumble::Protocol::UDPServerAudioEncoder &encoder, UDPSendBatch &sendBatch,
+					   VoiceStatistics &statistics) {
+	ZoneScopedN(TracyConstants::AUDIO_SENDOUT_ZONE);
 
-						buffer.addReceiver(*u, *pDst, Mumble::Protocol::AudioContext::NORMAL,
-										   audioData.containsPositionalData);
-					}
-				}
-			}
-		}
-	} else if (u->qmTargets.contains(audioData.targetOrContext)) { // Whisper/Shout
-		QSet< ServerUser * > channel;
-		QSet< ServerUser * > direct;
-		QHash< ServerUser *, VolumeAdjustment > cachedListeners;
+	const VoiceStatistics::Clock::time_point sendStart = VoiceStatistics::Clock::now();
+	statistics.countAudioPacket();
+	statistics.fanOut.record(buffer.getReceivers(true).size() + buffer.getReceivers(false).size());
 
-		if (u->qmTargetCache.contains(audioData.targetOrContext)) {
-			ZoneScopedN(TracyConstants::AUDIO_WHISPER_CACHE_STORE);
+	// The packet is encoded at most once per wire format. For every range of receivers only the context and volume
+	// adjustment are patched into it.
+	{
+		ZoneScopedN(TracyConstants::AUDIO_ENCODE);
+		encoder.prepareAudioPacket(audioData);
+	}
 
-			const WhisperTargetCache &cache = u->qmTargetCache.value(audioData.targetOrContext);
-			channel                         = cache.channelTargets;
-			direct                          = cache.directTargets;
-			cachedListeners                 = cache.listeningTargets;
-		} else {
-			ZoneScopedN(TracyConstants::AUDIO_WHISPER_CACHE_CREATE);
-
-			const WhisperTarget &wt = u->qmTargets.value(audioData.targetOrContext);
-			if (!wt.qlChannels.isEmpty()) {
-				QMutexLocker qml(&qmCache);
-
-				foreach (const WhisperTarget::Channel &wtc, wt.qlChannels) {
-					Channel *wc = qhChannels.value(wtc.iId);
-					if (wc) {
-						bool link       = wtc.bLinks && !wc->qhLinks.isEmpty();
-						bool dochildren = wtc.bChildren && !wc->qlChannels.isEmpty();
-						bool group      = !wtc.qsGroup.isEmpty();
-						if (!link && !dochildren && !group) {
-							// Common case
-							if (ChanACL::hasPermission(u, wc, ChanACL::Whisper, &acCache)) {
-								foreach (User *p, wc->qlUsers) { channel.insert(static_cast< ServerUser * >(p)); }
-
-								foreach (unsigned int currentSession,
-										 m_channelListenerManager.getListenersForChannel(wc->iId)) {
-									ServerUser *pDst = static_cast< ServerUser * >(qhUsers.value(currentSession));
-
-									if (pDst) {
-										addListener(cachedListeners, *pDst, *wc);
-									}
-								}
-							}
-						} else {
-							QSet< Channel * > channels;
-							if (link)
-								channels = wc->allLinks();
-							else
-								channels.insert(wc);
-							if (dochildren)
-								channels.unite(wc->allChildren());
-							const QString &redirect = u->qmWhisperRedirect.value(wtc.qsGroup);
-							const QString &qsg      = redirect.isEmpty() ? wtc.qsGroup : redirect;
-							foreach (Channel *tc, channels) {
-								if (ChanACL::hasPermission(u, tc, ChanACL::Whisper, &acCache)) {
-									foreach (User *p, tc->qlUsers) {
-										ServerUser *su = static_cast< ServerUser * >(p);
-
-										if (!group || Group::appliesToUser(*tc, *tc, qsg, *su)) {
-											channel.insert(su);
-										}
-									}
+	QByteArray tcpCache;
+	for (bool includePositionalData : { true, false }) {
+		std::vector< AudioReceiver > &receiverList = buffer.getReceivers(includePositionalData);
 
-									foreach (unsigned int currentSession,
-											 m_channelListenerManager.getListenersForChannel(tc->iId)) {
-										ServerUser *pDst = static_cast< ServerUser * >(qhUsers.value(currentSession));
+		// Note: The receiver-ranges are determined in such a way, that they are all going to receive the exact
+		// same audio packet.
+		ReceiverRange< std::vector< AudioReceiver >::iterator > currentRange =
+			AudioReceiverBuffer::getReceiverRange(receiverList.begin(), receiverList.end());
 
-										if (pDst && (!group || Group::appliesToUser(*tc, *tc, qsg, *pDst))) {
-											// Only send audio to listener if the user exists and it is in the group the
-											// speech is directed at (if any)
-											addListener(cachedListeners, *pDst, *tc);
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-			}
+		while (currentRange.begin != currentRange.end) {
+			TracyCZoneN(__tracy_zone, TracyConstants::AUDIO_UPDATE, true);
+			gsl::span< const Mumble::Protocol::byte > encodedPacket = encoder.updateAudioPacket(
+				currentRange.begin->getReceiver().m_version, currentRange.begin->getContext(),
+				currentRange.begin->getVolumeAdjustment(), includePositionalData && audioData.containsPositionalData);
+			TracyCZoneEnd(__tracy_zone);
 
-			{
-				QMutexLocker qml(&qmCache);
+			// Clear TCP cache (messages queued for tunnelling keep their own reference)
+			tcpCache.clear();
 
-				foreach (unsigned int id, wt.qlSessions) {
-					ServerUser *pDst = qhUsers.value(id);
-					if (pDst && ChanACL::hasPermission(u, pDst->cChannel, ChanACL::Whisper, &acCache)
-						&& !channel.contains(pDst))
-						direct.insert(pDst);
+			// Queue the encoded packet for all receivers of this range (the caller flushes the batch)
+			for (auto it = currentRange.begin; it != currentRange.end; ++it) {
+				switch (sendMessage(it->getReceiver(), encodedPacket.data(), encodedPacket.size(), tcpCache, false,
+									&sendBatch)) {
+					case VoiceSendResult::UDP:
+						break;
+					case VoiceSendResult::Tunnelled:
+						statistics.countTcpFallbackSend();
+						break;
+					case VoiceSendResult::TunnelFull:
+						statistics.countTunnelDrop();
+						break;
 				}
 			}
 
-			int uiSession = u->uiSession;
-			qrwlVoiceThread.unlock();
-			qrwlVoiceThread.lockForWrite();
+			// Find next range
+			currentRange = AudioReceiverBuffer::getReceiverRange(currentRange.end, receiverList.end());
+		}
+	}
 
-			if (qhUsers.contains(uiSession))
-				u->qmTargetCache.insert(audioData.targetOrContext, { channel, direct, cachedListeners });
-			qrwlVoiceThread.unlock();
-			qrwlVoiceThread.lockForRead();
-			if (!qhUsers.contains(uiSession))
-				return;
+	statistics.send.record(VoiceStatistics::elapsed(sendStart, VoiceStatistics::Clock::now()));
+}
+
+#ifdef USE_SERVER_MIXING
+void Server::sendMixedAudio(std::size_t worker, unsigned int frequency, const Mumble::Protocol::AudioData &audioData,
+							const std::vector< unsigned int > &transmitters) {
+	ZoneScoped;
+
+	// The mixing threads use the last reader slots
+	VoiceRoutingPublisher::ReadGuard routingGuard(m_voiceRouting,
+												  VoiceRoutingPublisher::MAX_READERS - MIXING_WORKERS + worker);
+	const VoiceRoutingSnapshot &routing = routingGuard.snapshot();
+
+	MixingOutput &output = m_mixingOutputs[worker];
+	output.receivers.clear();
+
+	for (const VoiceRoute &route : routing.frequencyRoutes(frequency)) {
+		// Stations that are transmitting can't receive at the same time
+		if (std::find(transmitters.begin(), transmitters.end(), route.receiver->uiSession) == transmitters.end()) {
+			output.receivers.forceAddReceiver(*route.receiver, route.context, false, route.volumeAdjustment);
 		}
-		// These users receive the audio because someone is shouting to their channel
-		for (ServerUser *pDst : channel) {
-			buffer.addReceiver(*u, *pDst, Mumble::Protocol::AudioContext::SHOUT, audioData.containsPositionalData);
+	}
+
+	output.receivers.preprocessBuffer();
+
+	sendAudio(audioData, output.receivers, output.encoder, output.sendBatch, output.statistics);
+	output.sendBatch.flush();
+}
+#endif
+
+/// @returns Whether the given user is to receive any audio at all
+static bool receivesAudio(const ServerUser &user) {
+	return !user.bDeaf && !user.bSelfDeaf;
+}
+
+static unsigned int positionalContextOf(const std::unordered_map< std::string, unsigned int > &positionalContexts,
+										const ServerUser &user) {
+	auto it = positionalContexts.find(user.ssContext);
+
+	return it == positionalContexts.end() ? 0 : it->second;
+}
+
+void Server::invalidateVoiceRouting() {
+	m_voiceRoutingOutdated = true;
+
+	// Rebuild as soon as control returns to the event loop (this also preempts a pending reclamation retry)
+	m_voiceRoutingTimer.start(0);
+}
+
+void Server::invalidateVoiceRouting(const ServerUser &user) {
+	m_voiceRoutingDirtyUsers.insert(user.uiSession);
+
+	m_voiceRoutingTimer.start(0);
+}
+
+void Server::updateVoiceRouting() {
+	if (m_voiceRoutingOutdated || !m_voiceRoutingDirtyUsers.empty()) {
+		m_voiceRouting.publish(buildVoiceRouting());
+	} else {
+		ZoneScopedN(TracyConstants::VOICE_ROUTING_RECLAIM_ZONE);
+
+		m_voiceRouting.reclaim();
+	}
+
+	if (m_voiceRouting.hasRetired()) {
+		// The voice thread is still processing a packet that might reference retired objects
+		m_voiceRoutingTimer.start(VOICE_ROUTING_RECLAIM_INTERVAL);
+	}
+}
+
+std::unique_ptr< VoiceRoutingSnapshot > Server::buildVoiceRouting() {
+	ZoneScopedN(TracyConstants::VOICE_ROUTING_BUILD_ZONE);
+
+	std::unique_ptr< VoiceRoutingSnapshot > routing = std::make_unique< VoiceRoutingSnapshot >();
+
+	routing->generation   = ++m_voiceRoutingGeneration;
+	routing->maxBandwidth = iMaxBandwidth;
+	routing->maxUsers     = iMaxUsers;
+	routing->userCount    = qhUsers.size() - static_cast< int >(m_botCount);
+	routing->allowPing    = bAllowPing;
+	routing->opus         = bOpus;
+
+	// The users, channels and frequencies whose entries are rebuilt
+	std::unordered_set< unsigned int > users;
+	std::unordered_set< unsigned int > channels;
+	std::unordered_set< unsigned int > frequencies;
+
+	if (m_voiceRoutingOutdated) {
+		m_positionalContexts.clear();
+		m_voiceRoutingReceivers.clear();
+
+		for (const ServerUser *user : qhUsers) {
+			users.insert(user->uiSession);
 		}
-		// These users receive audio because someone is whispering to them
-		for (ServerUser *pDst : direct) {
-			buffer.addReceiver(*u, *pDst, Mumble::Protocol::AudioContext::WHISPER, audioData.containsPositionalData);
+		for (const Channel *c : qhChannels) {
+			channels.insert(static_cast< unsigned int >(c->iId));
 		}
-		// These users receive audio because someone is sending audio to one of their listeners
-		QHashIterator< ServerUser *, VolumeAdjustment > it(cachedListeners);
-		while (it.hasNext()) {
-			it.next();
-			ServerUser *user                         = it.key();
-			const VolumeAdjustment &volumeAdjustment = it.value();
-
-			buffer.addReceiver(*u, *user, Mumble::Protocol::AudioContext::LISTEN, audioData.containsPositionalData,
-							   volumeAdjustment);
+		for (auto it = qhFrequencyUsers.constBegin(); it != qhFrequencyUsers.constEnd(); ++it) {
+			frequencies.insert(it.key());
 		}
+	} else {
+		// Everything else stays as it is. The whisper targets of the users taken over start out unresolved, as
+		// their receivers might have changed.
+		const VoiceRoutingSnapshot &previous = m_voiceRouting.current();
+		routing->users                       = previous.users;
+		routing->channels                    = previous.channels;
+		routing->frequencies                 = previous.frequencies;
+		routing->mixedFrequencies            = previous.mixedFrequencies;
+
+		users.swap(m_voiceRoutingDirtyUsers);
 	}
 
-	ZoneNamedN(__tracy_scoped_zone2, TracyConstants::AUDIO_SENDOUT_ZONE, true);
+	m_voiceRoutingOutdated = false;
+	m_voiceRoutingDirtyUsers.clear();
 
-	buffer.preprocessBuffer();
+	for (unsigned int session : users) {
+		routing->users.erase(session);
 
-	bool isFirstIteration = true;
-	QByteArray tcpCache;
-	for (bool includePositionalData : { true, false }) {
-		std::vector< AudioReceiver > &receiverList = buffer.getReceivers(includePositionalData);
+		// The receivers the user has been part of so far
+		auto previous = m_voiceRoutingReceivers.find(session);
+		if (previous != m_voiceRoutingReceivers.end()) {
+			channels.insert(previous->second.channels.begin(), previous->second.channels.end());
+			frequencies.insert(previous->second.frequencies.begin(), previous->second.frequencies.end());
 
-		audioData.containsPositionalData = includePositionalData && audioData.containsPositionalData;
+			m_voiceRoutingReceivers.erase(previous);
+		}
 
-		if (!audioData.containsPositionalData) {
-			encoder.dropPositionalData();
+		ServerUser *u = qhUsers.value(session);
+		if (!u) {
+			// The user has disconnected
+			continue;
 		}
 
-		// Note: The receiver-ranges are determined in such a way, that they are all going to receive the exact
-		// same audio packet.
-		ReceiverRange< std::vector< AudioReceiver >::iterator > currentRange =
-			AudioReceiverBuffer::getReceiverRange(receiverList.begin(), receiverList.end());
+		// Intern the positional audio contexts, so that the voice thread only has to compare integers
+		m_positionalContexts.emplace(u->ssContext, static_cast< unsigned int >(m_positionalContexts.size()) + 1);
 
-		while (currentRange.begin != currentRange.end) {
-			// Setup encoder for this range
-			if (isFirstIteration
-				|| !Mumble::Protocol::protocolVersionsAreCompatible(encoder.getProtocolVersion(),
-																	currentRange.begin->getReceiver().m_version)) {
-				ZoneScopedN(TracyConstants::AUDIO_ENCODE);
+		// The receivers the user is part of now
+		VoiceRoutingReceiver receiver;
+		if (u->cChannel) {
+			receiver.channels.push_back(static_cast< unsigned int >(u->cChannel->iId));
+		}
+		for (int channelID : m_channelListenerManager.getListenedChannelsForUser(session)) {
+			receiver.channels.push_back(static_cast< unsigned int >(channelID));
+		}
+		for (unsigned int frequency : u->m_tunedFrequencies) {
+			if (frequency != 0) {
+				receiver.frequencies.push_back(frequency);
+			}
+		}
+
+		channels.insert(receiver.channels.begin(), receiver.channels.end());
+		frequencies.insert(receiver.frequencies.begin(), receiver.frequencies.end());
+
+		m_voiceRoutingReceivers.emplace(session, std::move(receiver));
+
+		if (u->sState != ServerUser::Authenticated || u->bMute || u->bSuppress || u->bSelfMute) {
+			// Audio of this user is dropped anyway
+			continue;
+		}
+
+		VoiceRoutingSnapshot::User entry;
+		entry.user              = u;
+		entry.positionalContext = positionalContextOf(m_positionalContexts, *u);
+		entry.radioTuned        = u->isRadioTuned();
+		// Just like speaking in a channel, transmitting requires the Speak permission
+		entry.transmitFrequency =
+			entry.radioTuned && hasPermission(u, radioChannel(), ChanACL::Speak) ? u->transmitFrequency() : 0;
+
+		Channel *c = u->cChannel;
+		entry.speechChannels.push_back(static_cast< unsigned int >(c->iId));
+
+		// Linked channels the user has speak-permission in
+		if (!c->qhLinks.isEmpty()) {
+			QSet< Channel * > chans = c->allLinks();
+			chans.remove(c);
+
+			for (Channel *l : chans) {
+				if (hasPermission(u, l, ChanACL::Speak)) {
+					entry.speechChannels.push_back(static_cast< unsigned int >(l->iId));
+				}
+			}
+		}
+
+		// The receivers are only resolved once the target is used (see resolveWhisperRoutes())
+		for (auto it = u->qmTargets.constBegin(); it != u->qmTargets.constEnd(); ++it) {
+			entry.whisperTargets[it.key()];
+		}
+
+		routing->users.emplace(session, std::move(entry));
+	}
 
-				encoder.setProtocolVersion(currentRange.begin->getReceiver().m_version);
+	for (unsigned int channelID : channels) {
+		routing->channels.erase(channelID);
+
+		const Channel *c = qhChannels.value(static_cast< int >(channelID));
+		if (!c) {
+			continue;
+		}
 
-				// We have to re-encode the "fixed" part of the audio message
-				encoder.prepareAudioPacket(audioData);
+		std::vector< VoiceRoute > routes;
 
-				if (audioData.containsPositionalData) {
-					encoder.addPositionalData(audioData);
+		// Users that are listening to the channel
+		m_channelListenerManager.forEachListener(
+			c->iId, [&](unsigned int currentSession, const VolumeAdjustment &volumeAdjustment) {
+				ServerUser *pDst = qhUsers.value(currentSession);
+				if (pDst && receivesAudio(*pDst)) {
+					routes.push_back({ pDst, Mumble::Protocol::AudioContext::LISTEN, volumeAdjustment,
+									   positionalContextOf(m_positionalContexts, *pDst) });
 				}
+			});
 
-				isFirstIteration = false;
+		// Users in the channel
+		for (User *p : c->qlUsers) {
+			ServerUser *pDst = static_cast< ServerUser * >(p);
+			if (receivesAudio(*pDst)) {
+				routes.push_back({ pDst, Mumble::Protocol::AudioContext::NORMAL, VolumeAdjustment::fromFactor(1.0f),
+								   positionalContextOf(m_positionalContexts, *pDst) });
 			}
+		}
 
-			audioData.targetOrContext  = currentRange.begin->getContext();
-			audioData.volumeAdjustment = currentRange.begin->getVolumeAdjustment();
+		if (!routes.empty()) {
+			routing->channels.emplace(channelID,
+									  std::make_shared< const std::vector< VoiceRoute > >(std::move(routes)));
+		}
+	}
 
-			// Update data
-			TracyCZoneN(__tracy_zone, TracyConstants::AUDIO_UPDATE, true);
-			gsl::span< const Mumble::Protocol::byte > encodedPacket = encoder.updateAudioPacket(audioData);
-			TracyCZoneEnd(__tracy_zone);
+	for (unsigned int frequency : frequencies) {
+		routing->frequencies.erase(frequency);
+		routing->mixedFrequencies.erase(frequency);
 
-			// Clear TCP cache
-			tcpCache.clear();
+		std::vector< VoiceRoute > routes;
 
-			// Send encoded packet to all receivers of this range
-			for (auto it = currentRange.begin; it != currentRange.end; ++it) {
-				sendMessage(it->getReceiver(), encodedPacket.data(), encodedPacket.size(), tcpCache);
+		for (ServerUser *pDst : qhFrequencyUsers.value(frequency)) {
+			if (receivesAudio(*pDst)) {
+				// Tag the route with the radio the receiver receives the transmission on (COM1 takes precedence if
+				// both radios are tuned to the same frequency)
+				const Mumble::Protocol::audio_context_t context = pDst->m_tunedFrequencies[0] == frequency
+																	  ? Mumble::Protocol::AudioContext::RADIO_COM1
+																	  : Mumble::Protocol::AudioContext::RADIO_COM2;
+
+				routes.push_back({ pDst, context, VolumeAdjustment::fromFactor(1.0f),
+								   positionalContextOf(m_positionalContexts, *pDst) });
 			}
+		}
 
-			// Find next range
-			currentRange = AudioReceiverBuffer::getReceiverRange(currentRange.end, receiverList.end());
+		if (!routes.empty()) {
+#ifdef USE_SERVER_MIXING
+			if (iMixingThreshold > 0 && routes.size() >= static_cast< std::size_t >(iMixingThreshold)) {
+				routing->mixedFrequencies.insert(frequency);
+			}
+#endif
+
+			routing->frequencies.emplace(frequency,
+										 std::make_shared< const std::vector< VoiceRoute > >(std::move(routes)));
+		}
+	}
+
+	return routing;
+}
+
+const std::vector< VoiceRoute > &
+	Server::resolveWhisperRoutes(const VoiceRoutingSnapshot::User &sender, int target,
+								 const VoiceRoutingSnapshot::WhisperRoutes &whisperRoutes) {
+	ZoneScopedN(TracyConstants::VOICE_ROUTING_WHISPER_ZONE);
+
+	std::unique_ptr< std::vector< VoiceRoute > > routes = std::make_unique< std::vector< VoiceRoute > >();
+	resolveWhisperTarget(sender.user, sender.user->qmTargets.value(target), *routes);
+
+	// The voice thread only reads the routes once they are complete
+	whisperRoutes.routes.store(routes.get(), std::memory_order_release);
+
+	return *routes.release();
+}
+
+void Server::routeAudio(unsigned int session, const QByteArray &packet) {
+	ServerUser *u = qhUsers.value(session);
+	if (!u) {
+		// The user has disconnected in the meantime
+		return;
+	}
+
+	m_tcpTunnelDecoder.setProtocolVersion(u->m_version);
+
+	const gsl::span< const Mumble::Protocol::byte > data(
+		reinterpret_cast< const Mumble::Protocol::byte * >(packet.constData()), packet.size());
+	if (!m_tcpTunnelDecoder.decode(data)
+		|| m_tcpTunnelDecoder.getMessageType() != Mumble::Protocol::UDPMessageType::Audio) {
+		return;
+	}
+
+	Mumble::Protocol::AudioData audioData = m_tcpTunnelDecoder.getAudioData();
+	audioData.senderSession               = u->uiSession;
+
+	// The routing snapshot might have been replaced in the meantime, in which case the packet is routed by the current
+	// one (as it would have been had it arrived now)
+	processMsg(u, std::move(audioData), m_voiceRouting.current(), data, m_tcpAudioReceivers, m_tcpAudioEncoder,
+			   m_tcpSendBatch, m_tcpStatistics);
+	m_tcpSendBatch.flush();
+}
+
+void Server::resolveWhisperTarget(ServerUser *u, const WhisperTarget &wt, std::vector< VoiceRoute > &routes) {
+	QSet< ServerUser * > channel;
+	QSet< ServerUser * > direct;
+	QHash< ServerUser *, VolumeAdjustment > listeners;
+
+	if (!wt.qlChannels.isEmpty()) {
+		QMutexLocker qml(&qmCache);
+
+		for (const WhisperTarget::Channel &wtc : wt.qlChannels) {
+			Channel *wc = qhChannels.value(wtc.iId);
+			if (wc) {
+				bool link       = wtc.bLinks && !wc->qhLinks.isEmpty();
+				bool dochildren = wtc.bChildren && !wc->qlChannels.isEmpty();
+				bool group      = !wtc.qsGroup.isEmpty();
+				if (!link && !dochildren && !group) {
+					// Common case
+					if (ChanACL::hasPermission(u, wc, ChanACL::Whisper, &acCache)) {
+						for (User *p : wc->qlUsers) {
+							channel.insert(static_cast< ServerUser * >(p));
+						}
+
+						m_channelListenerManager.forEachListener(
+							wc->iId, [&](unsigned int currentSession, const VolumeAdjustment &volumeAdjustment) {
+								ServerUser *pDst = qhUsers.value(currentSession);
+
+								if (pDst) {
+									addListener(listeners, *pDst, volumeAdjustment);
+								}
+							});
+					}
+				} else {
+					QSet< Channel * > channels;
+					if (link)
+						channels = wc->allLinks();
+					else
+						channels.insert(wc);
+					if (dochildren)
+						channels.unite(wc->allChildren());
+					const QString &redirect = u->qmWhisperRedirect.value(wtc.qsGroup);
+					const QString &qsg      = redirect.isEmpty() ? wtc.qsGroup : redirect;
+					for (Channel *tc : channels) {
+						if (ChanACL::hasPermission(u, tc, ChanACL::Whisper, &acCache)) {
+							for (User *p : tc->qlUsers) {
+								ServerUser *su = static_cast< ServerUser * >(p);
+
+								if (!group || Group::appliesToUser(*tc, *tc, qsg, *su)) {
+									channel.insert(su);
+								}
+							}
+
+							m_channelListenerManager.forEachListener(
+								tc->iId, [&](unsigned int currentSession, const VolumeAdjustment &volumeAdjustment) {
+									ServerUser *pDst = qhUsers.value(currentSession);
+
+									if (pDst && (!group || Group::appliesToUser(*tc, *tc, qsg, *pDst))) {
+										// Only send audio to listener if the user exists and it is in the group the
+										// speech is directed at (if any)
+										addListener(listeners, *pDst, volumeAdjustment);
+									}
+								});
+						}
+					}
+				}
+			}
+		}
+	}
+
+	{
+		QMutexLocker qml(&qmCache);
+
+		for (unsigned int id : wt.qlSessions) {
+			ServerUser *pDst = qhUsers.value(id);
+			if (pDst && ChanACL::hasPermission(u, pDst->cChannel, ChanACL::Whisper, &acCache)
+				&& !channel.contains(pDst))
+				direct.insert(pDst);
+		}
+	}
+
+	// These users receive the audio because someone is shouting to their channel
+	for (ServerUser *pDst : channel) {
+		if (receivesAudio(*pDst)) {
+			routes.push_back({ pDst, Mumble::Protocol::AudioContext::SHOUT, VolumeAdjustment::fromFactor(1.0f),
+							   positionalContextOf(m_positionalContexts, *pDst) });
+		}
+	}
+	// These users receive audio because someone is whispering to them
+	for (ServerUser *pDst : direct) {
+		if (receivesAudio(*pDst)) {
+			routes.push_back({ pDst, Mumble::Protocol::AudioContext::WHISPER, VolumeAdjustment::fromFactor(1.0f),
+							   positionalContextOf(m_positionalContexts, *pDst) });
+		}
+	}
+	// These users receive audio because someone is sending audio to one of their listeners
+	for (auto it = listeners.constBegin(); it != listeners.constEnd(); ++it) {
+		if (receivesAudio(*it.key())) {
+			routes.push_back({ it.key(), Mumble::Protocol::AudioContext::LISTEN, it.value(),
+							   positionalContextOf(m_positionalContexts, *it.key()) });
 		}
 	}
 }
@@ -1673,21 +2154,31 @@ void Server::connectionClosed(QAbstractSocket::SocketError err, const QString &r
 	Channel *old = u->cChannel;
 
 	{
-		QWriteLocker wl(&qrwlVoiceThread);
+		QWriteLocker wl(&qrwlPeers);
 
-		qhUsers.remove(u->uiSession);
 		qhHostUsers[u->haAddress].remove(u);
 
 		quint16 port = (u->saiUdpAddress.ss_family == AF_INET6)
 						   ? (reinterpret_cast< sockaddr_in6 * >(&u->saiUdpAddress)->sin6_port)
 						   : (reinterpret_cast< sockaddr_in * >(&u->saiUdpAddress)->sin_port);
 		const QPair< HostAddress, quint16 > &key = QPair< HostAddress, quint16 >(u->haAddress, port);
-		qhPeerUsers.remove(key);
-
-		if (old)
-			old->removeUser(u);
+		foreach (UDPWorker *worker, m_udpWorkers) {
+			QWriteLocker peerLock(&worker->m_peerLock);
+			worker->m_peerUsers.remove(key);
+		}
 	}
 
+	qhUsers.remove(u->uiSession);
+	m_userStateSync.remove(u->uiSession);
+	u->m_timeoutTimer.cancel();
+
+	removeFromFrequencyIndex(u);
+
+	if (old)
+		old->removeUser(u);
+
+	invalidateVoiceRouting(*u);
+
 	if (old && old->bTemporary && old->qlUsers.isEmpty())
 		QCoreApplication::instance()->postEvent(this,
 												new ExecEvent(boost::bind(&Server::removeChannel, this, old->iId)));
@@ -1700,7 +2191,9 @@ void Server::connectionClosed(QAbstractSocket::SocketError err, const QString &r
 		recheckCodecVersions(); // Maybe can choose a better codec now
 	}
 
-	u->deleteLater();
+	// The voice thread may still be routing audio to (or from) this user, so it must only be deleted once the voice
+	// thread can no longer reference it
+	m_voiceRouting.retire([u]() { u->deleteLater(); });
 
 	if (qhUsers.isEmpty())
 		stopThread();
@@ -1718,13 +2211,17 @@ void Server::message(Mumble::Protocol::TCPMessageType type, const QByteArray &qb
 	}
 
 	if (type == Mumble::Protocol::TCPMessageType::UDPTunnel) {
+		const VoiceStatistics::Clock::time_point received = VoiceStatistics::Clock::now();
+		m_tcpStatistics.countReceived();
+
 		int len = qbaMsg.size();
 		if (len < 2 || static_cast< unsigned int >(len) > Mumble::Protocol::MAX_UDP_PACKET_SIZE) {
 			// Drop messages that are too small to be senseful or that are bigger than allowed
 			return;
 		}
 
-		QReadLocker rl(&qrwlVoiceThread);
+		// Audio received via TCP is processed on the main thread, which is the one publishing the routing snapshots
+		const VoiceRoutingSnapshot &routing = m_voiceRouting.current();
 
 		u->aiUdpFlag = 0;
 
@@ -1737,7 +2234,7 @@ void Server::message(Mumble::Protocol::TCPMessageType type, const QByteArray &qb
 				// Allow all voice packets through by default.
 				bool ok = true;
 				// ...Unless we're in Opus mode. In Opus mode, only Opus packets are allowed.
-				if (bOpus && audioData.usedCodec != Mumble::Protocol::AudioCodec::Opus) {
+				if (routing.opus && audioData.usedCodec != Mumble::Protocol::AudioCodec::Opus) {
 					ok = false;
 				}
 
@@ -1745,7 +2242,17 @@ void Server::message(Mumble::Protocol::TCPMessageType type, const QByteArray &qb
 					// Add session id
 					audioData.senderSession = u->uiSession;
 
-					processMsg(u, std::move(audioData), m_tcpAudioReceivers, m_tcpAudioEncoder);
+					const bool sent =
+						processMsg(u, std::move(audioData), routing,
+								   gsl::span< const Mumble::Protocol::byte >(
+									   reinterpret_cast< const Mumble::Protocol::byte * >(qbaMsg.constData()), len),
+								   m_tcpAudioReceivers, m_tcpAudioEncoder, m_tcpSendBatch, m_tcpStatistics);
+					m_tcpSendBatch.flush();
+
+					if (sent) {
+						m_tcpStatistics.latency.record(
+							VoiceStatistics::elapsed(received, VoiceStatistics::Clock::now()));
+					}
 				}
 			}
 		}
@@ -1753,67 +2260,62 @@ void Server::message(Mumble::Protocol::TCPMessageType type, const QByteArray &qb
 		return;
 	}
 
+	// Handlers that (indirectly) handle another message get instances of their own
+	const bool reuseMessage = !m_handlingMessage;
+	m_handlingMessage       = true;
+
 #ifdef QT_NO_DEBUG
-#	define PROCESS_MUMBLE_TCP_MESSAGE(name, value)                      \
-		case Mumble::Protocol::TCPMessageType::name: {                   \
-			MumbleProto::name msg;                                       \
-			if (msg.ParseFromArray(qbaMsg.constData(), qbaMsg.size())) { \
-				msg.DiscardUnknownFields();                              \
-				msg##name(u, msg);                                       \
-			}                                                            \
-			break;                                                       \
+#	define PROCESS_MUMBLE_TCP_MESSAGE(name, value)                                         \
+		case Mumble::Protocol::TCPMessageType::name: {                                     \
+			MumbleProto::name ownMsg;                                                      \
+			MumbleProto::name &msg = reuseMessage ? m_receivedMessages.msg##name : ownMsg; \
+			if (msg.ParseFromArray(qbaMsg.constData(), qbaMsg.size())) {                   \
+				msg.DiscardUnknownFields();                                                \
+				msg##name(u, msg);                                                         \
+			}                                                                              \
+			break;                                                                         \
 		}
 #else
-#	define PROCESS_MUMBLE_TCP_MESSAGE(name, value)                      \
-		case Mumble::Protocol::TCPMessageType::name: {                   \
-			MumbleProto::name msg;                                       \
-			if (msg.ParseFromArray(qbaMsg.constData(), qbaMsg.size())) { \
-				if (type != Mumble::Protocol::TCPMessageType::Ping) {    \
-					printf("== %s:\n", #name);                           \
-					msg.PrintDebugString();                              \
-				}                                                        \
-				msg.DiscardUnknownFields();                              \
-				msg##name(u, msg);                                       \
-			}                                                            \
-			break;                                                       \
+#	define PROCESS_MUMBLE_TCP_MESSAGE(name, value)                                         \
+		case Mumble::Protocol::TCPMessageType::name: {                                     \
+			MumbleProto::name ownMsg;                                                      \
+			MumbleProto::name &msg = reuseMessage ? m_receivedMessages.msg##name : ownMsg; \
+			if (msg.ParseFromArray(qbaMsg.constData(), qbaMsg.size())) {                   \
+				if (type != Mumble::Protocol::TCPMessageType::Ping) {                      \
+					printf("== %s:\n", #name);                                             \
+					msg.PrintDebugString();                                                \
+				}                                                                          \
+				msg.DiscardUnknownFields();                                                \
+				msg##name(u, msg);                                                         \
+			}                                                                              \
+			break;                                                                         \
 		}
 #endif
 
 	switch (type) { MUMBLE_ALL_TCP_MESSAGES }
 
 #undef PROCESS_MUMBLE_TCP_MESSAGE
-}
-
-void Server::checkTimeout() {
-	QList< ServerUser * > qlClose;
 
-	qrwlVoiceThread.lockForRead();
-	foreach (ServerUser *u, qhUsers) {
-		if (u->activityTime() > (iTimeout * 1000)) {
-			log(u, "Timeout");
-			qlClose.append(u);
-		}
+	if (reuseMessage) {
+		m_handlingMessage = false;
 	}
-	qrwlVoiceThread.unlock();
-	foreach (ServerUser *u, qlClose)
-		u->disconnectSocket(true);
 }
 
-void Server::tcpTransmitData(QByteArray a, unsigned int id) {
-	Connection *c = qhUsers.value(id);
-	if (c) {
-		QByteArray qba;
-		int len = a.size();
+void Server::scheduleTimeout(ServerUser *u) {
+	// Rather than being rescheduled whenever a message arrives, the timer expires when the user would time out without
+	// any further activity and then checks whether there has been some in the meantime
+	const qint64 remaining = static_cast< qint64 >(iTimeout) * 1000 - u->activityTime();
 
-		qba.resize(len + 6);
-		unsigned char *uc = reinterpret_cast< unsigned char * >(qba.data());
-		*reinterpret_cast< quint16 * >(&uc[0]) =
-			qToBigEndian(static_cast< quint16 >(Mumble::Protocol::TCPMessageType::UDPTunnel));
-		*reinterpret_cast< quint32 * >(&uc[2]) = qToBigEndian(static_cast< quint32 >(len));
-		memcpy(uc + 6, a.constData(), len);
+	meta->timers().schedule(u->m_timeoutTimer, std::chrono::milliseconds(std::max< qint64 >(remaining, 0)),
+							[this, u]() { checkTimeout(u); });
+}
 
-		c->sendMessage(qba);
-		c->forceFlush();
+void Server::checkTimeout(ServerUser *u) {
+	if (u->activityTime() > (static_cast< qint64 >(iTimeout) * 1000)) {
+		log(u, "Timeout");
+		u->disconnectSocket(true);
+	} else {
+		scheduleTimeout(u);
 	}
 }
 
@@ -1828,6 +2330,12 @@ void Server::doSync(unsigned int id) {
 
 void Server::sendProtoMessage(ServerUser *u, const ::google::protobuf::Message &msg,
 							  Mumble::Protocol::TCPMessageType msgType) {
+	// A message sent directly must not overtake the broadcasts still queued for the same user. E.g. a joining user
+	// has to receive its own UserState before the ServerSync.
+	if (u->sState == ServerUser::Authenticated && !m_broadcasts.isEmpty()) {
+		flushBroadcasts();
+	}
+
 	QByteArray cache;
 	u->sendMessage(msg, msgType, cache);
 }
@@ -1840,18 +2348,311 @@ void Server::sendProtoAll(const ::google::protobuf::Message &msg, Mumble::Protoc
 void Server::sendProtoExcept(ServerUser *u, const ::google::protobuf::Message &msg,
 							 Mumble::Protocol::TCPMessageType msgType, Version::full_t version,
 							 Version::CompareMode mode) {
-	QByteArray cache;
-	foreach (ServerUser *usr, qhUsers)
-		if ((usr != u) && (usr->sState == ServerUser::Authenticated)) {
-			assert(mode == Version::CompareMode::AtLeast || mode == Version::CompareMode::LessThan);
-
-			const bool isUnknown = version == Version::UNKNOWN;
-			const bool fulfillsVersionRequirement =
-				mode == Version::CompareMode::AtLeast ? usr->m_version >= version : usr->m_version < version;
-			if (isUnknown || fulfillsVersionRequirement) {
-				usr->sendMessage(msg, msgType, cache);
-			}
+	if (msgType == Mumble::Protocol::TCPMessageType::UserState) {
+		const MumbleProto::UserState &mpus = static_cast< const MumbleProto::UserState & >(msg);
+		if (mpus.has_session()) {
+			invalidateUserStateSync(mpus.session());
+		}
+	}
+
+	if (!m_broadcasts.add(msg, msgType, u ? u->uiSession : 0, version, mode)) {
+		// Everything queued before is sent along, so that the order of the messages is retained
+		flushBroadcasts();
+	} else if (!m_broadcastTimer.isActive()) {
+		m_broadcastTimer.start(BROADCAST_COALESCE_WINDOW);
+	}
+}
+
+void Server::flushBroadcasts() {
+	m_broadcastTimer.stop();
+
+	if (m_broadcasts.isEmpty()) {
+		return;
+	}
+
+	foreach (ServerUser *usr, qhUsers) {
+		if (usr->sState == ServerUser::Authenticated) {
+			usr->sendMessage(m_broadcasts.batchFor(usr->uiSession, usr->m_version));
+		}
+	}
+
+	m_broadcasts.clear();
+}
+
+VoiceStatistics::Snapshot Server::voiceStatistics() const {
+	VoiceStatistics::Snapshot statistics = m_tcpStatistics.snapshot();
+
+	foreach (const UDPWorker *worker, m_udpWorkers) {
+		statistics.merge(worker->m_statistics.snapshot());
+	}
+#ifdef USE_SERVER_MIXING
+	for (const MixingOutput &output : m_mixingOutputs) {
+		statistics.merge(output.statistics.snapshot());
+	}
+#endif
+
+	return statistics;
+}
+
+QString Server::formatVoiceStatistics(const VoiceStatistics::Snapshot &statistics) {
+	return QString("%1 packets received, %2 audio packets sent to an average of %3 receivers (max %4), %5 dropped by "
+				   "the bandwidth limit, %6 failed to decrypt, %7 sends via TCP (%8 dropped as the connection didn't "
+				   "keep up); latency %9/%10/%11 us (median/99th percentile/max), decrypt %12/%13 us, route %14/%15 "
+				   "us, send %16/%17 us (median/99th percentile)")
+		.arg(statistics.packetsReceived)
+		.arg(statistics.audioPackets)
+		.arg(statistics.fanOut.mean())
+		.arg(statistics.fanOut.max())
+		.arg(statistics.bandwidthDrops)
+		.arg(statistics.decryptFailures)
+		.arg(statistics.tcpFallbackSends)
+		.arg(statistics.tunnelDrops)
+		.arg(statistics.latency.quantile(0.5) / 1000.0, 0, 'f', 1)
+		.arg(statistics.latency.quantile(0.99) / 1000.0, 0, 'f', 1)
+		.arg(statistics.latency.max() / 1000.0, 0, 'f', 1)
+		.arg(statistics.decrypt.quantile(0.5) / 1000.0, 0, 'f', 1)
+		.arg(statistics.decrypt.quantile(0.99) / 1000.0, 0, 'f', 1)
+		.arg(statistics.route.quantile(0.5) / 1000.0, 0, 'f', 1)
+		.arg(statistics.route.quantile(0.99) / 1000.0, 0, 'f', 1)
+		.arg(statistics.send.quantile(0.5) / 1000.0, 0, 'f', 1)
+		.arg(statistics.send.quantile(0.99) / 1000.0, 0, 'f', 1);
+}
+
+void Server::logVoiceStatistics() {
+	const VoiceStatistics::Snapshot statistics = voiceStatistics();
+	const VoiceStatistics::Snapshot interval   = statistics.since(m_loggedVoiceStatistics);
+	m_loggedVoiceStatistics                    = statistics;
+
+	if (interval.packetsReceived == 0) {
+		// Nothing worth logging
+		return;
+	}
+
+	log(QString("Voice (last %1 s): %2").arg(iVoiceStatisticsInterval).arg(formatVoiceStatistics(interval)));
+}
+
+// Defined in Messages.cpp
+bool isChannelEnterRestricted(Channel *c);
+
+static QByteArray serializeMessage(const ::google::protobuf::Message &msg) {
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+	const int len = static_cast< int >(msg.ByteSizeLong());
+#else
+	// ByteSize() has been deprecated as of protobuf v3.4
+	const int len = msg.ByteSize();
+#endif
+	QByteArray serialized;
+	serialized.resize(len);
+	msg.SerializeToArray(serialized.data(), len);
+
+	return serialized;
+}
+
+void Server::invalidateChannelTreeSync() {
+	for (ChannelTreeSync &sync : m_channelTreeSync) {
+		sync.valid = false;
+	}
+}
+
+void Server::buildChannelTreeSync(ChannelTreeSync &sync, bool descriptionHashes) {
+	sync.channels.clear();
+	sync.links.clear();
+
+	MumbleProto::ChannelState mpcs;
+
+	QQueue< Channel * > q;
+	q << qhChannels.value(0);
+	while (!q.isEmpty()) {
+		Channel *c = q.dequeue();
+
+		mpcs.Clear();
+
+		mpcs.set_channel_id(c->iId);
+		if (c->cParent)
+			mpcs.set_parent(c->cParent->iId);
+		if (c->iId == 0)
+			mpcs.set_name(u8(qsRegName.isEmpty() ? QLatin1String("Root") : qsRegName));
+		else
+			mpcs.set_name(u8(c->qsName));
+
+		mpcs.set_position(c->iPosition);
+
+		if (descriptionHashes && !c->qbaDescHash.isEmpty())
+			mpcs.set_description_hash(blob(c->qbaDescHash));
+		else if (!c->qsDesc.isEmpty())
+			mpcs.set_description(u8(c->qsDesc));
+
+		mpcs.set_max_users(c->uiMaxUsers);
+
+		// Include info about enter restrictions of this channel
+		mpcs.set_is_enter_restricted(isChannelEnterRestricted(c));
+
+		sync.channels.emplace_back(c, serializeMessage(mpcs));
+
+		foreach (Channel *child, c->qlChannels)
+			q.enqueue(child);
+	}
+
+	// Links can only be transmitted once all channels are known
+	QByteArray framed;
+	for (const auto &entry : sync.channels) {
+		const Channel *c = entry.first;
+		if (c->qhLinks.count() > 0) {
+			mpcs.Clear();
+			mpcs.set_channel_id(c->iId);
+
+			foreach (Channel *l, c->qhLinks.keys())
+				mpcs.add_links(l->iId);
+
+			framed.clear();
+			Connection::messageToNetwork(mpcs, Mumble::Protocol::TCPMessageType::ChannelState, framed);
+			sync.links.append(framed);
+		}
+	}
+
+	// Concatenated protobuf messages are parsed as a single, merged one. This allows appending the per-user field to
+	// the shared part of the message without serializing it again.
+	for (bool canEnter : { false, true }) {
+		mpcs.Clear();
+		mpcs.set_can_enter(canEnter);
+		sync.canEnter[canEnter ? 1 : 0] = serializeMessage(mpcs);
+	}
+
+	sync.valid = true;
+}
+
+void Server::sendChannelTree(ServerUser *u) {
+	const bool descriptionHashes = u->m_version >= Version::fromComponents(1, 2, 2);
+	ChannelTreeSync &sync        = m_channelTreeSync[descriptionHashes ? 1 : 0];
+
+	if (!sync.valid) {
+		buildChannelTreeSync(sync, descriptionHashes);
+	}
+
+	int size = sync.links.size();
+	for (const auto &entry : sync.channels) {
+		size += 6 + entry.second.size() + sync.canEnter[1].size();
+	}
+
+	QByteArray batch;
+	batch.reserve(size);
+
+	unsigned char header[6];
+	for (const auto &entry : sync.channels) {
+		const QByteArray &canEnter =
+			sync.canEnter[ChanACL::hasPermission(u, entry.first, ChanACL::Enter, &acCache) ? 1 : 0];
+
+		qToBigEndian< quint16 >(static_cast< quint16 >(Mumble::Protocol::TCPMessageType::ChannelState), &header[0]);
+		qToBigEndian< quint32 >(static_cast< quint32 >(entry.second.size() + canEnter.size()), &header[2]);
+
+		batch.append(reinterpret_cast< const char * >(header), sizeof(header));
+		batch.append(entry.second);
+		batch.append(canEnter);
+	}
+	batch.append(sync.links);
+
+	// A single write instead of one per message
+	u->sendMessage(batch);
+}
+
+void Server::invalidateUserStateSync(unsigned int session) {
+	auto it = m_userStateSync.find(session);
+	if (it != m_userStateSync.end()) {
+		for (QByteArray &framed : it->framed) {
+			framed.clear();
 		}
+	}
+}
+
+QByteArray Server::buildUserStateSync(const ServerUser *u, UserStateSyncFormat format) {
+	MumbleProto::UserState mpus;
+	mpus.set_session(u->uiSession);
+	mpus.set_name(u8(u->qsName));
+	if (u->iId >= 0)
+		mpus.set_user_id(u->iId);
+	if (format == UserStateSyncFormat::Hashes) {
+		if (!u->qbaTextureHash.isEmpty())
+			mpus.set_texture_hash(blob(u->qbaTextureHash));
+		else if (!u->qbaTexture.isEmpty())
+			mpus.set_texture(blob(u->qbaTexture));
+	} else if (format == UserStateSyncFormat::FullWithTexture) {
+		mpus.set_texture(blob(u->qbaTexture));
+	}
+	if (u->cChannel->iId != 0)
+		mpus.set_channel_id(u->cChannel->iId);
+	if (u->bDeaf)
+		mpus.set_deaf(true);
+	else if (u->bMute)
+		mpus.set_mute(true);
+	if (u->bSuppress)
+		mpus.set_suppress(true);
+	if (u->bPrioritySpeaker)
+		mpus.set_priority_speaker(true);
+	if (u->bRecording)
+		mpus.set_recording(true);
+	if (u->bSelfDeaf)
+		mpus.set_self_deaf(true);
+	else if (u->bSelfMute)
+		mpus.set_self_mute(true);
+	if ((format == UserStateSyncFormat::Hashes) && !u->qbaCommentHash.isEmpty())
+		mpus.set_comment_hash(blob(u->qbaCommentHash));
+	else if (!u->qsComment.isEmpty())
+		mpus.set_comment(u8(u->qsComment));
+	if (!u->qsHash.isEmpty())
+		mpus.set_hash(u8(u->qsHash));
+
+	for (int channelID : m_channelListenerManager.getListenedChannelsForUser(u->uiSession)) {
+		mpus.add_listening_channel_add(channelID);
+
+		if (broadcastListenerVolumeAdjustments) {
+			VolumeAdjustment volume = m_channelListenerManager.getListenerVolumeAdjustment(u->uiSession, channelID);
+			MumbleProto::UserState::VolumeAdjustment *adjustment = mpus.add_listening_volume_adjustment();
+			adjustment->set_listening_channel(channelID);
+			adjustment->set_volume_adjustment(volume.factor);
+		}
+	}
+
+	QByteArray framed;
+	Connection::messageToNetwork(mpus, Mumble::Protocol::TCPMessageType::UserState, framed);
+
+	return framed;
+}
+
+void Server::sendUserStates(ServerUser *u) {
+	UserStateSyncFormat format = UserStateSyncFormat::Hashes;
+	if (u->m_version < Version::fromComponents(1, 2, 2)) {
+		// Older clients only get the textures of others if their own one is a raw (uncompressed) image
+		const bool rawTexture =
+			(u->qbaTexture.length() >= 4)
+			&& (qFromBigEndian< unsigned int >(reinterpret_cast< const unsigned char * >(u->qbaTexture.constData()))
+				== 600 * 60 * 4);
+		format = rawTexture ? UserStateSyncFormat::FullWithTexture : UserStateSyncFormat::Full;
+	}
+
+	QByteArray batch;
+	foreach (ServerUser *other, qhUsers) {
+		if (other->sState != ServerUser::Authenticated || other == u)
+			continue;
+
+		QByteArray &framed = m_userStateSync[other->uiSession].framed[static_cast< std::size_t >(format)];
+		if (framed.isEmpty()) {
+			framed = buildUserStateSync(other, format);
+		}
+
+		batch.append(framed);
+	}
+
+	if (batch.isEmpty()) {
+		return;
+	}
+
+	// The user's own state may still be waiting to be broadcast and has to arrive first
+	if (!m_broadcasts.isEmpty()) {
+		flushBroadcasts();
+	}
+
+	// A single write instead of one per message
+	u->sendMessage(batch);
 }
 
 void Server::removeChannel(int id) {
@@ -1867,18 +2668,12 @@ void Server::removeChannel(Channel *chan, Channel *dest) {
 	if (!dest)
 		dest = chan->cParent;
 
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-		chan->unlink(nullptr);
-	}
+	chan->unlink(nullptr);
 
 	foreach (c, chan->qlChannels) { removeChannel(c, dest); }
 
 	foreach (p, chan->qlUsers) {
-		{
-			QWriteLocker wl(&qrwlVoiceThread);
-			chan->removeUser(p);
-		}
+		chan->removeUser(p);
 
 		Channel *target = dest;
 		while (target->cParent
@@ -1918,10 +2713,12 @@ void Server::removeChannel(Channel *chan, Channel *dest) {
 	emit channelRemoved(chan);
 
 	if (chan->cParent) {
-		QWriteLocker wl(&qrwlVoiceThread);
 		chan->cParent->removeChannel(chan);
 	}
 
+	invalidateVoiceRouting();
+	invalidateChannelTreeSync();
+
 	delete chan;
 }
 
@@ -1973,26 +2770,25 @@ void Server::userEnterChannel(User *p, Channel *c, MumbleProto::UserState &mpus)
 
 	Channel *old = p->cChannel;
 
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-		c->addUser(p);
+	c->addUser(p);
 
-		bool mayspeak = ChanACL::hasPermission(static_cast< ServerUser * >(p), c, ChanACL::Speak, nullptr);
-		bool sup      = p->bSuppress;
+	bool mayspeak = ChanACL::hasPermission(static_cast< ServerUser * >(p), c, ChanACL::Speak, nullptr);
+	bool sup      = p->bSuppress;
 
-		if (mayspeak == sup) {
-			// Ok, he can speak and was suppressed, or vice versa
-			p->bSuppress = !mayspeak;
-			mpus.set_suppress(p->bSuppress);
-		}
+	if (mayspeak == sup) {
+		// Ok, he can speak and was suppressed, or vice versa
+		p->bSuppress = !mayspeak;
+		mpus.set_suppress(p->bSuppress);
+	}
 
-		if (p->bPrioritySpeaker) {
-			// Clear priority speaker flag when switching channels
-			p->bPrioritySpeaker = false;
-			mpus.set_priority_speaker(p->bPrioritySpeaker);
-		}
+	if (p->bPrioritySpeaker) {
+		// Clear priority speaker flag when switching channels
+		p->bPrioritySpeaker = false;
+		mpus.set_priority_speaker(p->bPrioritySpeaker);
 	}
 
+	invalidateVoiceRouting(*static_cast< ServerUser * >(p));
+
 	clearACLCache(p);
 	setLastChannel(p);
 
@@ -2006,6 +2802,58 @@ void Server::userEnterChannel(User *p, Channel *c, MumbleProto::UserState &mpus)
 		sendClientPermission(static_cast< ServerUser * >(p), c->cParent);
 }
 
+void Server::tuneUser(ServerUser *u, const std::array< unsigned int, 2 > &frequencies, unsigned int transmitRadio) {
+	if (u->m_tunedFrequencies == frequencies && u->m_transmitRadio == transmitRadio)
+		return;
+
+	removeFromFrequencyIndex(u);
+
+	u->m_tunedFrequencies = frequencies;
+	u->m_transmitRadio    = transmitRadio;
+
+	for (unsigned int frequency : frequencies) {
+		if (frequency != 0) {
+			// A user monitoring the same frequency on both radios is only indexed once
+			qhFrequencyUsers[frequency].insert(u);
+		}
+	}
+
+	invalidateVoiceRouting(*u);
+
+	MumbleProto::RadioTune mprt;
+	mprt.set_session(u->uiSession);
+	mprt.set_frequency_com1(frequencies[0]);
+	mprt.set_frequency_com2(frequencies[1]);
+	mprt.set_transmit_radio(static_cast< MumbleProto::RadioTune_Radio >(transmitRadio));
+	sendMessage(u, mprt);
+}
+
+Channel *Server::radioChannel() const {
+	Channel *c = qhChannels.value(iRadioChannel);
+
+	return c ? c : qhChannels.value(0);
+}
+
+void Server::removeFromFrequencyIndex(ServerUser *u) {
+	for (unsigned int frequency : u->m_tunedFrequencies) {
+		if (frequency == 0)
+			continue;
+
+		auto it = qhFrequencyUsers.find(frequency);
+		if (it != qhFrequencyUsers.end()) {
+			it->remove(u);
+			if (it->isEmpty()) {
+				// Don't keep empty frequencies around
+				qhFrequencyUsers.erase(it);
+			}
+		}
+	}
+}
+
+bool Server::isValidFrequency(unsigned int frequency) {
+	return Frequency(frequency).isValid();
+}
+
 bool Server::hasPermission(ServerUser *p, Channel *c, QFlags< ChanACL::Perm > perm) {
 	QMutexLocker qml(&qmCache);
 	return ChanACL::hasPermission(p, c, perm, &acCache);
@@ -2144,13 +2992,11 @@ void Server::clearACLCache(User *p) {
 
 	// A change in ACLs means that the user might be able to whisper
 	// to users it didn't have permission to do before (or vice versa)
-	clearWhisperTargetCache();
-}
-
-void Server::clearWhisperTargetCache() {
-	QWriteLocker lock(&qrwlVoiceThread);
-
-	foreach (ServerUser *u, qhUsers) { u->qmTargetCache.clear(); }
+	if (p) {
+		invalidateVoiceRouting(*static_cast< ServerUser * >(p));
+	} else {
+		invalidateVoiceRouting();
+	}
 }
 
 QString Server::addressToString(const QHostAddress &adr, unsigned short port) {
@@ -2247,6 +3093,7 @@ void Server::recheckCodecVersions(ServerUser *connectingUser) {
 	}
 
 	bOpus = enableOpus;
+	invalidateVoiceRouting();
 
 	MumbleProto::CodecVersion mpcv;
 	mpcv.set_alpha(iCodecAlpha);
@@ -15,15 +15,23 @@
 #include "ACL.h"
 #include "AudioReceiverBuffer.h"
 #include "Ban.h"
+#include "Broadcast.h"
 #include "ChannelListenerManager.h"
 #include "HostAddress.h"
 #include "Mumble.pb.h"
 #include "MumbleProtocol.h"
 #include "Timer.h"
+#include "UDPBatch.h"
 #include "User.h"
 #include "Version.h"
+#include "VoiceRouting.h"
+#include "VoiceStatistics.h"
 #include "VolumeAdjustment.h"
 
+#ifdef USE_SERVER_MIXING
+#	include "FrequencyMixer.h"
+#endif
+
 #ifndef Q_MOC_RUN
 #	include <boost/function.hpp>
 #endif
@@ -49,10 +57,20 @@
 #	include <winsock2.h>
 #endif
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 class Zeroconf;
 class Channel;
 class PacketDataStream;
 class ServerUser;
+class UDPWorker;
 class User;
 class QNetworkAccessManager;
 
@@ -89,13 +107,14 @@ public:
 	void execute();
 };
 
-class Server : public QThread {
+class Server : public QObject {
 private:
 	Q_OBJECT;
 	Q_DISABLE_COPY(Server);
 
 protected:
-	bool bRunning;
+	/// Whether the UDP workers should keep running. Cleared by the main thread or by a worker that hit a fatal error.
+	std::atomic< bool > bRunning;
 
 	QNetworkAccessManager *qnamNetwork;
 
@@ -148,6 +167,14 @@ public:
 
 	bool broadcastListenerVolumeAdjustments;
 
+	int iUdpWorkers;
+	/// Radio frequencies with at least this many listeners are mixed on the server. 0 disables mixing.
+	int iMixingThreshold;
+	/// The channel whose Enter and Speak permissions are required for listening and transmitting on radio frequencies
+	int iRadioChannel;
+	/// The interval (in seconds) in which the voice statistics are written to the log. 0 disables logging them.
+	int iVoiceStatisticsInterval;
+
 	Version::full_t m_suggestVersion;
 
 	QVariant qvSuggestPositional;
@@ -177,15 +204,28 @@ public:
 	ChannelListenerManager m_channelListenerManager;
 
 
+	// Used for answering pings on the main thread while the UDP workers are not running. The UDP workers have their
+	// own instances.
 	Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > m_udpDecoder;
 	Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > m_tcpTunnelDecoder;
 	Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > m_udpPingEncoder;
-	Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > m_udpAudioEncoder;
-	Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > m_tcpAudioEncoder;
+	Mumble::Protocol::UDPServerAudioEncoder m_tcpAudioEncoder;
+
+	/// One instance of every control message, which incoming messages are parsed into. As parsing keeps the memory
+	/// allocated by earlier messages, handling a message usually doesn't allocate.
+	struct ReceivedMessages {
+#define PROCESS_MUMBLE_TCP_MESSAGE(name, value) MumbleProto::name msg##name;
+		MUMBLE_ALL_TCP_MESSAGES
+#undef PROCESS_MUMBLE_TCP_MESSAGE
+	};
+	ReceivedMessages m_receivedMessages;
+	/// Whether a message is being handled (in which case the instances above are in use)
+	bool m_handlingMessage = false;
 
 	gsl::span< const Mumble::Protocol::byte >
 		handlePing(const Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > &decoder,
-				   Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > &encoder, bool expectExtended);
+				   Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > &encoder, bool expectExtended,
+				   const VoiceRoutingSnapshot &routing);
 
 	void readParams();
 
@@ -207,8 +247,81 @@ private:
 	int iChannelNestingLimit;
 	int iChannelCountLimit;
 
-	AudioReceiverBuffer m_udpAudioReceivers;
 	AudioReceiverBuffer m_tcpAudioReceivers;
+	UDPSendBatch m_tcpSendBatch;
+	VoiceStatistics m_tcpStatistics;
+
+#ifdef USE_SERVER_MIXING
+	/// The number of threads mixing frequencies. They use the last reader slots of m_voiceRouting.
+	static constexpr std::size_t MIXING_WORKERS = 2;
+
+	/// What a mixing thread needs for sending out the mixed audio (these are private to the thread)
+	struct MixingOutput {
+		Mumble::Protocol::UDPServerAudioEncoder encoder;
+		AudioReceiverBuffer receivers;
+		UDPSendBatch sendBatch;
+		VoiceStatistics statistics;
+	};
+	std::array< MixingOutput, MIXING_WORKERS > m_mixingOutputs;
+	FrequencyMixer m_frequencyMixer;
+
+	/// Sends the mix of the given frequency to all of its listeners except for the stations contributing to it. Runs on
+	/// the mixing threads.
+	void sendMixedAudio(std::size_t worker, unsigned int frequency, const Mumble::Protocol::AudioData &audioData,
+						const std::vector< unsigned int > &transmitters);
+#endif
+
+	/// The interval (in ms) in which freeing retired voice routing objects is retried
+	static constexpr int VOICE_ROUTING_RECLAIM_INTERVAL = 100;
+
+	/// The channels and frequencies a user receives audio on
+	struct VoiceRoutingReceiver {
+		std::vector< unsigned int > channels;
+		std::vector< unsigned int > frequencies;
+	};
+
+	QTimer m_voiceRoutingTimer;
+	/// Whether the next snapshot has to be built from scratch (the initial one always is)
+	bool m_voiceRoutingOutdated = true;
+	/// The sessions of the users whose routing has to be rebuilt for the next snapshot
+	std::unordered_set< unsigned int > m_voiceRoutingDirtyUsers;
+	/// Where every user receives audio as of the current snapshot (by session), so that an incremental update knows
+	/// which receivers to rebuild when a user leaves a channel or frequency
+	std::unordered_map< unsigned int, VoiceRoutingReceiver > m_voiceRoutingReceivers;
+	/// The interned positional audio contexts (see VoiceRoutingSnapshot::User::positionalContext). New contexts are
+	/// added as they show up and the numbers are only reassigned when the routing is built from scratch, so that
+	/// entries taken over from the previous snapshot stay valid.
+	std::unordered_map< std::string, unsigned int > m_positionalContexts;
+	std::uint64_t m_voiceRoutingGeneration = 0;
+
+	/// The time (in ms) for which UserState broadcasts are held back, so that further updates of the same user can be
+	/// merged into them
+	static constexpr int BROADCAST_COALESCE_WINDOW = 10;
+
+	BroadcastQueue m_broadcasts;
+	QTimer m_broadcastTimer;
+
+	QTimer m_voiceStatisticsTimer;
+	/// The voice statistics as of the last time they have been logged
+	VoiceStatistics::Snapshot m_loggedVoiceStatistics;
+
+	/// @returns A human-readable summary of the given statistics
+	static QString formatVoiceStatistics(const VoiceStatistics::Snapshot &statistics);
+
+	/// (Re)schedules the timeout timer of the given user for when it would time out without any further activity
+	void scheduleTimeout(ServerUser *u);
+	/// Disconnects the given user if it has timed out or reschedules its timer otherwise
+	void checkTimeout(ServerUser *u);
+
+private slots:
+	void updateVoiceRouting();
+	/// Routes an audio packet the voice thread has handed over, as the receivers of its whisper target had to be
+	/// resolved first
+	void routeAudio(unsigned int session, const QByteArray &packet);
+	/// Sends all queued broadcasts, handing each user all of its messages at once
+	void flushBroadcasts();
+	/// Logs the voice statistics of the last interval
+	void logVoiceStatistics();
 
 public slots:
 	void regSslError(const QList< QSslError > &);
@@ -231,20 +344,17 @@ public slots:
 	void connectionClosed(QAbstractSocket::SocketError, const QString &);
 	void sslError(const QList< QSslError > &);
 	void message(Mumble::Protocol::TCPMessageType, const QByteArray &, ServerUser *cCon = nullptr);
-	void checkTimeout();
-	void tcpTransmitData(QByteArray, unsigned int);
 	void doSync(unsigned int);
 	void encrypted();
 	void udpActivated(int);
 signals:
 	void reqSync(unsigned int);
-	void tcpTransmit(QByteArray, unsigned int id);
+	void reqRouteAudio(unsigned int, const QByteArray &);
 
 public:
 	int iServerNum;
 	QQueue< int > qqIds;
 	QList< SslServer * > qlServer;
-	QTimer *qtTimeout;
 
 #ifdef Q_OS_UNIX
 	int aiNotify[2];
@@ -254,57 +364,48 @@ public:
 	QList< SOCKET > qlUdpSocket;
 #endif
 	QList< QSocketNotifier * > qlUdpNotifier;
-
-	/// This lock provides synchronization between the
-	/// main thread (where control channel messages and
-	/// RPC happens), and the Server's voice thread.
-	///
-	/// These are the only two threads in Murmur that
-	/// access a Server's data.
-	///
-	/// The easiest way to understand the locking strategy
-	/// and synchronization between the main thread and the
-	/// Server's voice thread is by using the concept of
-	/// ownership.
-	///
-	/// A thread owning an object means that it is the only
-	/// thread that is allowed to write to that object. To
-	/// make changes to it.
-	///
-	/// Most data in the Server class is owned by the main
-	/// thread. That means that the main thread is the only
-	/// thread that writes/updates those structures.
-	///
-	/// When processing incoming voice data (and re-
-	/// broadcasting) that voice data), the Server's voice
-	/// thread needs to access various parts of Server's data,
-	/// such as qhUsers, qhChannels, User->cChannel, etc.
-	/// However, these are owned by the main thread.
-	///
-	/// To ensure correct synchronization between the two
-	/// threads, the contract for using qrwlVoiceThread is
-	/// as follows:
-	///
-	///  - When the Server's voice thread needs to read data
-	///    owned by the main thread, it must hold a read lock
-	///    on qrwlVoiceThread.
-	///
-	///  - The Server's voice thread does not write to any data
-	///    that is owned by the main thread.
-	///
-	///  - When the main thread needs to write to data owned by
-	///    itself that is accessed by the voice thread, it must
-	///    hold a write lock on qrwlVoiceThread.
-	///
-	///  - When the main thread needs to read data that is owned
-	///    by itself, it DOES NOT hold a lock on qrwlVoiceThread.
-	///    That is because ownership of data guarantees that no
-	///    other thread can write to that data.
-	QReadWriteLock qrwlVoiceThread;
+	/// The threads processing UDP packets. Each of them has its own socket per bind address (all of these are also
+	/// contained in qlUdpSocket).
+	QList< UDPWorker * > m_udpWorkers;
+
+	/// @returns The statistics of the voice path of all threads since the server has been started. Must only be
+	/// 	called from the main thread.
+	VoiceStatistics::Snapshot voiceStatistics() const;
+
+	/// The voice threads (UDP workers) do not take any locks in order to route audio. Instead, they read an immutable
+	/// snapshot of everything the routing depends on (users, channel membership, links, listeners, whisper targets and
+	/// radio frequencies), which the main thread rebuilds and publishes whenever any of that data changes (see
+	/// invalidateVoiceRouting()). The data itself stays owned by the main thread, which thus never has to lock in
+	/// order to access it. Objects a voice thread may still reference (replaced snapshots and disconnected users)
+	/// are only freed once all of them are done with them.
+	VoiceRoutingPublisher m_voiceRouting;
+	/// The only data that is written to by the voice threads are the peer tables, as they associate users with the
+	/// address they send UDP packets from. Each UDP worker has its own peer table (UDPWorker::m_peerUsers). Users whose
+	/// UDP address is not known yet are kept in qhHostUsers, which is shared by all workers and guarded by this lock.
+	/// It is only ever locked for writing when a user connects, disconnects or sends its first UDP packet. If both
+	/// this lock and a worker's UDPWorker::m_peerLock are needed, this lock has to be taken first.
+	QReadWriteLock qrwlPeers;
 	QHash< unsigned int, ServerUser * > qhUsers;
-	QHash< QPair< HostAddress, quint16 >, ServerUser * > qhPeerUsers;
 	QHash< HostAddress, QSet< ServerUser * > > qhHostUsers;
 	QHash< unsigned int, Channel * > qhChannels;
+	/// Index of all users tuned to a given radio frequency (in kHz)
+	QHash< unsigned int, QSet< ServerUser * > > qhFrequencyUsers;
+
+	/// Marks the voice routing as outdated. A new snapshot is built from scratch and published as soon as control
+	/// returns to the event loop, so that consecutive changes are coalesced into a single update. Must be called after
+	/// changing any data the routing depends on, unless the change only concerns a single user (see below).
+	void invalidateVoiceRouting();
+	/// Marks the routing of the given user as outdated: its own entry and the receivers of every channel and frequency
+	/// it receives audio on (before or after the change). Only these are rebuilt, everything else is taken over from
+	/// the current snapshot. Must be called after changing the state of the user (e.g. its channel, listeners,
+	/// radios, mute/deaf state, positional audio context or whisper targets) or the user's ACL cache.
+	void invalidateVoiceRouting(const ServerUser &user);
+	std::unique_ptr< VoiceRoutingSnapshot > buildVoiceRouting();
+	/// @returns The receivers of the given whisper target of the given user, which are resolved (and stored in the
+	/// 	snapshot) if they haven't been yet. Must only be called from the main thread, for the current snapshot.
+	const std::vector< VoiceRoute > &resolveWhisperRoutes(const VoiceRoutingSnapshot::User &sender, int target,
+														   const VoiceRoutingSnapshot::WhisperRoutes &whisperRoutes);
+	void resolveWhisperTarget(ServerUser *u, const WhisperTarget &wt, std::vector< VoiceRoute > &routes);
 
 	QMutex qmCache;
 	ChanACL::ACLCache acCache;
@@ -314,11 +415,57 @@ public:
 
 	QList< Ban > qlBans;
 
-	void addListener(QHash< ServerUser *, VolumeAdjustment > &listeners, ServerUser &user, const Channel &channel);
-	void processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, AudioReceiverBuffer &buffer,
-					Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > &encoder);
-	void sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache, bool force = false);
-	void run();
+	void addListener(QHash< ServerUser *, VolumeAdjustment > &listeners, ServerUser &user,
+					 const VolumeAdjustment &volumeAdjustment);
+	/// @param packet The encoded packet, which is handed to the main thread if the receivers of its whisper target have
+	/// 	to be resolved first
+	/// @returns Whether the audio has been sent out (rather than having been dropped or handed to the mixer or the main
+	/// 	thread)
+	bool processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, const VoiceRoutingSnapshot &routing,
+					gsl::span< const Mumble::Protocol::byte > packet, AudioReceiverBuffer &buffer,
+					Mumble::Protocol::UDPServerAudioEncoder &encoder,
+					UDPSendBatch &sendBatch,
+					VoiceStatistics &statistics);
+	/// Sends the given audio packet to all receivers in the given buffer (which has to be preprocessed)
+	void sendAudio(const Mumble::Protocol::AudioData &audioData, AudioReceiverBuffer &buffer,
+				   Mumble::Protocol::UDPServerAudioEncoder &encoder, UDPSendBatch &sendBatch,
+				   VoiceStatistics &statistics);
+	/// The way an audio packet has been sent to a user
+	enum class VoiceSendResult {
+		/// Via UDP (or not at all, if the packet couldn't be encrypted)
+		UDP,
+		/// Queued for tunnelling through the user's TCP connection
+		Tunnelled,
+		/// Dropped, as too many packets are already waiting to be tunnelled to the user
+		TunnelFull
+	};
+	/// Sends the given audio packet to the given user. If a batch is given and the packet is sent via UDP, it is only
+	/// queued in the batch.
+	VoiceSendResult sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache,
+								bool force = false, UDPSendBatch *batch = nullptr);
+	/// Queues the given UDPTunnel message for the given user and schedules a flush. May be called from any thread.
+	///
+	/// @returns Whether the message was queued (false if the user's queue is full)
+	bool queueTunnelMessage(ServerUser &u, const QByteArray &message);
+	/// Writes the queued UDPTunnel messages to the users' connections. Runs on the main thread.
+	void flushTunnelMessages();
+	/// Guards m_tunnelUsers
+	QMutex m_tunnelLock;
+	/// The sessions of the users that got UDPTunnel messages queued since the last flush
+	std::vector< unsigned int > m_tunnelUsers;
+	/// The users currently being flushed (swapped with m_tunnelUsers, so that neither has to reallocate)
+	std::vector< unsigned int > m_flushedTunnelUsers;
+	std::atomic< bool > m_tunnelFlushScheduled = { false };
+	/// The loop run by each UDP worker
+	void processUDP(UDPWorker &worker);
+	/// Processes the datagram at the given index of the worker's receive batch
+	///
+	/// @returns Whether the datagram contained audio that has been sent out
+#ifdef Q_OS_UNIX
+	bool processDatagram(UDPWorker &worker, int sock, std::size_t index);
+#else
+	bool processDatagram(UDPWorker &worker, SOCKET sock, std::size_t index);
+#endif
 
 	bool validateChannelName(const QString &name);
 	bool validateUserName(const QString &name);
@@ -330,7 +477,6 @@ public:
 	void sendClientPermission(ServerUser *u, Channel *c, bool explicitlyRequested = false);
 	void flushClientPermissionCache(ServerUser *u, MumbleProto::PermissionQuery &mpqq);
 	void clearACLCache(User *p = nullptr);
-	void clearWhisperTargetCache();
 
 	void sendProtoAll(const ::google::protobuf::Message &msg, Mumble::Protocol::TCPMessageType type,
 					  Version::full_t version, Version::CompareMode mode);
@@ -338,6 +484,49 @@ public:
 						 Version::full_t version, Version::CompareMode mode);
 	void sendProtoMessage(ServerUser *, const ::google::protobuf::Message &msg, Mumble::Protocol::TCPMessageType type);
 
+	/// The channel tree as it is sent to joining clients. It only changes along with the channels, links and ACLs,
+	/// so it is serialized once per revision of the tree and then shared by all clients joining until the next change.
+	struct ChannelTreeSync {
+		/// Whether this still reflects the current channel tree
+		bool valid = false;
+		/// The serialized ChannelState of every channel (parents before their children), except for can_enter, which
+		/// differs from user to user
+		std::vector< std::pair< Channel *, QByteArray > > channels;
+		/// The framed ChannelStates transmitting all links
+		QByteArray links;
+		/// The serialized ChannelStates consisting of nothing but can_enter (false and true)
+		std::array< QByteArray, 2 > canEnter;
+	};
+	/// Index 0 is used for clients older than 1.2.2 (which get full descriptions), index 1 for all others
+	std::array< ChannelTreeSync, 2 > m_channelTreeSync;
+	/// Discards the serialized channel tree. Has to be called whenever a channel, a link or an ACL changes.
+	void invalidateChannelTreeSync();
+	void buildChannelTreeSync(ChannelTreeSync &sync, bool descriptionHashes);
+	/// Sends all channels and links to the given (joining) user in a single write
+	void sendChannelTree(ServerUser *u);
+
+	/// The ways a UserState is sent to joining clients, depending on the client
+	enum class UserStateSyncFormat {
+		/// For clients as of 1.2.2, which get texture and comment hashes
+		Hashes,
+		/// For older clients, which get full comments
+		Full,
+		/// For older clients that also get full textures
+		FullWithTexture
+	};
+	/// The UserState of a user as it is sent to joining clients. It is serialized once per revision of the user's
+	/// state, i.e. until the next UserState about the user is broadcast, and shared by all clients joining until then.
+	struct UserStateSync {
+		/// The framed UserState per UserStateSyncFormat (empty if not serialized yet)
+		std::array< QByteArray, 3 > framed;
+	};
+	QHash< unsigned int, UserStateSync > m_userStateSync;
+	/// Discards the serialized state of the user with the given session. Has to be called whenever it changes.
+	void invalidateUserStateSync(unsigned int session);
+	QByteArray buildUserStateSync(const ServerUser *u, UserStateSyncFormat format);
+	/// Sends the states of all other users to the given (joining) user in a single write
+	void sendUserStates(ServerUser *u);
+
 	// sendAll sends a protobuf message to all users on the server whose version is either bigger than v or
 	// lower than ~v. If v == 0 the message is sent to everyone.
 #define PROCESS_MUMBLE_TCP_MESSAGE(name, value)                                                        \
@@ -370,6 +559,15 @@ public:
 	void removeChannel(int id);
 	void removeChannel(Channel *c, Channel *dest = nullptr);
 	void userEnterChannel(User *u, Channel *c, MumbleProto::UserState &mpus);
+	/// Tunes the radios (COM1, COM2) of the given user to the given frequencies (in kHz) and selects the radio the
+	/// user transmits on. A frequency of 0 untunes the respective radio.
+	void tuneUser(ServerUser *u, const std::array< unsigned int, 2 > &frequencies, unsigned int transmitRadio);
+	static bool isValidFrequency(unsigned int frequency);
+	/// @returns The channel whose ACL governs radio use (see iRadioChannel). Falls back to the root channel if the
+	/// 	configured one doesn't exist.
+	Channel *radioChannel() const;
+	/// Removes the given user from qhFrequencyUsers
+	void removeFromFrequencyIndex(ServerUser *u);
 	bool unregisterUser(int id);
 
 	Server(int snum, QObject *parent = nullptr);
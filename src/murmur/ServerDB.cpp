@@ -1770,10 +1770,9 @@ QByteArray Server::getUserTexture(int id) {
 }
 
 void Server::addLink(Channel *c, Channel *l) {
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-		c->link(l);
-	}
+	c->link(l);
+	invalidateVoiceRouting();
+	invalidateChannelTreeSync();
 
 	if (c->bTemporary || l->bTemporary)
 		return;
@@ -1793,10 +1792,9 @@ void Server::addLink(Channel *c, Channel *l) {
 }
 
 void Server::removeLink(Channel *c, Channel *l) {
-	{
-		QWriteLocker wl(&qrwlVoiceThread);
-		c->unlink(l);
-	}
+	c->unlink(l);
+	invalidateVoiceRouting();
+	invalidateChannelTreeSync();
 
 	if (c->bTemporary || l->bTemporary)
 		return;
@@ -1867,6 +1865,7 @@ Channel *Server::addChannel(Channel *p, const QString &name, bool temporary, int
 	c->iPosition  = position;
 	c->uiMaxUsers = maxUsers;
 	qhChannels.insert(id, c);
+	invalidateChannelTreeSync();
 	return c;
 }
 
@@ -1884,6 +1883,9 @@ void Server::removeChannelDB(const Channel *c) {
 }
 
 void Server::updateChannel(const Channel *c) {
+	// Channels (and their ACLs) are always stored after having been changed, even if the change is not persisted
+	invalidateChannelTreeSync();
+
 	if (c->bTemporary)
 		return;
 	TransactionHolder th;
@@ -2164,10 +2166,11 @@ void Server::readLinks() {
 		Channel *c = qhChannels.value(cid);
 		Channel *l = qhChannels.value(lid);
 		if (c && l) {
-			QWriteLocker wl(&qrwlVoiceThread);
 			c->link(l);
 		}
 	}
+
+	invalidateVoiceRouting();
 }
 
 void Server::setLastChannel(const User *p) {
@@ -2444,6 +2447,8 @@ void Server::loadChannelListenersOf(const ServerUser &user) {
 		m_channelListenerManager.setListenerVolumeAdjustment(user.uiSession, channelID,
 															 VolumeAdjustment::fromFactor(volume));
 	}
+
+	invalidateVoiceRouting(user);
 }
 
 void Server::addChannelListener(const ServerUser &user, const Channel &channel) {
@@ -2477,6 +2482,7 @@ void Server::addChannelListener(const ServerUser &user, const Channel &channel)
 	}
 
 	m_channelListenerManager.addListener(user.uiSession, channel.iId);
+	invalidateVoiceRouting(user);
 }
 
 void Server::disableChannelListener(const ServerUser &user, const Channel &channel) {
@@ -2499,6 +2505,7 @@ void Server::disableChannelListener(const ServerUser &user, const Channel &chann
 	}
 
 	m_channelListenerManager.removeListener(user.uiSession, channel.iId);
+	invalidateVoiceRouting(user);
 }
 
 void Server::deleteChannelListener(const ServerUser &user, const Channel &channel) {
@@ -2518,6 +2525,7 @@ void Server::deleteChannelListener(const ServerUser &user, const Channel &channe
 	}
 
 	m_channelListenerManager.removeListener(user.uiSession, channel.iId);
+	invalidateVoiceRouting(user);
 }
 
 void Server::setChannelListenerVolume(const ServerUser &user, const Channel &channel, float volumeAdjustment) {
@@ -2536,6 +2544,7 @@ void Server::setChannelListenerVolume(const ServerUser &user, const Channel &cha
 
 	m_channelListenerManager.setListenerVolumeAdjustment(user.uiSession, channel.iId,
 														 VolumeAdjustment::fromFactor(volumeAdjustment));
+	invalidateVoiceRouting(user);
 }
 
 void ServerDB::wipeLogs() {
@@ -16,7 +16,9 @@
 #include "Connection.h"
 #include "HostAddress.h"
 #include "Timer.h"
+#include "TimingWheel.h"
 #include "User.h"
+#include "VoiceTunnel.h"
 
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QStringList>
@@ -27,6 +29,8 @@
 #	include <sys/socket.h>
 #endif
 
+#include <array>
+
 // Unfortunately, this needs to be "large enough" to hold
 // enough frames to account for both short-term and
 // long-term "maladjustments".
@@ -61,14 +65,6 @@ struct WhisperTarget {
 	QList< WhisperTarget::Channel > qlChannels;
 };
 
-class ServerUser;
-
-struct WhisperTargetCache {
-	QSet< ServerUser * > channelTargets;
-	QSet< ServerUser * > directTargets;
-	QHash< ServerUser *, VolumeAdjustment > listeningTargets;
-};
-
 class Server;
 
 /// A simple implementation for rate-limiting.
@@ -139,15 +135,28 @@ public:
 	/// UDP.
 	QAtomicInt aiUdpFlag;
 
+	/// The audio packets waiting to be sent through the TCP connection while the user is not using UDP
+	VoiceTunnelQueue m_voiceTunnel;
+
 	QList< int > qlCodecs;
 	bool bOpus;
 
 	QStringList qslAccessTokens;
 
 	QMap< int, WhisperTarget > qmTargets;
-	QMap< int, WhisperTargetCache > qmTargetCache;
 	QMap< QString, QString > qmWhisperRedirect;
 
+	/// The radio frequencies (in kHz) this user's COM1 and COM2 are tuned to. 0 means the respective radio is not
+	/// tuned.
+	std::array< unsigned int, 2 > m_tunedFrequencies = {};
+	/// The radio (index into m_tunedFrequencies) this user transmits on.
+	unsigned int m_transmitRadio = 0;
+
+	/// @returns Whether any of this user's radios is tuned
+	bool isRadioTuned() const { return m_tunedFrequencies[0] != 0 || m_tunedFrequencies[1] != 0; }
+	/// @returns The frequency this user transmits on or 0 if the transmitting radio is not tuned
+	unsigned int transmitFrequency() const { return m_tunedFrequencies[m_transmitRadio]; }
+
 	LeakyBucket leakyBucket;
 	LeakyBucket m_pluginMessageBucket;
 
@@ -159,6 +168,8 @@ public:
 	SOCKET sUdpSocket;
 #endif
 	BandwidthRecord bwr;
+	/// Expires when the user may have timed out. Scheduled on Meta's timing wheel once the user is authenticating.
+	TimingWheel::Timer m_timeoutTimer;
 	struct sockaddr_storage saiUdpAddress;
 	struct sockaddr_storage saiTcpLocalAddress;
 	ServerUser(Server *parent, QSslSocket *socket);
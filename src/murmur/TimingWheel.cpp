@@ -0,0 +1,133 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "TimingWheel.h"
+
+#include <algorithm>
+#include <utility>
+
+void TimingWheel::Timer::cancel() {
+	if (m_wheel) {
+		m_wheel->unlink(*this);
+		m_callback = nullptr;
+	}
+}
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, Clock::time_point start)
+	: m_tick(std::max(tick, std::chrono::milliseconds(1))), m_start(start) {
+}
+
+TimingWheel::~TimingWheel() {
+	for (std::array< Timer *, SLOTS > &level : m_slots) {
+		for (Timer *&head : level) {
+			while (head) {
+				unlink(*head);
+			}
+		}
+	}
+}
+
+void TimingWheel::schedule(Timer &timer, std::chrono::milliseconds delay, std::function< void() > callback) {
+	timer.cancel();
+
+	// Round up, so that a timer never expires early
+	const std::uint64_t ticks =
+		delay.count() > 0 ? static_cast< std::uint64_t >((delay.count() + m_tick.count() - 1) / m_tick.count()) : 0;
+
+	timer.m_wheel    = this;
+	timer.m_expiry   = m_currentTick + (ticks < MAX_TICKS ? ticks : MAX_TICKS);
+	timer.m_callback = std::move(callback);
+
+	insert(timer);
+	m_size++;
+}
+
+void TimingWheel::advance(Clock::time_point now) {
+	if (now < m_start) {
+		return;
+	}
+
+	const std::uint64_t lastTick = static_cast< std::uint64_t >((now - m_start) / m_tick);
+
+	while (m_currentTick <= lastTick) {
+		if (m_size == 0) {
+			// Nothing to cascade or expire
+			m_currentTick = lastTick + 1;
+			break;
+		}
+
+		// Whenever a level has wrapped around, the timers of the next slot of the level above get close enough to
+		// be sorted into the levels below
+		for (unsigned int level = LEVELS - 1; level > 0; --level) {
+			if ((m_currentTick & ((std::uint64_t(1) << (SLOT_BITS * level)) - 1)) == 0) {
+				cascade(level);
+			}
+		}
+
+		// Detach the expired timers first, so that the callbacks can freely (re)schedule and cancel timers
+		Timer *&slot   = m_slots[0][m_currentTick & (SLOTS - 1)];
+		Timer *expired = slot;
+		slot           = nullptr;
+		if (expired) {
+			expired->m_previous = &expired;
+		}
+
+		m_currentTick++;
+
+		while (expired) {
+			Timer &timer = *expired;
+			unlink(timer);
+
+			std::function< void() > callback = std::move(timer.m_callback);
+			timer.m_callback                 = nullptr;
+			if (callback) {
+				callback();
+			}
+		}
+	}
+}
+
+void TimingWheel::insert(Timer &timer) {
+	const std::uint64_t delta = timer.m_expiry > m_currentTick ? timer.m_expiry - m_currentTick : 0;
+	const std::uint64_t tick  = std::max(timer.m_expiry, m_currentTick);
+
+	unsigned int level = 0;
+	while (level < LEVELS - 1 && delta >= (std::uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+		level++;
+	}
+
+	Timer *&head = m_slots[level][(tick >> (SLOT_BITS * level)) & (SLOTS - 1)];
+
+	timer.m_next     = head;
+	timer.m_previous = &head;
+	if (head) {
+		head->m_previous = &timer.m_next;
+	}
+	head = &timer;
+}
+
+void TimingWheel::unlink(Timer &timer) {
+	*timer.m_previous = timer.m_next;
+	if (timer.m_next) {
+		timer.m_next->m_previous = timer.m_previous;
+	}
+
+	timer.m_wheel    = nullptr;
+	timer.m_previous = nullptr;
+	timer.m_next     = nullptr;
+	m_size--;
+}
+
+void TimingWheel::cascade(unsigned int level) {
+	Timer *&slot = m_slots[level][(m_currentTick >> (SLOT_BITS * level)) & (SLOTS - 1)];
+	Timer *timer = slot;
+	slot         = nullptr;
+
+	while (timer) {
+		Timer *next = timer->m_next;
+		insert(*timer);
+		timer = next;
+	}
+}
@@ -0,0 +1,94 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_TIMINGWHEEL_H_
+#define MUMBLE_MURMUR_TIMINGWHEEL_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/// A hierarchical timing wheel for large numbers of coarse timers (e.g. one per connected user).
+///
+/// Time is divided into ticks. Timers expiring within the next SLOTS ticks are kept in the slot of the first level
+/// that corresponds to their tick, timers further away in the slots of the higher levels, each of which covers SLOTS
+/// times the range of the level below it. Whenever the wheel of a level wraps around, the timers of the next slot of
+/// the level above are distributed into the levels below. Scheduling and cancelling a timer is therefore O(1), and
+/// advancing the wheel only touches the timers that (almost) expire.
+///
+/// The wheel is not thread-safe. It, and all of its timers, may only be used by a single thread.
+class TimingWheel {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr unsigned int SLOT_BITS = 6;
+	static constexpr unsigned int SLOTS     = 1u << SLOT_BITS;
+	static constexpr unsigned int LEVELS    = 4;
+	/// The number of ticks a timer can be scheduled in at most. Longer delays are shortened to this.
+	static constexpr std::uint64_t MAX_TICKS = (std::uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+
+	/// A timer that can be scheduled on a wheel. A timer is cancelled when it is destroyed, so owning the timer is
+	/// enough to make sure that its callback is not invoked after the owner is gone.
+	class Timer {
+	public:
+		Timer() = default;
+		~Timer() { cancel(); }
+
+		Timer(const Timer &) = delete;
+		Timer &operator=(const Timer &) = delete;
+
+		/// Removes the timer from its wheel without invoking the callback. Does nothing if it isn't scheduled.
+		void cancel();
+		bool isScheduled() const { return m_wheel != nullptr; }
+
+	private:
+		friend class TimingWheel;
+
+		TimingWheel *m_wheel = nullptr;
+		/// The timers of a slot form an intrusive doubly linked list. m_previous points to the pointer that points to
+		/// this timer, which is either the head of the list or the m_next member of the previous timer.
+		Timer **m_previous     = nullptr;
+		Timer *m_next          = nullptr;
+		std::uint64_t m_expiry = 0;
+		std::function< void() > m_callback;
+	};
+
+	/// @param tick The resolution of the wheel. Timers never expire early, but up to one tick late.
+	/// @param start The point in time of the first tick
+	explicit TimingWheel(std::chrono::milliseconds tick, Clock::time_point start = Clock::now());
+	/// Unschedules all timers that are still scheduled
+	~TimingWheel();
+
+	TimingWheel(const TimingWheel &) = delete;
+	TimingWheel &operator=(const TimingWheel &) = delete;
+
+	/// (Re)schedules the given timer to invoke the given callback after the given delay. The callback is invoked by
+	/// advance() and may schedule or cancel any timer, including the one it belongs to.
+	void schedule(Timer &timer, std::chrono::milliseconds delay, std::function< void() > callback);
+
+	/// Invokes the callbacks of all timers that expire up to the given point in time
+	void advance(Clock::time_point now);
+
+	std::chrono::milliseconds tick() const { return m_tick; }
+	/// @returns The number of scheduled timers
+	std::size_t size() const { return m_size; }
+
+private:
+	void insert(Timer &timer);
+	void unlink(Timer &timer);
+	/// Redistributes the timers of the current slot of the given level into the levels below
+	void cascade(unsigned int level);
+
+	std::chrono::milliseconds m_tick;
+	Clock::time_point m_start;
+	/// The next tick to be processed
+	std::uint64_t m_currentTick                                = 0;
+	std::size_t m_size                                         = 0;
+	std::array< std::array< Timer *, SLOTS >, LEVELS > m_slots = {};
+};
+
+#endif // MUMBLE_MURMUR_TIMINGWHEEL_H_
@@ -12,14 +12,19 @@ static constexpr const char *TCP_PACKET_PROCESSING_ZONE = "tcp_packet_processing
 static constexpr const char *PING_PROCESSING_ZONE       = "tcp_ping";
 static constexpr const char *UDP_PING_PROCESSING_ZONE   = "udp_ping";
 static constexpr const char *DECRYPT_UNKNOWN_PEER_ZONE  = "decrypt_unknown_peer";
+static constexpr const char *UDP_PEER_LOOKUP_ZONE       = "udp_peer_lookup";
 
 static constexpr const char *UDP_FRAME = "udp_frame";
 
 static constexpr const char *AUDIO_SENDOUT_ZONE         = "audio_send_out";
 static constexpr const char *AUDIO_ENCODE               = "audio_encode";
 static constexpr const char *AUDIO_UPDATE               = "audio_update";
-static constexpr const char *AUDIO_WHISPER_CACHE_STORE  = "audio_whisper_cache_restore";
-static constexpr const char *AUDIO_WHISPER_CACHE_CREATE = "audio_whisper_cache_create";
+static constexpr const char *AUDIO_WHISPER_ROUTING_ZONE = "audio_whisper_routing";
+static constexpr const char *VOICE_ROUTING_BUILD_ZONE   = "voice_routing_build";
+static constexpr const char *VOICE_ROUTING_RECLAIM_ZONE = "voice_routing_reclaim";
+static constexpr const char *VOICE_ROUTING_WHISPER_ZONE = "voice_routing_whisper";
+
+static constexpr const char *AUDIO_FREQUENCY_ROUTING_ZONE = "audio_frequency_routing";
 }; // namespace TracyConstants
 
 #endif // MUMBLE_MURMUR_TRACYCONSTANTS_H_
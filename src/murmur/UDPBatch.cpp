@@ -0,0 +1,222 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "UDPBatch.h"
+
+#include "HostAddress.h"
+#include "ServerUser.h"
+#include "Utils.h"
+
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+/// The size of the control data buffer of a received datagram (large enough for either kind of packet info)
+static constexpr std::size_t RECEIVE_CONTROL_DATA_SIZE =
+	CMSG_SPACE(sizeof(struct in6_pktinfo) > sizeof(struct in_pktinfo) ? sizeof(struct in6_pktinfo)
+																	  : sizeof(struct in_pktinfo));
+#endif
+
+UDPReceiveBatch::UDPReceiveBatch() : m_buffers(CAPACITY), m_addresses(CAPACITY), m_lengths(CAPACITY, 0) {
+#ifdef Q_OS_LINUX
+	m_controlData.resize(CAPACITY * RECEIVE_CONTROL_DATA_SIZE);
+	m_iovecs.resize(CAPACITY);
+	m_headers.resize(CAPACITY);
+	memset(m_headers.data(), 0, m_headers.size() * sizeof(struct mmsghdr));
+
+	for (std::size_t i = 0; i < CAPACITY; ++i) {
+		m_iovecs[i].iov_base = m_buffers[i].data();
+		m_iovecs[i].iov_len  = Mumble::Protocol::MAX_UDP_PACKET_SIZE;
+
+		m_headers[i].msg_hdr.msg_name   = &m_addresses[i];
+		m_headers[i].msg_hdr.msg_iov    = &m_iovecs[i];
+		m_headers[i].msg_hdr.msg_iovlen = 1;
+	}
+#endif
+}
+
+#ifdef Q_OS_UNIX
+int UDPReceiveBatch::receive(int socket) {
+#else
+int UDPReceiveBatch::receive(SOCKET socket) {
+#endif
+#ifdef Q_OS_LINUX
+	for (std::size_t i = 0; i < CAPACITY; ++i) {
+		// These are overwritten by the kernel on every call
+		m_headers[i].msg_hdr.msg_namelen    = sizeof(sockaddr_storage);
+		m_headers[i].msg_hdr.msg_control    = &m_controlData[i * RECEIVE_CONTROL_DATA_SIZE];
+		m_headers[i].msg_hdr.msg_controllen = RECEIVE_CONTROL_DATA_SIZE;
+	}
+
+	// MSG_TRUNC makes the kernel report the real size of truncated datagrams
+	const int count = ::recvmmsg(socket, m_headers.data(), CAPACITY, MSG_DONTWAIT | MSG_TRUNC, nullptr);
+	if (count < 0) {
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : SOCKET_ERROR;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		m_lengths[i] = static_cast< qint32 >(m_headers[i].msg_len);
+	}
+
+	return count;
+#else
+#	ifdef Q_OS_WIN
+	m_addressLength = sizeof(sockaddr_storage);
+	m_lengths[0]    = ::recvfrom(socket, reinterpret_cast< char * >(m_buffers[0].data()),
+								 Mumble::Protocol::MAX_UDP_PACKET_SIZE, 0,
+								 reinterpret_cast< struct sockaddr * >(&m_addresses[0]), &m_addressLength);
+#	else
+	socklen_t addressLength = sizeof(sockaddr_storage);
+	m_lengths[0] = static_cast< qint32 >(::recvfrom(socket, m_buffers[0].data(), Mumble::Protocol::MAX_UDP_PACKET_SIZE,
+													MSG_TRUNC, reinterpret_cast< struct sockaddr * >(&m_addresses[0]),
+													&addressLength));
+	m_addressLength = static_cast< int >(addressLength);
+#	endif
+
+	if (m_lengths[0] == SOCKET_ERROR) {
+		return SOCKET_ERROR;
+	}
+
+	return m_lengths[0] == 0 ? 0 : 1;
+#endif
+}
+
+unsigned char *UDPReceiveBatch::data(std::size_t index) {
+	return m_buffers[index].data();
+}
+
+qint32 UDPReceiveBatch::length(std::size_t index) const {
+	return m_lengths[index];
+}
+
+const sockaddr_storage &UDPReceiveBatch::address(std::size_t index) const {
+	return m_addresses[index];
+}
+
+#ifdef Q_OS_UNIX
+void UDPReceiveBatch::reply(std::size_t index, int socket, const unsigned char *data, std::size_t length) {
+#else
+void UDPReceiveBatch::reply(std::size_t index, SOCKET socket, const unsigned char *data, std::size_t length) {
+#endif
+#ifdef Q_OS_LINUX
+	// Reuse the received header: its control data contains the local address the datagram was sent to, which makes
+	// the reply originate from that very address.
+	struct msghdr msg = m_headers[index].msg_hdr;
+	struct iovec iov;
+
+	// We are only reading from the buffer and thus the const_cast should be fine
+	iov.iov_base   = const_cast< unsigned char * >(data);
+	iov.iov_len    = length;
+	msg.msg_iov    = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_flags  = 0;
+
+	::sendmsg(socket, &msg, 0);
+#else
+	::sendto(socket, reinterpret_cast< const char * >(data), static_cast< int >(length), 0,
+			 reinterpret_cast< const struct sockaddr * >(&m_addresses[index]), m_addressLength);
+#endif
+}
+
+
+UDPSendBatch::UDPSendBatch() {
+#ifdef Q_OS_LINUX
+	m_buffers.resize(CAPACITY);
+	m_sockets.resize(CAPACITY, INVALID_SOCKET);
+	m_addresses.resize(CAPACITY);
+	m_controlData.resize(CAPACITY * CONTROL_DATA_SIZE);
+	m_iovecs.resize(CAPACITY);
+	m_headers.resize(CAPACITY);
+#endif
+}
+
+#ifdef Q_OS_LINUX
+unsigned char *UDPSendBatch::nextBuffer() {
+	return m_buffers[m_size].data();
+}
+
+void UDPSendBatch::push(const ServerUser &receiver, std::size_t length) {
+	// The receiver might be gone by the time the batch is flushed, so take a copy of its address
+	m_sockets[m_size] = receiver.sUdpSocket;
+	memcpy(&m_addresses[m_size], &receiver.saiUdpAddress, sizeof(sockaddr_storage));
+
+	struct msghdr &msg = m_headers[m_size].msg_hdr;
+	if (!prepareHeader(msg, m_iovecs[m_size], &m_controlData[m_size * CONTROL_DATA_SIZE], receiver,
+					   m_buffers[m_size].data(), length)) {
+		return;
+	}
+	msg.msg_name = &m_addresses[m_size];
+
+	if (++m_size == CAPACITY) {
+		flush();
+	}
+}
+
+bool UDPSendBatch::prepareHeader(struct msghdr &msg, struct iovec &iov, unsigned char *controlData,
+								 const ServerUser &receiver, unsigned char *buffer, std::size_t length) {
+	iov.iov_base = buffer;
+	iov.iov_len  = length;
+
+	memset(controlData, 0, CONTROL_DATA_SIZE);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name    = const_cast< sockaddr_storage * >(&receiver.saiUdpAddress);
+	msg.msg_namelen = static_cast< socklen_t >(
+		(receiver.saiUdpAddress.ss_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+	msg.msg_iov        = &iov;
+	msg.msg_iovlen     = 1;
+	msg.msg_control    = controlData;
+	msg.msg_controllen = CMSG_SPACE((receiver.saiUdpAddress.ss_family == AF_INET6) ? sizeof(struct in6_pktinfo)
+																				   : sizeof(struct in_pktinfo));
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	HostAddress tcpha(receiver.saiTcpLocalAddress);
+	if (receiver.saiUdpAddress.ss_family == AF_INET6) {
+		cmsg->cmsg_level            = IPPROTO_IPV6;
+		cmsg->cmsg_type             = IPV6_PKTINFO;
+		cmsg->cmsg_len              = CMSG_LEN(sizeof(struct in6_pktinfo));
+		struct in6_pktinfo *pktinfo = reinterpret_cast< struct in6_pktinfo * >(CMSG_DATA(cmsg));
+		memset(pktinfo, 0, sizeof(*pktinfo));
+		memcpy(&pktinfo->ipi6_addr.s6_addr[0], &tcpha.qip6.c[0], sizeof(pktinfo->ipi6_addr.s6_addr));
+	} else {
+		cmsg->cmsg_level           = IPPROTO_IP;
+		cmsg->cmsg_type            = IP_PKTINFO;
+		cmsg->cmsg_len             = CMSG_LEN(sizeof(struct in_pktinfo));
+		struct in_pktinfo *pktinfo = reinterpret_cast< struct in_pktinfo * >(CMSG_DATA(cmsg));
+		memset(pktinfo, 0, sizeof(*pktinfo));
+		if (tcpha.isV6())
+			return false;
+		pktinfo->ipi_spec_dst.s_addr = tcpha.hash[3];
+	}
+
+	return true;
+}
+#endif
+
+void UDPSendBatch::flush() {
+#ifdef Q_OS_LINUX
+	// sendmmsg only works on a single socket, so send each run of datagrams sharing the same socket at once
+	std::size_t begin = 0;
+	while (begin < m_size) {
+		std::size_t end = begin + 1;
+		while (end < m_size && m_sockets[end] == m_sockets[begin]) {
+			++end;
+		}
+
+		while (begin < end) {
+			const int sent =
+				::sendmmsg(m_sockets[begin], &m_headers[begin], static_cast< unsigned int >(end - begin), 0);
+
+			// Just like a failed sendmsg, a datagram that can't be sent is dropped
+			begin += sent > 0 ? static_cast< std::size_t >(sent) : 1;
+		}
+	}
+#endif
+
+	m_size = 0;
+}
+
+std::size_t UDPSendBatch::size() const {
+	return m_size;
+}
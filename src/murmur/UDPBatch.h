@@ -0,0 +1,135 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_UDPBATCH_H_
+#define MUMBLE_MURMUR_UDPBATCH_H_
+
+#include <QtCore/QtGlobal>
+
+#ifdef Q_OS_WIN
+#	include "win.h"
+#endif
+
+#include "MumbleProtocol.h"
+
+#ifdef Q_OS_WIN
+#	include <winsock2.h>
+#else
+#	include <netinet/in.h>
+#	include <sys/socket.h>
+#endif
+
+#include <cstddef>
+#include <vector>
+
+class ServerUser;
+
+/// Storage for a single (encrypted) datagram. The datagram starts with the 4 byte crypt header, so it is placed such
+/// that the encrypted payload following the header is 8 byte aligned.
+struct UDPDatagramBuffer {
+	alignas(8) unsigned char storage[Mumble::Protocol::MAX_UDP_PACKET_SIZE + 8];
+
+	unsigned char *data() { return storage + 4; }
+};
+
+/// Receives multiple datagrams with a single system call (recvmmsg) on Linux. On other platforms a batch only ever
+/// holds a single datagram.
+class UDPReceiveBatch {
+public:
+#ifdef Q_OS_LINUX
+	static constexpr std::size_t CAPACITY = 32;
+#else
+	static constexpr std::size_t CAPACITY = 1;
+#endif
+
+	UDPReceiveBatch();
+
+	/// Reads up to CAPACITY datagrams that are pending on the given socket (without blocking).
+	///
+	/// @returns The number of datagrams read, 0 if there was none or SOCKET_ERROR on error
+#ifdef Q_OS_UNIX
+	int receive(int socket);
+#else
+	int receive(SOCKET socket);
+#endif
+
+	/// @returns The encrypted datagram at the given index
+	unsigned char *data(std::size_t index);
+	/// @returns The size of the datagram at the given index. This may exceed Mumble::Protocol::MAX_UDP_PACKET_SIZE
+	/// 	if the datagram was truncated.
+	qint32 length(std::size_t index) const;
+	/// @returns The address the datagram at the given index was sent from
+	const sockaddr_storage &address(std::size_t index) const;
+
+	/// Sends the given data back to the sender of the datagram at the given index, using the local address the datagram
+	/// was received on.
+#ifdef Q_OS_UNIX
+	void reply(std::size_t index, int socket, const unsigned char *data, std::size_t length);
+#else
+	void reply(std::size_t index, SOCKET socket, const unsigned char *data, std::size_t length);
+#endif
+
+protected:
+	std::vector< UDPDatagramBuffer > m_buffers;
+	std::vector< sockaddr_storage > m_addresses;
+	std::vector< qint32 > m_lengths;
+#ifdef Q_OS_LINUX
+	std::vector< unsigned char > m_controlData;
+	std::vector< struct iovec > m_iovecs;
+	std::vector< struct mmsghdr > m_headers;
+#else
+	int m_addressLength = 0;
+#endif
+};
+
+/// Collects encrypted datagrams and sends them with as few system calls as possible (sendmmsg on Linux).
+///
+/// On other platforms Server::sendMessage sends every datagram right away and the batch always stays empty.
+class UDPSendBatch {
+public:
+	static constexpr std::size_t CAPACITY = 64;
+
+	UDPSendBatch();
+
+#ifdef Q_OS_LINUX
+	/// @returns The buffer the next datagram has to be written to. It can hold
+	/// 	Mumble::Protocol::MAX_UDP_PACKET_SIZE + 4 bytes.
+	unsigned char *nextBuffer();
+	/// Queues the datagram that has been written to nextBuffer() for being sent to the given user. If the batch is
+	/// full afterwards, it is flushed.
+	void push(const ServerUser &receiver, std::size_t length);
+
+	/// Sets up the given header for sending the given buffer to the given user. The datagram is sent from the local
+	/// address the user's TCP connection uses.
+	///
+	/// @param controlData A buffer of at least CONTROL_DATA_SIZE bytes
+	/// @returns Whether the datagram can be sent to the user
+	static bool prepareHeader(struct msghdr &msg, struct iovec &iov, unsigned char *controlData,
+							  const ServerUser &receiver, unsigned char *buffer, std::size_t length);
+
+	static constexpr std::size_t CONTROL_DATA_SIZE =
+		CMSG_SPACE(sizeof(struct in6_pktinfo) > sizeof(struct in_pktinfo) ? sizeof(struct in6_pktinfo)
+																		  : sizeof(struct in_pktinfo));
+#endif
+
+	/// Sends all queued datagrams
+	void flush();
+
+	/// @returns The number of queued datagrams
+	std::size_t size() const;
+
+protected:
+	std::size_t m_size = 0;
+#ifdef Q_OS_LINUX
+	std::vector< UDPDatagramBuffer > m_buffers;
+	std::vector< int > m_sockets;
+	std::vector< sockaddr_storage > m_addresses;
+	std::vector< unsigned char > m_controlData;
+	std::vector< struct iovec > m_iovecs;
+	std::vector< struct mmsghdr > m_headers;
+#endif
+};
+
+#endif // MUMBLE_MURMUR_UDPBATCH_H_
@@ -0,0 +1,15 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "UDPWorker.h"
+
+#include "Server.h"
+
+UDPWorker::UDPWorker(Server &server, std::size_t index) : QThread(&server), m_server(server), m_index(index) {
+}
+
+void UDPWorker::run() {
+	m_server.processUDP(*this);
+}
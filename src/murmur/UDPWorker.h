@@ -0,0 +1,80 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_UDPWORKER_H_
+#define MUMBLE_MURMUR_UDPWORKER_H_
+
+#include <QtCore/QtGlobal>
+
+#ifdef Q_OS_WIN
+#	include "win.h"
+#endif
+
+#include "AudioReceiverBuffer.h"
+#include "HostAddress.h"
+#include "MumbleProtocol.h"
+#include "UDPBatch.h"
+#include "VoiceStatistics.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QThread>
+
+#ifdef Q_OS_WIN
+#	include <winsock2.h>
+#endif
+
+#include <cstddef>
+
+class Server;
+class ServerUser;
+
+/// A voice thread: receives UDP packets on its own set of sockets (one per address the server is bound to) and
+/// forwards the contained audio.
+///
+/// If a server uses multiple workers, each worker binds its own sockets using SO_REUSEPORT and the kernel distributes
+/// the incoming datagrams among them. As datagrams from a given peer (source address and port) always end up on the
+/// same socket, each worker serves its own shard of peers and keeps its own peer table. Everything a worker needs for
+/// processing a packet is either owned by the worker or taken from the server's voice routing snapshot, so the workers
+/// don't contend with each other (except for the per-user crypt state of a common receiver).
+class UDPWorker : public QThread {
+private:
+	Q_OBJECT;
+	Q_DISABLE_COPY(UDPWorker);
+
+protected:
+	Server &m_server;
+
+	void run() Q_DECL_OVERRIDE;
+
+public:
+	UDPWorker(Server &server, std::size_t index);
+
+	/// The index of this worker. It is also the worker's reader slot in the server's VoiceRoutingPublisher.
+	const std::size_t m_index;
+
+#ifdef Q_OS_UNIX
+	QList< int > m_sockets;
+#else
+	QList< SOCKET > m_sockets;
+#endif
+
+	/// The peers this worker has associated with a user. Written by the worker when it learns a peer and by the main
+	/// thread when a user disconnects. Guarded by m_peerLock, which is therefore hardly ever contended.
+	QHash< QPair< HostAddress, quint16 >, ServerUser * > m_peerUsers;
+	QReadWriteLock m_peerLock;
+
+	Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > m_udpDecoder;
+	Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > m_udpPingEncoder;
+	Mumble::Protocol::UDPServerAudioEncoder m_udpAudioEncoder;
+	AudioReceiverBuffer m_udpAudioReceivers;
+	UDPReceiveBatch m_receiveBatch;
+	UDPSendBatch m_sendBatch;
+	VoiceStatistics m_statistics;
+};
+
+#endif // MUMBLE_MURMUR_UDPWORKER_H_
@@ -0,0 +1,124 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "VoiceRouting.h"
+
+#include <algorithm>
+#include <cassert>
+
+VoiceRoutingSnapshot::WhisperRoutes::~WhisperRoutes() {
+	delete routes.load();
+}
+
+const VoiceRoutingSnapshot::User *VoiceRoutingSnapshot::findUser(const ServerUser *user, unsigned int session) const {
+	auto it = users.find(session);
+
+	// Session IDs get reused, so make sure that the entry actually belongs to the given user
+	if (it == users.end() || it->second.user != user) {
+		return nullptr;
+	}
+
+	return &it->second;
+}
+
+const std::vector< VoiceRoute > &VoiceRoutingSnapshot::channelRoutes(unsigned int channelID) const {
+	static const std::vector< VoiceRoute > noRoutes;
+
+	auto it = channels.find(channelID);
+
+	return it == channels.end() ? noRoutes : *it->second;
+}
+
+const std::vector< VoiceRoute > &VoiceRoutingSnapshot::frequencyRoutes(unsigned int frequency) const {
+	static const std::vector< VoiceRoute > noRoutes;
+
+	auto it = frequencies.find(frequency);
+
+	return it == frequencies.end() ? noRoutes : *it->second;
+}
+
+
+VoiceRoutingPublisher::VoiceRoutingPublisher() : m_snapshot(new VoiceRoutingSnapshot()) {
+}
+
+VoiceRoutingPublisher::~VoiceRoutingPublisher() {
+	for (Retired &current : m_retired) {
+		current.deleter();
+	}
+
+	delete m_snapshot.load();
+}
+
+void VoiceRoutingPublisher::publish(std::unique_ptr< VoiceRoutingSnapshot > snapshot) {
+	// Readers that announce the new epoch are guaranteed to see the new snapshot, because the snapshot is stored
+	// before the epoch is incremented (all operations are sequentially consistent).
+	const VoiceRoutingSnapshot *previous = m_snapshot.exchange(snapshot.release());
+	const std::uint64_t epoch            = m_epoch.fetch_add(1) + 1;
+
+	m_retired.push_back({ epoch, [previous]() { delete previous; } });
+
+	reclaim();
+}
+
+const VoiceRoutingSnapshot &VoiceRoutingPublisher::current() const {
+	return *m_snapshot.load(std::memory_order_relaxed);
+}
+
+void VoiceRoutingPublisher::retire(std::function< void() > deleter) {
+	m_retired.push_back({ m_epoch.load() + 1, std::move(deleter) });
+}
+
+bool VoiceRoutingPublisher::reclaim() {
+	// An object retired for epoch e can be freed once epoch e has been published and every reader is either idle or
+	// has entered its current section in epoch e or later.
+	std::uint64_t safeEpoch = m_epoch.load();
+	for (const ReaderSlot &slot : m_readers) {
+		safeEpoch = std::min(safeEpoch, slot.epoch.load());
+	}
+
+	auto freeable = std::stable_partition(m_retired.begin(), m_retired.end(),
+										  [safeEpoch](const Retired &current) { return current.epoch > safeEpoch; });
+
+	// Move the deleters out first as they might retire further objects
+	std::vector< Retired > toFree(std::make_move_iterator(freeable), std::make_move_iterator(m_retired.end()));
+	m_retired.erase(freeable, m_retired.end());
+
+	for (Retired &current : toFree) {
+		current.deleter();
+	}
+
+	return !m_retired.empty();
+}
+
+bool VoiceRoutingPublisher::hasRetired() const {
+	return !m_retired.empty();
+}
+
+const VoiceRoutingSnapshot &VoiceRoutingPublisher::enter(std::size_t reader) {
+	assert(reader < MAX_READERS);
+
+	m_readers[reader].epoch.store(m_epoch.load());
+
+	return *m_snapshot.load();
+}
+
+void VoiceRoutingPublisher::leave(std::size_t reader) {
+	assert(reader < MAX_READERS);
+
+	m_readers[reader].epoch.store(IDLE, std::memory_order_release);
+}
+
+
+VoiceRoutingPublisher::ReadGuard::ReadGuard(VoiceRoutingPublisher &publisher, std::size_t reader)
+	: m_publisher(publisher), m_reader(reader), m_snapshot(publisher.enter(reader)) {
+}
+
+VoiceRoutingPublisher::ReadGuard::~ReadGuard() {
+	m_publisher.leave(m_reader);
+}
+
+const VoiceRoutingSnapshot &VoiceRoutingPublisher::ReadGuard::snapshot() const {
+	return m_snapshot;
+}
@@ -0,0 +1,177 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_VOICEROUTING_H_
+#define MUMBLE_MURMUR_VOICEROUTING_H_
+
+#include "MumbleProtocol.h"
+#include "VolumeAdjustment.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ServerUser;
+
+/// A single receiver of an audio packet
+struct VoiceRoute {
+	ServerUser *receiver;
+	Mumble::Protocol::audio_context_t context;
+	VolumeAdjustment volumeAdjustment;
+	/// The interned positional audio context of the receiver (see VoiceRoutingSnapshot::User::positionalContext)
+	unsigned int positionalContext;
+};
+
+/// An immutable view of everything the voice thread needs in order to route audio: the users that may speak, the
+/// receivers of every channel (members and listeners), the channels a user's regular speech reaches (its own channel
+/// and the linked ones it may speak in), the whisper targets and the radio frequencies.
+///
+/// Snapshots are built by the main thread from the data it owns and are never modified once published, except for the
+/// receivers of whisper targets: as resolving them is expensive and most of them are not used before the snapshot is
+/// replaced, the main thread only resolves them when they are first used. All receivers that are deaf are already
+/// filtered out.
+struct VoiceRoutingSnapshot {
+	/// Route lists are shared with the snapshots built after this one, as long as they don't change
+	using Routes = std::shared_ptr< const std::vector< VoiceRoute > >;
+
+	/// The receivers of a whisper target
+	struct WhisperRoutes {
+		WhisperRoutes() = default;
+		/// Copies start out unresolved, as the receivers are only valid for the snapshot they have been resolved for
+		WhisperRoutes(const WhisperRoutes &) {}
+		~WhisperRoutes();
+
+		WhisperRoutes &operator=(const WhisperRoutes &) = delete;
+
+		/// Set by the main thread once the target has been resolved (nullptr until then)
+		mutable std::atomic< const std::vector< VoiceRoute > * > routes{ nullptr };
+	};
+
+	struct User {
+		ServerUser *user;
+		/// The user's positional audio context, interned into an integer. Positional data is only forwarded to
+		/// receivers sharing the same context.
+		unsigned int positionalContext;
+		/// Whether any of the user's radios is tuned (if so, regular speech is routed by frequency)
+		bool radioTuned;
+		/// The frequency the user transmits on or 0 if the transmitting radio is not tuned or the user lacks the Speak
+		/// permission in the radio channel
+		unsigned int transmitFrequency;
+		/// The channels whose receivers get the user's regular speech
+		std::vector< unsigned int > speechChannels;
+		/// The receivers of each of the user's whisper targets
+		std::unordered_map< int, WhisperRoutes > whisperTargets;
+	};
+
+	/// A monotonically increasing number identifying this snapshot
+	std::uint64_t generation = 0;
+
+	/// All users that may speak (authenticated and neither muted, suppressed nor self-muted)
+	std::unordered_map< unsigned int, User > users;
+	std::unordered_map< unsigned int, Routes > channels;
+	std::unordered_map< unsigned int, Routes > frequencies;
+	/// The frequencies whose transmissions are mixed on the server instead of being forwarded (see FrequencyMixer)
+	std::unordered_set< unsigned int > mixedFrequencies;
+
+	// Server configuration that is read by the voice thread
+	int maxBandwidth = 0;
+	int maxUsers     = 0;
+	int userCount    = 0;
+	bool allowPing   = false;
+	bool opus        = false;
+
+	/// @returns The routing entry of the given user (with the given session) or nullptr if the user can't send audio
+	/// 	(because it is not authenticated (yet) or muted)
+	const User *findUser(const ServerUser *user, unsigned int session) const;
+	/// @returns The receivers of the given channel
+	const std::vector< VoiceRoute > &channelRoutes(unsigned int channelID) const;
+	/// @returns The receivers of the given frequency
+	const std::vector< VoiceRoute > &frequencyRoutes(unsigned int frequency) const;
+};
+
+/// Publishes VoiceRoutingSnapshots from the main thread to the threads processing UDP packets (the readers).
+///
+/// Readers never block: entering a read section announces the current epoch in the reader's slot and loads the
+/// current snapshot. The main thread retires replaced snapshots (and any other object the readers may still reference,
+/// such as disconnected users) and only frees them once every reader has left the section it might have used them in.
+///
+/// All methods except enter() and leave() must only be called from the main thread.
+class VoiceRoutingPublisher {
+public:
+	static constexpr std::size_t MAX_READERS = 32;
+
+	VoiceRoutingPublisher();
+	/// Frees the current snapshot and everything that is retired. Readers must have stopped at this point.
+	~VoiceRoutingPublisher();
+
+	VoiceRoutingPublisher(const VoiceRoutingPublisher &) = delete;
+	VoiceRoutingPublisher &operator=(const VoiceRoutingPublisher &) = delete;
+
+	/// Atomically replaces the current snapshot. The previous one is retired.
+	void publish(std::unique_ptr< VoiceRoutingSnapshot > snapshot);
+	/// @returns The current snapshot. Only valid on the main thread (which is the only one freeing snapshots).
+	const VoiceRoutingSnapshot &current() const;
+	/// Defers the given deleter until no reader can reference the object anymore. This requires the object to no
+	/// longer be reachable from the snapshot published next.
+	void retire(std::function< void() > deleter);
+	/// Runs the deleters of all retired objects that are no longer in use.
+	///
+	/// @returns Whether there are retired objects left that could not be freed yet
+	bool reclaim();
+	/// @returns Whether there are retired objects that have not been freed yet
+	bool hasRetired() const;
+
+	/// Enters a read section for the given reader slot.
+	///
+	/// @returns The snapshot to use until leave() is called
+	const VoiceRoutingSnapshot &enter(std::size_t reader);
+	/// Leaves the read section of the given reader slot. Any snapshot (or object reached through it) obtained during
+	/// the section must not be used anymore afterwards.
+	void leave(std::size_t reader);
+
+	/// RAII helper for read sections
+	class ReadGuard {
+	public:
+		ReadGuard(VoiceRoutingPublisher &publisher, std::size_t reader);
+		~ReadGuard();
+
+		ReadGuard(const ReadGuard &) = delete;
+		ReadGuard &operator=(const ReadGuard &) = delete;
+
+		const VoiceRoutingSnapshot &snapshot() const;
+
+	protected:
+		VoiceRoutingPublisher &m_publisher;
+		std::size_t m_reader;
+		const VoiceRoutingSnapshot &m_snapshot;
+	};
+
+protected:
+	static constexpr std::uint64_t IDLE = std::numeric_limits< std::uint64_t >::max();
+
+	// Keep each slot on its own cache line in order to avoid false sharing between readers
+	struct alignas(64) ReaderSlot {
+		std::atomic< std::uint64_t > epoch{ IDLE };
+	};
+
+	struct Retired {
+		/// The first epoch in which the object is guaranteed to be unreachable
+		std::uint64_t epoch;
+		std::function< void() > deleter;
+	};
+
+	std::atomic< const VoiceRoutingSnapshot * > m_snapshot;
+	std::atomic< std::uint64_t > m_epoch{ 0 };
+	std::array< ReaderSlot, MAX_READERS > m_readers;
+	std::vector< Retired > m_retired;
+};
+
+#endif // MUMBLE_MURMUR_VOICEROUTING_H_
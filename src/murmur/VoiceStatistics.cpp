@@ -0,0 +1,195 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "VoiceStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// @returns The index of the highest set bit of the given (non-zero) value
+static unsigned int highestBit(std::uint64_t value) {
+	unsigned int bit = 0;
+	while (value >>= 1) {
+		bit++;
+	}
+
+	return bit;
+}
+
+std::size_t VoiceHistogram::bucketOf(std::uint64_t value) {
+	if (value < SUB_BUCKETS) {
+		return static_cast< std::size_t >(value);
+	}
+
+	// The highest bit selects the power of two, the following SUB_BUCKET_BITS bits the bucket within it
+	const unsigned int magnitude = highestBit(value);
+	const std::uint64_t sub      = (value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+
+	return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast< std::size_t >(sub);
+}
+
+std::uint64_t VoiceHistogram::upperBoundOf(std::size_t bucket) {
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+
+	const unsigned int magnitude = static_cast< unsigned int >(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+	const std::uint64_t sub      = bucket % SUB_BUCKETS;
+	const unsigned int shift     = magnitude - SUB_BUCKET_BITS;
+
+	const std::uint64_t lowerBound = (std::uint64_t(1) << magnitude) | (sub << shift);
+
+	return lowerBound + ((std::uint64_t(1) << shift) - 1);
+}
+
+void VoiceHistogram::record(std::uint64_t value, std::uint64_t times) {
+	// Only the owning thread writes, so there is no need for atomic read-modify-write operations
+	std::atomic< std::uint64_t > &count = m_counts[bucketOf(value)];
+	count.store(count.load(std::memory_order_relaxed) + times, std::memory_order_relaxed);
+	m_sum.store(m_sum.load(std::memory_order_relaxed) + value * times, std::memory_order_relaxed);
+}
+
+VoiceHistogram::Snapshot VoiceHistogram::snapshot() const {
+	Snapshot snapshot;
+
+	for (std::size_t i = 0; i < BUCKETS; ++i) {
+		snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+		snapshot.count += snapshot.counts[i];
+	}
+	snapshot.sum = m_sum.load(std::memory_order_relaxed);
+
+	return snapshot;
+}
+
+void VoiceHistogram::Snapshot::merge(const Snapshot &other) {
+	for (std::size_t i = 0; i < BUCKETS; ++i) {
+		counts[i] += other.counts[i];
+	}
+	count += other.count;
+	sum += other.sum;
+}
+
+VoiceHistogram::Snapshot VoiceHistogram::Snapshot::since(const Snapshot &earlier) const {
+	Snapshot difference;
+
+	for (std::size_t i = 0; i < BUCKETS; ++i) {
+		difference.counts[i] = counts[i] - earlier.counts[i];
+	}
+	difference.count = count - earlier.count;
+	difference.sum   = sum - earlier.sum;
+
+	return difference;
+}
+
+std::uint64_t VoiceHistogram::Snapshot::quantile(double fraction) const {
+	if (count == 0) {
+		return 0;
+	}
+
+	const std::uint64_t rank =
+		std::max< std::uint64_t >(1, static_cast< std::uint64_t >(std::ceil(fraction * static_cast< double >(count))));
+
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < BUCKETS; ++i) {
+		seen += counts[i];
+
+		if (seen >= rank) {
+			return upperBoundOf(i);
+		}
+	}
+
+	return max();
+}
+
+std::uint64_t VoiceHistogram::Snapshot::max() const {
+	for (std::size_t i = BUCKETS; i > 0; --i) {
+		if (counts[i - 1] > 0) {
+			return upperBoundOf(i - 1);
+		}
+	}
+
+	return 0;
+}
+
+std::uint64_t VoiceHistogram::Snapshot::mean() const {
+	return count > 0 ? sum / count : 0;
+}
+
+VoiceStatistics::Snapshot VoiceStatistics::snapshot() const {
+	Snapshot snapshot;
+
+	snapshot.packetsReceived  = m_packetsReceived.load(std::memory_order_relaxed);
+	snapshot.audioPackets     = m_audioPackets.load(std::memory_order_relaxed);
+	snapshot.bandwidthDrops   = m_bandwidthDrops.load(std::memory_order_relaxed);
+	snapshot.decryptFailures  = m_decryptFailures.load(std::memory_order_relaxed);
+	snapshot.tcpFallbackSends = m_tcpFallbackSends.load(std::memory_order_relaxed);
+	snapshot.tunnelDrops      = m_tunnelDrops.load(std::memory_order_relaxed);
+
+	snapshot.latency = latency.snapshot();
+	snapshot.decrypt = decrypt.snapshot();
+	snapshot.route   = route.snapshot();
+	snapshot.send    = send.snapshot();
+	snapshot.fanOut  = fanOut.snapshot();
+
+	return snapshot;
+}
+
+void VoiceStatistics::Snapshot::merge(const Snapshot &other) {
+	packetsReceived += other.packetsReceived;
+	audioPackets += other.audioPackets;
+	bandwidthDrops += other.bandwidthDrops;
+	decryptFailures += other.decryptFailures;
+	tcpFallbackSends += other.tcpFallbackSends;
+	tunnelDrops += other.tunnelDrops;
+
+	latency.merge(other.latency);
+	decrypt.merge(other.decrypt);
+	route.merge(other.route);
+	send.merge(other.send);
+	fanOut.merge(other.fanOut);
+}
+
+VoiceStatistics::Snapshot VoiceStatistics::Snapshot::since(const Snapshot &earlier) const {
+	Snapshot difference;
+
+	difference.packetsReceived  = packetsReceived - earlier.packetsReceived;
+	difference.audioPackets     = audioPackets - earlier.audioPackets;
+	difference.bandwidthDrops   = bandwidthDrops - earlier.bandwidthDrops;
+	difference.decryptFailures  = decryptFailures - earlier.decryptFailures;
+	difference.tcpFallbackSends = tcpFallbackSends - earlier.tcpFallbackSends;
+	difference.tunnelDrops      = tunnelDrops - earlier.tunnelDrops;
+
+	difference.latency = latency.since(earlier.latency);
+	difference.decrypt = decrypt.since(earlier.decrypt);
+	difference.route   = route.since(earlier.route);
+	difference.send    = send.since(earlier.send);
+	difference.fanOut  = fanOut.since(earlier.fanOut);
+
+	return difference;
+}
+
+std::vector< std::pair< const char *, std::uint64_t > > VoiceStatistics::Snapshot::entries() const {
+	std::vector< std::pair< const char *, std::uint64_t > > entries = {
+		{ "packetsReceived", packetsReceived },   { "audioPackets", audioPackets },
+		{ "bandwidthDrops", bandwidthDrops },     { "decryptFailures", decryptFailures },
+		{ "tcpFallbackSends", tcpFallbackSends }, { "tunnelDrops", tunnelDrops },
+	};
+
+	const auto addHistogram = [&entries](const VoiceHistogram::Snapshot &histogram, const char *mean,
+										 const char *median, const char *p99, const char *max) {
+		entries.emplace_back(mean, histogram.mean());
+		entries.emplace_back(median, histogram.quantile(0.5));
+		entries.emplace_back(p99, histogram.quantile(0.99));
+		entries.emplace_back(max, histogram.max());
+	};
+
+	addHistogram(latency, "latency.mean", "latency.p50", "latency.p99", "latency.max");
+	addHistogram(decrypt, "decrypt.mean", "decrypt.p50", "decrypt.p99", "decrypt.max");
+	addHistogram(route, "route.mean", "route.p50", "route.p99", "route.max");
+	addHistogram(send, "send.mean", "send.p50", "send.p99", "send.max");
+	addHistogram(fanOut, "fanOut.mean", "fanOut.p50", "fanOut.p99", "fanOut.max");
+
+	return entries;
+}
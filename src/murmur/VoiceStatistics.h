@@ -0,0 +1,133 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_VOICESTATISTICS_H_
+#define MUMBLE_MURMUR_VOICESTATISTICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// A histogram of non-negative values (e.g. durations in nanoseconds) with a bounded relative error.
+///
+/// Values are grouped by their power of two, which is split into SUB_BUCKETS linear buckets (like an HDR histogram
+/// with a precision of 1/SUB_BUCKETS). Recording a value only increments a single counter.
+///
+/// A histogram may only be written by a single thread, but it can be read by any thread at any time.
+class VoiceHistogram {
+public:
+	static constexpr unsigned int SUB_BUCKET_BITS = 3;
+	static constexpr unsigned int SUB_BUCKETS     = 1u << SUB_BUCKET_BITS;
+	static constexpr std::size_t BUCKETS          = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	/// A copy of the counters of one or more histograms
+	struct Snapshot {
+		std::array< std::uint64_t, BUCKETS > counts = {};
+		std::uint64_t count                         = 0;
+		std::uint64_t sum                           = 0;
+
+		void merge(const Snapshot &other);
+		/// @returns The values recorded since the given snapshot of the same histogram(s) has been taken
+		Snapshot since(const Snapshot &earlier) const;
+
+		/// @returns The (approximate) value below which the given fraction of the recorded values lie. 0 if nothing
+		/// 	has been recorded.
+		std::uint64_t quantile(double fraction) const;
+		/// @returns The (approximate) largest value recorded
+		std::uint64_t max() const;
+		std::uint64_t mean() const;
+	};
+
+	void record(std::uint64_t value, std::uint64_t times = 1);
+
+	Snapshot snapshot() const;
+
+	static std::size_t bucketOf(std::uint64_t value);
+	/// @returns The largest value that falls into the given bucket
+	static std::uint64_t upperBoundOf(std::size_t bucket);
+
+private:
+	std::array< std::atomic< std::uint64_t >, BUCKETS > m_counts = {};
+	std::atomic< std::uint64_t > m_sum                           = { 0 };
+};
+
+/// Always-on statistics of the voice path of a single thread processing audio: how long the stages of forwarding a
+/// packet take, how many receivers a packet has and why packets are dropped.
+///
+/// Every thread sending audio owns an instance, so recording never contends with other threads: the counters are
+/// written by their owner only and merely read by the main thread when the statistics are queried.
+class VoiceStatistics {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// A copy of the statistics of one or more threads
+	struct Snapshot {
+		std::uint64_t packetsReceived  = 0;
+		std::uint64_t audioPackets     = 0;
+		std::uint64_t bandwidthDrops   = 0;
+		std::uint64_t decryptFailures  = 0;
+		std::uint64_t tcpFallbackSends = 0;
+		std::uint64_t tunnelDrops      = 0;
+
+		/// The time from receiving a datagram until the audio has been sent out to all receivers (ns)
+		VoiceHistogram::Snapshot latency;
+		/// The time it takes to decrypt a datagram (ns)
+		VoiceHistogram::Snapshot decrypt;
+		/// The time it takes to determine the receivers of an audio packet (ns)
+		VoiceHistogram::Snapshot route;
+		/// The time it takes to encode, encrypt and queue an audio packet for all receivers (ns)
+		VoiceHistogram::Snapshot send;
+		/// The number of receivers of an audio packet
+		VoiceHistogram::Snapshot fanOut;
+
+		void merge(const Snapshot &other);
+		/// @returns The statistics recorded since the given snapshot has been taken
+		Snapshot since(const Snapshot &earlier) const;
+
+		/// @returns All counters and the mean, median, 99th percentile and maximum of each histogram as name-value
+		/// 	pairs (e.g. "latency.p99"). Durations are in nanoseconds.
+		std::vector< std::pair< const char *, std::uint64_t > > entries() const;
+	};
+
+	VoiceHistogram latency;
+	VoiceHistogram decrypt;
+	VoiceHistogram route;
+	VoiceHistogram send;
+	VoiceHistogram fanOut;
+
+	void countReceived(std::uint64_t count = 1) { increment(m_packetsReceived, count); }
+	void countAudioPacket() { increment(m_audioPackets, 1); }
+	void countBandwidthDrop() { increment(m_bandwidthDrops, 1); }
+	void countDecryptFailure() { increment(m_decryptFailures, 1); }
+	void countTcpFallbackSend() { increment(m_tcpFallbackSends, 1); }
+	void countTunnelDrop() { increment(m_tunnelDrops, 1); }
+
+	Snapshot snapshot() const;
+
+	/// @returns The nanoseconds between the two given points in time
+	static std::uint64_t elapsed(Clock::time_point begin, Clock::time_point end) {
+		return static_cast< std::uint64_t >(
+			std::chrono::duration_cast< std::chrono::nanoseconds >(end - begin).count());
+	}
+
+private:
+	/// There is a single writer, so a relaxed load and store suffices (and is cheaper than an atomic increment)
+	static void increment(std::atomic< std::uint64_t > &counter, std::uint64_t count) {
+		counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	}
+
+	std::atomic< std::uint64_t > m_packetsReceived  = { 0 };
+	std::atomic< std::uint64_t > m_audioPackets     = { 0 };
+	std::atomic< std::uint64_t > m_bandwidthDrops   = { 0 };
+	std::atomic< std::uint64_t > m_decryptFailures  = { 0 };
+	std::atomic< std::uint64_t > m_tcpFallbackSends = { 0 };
+	std::atomic< std::uint64_t > m_tunnelDrops      = { 0 };
+};
+
+#endif // MUMBLE_MURMUR_VOICESTATISTICS_H_
@@ -0,0 +1,83 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "VoiceTunnel.h"
+
+#include "MumbleProtocol.h"
+
+#include <QtCore/QtEndian>
+
+#include <cstring>
+#include <utility>
+
+VoiceTunnelQueue::VoiceTunnelQueue() : m_writePosition(0), m_pending(false) {
+	for (std::size_t i = 0; i < CAPACITY; ++i) {
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+QByteArray VoiceTunnelQueue::frame(const unsigned char *data, int len) {
+	QByteArray message;
+	message.resize(len + 6);
+
+	unsigned char *uc = reinterpret_cast< unsigned char * >(message.data());
+	qToBigEndian< quint16 >(static_cast< quint16 >(Mumble::Protocol::TCPMessageType::UDPTunnel), &uc[0]);
+	qToBigEndian< quint32 >(static_cast< quint32 >(len), &uc[2]);
+	std::memcpy(uc + 6, data, static_cast< std::size_t >(len));
+
+	return message;
+}
+
+bool VoiceTunnelQueue::push(const QByteArray &message) {
+	std::size_t position = m_writePosition.load(std::memory_order_relaxed);
+
+	while (true) {
+		Slot &slot                 = m_slots[position % CAPACITY];
+		const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+		if (sequence == position) {
+			// The slot is free: try to claim it
+			if (m_writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				slot.message = message;
+				slot.sequence.store(position + 1, std::memory_order_release);
+
+				return true;
+			}
+		} else if (sequence < position) {
+			// The slot still holds the message written one round before, i.e. the queue is full
+			return false;
+		} else {
+			// Another thread claimed the slot first
+			position = m_writePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool VoiceTunnelQueue::pop(QByteArray &message) {
+	Slot &slot = m_slots[m_readPosition % CAPACITY];
+
+	if (slot.sequence.load(std::memory_order_acquire) != m_readPosition + 1) {
+		return false;
+	}
+
+	message = std::move(slot.message);
+	slot.message.clear();
+	slot.sequence.store(m_readPosition + CAPACITY, std::memory_order_release);
+	++m_readPosition;
+
+	return true;
+}
+
+bool VoiceTunnelQueue::markPending() {
+	return !m_pending.exchange(true, std::memory_order_seq_cst);
+}
+
+void VoiceTunnelQueue::clearPending() {
+	// A plain store could be reordered after the loads of the messages taken next, which would allow a producer to
+	// still see the mark after the consumer has already missed its message. As a read-modify-write, the clear reads
+	// the mark of every push it comes after and thereby synchronizes with it, so the message of such a push is visible
+	// to the following pop() calls. Any push after the clear finds the mark removed and schedules another flush.
+	m_pending.exchange(false, std::memory_order_seq_cst);
+}
@@ -0,0 +1,63 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_VOICETUNNEL_H_
+#define MUMBLE_MURMUR_VOICETUNNEL_H_
+
+#include <QtCore/QByteArray>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/// The audio packets waiting to be sent to a user through its TCP connection, which is used for voice if the user
+/// has no working UDP connection (UDPTunnel messages).
+///
+/// Any number of voice threads may push packets without locking, while only the main thread (which owns the
+/// connection) takes them. The packets are stored as complete TCP messages that are shared between all receivers of
+/// the same packet, so queueing a packet never copies or allocates.
+///
+/// The queue is bounded: if the connection doesn't keep up, further packets are dropped instead of piling up.
+class VoiceTunnelQueue {
+public:
+	static constexpr std::size_t CAPACITY = 64;
+
+	VoiceTunnelQueue();
+
+	/// @returns The given audio packet framed as UDPTunnel message
+	static QByteArray frame(const unsigned char *data, int len);
+
+	/// Adds the given framed message. May be called from any thread.
+	///
+	/// @returns Whether the message was queued (false if the queue is full)
+	bool push(const QByteArray &message);
+	/// Takes the oldest message. Must only be called from a single thread.
+	///
+	/// @returns Whether there was a message
+	bool pop(QByteArray &message);
+
+	/// Marks this queue as waiting to be flushed. May be called from any thread.
+	///
+	/// @returns Whether the queue was not marked before (i.e. the caller has to make sure it gets flushed)
+	bool markPending();
+	/// Removes the mark. Must be called before taking the messages, so that messages pushed in the meantime cause the
+	/// queue to be marked again. The removal is ordered before the messages are taken, so that no message is missed by
+	/// both the flush in progress and its pusher.
+	void clearPending();
+
+private:
+	struct Slot {
+		/// Equals the position the slot is written to next if it is free, one more if it holds that message
+		std::atomic< std::size_t > sequence;
+		QByteArray message;
+	};
+
+	std::array< Slot, CAPACITY > m_slots;
+	alignas(64) std::atomic< std::size_t > m_writePosition;
+	alignas(64) std::size_t m_readPosition = 0;
+	std::atomic< bool > m_pending;
+};
+
+#endif // MUMBLE_MURMUR_VOICETUNNEL_H_
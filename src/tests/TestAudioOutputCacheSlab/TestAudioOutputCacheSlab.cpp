@@ -0,0 +1,167 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioOutputCacheSlab.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+/// Audio data whose payload consists of the given byte only
+struct Packet {
+	explicit Packet(Mumble::Protocol::byte value) : payload(16, value) {
+		audioData.payload = { payload.data(), payload.size() };
+	}
+
+	std::vector< Mumble::Protocol::byte > payload;
+	Mumble::Protocol::AudioData audioData;
+};
+
+/// Only the address matters
+static const int OWNER_A = 0;
+
+class TestAudioOutputCacheSlab : public QObject {
+	Q_OBJECT
+private slots:
+	void test_storeAndRelease() {
+		AudioOutputCacheSlab slab(4);
+		QCOMPARE(slab.capacity(), static_cast< std::size_t >(4));
+
+		std::set< AudioOutputCacheSlab::Handle > handles;
+		for (int i = 0; i < 4; ++i) {
+			const AudioOutputCacheSlab::Handle handle = slab.store(Packet(i + 1).audioData, &OWNER_A);
+			QVERIFY(handle != AudioOutputCacheSlab::INVALID_HANDLE);
+			handles.insert(handle);
+
+			const AudioOutputCache *cache = slab.get(handle);
+			QVERIFY(cache);
+			QCOMPARE(cache->getAudioData().size(), static_cast< std::size_t >(16));
+			QCOMPARE(static_cast< int >(cache->getAudioData()[0]), i + 1);
+		}
+		QCOMPARE(handles.size(), static_cast< std::size_t >(4));
+		QCOMPARE(slab.size(), static_cast< std::size_t >(4));
+
+		// The capacity is fixed
+		QVERIFY(slab.store(Packet(5).audioData, &OWNER_A) == AudioOutputCacheSlab::INVALID_HANDLE);
+
+		for (AudioOutputCacheSlab::Handle handle : handles) {
+			QVERIFY(slab.release(handle));
+		}
+		QCOMPARE(slab.size(), static_cast< std::size_t >(0));
+		QVERIFY(slab.store(Packet(5).audioData, &OWNER_A) != AudioOutputCacheSlab::INVALID_HANDLE);
+	}
+
+	void test_staleHandles() {
+		AudioOutputCacheSlab slab(1);
+
+		const AudioOutputCacheSlab::Handle first = slab.store(Packet(1).audioData, &OWNER_A);
+		QVERIFY(slab.release(first));
+		QVERIFY(!slab.release(first));
+		QVERIFY(!slab.get(first));
+
+		// The entry is reused, but the old handle keeps being stale
+		const AudioOutputCacheSlab::Handle second = slab.store(Packet(2).audioData, &OWNER_A);
+		QVERIFY(second != first);
+		QVERIFY(!slab.get(first));
+		QVERIFY(!slab.release(first));
+		QVERIFY(slab.get(second));
+		QCOMPARE(static_cast< int >(slab.get(second)->getAudioData()[0]), 2);
+
+		QVERIFY(slab.release(second));
+
+		// Handles never become 0, not even once the generation wraps around
+		for (int i = 0; i < 0x20000; ++i) {
+			const AudioOutputCacheSlab::Handle handle = slab.store(Packet(3).audioData, &OWNER_A);
+			QVERIFY(handle != AudioOutputCacheSlab::INVALID_HANDLE);
+			QVERIFY(slab.release(handle));
+		}
+
+		QVERIFY(!slab.release(AudioOutputCacheSlab::INVALID_HANDLE));
+		QVERIFY(!slab.get(AudioOutputCacheSlab::INVALID_HANDLE));
+	}
+
+	void test_releaseAll() {
+		AudioOutputCacheSlab slab(8);
+		const int ownerB = 0;
+
+		std::vector< AudioOutputCacheSlab::Handle > handlesA;
+		std::vector< AudioOutputCacheSlab::Handle > handlesB;
+		for (int i = 0; i < 3; ++i) {
+			handlesA.push_back(slab.store(Packet(1).audioData, &OWNER_A));
+			handlesB.push_back(slab.store(Packet(2).audioData, &ownerB));
+		}
+		QVERIFY(slab.release(handlesA[0]));
+
+		QCOMPARE(slab.releaseAll(&OWNER_A), static_cast< std::size_t >(2));
+		QCOMPARE(slab.size(), static_cast< std::size_t >(3));
+		for (AudioOutputCacheSlab::Handle handle : handlesA) {
+			QVERIFY(!slab.get(handle));
+		}
+		for (AudioOutputCacheSlab::Handle handle : handlesB) {
+			QVERIFY(slab.get(handle));
+		}
+
+		QCOMPARE(slab.releaseAll(&OWNER_A), static_cast< std::size_t >(0));
+		QCOMPARE(slab.releaseAll(&ownerB), static_cast< std::size_t >(3));
+		QCOMPARE(slab.size(), static_cast< std::size_t >(0));
+	}
+
+	void test_concurrent() {
+		AudioOutputCacheSlab slab(64);
+
+		constexpr int THREADS    = 4;
+		constexpr int ITERATIONS = 20000;
+		std::atomic< bool > consistent(true);
+
+		// Every thread keeps a few entries at a time, which have to keep their content until released
+		std::vector< std::thread > threads;
+		for (int t = 0; t < THREADS; ++t) {
+			threads.emplace_back([&slab, &consistent, t]() {
+				const Packet packet(static_cast< Mumble::Protocol::byte >(t + 1));
+				std::vector< AudioOutputCacheSlab::Handle > held;
+
+				for (int i = 0; i < ITERATIONS; ++i) {
+					const AudioOutputCacheSlab::Handle handle = slab.store(packet.audioData, &packet);
+					if (handle != AudioOutputCacheSlab::INVALID_HANDLE) {
+						held.push_back(handle);
+					}
+
+					if (held.size() > static_cast< std::size_t >(i % 8)) {
+						const AudioOutputCache *cache = slab.get(held.front());
+						if (!cache || cache->getAudioData()[0] != packet.payload[0]
+							|| cache->getAudioData()[15] != packet.payload[0] || !slab.release(held.front())) {
+							consistent = false;
+						}
+						held.erase(held.begin());
+					}
+				}
+
+				slab.releaseAll(&packet);
+			});
+		}
+
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+
+		QVERIFY(consistent);
+		QCOMPARE(slab.size(), static_cast< std::size_t >(0));
+
+		// All entries made it back to the free-list
+		std::vector< AudioOutputCacheSlab::Handle > handles;
+		for (std::size_t i = 0; i < slab.capacity(); ++i) {
+			handles.push_back(slab.store(Packet(1).audioData, &OWNER_A));
+			QVERIFY(handles.back() != AudioOutputCacheSlab::INVALID_HANDLE);
+		}
+		QVERIFY(slab.store(Packet(1).audioData, &OWNER_A) == AudioOutputCacheSlab::INVALID_HANDLE);
+	}
+};
+
+QTEST_MAIN(TestAudioOutputCacheSlab)
+#include "TestAudioOutputCacheSlab.moc"
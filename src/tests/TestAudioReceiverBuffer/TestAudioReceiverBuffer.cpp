@@ -282,6 +282,46 @@ private slots:
 
 		QCOMPARE(range.begin, range.end);
 	}
+
+	void test_plan() {
+		AudioReceiverBuffer buffer;
+
+		const AudioReceiverBuffer::PlanKey key = { 1, users[0].uiSession,
+												   Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH, false };
+
+		QVERIFY(!buffer.usePlan(key));
+
+		buffer.addReceiver(users[0], users[1], Mumble::Protocol::AudioContext::NORMAL, false);
+		buffer.addReceiver(users[0], users[3], Mumble::Protocol::AudioContext::LISTEN, false);
+		buffer.preprocessBuffer();
+		buffer.storePlan(key);
+
+		const std::vector< AudioReceiver > expected = buffer.getReceivers(false);
+		buffer.clear();
+		QVERIFY(buffer.getReceivers(false).empty());
+
+		QVERIFY(buffer.usePlan(key));
+		QCOMPARE(buffer.getReceivers(false).size(), expected.size());
+		for (std::size_t i = 0; i < expected.size(); ++i) {
+			QCOMPARE(buffer.getReceivers(false)[i].getReceiver().uiSession, expected[i].getReceiver().uiSession);
+			QCOMPARE(buffer.getReceivers(false)[i].getContext(), expected[i].getContext());
+		}
+
+		// The plan is used until the buffer is cleared
+		buffer.clear();
+		QVERIFY(buffer.getReceivers(false).empty());
+
+		// Other targets have plans of their own
+		AudioReceiverBuffer::PlanKey otherKey = key;
+		otherKey.target                       = 1;
+		QVERIFY(!buffer.usePlan(otherKey));
+
+		// A new generation discards all plans
+		AudioReceiverBuffer::PlanKey nextGeneration = key;
+		nextGeneration.generation                   = 2;
+		QVERIFY(!buffer.usePlan(nextGeneration));
+		QVERIFY(!buffer.usePlan(key));
+	}
 };
 
 QTEST_MAIN(TestAudioReceiverBuffer)
@@ -0,0 +1,171 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "Broadcast.h"
+
+#include <QObject>
+#include <QtEndian>
+#include <QtTest>
+
+#include <utility>
+#include <vector>
+
+using Message = std::pair< Mumble::Protocol::TCPMessageType, QByteArray >;
+
+/// Splits the given batch into the messages it consists of
+static std::vector< Message > split(const QByteArray &batch) {
+	std::vector< Message > messages;
+
+	int offset = 0;
+	while (offset + 6 <= batch.size()) {
+		const unsigned char *uc = reinterpret_cast< const unsigned char * >(batch.constData()) + offset;
+		const auto type         = static_cast< Mumble::Protocol::TCPMessageType >(qFromBigEndian< quint16 >(&uc[0]));
+		const int len           = static_cast< int >(qFromBigEndian< quint32 >(&uc[2]));
+
+		messages.emplace_back(type, batch.mid(offset + 6, len));
+		offset += len + 6;
+	}
+
+	return messages;
+}
+
+static MumbleProto::UserState parseUserState(const Message &message) {
+	MumbleProto::UserState msg;
+	msg.ParseFromArray(message.second.constData(), message.second.size());
+
+	return msg;
+}
+
+static const Version::full_t OLD_VERSION = Version::fromComponents(1, 2, 0);
+static const Version::full_t NEW_VERSION = Version::fromComponents(1, 4, 0);
+
+class TestBroadcastQueue : public QObject {
+	Q_OBJECT
+private slots:
+	void test_coalesce() {
+		BroadcastQueue queue;
+
+		for (unsigned int channel = 1; channel <= 3; ++channel) {
+			MumbleProto::UserState mpus;
+			mpus.set_session(1);
+			mpus.set_channel_id(channel);
+			QVERIFY(queue.add(mpus, Mumble::Protocol::TCPMessageType::UserState, 0, Version::UNKNOWN,
+							  Version::CompareMode::AtLeast));
+		}
+
+		MumbleProto::UserState mpus;
+		mpus.set_session(1);
+		mpus.set_self_mute(true);
+		QVERIFY(queue.add(mpus, Mumble::Protocol::TCPMessageType::UserState, 0, Version::UNKNOWN,
+						  Version::CompareMode::AtLeast));
+
+		const std::vector< Message > messages = split(queue.batchFor(2, NEW_VERSION));
+		QCOMPARE(messages.size(), static_cast< std::size_t >(1));
+		QCOMPARE(messages[0].first, Mumble::Protocol::TCPMessageType::UserState);
+
+		const MumbleProto::UserState merged = parseUserState(messages[0]);
+		QCOMPARE(merged.session(), 1u);
+		QCOMPARE(merged.channel_id(), 3u);
+		QVERIFY(merged.self_mute());
+
+		QCOMPARE(queue.statistics().messagesCoalesced, static_cast< quint64 >(3));
+		QVERIFY(queue.statistics().bytesSaved > 0);
+	}
+
+	void test_keepApart() {
+		BroadcastQueue queue;
+
+		// Different sessions
+		MumbleProto::UserState first;
+		first.set_session(1);
+		first.set_mute(true);
+		queue.add(first, Mumble::Protocol::TCPMessageType::UserState, 0, Version::UNKNOWN,
+				  Version::CompareMode::AtLeast);
+
+		MumbleProto::UserState second;
+		second.set_session(2);
+		second.set_mute(true);
+		queue.add(second, Mumble::Protocol::TCPMessageType::UserState, 0, Version::UNKNOWN,
+				  Version::CompareMode::AtLeast);
+
+		// Different actor
+		MumbleProto::UserState third;
+		third.set_session(1);
+		third.set_actor(3);
+		third.set_deaf(true);
+		queue.add(third, Mumble::Protocol::TCPMessageType::UserState, 0, Version::UNKNOWN,
+				  Version::CompareMode::AtLeast);
+
+		// Repeated fields
+		MumbleProto::UserState fourth;
+		fourth.set_session(1);
+		fourth.set_actor(3);
+		fourth.add_listening_channel_add(5);
+		QVERIFY(!queue.add(fourth, Mumble::Protocol::TCPMessageType::UserState, 0, Version::UNKNOWN,
+						   Version::CompareMode::AtLeast));
+
+		// Not to be merged with the third one, as it has to be applied after the fourth
+		MumbleProto::UserState fifth;
+		fifth.set_session(1);
+		fifth.set_actor(3);
+		fifth.set_deaf(false);
+		queue.add(fifth, Mumble::Protocol::TCPMessageType::UserState, 0, Version::UNKNOWN,
+				  Version::CompareMode::AtLeast);
+
+		const std::vector< Message > messages = split(queue.batchFor(4, NEW_VERSION));
+		QCOMPARE(messages.size(), static_cast< std::size_t >(5));
+		QCOMPARE(parseUserState(messages[1]).session(), 2u);
+		QCOMPARE(parseUserState(messages[3]).listening_channel_add_size(), 1);
+		QVERIFY(!parseUserState(messages[4]).deaf());
+
+		QCOMPARE(queue.statistics().messagesCoalesced, static_cast< quint64 >(0));
+		QCOMPARE(queue.statistics().bytesSaved, static_cast< quint64 >(0));
+	}
+
+	void test_receivers() {
+		BroadcastQueue queue;
+
+		MumbleProto::UserState forNew;
+		forNew.set_session(1);
+		forNew.set_comment_hash("hash");
+		queue.add(forNew, Mumble::Protocol::TCPMessageType::UserState, 1, Version::fromComponents(1, 2, 2),
+				  Version::CompareMode::AtLeast);
+
+		MumbleProto::UserState forOld;
+		forOld.set_session(1);
+		forOld.set_comment("comment");
+		queue.add(forOld, Mumble::Protocol::TCPMessageType::UserState, 1, Version::fromComponents(1, 2, 2),
+				  Version::CompareMode::LessThan);
+
+		MumbleProto::UserRemove mpur;
+		mpur.set_session(2);
+		QVERIFY(!queue.add(mpur, Mumble::Protocol::TCPMessageType::UserRemove, 0, Version::UNKNOWN,
+						   Version::CompareMode::AtLeast));
+
+		std::vector< Message > messages = split(queue.batchFor(3, NEW_VERSION));
+		QCOMPARE(messages.size(), static_cast< std::size_t >(2));
+		QVERIFY(parseUserState(messages[0]).has_comment_hash());
+		QCOMPARE(messages[1].first, Mumble::Protocol::TCPMessageType::UserRemove);
+
+		messages = split(queue.batchFor(4, OLD_VERSION));
+		QCOMPARE(messages.size(), static_cast< std::size_t >(2));
+		QVERIFY(parseUserState(messages[0]).has_comment());
+
+		// Receivers of the same version share the batch
+		QVERIFY(queue.batchFor(5, NEW_VERSION).isSharedWith(queue.batchFor(3, NEW_VERSION)));
+
+		// The user the update is about doesn't get it
+		messages = split(queue.batchFor(1, NEW_VERSION));
+		QCOMPARE(messages.size(), static_cast< std::size_t >(1));
+		QCOMPARE(messages[0].first, Mumble::Protocol::TCPMessageType::UserRemove);
+
+		queue.clear();
+		QVERIFY(queue.isEmpty());
+		QVERIFY(queue.batchFor(3, NEW_VERSION).isEmpty());
+	}
+};
+
+QTEST_MAIN(TestBroadcastQueue)
+#include "TestBroadcastQueue.moc"
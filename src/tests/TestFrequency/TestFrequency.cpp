@@ -0,0 +1,105 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "Frequency.h"
+
+#include <QHash>
+#include <QObject>
+#include <QtTest>
+
+class TestFrequency : public QObject {
+	Q_OBJECT
+private slots:
+	void test_null() {
+		const Frequency frequency;
+
+		QVERIFY(frequency.isNull());
+		QVERIFY(!frequency.isValid());
+		QCOMPARE(frequency.kHz(), 0u);
+	}
+
+	void test_fromMHz() {
+		QCOMPARE(Frequency::fromMHz(118.0).kHz(), 118000u);
+		// Not exactly representable as a double
+		QCOMPARE(Frequency::fromMHz(118.325).kHz(), 118325u);
+		QCOMPARE(Frequency::fromMHz(121.9).kHz(), 121900u);
+		QCOMPARE(Frequency::fromMHz(132.005).kHz(), 132005u);
+		QVERIFY(Frequency::fromMHz(0.0).isNull());
+		QVERIFY(Frequency::fromMHz(-1.0).isNull());
+	}
+
+	void test_fromChannel() {
+		QCOMPARE(Frequency::fromChannel(0).kHz(), 118000u);
+		QCOMPARE(Frequency::fromChannel(13).kHz(), 118325u);
+		QCOMPARE(Frequency::fromChannel(759).kHz(), 136975u);
+	}
+
+	void test_fromString_data() {
+		QTest::addColumn< QString >("string");
+		QTest::addColumn< unsigned int >("kHz");
+
+		QTest::newRow("25 kHz") << QString::fromLatin1("118.325") << 118325u;
+		QTest::newRow("8.33 kHz") << QString::fromLatin1("132.005") << 132005u;
+		QTest::newRow("short") << QString::fromLatin1("121.5") << 121500u;
+		QTest::newRow("two decimals") << QString::fromLatin1("121.95") << 121950u;
+		QTest::newRow("no decimals") << QString::fromLatin1("118") << 118000u;
+		QTest::newRow("trailing dot") << QString::fromLatin1("118.") << 118000u;
+		QTest::newRow("whitespace") << QString::fromLatin1(" 122.800 ") << 122800u;
+		QTest::newRow("empty") << QString() << 0u;
+		QTest::newRow("too many decimals") << QString::fromLatin1("118.0001") << 0u;
+		QTest::newRow("too large") << QString::fromLatin1("1180.000") << 0u;
+		QTest::newRow("letters") << QString::fromLatin1("11a.000") << 0u;
+		QTest::newRow("letters in decimals") << QString::fromLatin1("118.0a0") << 0u;
+		QTest::newRow("no MHz") << QString::fromLatin1(".325") << 0u;
+		QTest::newRow("negative") << QString::fromLatin1("-118.000") << 0u;
+	}
+
+	void test_fromString() {
+		QFETCH(QString, string);
+		QFETCH(unsigned int, kHz);
+
+		QCOMPARE(Frequency::fromString(string).kHz(), kHz);
+	}
+
+	void test_toString() {
+		QCOMPARE(Frequency(118000).toString(), QString::fromLatin1("118.000"));
+		QCOMPARE(Frequency(121500).toString(), QString::fromLatin1("121.500"));
+		QCOMPARE(Frequency(132005).toString(), QString::fromLatin1("132.005"));
+
+		for (unsigned int channel = 0; channel < 760; ++channel) {
+			const Frequency frequency = Frequency::fromChannel(channel);
+
+			QCOMPARE(Frequency::fromString(frequency.toString()), frequency);
+		}
+	}
+
+	void test_validity() {
+		QVERIFY(Frequency(118000).isValid());
+		QVERIFY(Frequency(136990).isValid());
+		QVERIFY(Frequency(132005).isValid());
+		QVERIFY(Frequency(132015).isValid());
+		QVERIFY(!Frequency(117975).isValid());
+		QVERIFY(!Frequency(137000).isValid());
+		// There is no 8.33 kHz channel named like this
+		QVERIFY(!Frequency(132020).isValid());
+		QVERIFY(!Frequency(132001).isValid());
+
+		QCOMPARE(Frequency(118325).spacing(), Frequency::Spacing::Channel25kHz);
+		QCOMPARE(Frequency(132005).spacing(), Frequency::Spacing::Channel8_33kHz);
+	}
+
+	void test_hash() {
+		QHash< Frequency, int > hash;
+		hash.insert(Frequency(118325), 1);
+		hash.insert(Frequency::fromMHz(121.5), 2);
+
+		QCOMPARE(hash.value(Frequency::fromString(QString::fromLatin1("118.325"))), 1);
+		QCOMPARE(hash.value(Frequency(121500)), 2);
+		QVERIFY(!hash.contains(Frequency(121505)));
+	}
+};
+
+QTEST_MAIN(TestFrequency)
+#include "TestFrequency.moc"
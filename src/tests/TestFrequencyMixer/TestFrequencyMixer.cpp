@@ -0,0 +1,197 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "FrequencyMixer.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <opus.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static constexpr unsigned int FREQUENCY = 121500;
+
+/// A packet as received by the output function of the mixer
+struct MixedPacket {
+	unsigned int frequency;
+	unsigned int session;
+	std::uint64_t frameNumber;
+	bool isLastFrame;
+	std::vector< unsigned int > transmitters;
+	/// The peak amplitude of the decoded packet
+	float peak;
+};
+
+/// Produces the packets of a station transmitting silence
+class Station {
+public:
+	explicit Station(unsigned int session) : m_session(session) {
+		int error = OPUS_OK;
+		m_encoder = opus_encoder_create(FrequencyMixer::SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, &error);
+	}
+
+	~Station() { opus_encoder_destroy(m_encoder); }
+
+	void transmit(FrequencyMixer &mixer, bool isLastFrame = false) {
+		std::vector< float > silence(FrequencyMixer::FRAME_SIZE, 0.0f);
+		std::array< Mumble::Protocol::byte, Mumble::Protocol::MAX_UDP_PACKET_SIZE > encoded;
+
+		const opus_int32 size = opus_encode_float(m_encoder, silence.data(), static_cast< int >(silence.size()),
+												  encoded.data(), static_cast< opus_int32 >(encoded.size()));
+		QVERIFY(size > 0);
+
+		Mumble::Protocol::AudioData data;
+		data.usedCodec       = Mumble::Protocol::AudioCodec::Opus;
+		data.targetOrContext = Mumble::Protocol::ReservedTargetIDs::REGULAR_SPEECH;
+		data.senderSession   = m_session;
+		data.frameNumber     = m_frameNumber;
+		data.payload         = { encoded.data(), static_cast< std::size_t >(size) };
+		data.isLastFrame     = isLastFrame;
+
+		m_frameNumber += 2;
+
+		mixer.submit(FREQUENCY, data);
+	}
+
+private:
+	unsigned int m_session;
+	std::uint64_t m_frameNumber = 0;
+	OpusEncoder *m_encoder;
+};
+
+class TestFrequencyMixer : public QObject {
+	Q_OBJECT
+private:
+	std::vector< MixedPacket > m_packets;
+	OpusDecoder *m_decoder = nullptr;
+
+	FrequencyMixer::Output output() {
+		return [this](std::size_t worker, unsigned int frequency, const Mumble::Protocol::AudioData &data,
+					  const std::vector< unsigned int > &transmitters) {
+			QCOMPARE(worker, static_cast< std::size_t >(0));
+
+			std::vector< float > decoded(FrequencyMixer::FRAME_SIZE);
+			const int samples = opus_decode_float(m_decoder, data.payload.data(),
+												  static_cast< opus_int32 >(data.payload.size()), decoded.data(),
+												  static_cast< int >(decoded.size()), 0);
+			QCOMPARE(samples, static_cast< int >(FrequencyMixer::FRAME_SIZE));
+
+			float peak = 0.0f;
+			for (float sample : decoded) {
+				peak = std::max(peak, std::abs(sample));
+			}
+
+			m_packets.push_back(
+				{ frequency, data.senderSession, data.frameNumber, data.isLastFrame, transmitters, peak });
+		};
+	}
+
+private slots:
+	void init() {
+		m_packets.clear();
+
+		int error = OPUS_OK;
+		m_decoder = opus_decoder_create(FrequencyMixer::SAMPLE_RATE, 1, &error);
+		QCOMPARE(error, OPUS_OK);
+	}
+
+	void cleanup() { opus_decoder_destroy(m_decoder); }
+
+	void test_singleTransmission() {
+		FrequencyMixer mixer(1, output());
+		Station station(7);
+
+		// The transmission is buffered before it is mixed in
+		for (unsigned int i = 0; i < FrequencyMixer::PREBUFFER_FRAMES - 1; ++i) {
+			station.transmit(mixer);
+			mixer.mixAll();
+		}
+		QVERIFY(m_packets.empty());
+
+		for (int i = 0; i < 5; ++i) {
+			station.transmit(mixer);
+			mixer.mixAll();
+		}
+		station.transmit(mixer, true);
+
+		// Drain the buffer
+		for (unsigned int i = 0; i < FrequencyMixer::PREBUFFER_FRAMES + 1; ++i) {
+			mixer.mixAll();
+		}
+
+		QVERIFY(m_packets.size() >= 6);
+		for (std::size_t i = 0; i < m_packets.size(); ++i) {
+			QCOMPARE(m_packets[i].frequency, FREQUENCY);
+			QCOMPARE(m_packets[i].session, 7u);
+			QCOMPARE(m_packets[i].frameNumber, static_cast< std::uint64_t >(2 * i));
+			QVERIFY(m_packets[i].transmitters.size() <= 1);
+			// No heterodyne tone without overlapping transmissions
+			QVERIFY(m_packets[i].peak < 0.05f);
+		}
+		QVERIFY(m_packets.back().isLastFrame);
+	}
+
+	void test_overlappingTransmissions() {
+		FrequencyMixer mixer(1, output());
+		Station first(7);
+		Station second(9);
+
+		for (int i = 0; i < 10; ++i) {
+			first.transmit(mixer);
+			second.transmit(mixer);
+			mixer.mixAll();
+		}
+
+		QVERIFY(!m_packets.empty());
+
+		// The decoder has had a few frames to settle by now
+		const MixedPacket &packet = m_packets.back();
+		QCOMPARE(packet.transmitters.size(), static_cast< std::size_t >(2));
+		QVERIFY(std::find(packet.transmitters.begin(), packet.transmitters.end(), packet.session)
+				!= packet.transmitters.end());
+
+		// The codec doesn't preserve the exact amplitude of the low tone (the voice mode filters low frequencies), but
+		// it has to be clearly audible
+		const float expectedPeak = FrequencyMixer::HETERODYNE_AMPLITUDE * FrequencyMixer::OVERLAP_GAIN;
+		QVERIFY(packet.peak > 0.4f * expectedPeak);
+		QVERIFY(packet.peak < 1.25f * expectedPeak);
+	}
+
+	void test_ownerStopsTransmitting() {
+		FrequencyMixer mixer(1, output());
+		Station first(7);
+		Station second(9);
+
+		for (int i = 0; i < 4; ++i) {
+			first.transmit(mixer);
+			second.transmit(mixer);
+			mixer.mixAll();
+		}
+
+		const unsigned int owner = m_packets.back().session;
+		Station &remaining       = owner == 7 ? second : first;
+
+		// The owner of the stream stops, the mix continues as a new stream of the remaining station
+		for (int i = 0; i < 8; ++i) {
+			remaining.transmit(mixer);
+			mixer.mixAll();
+		}
+
+		auto lastFrame = std::find_if(m_packets.begin(), m_packets.end(),
+									  [](const MixedPacket &packet) { return packet.isLastFrame; });
+		QVERIFY(lastFrame != m_packets.end());
+		QCOMPARE(lastFrame->session, owner);
+
+		QVERIFY(lastFrame + 1 != m_packets.end());
+		QVERIFY((lastFrame + 1)->session != owner);
+		QCOMPARE((lastFrame + 1)->frameNumber, static_cast< std::uint64_t >(0));
+	}
+};
+
+QTEST_MAIN(TestFrequencyMixer)
+#include "TestFrequencyMixer.moc"
@@ -10,6 +10,7 @@
 #include <QObject>
 #include <QtTest>
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <string>
@@ -222,6 +223,59 @@ template< Mumble::Protocol::Role encoderRole, Mumble::Protocol::Role decoderRole
 	}
 }
 
+void do_test_server_audio(Mumble::Protocol::AudioCodec codec) {
+	Mumble::Protocol::UDPServerAudioEncoder encoder;
+	Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > referenceEncoder;
+
+	std::string payloadData = "I am the payload";
+
+	Mumble::Protocol::AudioData data;
+	data.payload = { reinterpret_cast< const Mumble::Protocol::byte * >(payloadData.c_str()), payloadData.size() };
+
+	data.senderSession          = 42;
+	data.frameNumber            = 12;
+	data.containsPositionalData = true;
+	data.position               = { 3, 2, 1 };
+	data.isLastFrame            = true;
+	data.usedCodec              = codec;
+
+	encoder.prepareAudioPacket(data);
+
+	// Mix the versions such that every format has to be picked up again after the other one has been used
+	for (Version::full_t version :
+		 { Mumble::Protocol::PROTOBUF_INTRODUCTION_VERSION, Version::fromComponents(1, 3, 0),
+		   Mumble::Protocol::PROTOBUF_INTRODUCTION_VERSION, Version::fromComponents(1, 4, 0) }) {
+		for (bool includePositionalData : { true, false, true }) {
+			for (float volumeFactor : { 1.0f, 1.4f }) {
+				Mumble::Protocol::AudioData expected = data;
+				expected.targetOrContext             = Mumble::Protocol::AudioContext::LISTEN;
+				expected.containsPositionalData      = includePositionalData;
+				expected.volumeAdjustment            = VolumeAdjustment::fromFactor(volumeFactor);
+
+				// Codecs other than Opus are always sent in the legacy format
+				referenceEncoder.setProtocolVersion(codec == Mumble::Protocol::AudioCodec::Opus
+														? version
+														: Version::fromComponents(1, 3, 0));
+
+				gsl::span< const Mumble::Protocol::byte > reference = referenceEncoder.encodeAudioPacket(expected);
+				gsl::span< const Mumble::Protocol::byte > encoded =
+					encoder.updateAudioPacket(version, expected.targetOrContext, expected.volumeAdjustment,
+											  includePositionalData);
+
+				QVERIFY(!encoded.empty());
+				QCOMPARE(encoded.size(), reference.size());
+				QVERIFY2(std::equal(encoded.begin(), encoded.end(), reference.begin()),
+						 "Encoded packet differs from the one of UDPAudioEncoder");
+			}
+		}
+	}
+
+	// The legacy format can't encode contexts beyond 5 bits
+	QVERIFY(encoder.updateAudioPacket(Version::fromComponents(1, 3, 0), 1 << 5, VolumeAdjustment::fromFactor(1.0f),
+									  false)
+				.empty());
+}
+
 class TestMumbleProtocol : public QObject {
 	Q_OBJECT;
 private slots:
@@ -241,6 +295,10 @@ private slots:
 		do_test_audio< Mumble::Protocol::Role::Server, Mumble::Protocol::Role::Client >();
 	}
 
+	void test_server_audio_opus() { do_test_server_audio(Mumble::Protocol::AudioCodec::Opus); }
+
+	void test_server_audio_speex() { do_test_server_audio(Mumble::Protocol::AudioCodec::Speex); }
+
 	void test_preEncode_audio_context() {
 		Mumble::Protocol::TestAudioEncoder< Mumble::Protocol::Role::Server > encoder;
 
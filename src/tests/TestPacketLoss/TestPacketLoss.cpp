@@ -0,0 +1,378 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioOutputCacheSlab.h"
+#include "AudioOutputLookahead.h"
+#include "OpusEncoderSettings.h"
+#include "PacketLossEstimator.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <opus.h>
+#include <speex/speex_jitter.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+static constexpr int SAMPLE_RATE = 48000;
+/// The default audio quality of the client
+static constexpr int BITRATE = 40000;
+/// 20 ms, as sent with the default setting of 2 frames per packet
+static constexpr int PACKET_SAMPLES = SAMPLE_RATE / 50;
+/// 3 s of audio
+static constexpr int PACKET_COUNT = 150;
+/// Every 20th packet gets lost on the link, which makes for 5 % of them
+static constexpr int LOSS_INTERVAL = 20;
+
+/// The jitter buffer of AudioOutputSpeech steps by 10 ms of interleaved stereo audio
+static constexpr spx_uint32_t FRAME_SIZE  = 2 * SAMPLE_RATE / 100;
+static constexpr spx_uint32_t PACKET_SPAN = 2 * PACKET_SAMPLES;
+/// How many packets ahead of being due the packets arrive
+static constexpr spx_uint32_t LEAD_PACKETS = 1;
+
+static constexpr double PI = 3.14159265358979323846;
+
+using Packet = std::vector< unsigned char >;
+
+/// The received packets, as AudioOutputSpeech::s_audioCaches
+static AudioOutputCacheSlab s_caches(256);
+
+static void releaseCache(void *handle) {
+	s_caches.release(static_cast< AudioOutputCacheSlab::Handle >(reinterpret_cast< std::uintptr_t >(handle)));
+}
+
+/// Sets up a jitter buffer as AudioOutputSpeech does, except for the margin. It covers the lead of the packets, so that
+/// the jitter buffer sticks to its delay and the audio stays where its timestamps say it belongs.
+static JitterBuffer *createJitterBuffer() {
+	JitterBuffer *jitter = jitter_buffer_init(FRAME_SIZE);
+	int margin           = static_cast< int >(LEAD_PACKETS * PACKET_SPAN);
+	jitter_buffer_ctl(jitter, JITTER_BUFFER_SET_MARGIN, &margin);
+	jitter_buffer_ctl(jitter, JITTER_BUFFER_SET_DESTROY_CALLBACK, reinterpret_cast< void * >(&releaseCache));
+
+	return jitter;
+}
+
+/// Stores a packet in s_caches
+static AudioOutputCacheSlab::Handle store(const Packet &packet, const void *owner) {
+	Mumble::Protocol::AudioData audioData;
+	audioData.payload = { packet.data(), packet.size() };
+
+	return s_caches.store(audioData, owner);
+}
+
+/// A deterministic stand-in for speech: a voiced sound with a wandering pitch and a syllable-like rhythm
+static std::vector< float > makeSpeech() {
+	std::vector< float > speech(PACKET_COUNT * PACKET_SAMPLES);
+
+	double phase = 0.0;
+	for (std::size_t i = 0; i < speech.size(); ++i) {
+		const double time = static_cast< double >(i) / SAMPLE_RATE;
+
+		const double pitch = 130.0 + 40.0 * std::sin(2.0 * PI * 1.3 * time);
+		phase += 2.0 * PI * pitch / SAMPLE_RATE;
+
+		double sample = 0.0;
+		for (int harmonic = 1; harmonic <= 20; ++harmonic) {
+			sample += std::sin(harmonic * phase) / harmonic;
+		}
+
+		const double loudness = 0.55 + 0.45 * std::sin(2.0 * PI * 3.7 * time);
+
+		speech[i] = static_cast< float >(0.15 * loudness * sample);
+	}
+
+	return speech;
+}
+
+/// Encodes the audio into packets, with the encoder set up as AudioInput does for the default quality
+static std::vector< Packet > encode(const std::vector< float > &speech, bool inBandFEC, int lossPercentage) {
+	OpusEncoder *encoder = OpusEncoderSettings::create(SAMPLE_RATE, BITRATE, true, inBandFEC);
+
+	std::vector< Packet > packets;
+	Packet buffer(4000);
+	for (int i = 0; i < PACKET_COUNT; ++i) {
+		OpusEncoderSettings::update(encoder, BITRATE, inBandFEC, lossPercentage);
+
+		const opus_int32 size = opus_encode_float(encoder, &speech[i * PACKET_SAMPLES], PACKET_SAMPLES, buffer.data(),
+												  static_cast< opus_int32 >(buffer.size()));
+
+		packets.emplace_back(buffer.begin(), buffer.begin() + (size > 0 ? size : 0));
+	}
+
+	opus_encoder_destroy(encoder);
+
+	return packets;
+}
+
+/// What the receiving end made of a stream
+struct Playback {
+	/// The left channel, placed where the timestamps handed out by the jitter buffer say it belongs
+	std::vector< float > left;
+	/// How often missing audio has been restored from the FEC data of the packet after it
+	unsigned int recoveries = 0;
+};
+
+/// Plays the packets that made it across the link through a jitter buffer and AudioOutputLookahead, decoding them
+/// the way AudioOutputSpeech::decodeFrame() does (into stereo)
+static Playback play(const std::vector< Packet > &packets, const std::vector< bool > &lost) {
+	JitterBuffer *jitter = createJitterBuffer();
+	AudioOutputLookahead lookahead(s_caches, FRAME_SIZE);
+
+	int error            = OPUS_OK;
+	OpusDecoder *decoder = opus_decoder_create(SAMPLE_RATE, 2, &error);
+
+	Playback playback;
+	playback.left.resize(PACKET_COUNT * PACKET_SAMPLES);
+
+	// Up to 60 ms of stereo audio, as AudioOutputSpeech::iAudioBufferSize
+	std::vector< float > pcm(2 * 3 * PACKET_SAMPLES);
+
+	spx_uint32_t sent = 0;
+	spx_uint32_t due  = 0;
+	while ((due = static_cast< spx_uint32_t >(jitter_buffer_get_pointer_timestamp(jitter)))
+		   < PACKET_COUNT * PACKET_SPAN) {
+		// The packets arrive ahead of being due
+		for (; sent < packets.size() && sent * PACKET_SPAN <= due + LEAD_PACKETS * PACKET_SPAN; ++sent) {
+			if (!lost[sent]) {
+				lookahead.put(jitter, store(packets[sent], &playback), sent * PACKET_SPAN, PACKET_SPAN);
+			}
+		}
+
+		JitterBufferPacket jbp;
+		const AudioOutputLookahead::Result result = lookahead.get(jitter, jbp);
+
+		int samples;
+		if (result.status == JITTER_BUFFER_OK) {
+			const AudioOutputCache *cache = s_caches.get(result.handle);
+			samples = opus_decode_float(decoder, cache->getAudioData().data(),
+										static_cast< opus_int32 >(cache->getAudioData().size()), pcm.data(),
+										static_cast< int >(pcm.size() / 2), 0);
+
+			s_caches.release(result.handle);
+		} else if (result.recoverySpan > 0) {
+			const AudioOutputCache *cache = s_caches.get(result.recoveryHandle);
+			samples = opus_decode_float(decoder, cache->getAudioData().data(),
+										static_cast< opus_int32 >(cache->getAudioData().size()), pcm.data(),
+										static_cast< int >(result.recoverySpan / 2), 1);
+
+			++playback.recoveries;
+		} else {
+			samples = opus_decode_float(decoder, nullptr, 0, pcm.data(), static_cast< int >(FRAME_SIZE), 0);
+		}
+
+		if (samples < 0) {
+			samples = static_cast< int >(FRAME_SIZE / 2);
+			std::fill(pcm.begin(), pcm.end(), 0.0f);
+		}
+
+		// Inserted audio doesn't belong anywhere
+		if (result.status != JITTER_BUFFER_INSERTION) {
+			const std::size_t offset = jbp.timestamp / 2;
+			for (std::size_t s = 0; s < static_cast< std::size_t >(samples) && offset + s < playback.left.size(); ++s) {
+				playback.left[offset + s] = pcm[s * 2];
+			}
+		}
+
+		for (int i = samples * 2 / static_cast< int >(FRAME_SIZE); i > 0; --i) {
+			jitter_buffer_tick(jitter);
+		}
+	}
+
+	opus_decoder_destroy(decoder);
+	jitter_buffer_destroy(jitter);
+
+	return playback;
+}
+
+/// @returns The signal-to-noise ratio (in dB) of the audio played in place of the lost packets, with the audio of
+/// 	the lossless link as the signal
+static double lostAudioSNR(const std::vector< float > &reference, const std::vector< float > &received,
+						   const std::vector< bool > &lost) {
+	double signal = 0.0;
+	double noise  = 0.0;
+	for (std::size_t i = 0; i < lost.size(); ++i) {
+		if (!lost[i]) {
+			continue;
+		}
+
+		for (std::size_t s = i * PACKET_SAMPLES; s < (i + 1) * PACKET_SAMPLES; ++s) {
+			const double error = reference[s] - received[s];
+
+			signal += reference[s] * reference[s];
+			noise += error * error;
+		}
+	}
+
+	return 10.0 * std::log10(signal / (noise > 1e-12 ? noise : 1e-12));
+}
+
+class TestPacketLoss : public QObject {
+	Q_OBJECT
+private slots:
+	void test_noLoss() {
+		PacketLossEstimator estimator;
+		QCOMPARE(estimator.getLossPercentage(), 0);
+
+		estimator.update(100, 0, 0);
+		QCOMPARE(estimator.getLossPercentage(), 0);
+
+		// Late packets have arrived after all
+		estimator.update(190, 10, 0);
+		QCOMPARE(estimator.getLossPercentage(), 0);
+	}
+
+	void test_loss() {
+		PacketLossEstimator estimator;
+
+		estimator.update(95, 0, 5);
+		QCOMPARE(estimator.getLossPercentage(), 5);
+
+		// Nothing sent in the meantime
+		estimator.update(95, 0, 5);
+		QCOMPARE(estimator.getLossPercentage(), 5);
+
+		// Older losses fade out
+		int previous = estimator.getLossPercentage();
+		for (unsigned int i = 1; i <= 20; ++i) {
+			estimator.update(95 + i * 100, 0, 5);
+			QVERIFY(estimator.getLossPercentage() <= previous);
+			previous = estimator.getLossPercentage();
+		}
+		QCOMPARE(previous, 0);
+
+		estimator.update(2095, 0, 1005);
+		QVERIFY(estimator.getLossPercentage() > 50);
+
+		estimator.reset();
+		QCOMPARE(estimator.getLossPercentage(), 0);
+
+		estimator.update(0, 0, 300);
+		QCOMPARE(estimator.getLossPercentage(), 100);
+	}
+
+	void test_counterReset() {
+		PacketLossEstimator estimator;
+
+		estimator.update(900, 0, 100);
+		QCOMPARE(estimator.getLossPercentage(), 10);
+
+		// The counters start over, which doesn't say anything about the loss
+		estimator.update(10, 0, 0);
+		QCOMPARE(estimator.getLossPercentage(), 10);
+
+		// They are counted from the new baseline on
+		estimator.update(1010, 0, 0);
+		QVERIFY(estimator.getLossPercentage() < 10);
+	}
+
+	void test_recovery() {
+		JitterBuffer *jitter = createJitterBuffer();
+		AudioOutputLookahead lookahead(s_caches, FRAME_SIZE);
+
+		// Packets 1 and 2 get lost, but only packet 2 can be restored from the FEC data of packet 3
+		std::array< AudioOutputCacheSlab::Handle, 4 > handles;
+		for (spx_uint32_t i = 0; i < handles.size(); ++i) {
+			handles[i] = store(Packet(16, static_cast< unsigned char >(i)), &lookahead);
+			if (i == 0 || i == 3) {
+				lookahead.put(jitter, handles[i], i * PACKET_SPAN, PACKET_SPAN);
+			}
+		}
+
+		JitterBufferPacket jbp;
+		AudioOutputLookahead::Result result = lookahead.get(jitter, jbp);
+		QCOMPARE(result.status, JITTER_BUFFER_OK);
+		QCOMPARE(result.handle, handles[0]);
+		s_caches.release(result.handle);
+		jitter_buffer_tick(jitter);
+		jitter_buffer_tick(jitter);
+
+		// Packet 1 is asked for a frame at a time, in case it still arrives
+		for (spx_uint32_t frame = 0; frame < PACKET_SPAN / FRAME_SIZE; ++frame) {
+			QVERIFY(!lookahead.findRecoveryPacket(PACKET_SPAN + frame * FRAME_SIZE));
+
+			result = lookahead.get(jitter, jbp);
+			QCOMPARE(result.status, JITTER_BUFFER_MISSING);
+			QCOMPARE(jbp.timestamp, PACKET_SPAN + frame * FRAME_SIZE);
+			QCOMPARE(jbp.span, FRAME_SIZE);
+			QCOMPARE(result.recoverySpan, static_cast< spx_uint32_t >(0));
+			jitter_buffer_tick(jitter);
+		}
+
+		// Packet 2 is skipped at once, so that it can be restored
+		QVERIFY(lookahead.findRecoveryPacket(2 * PACKET_SPAN));
+
+		result = lookahead.get(jitter, jbp);
+		QCOMPARE(result.status, JITTER_BUFFER_MISSING);
+		QCOMPARE(jbp.timestamp, 2 * PACKET_SPAN);
+		QCOMPARE(jbp.span, PACKET_SPAN);
+		QCOMPARE(result.recoverySpan, PACKET_SPAN);
+		QCOMPARE(result.recoveryHandle, handles[3]);
+		jitter_buffer_tick(jitter);
+		jitter_buffer_tick(jitter);
+
+		// The packet carrying the FEC data is played as usual
+		result = lookahead.get(jitter, jbp);
+		QCOMPARE(result.status, JITTER_BUFFER_OK);
+		QCOMPARE(result.handle, handles[3]);
+		s_caches.release(result.handle);
+
+		// Once a packet has been played, it doesn't cover anything anymore
+		QVERIFY(!lookahead.findRecoveryPacket(2 * PACKET_SPAN));
+
+		jitter_buffer_destroy(jitter);
+		s_caches.releaseAll(&lookahead);
+		QCOMPARE(s_caches.size(), static_cast< std::size_t >(0));
+	}
+
+	void test_lossyLink() {
+		std::vector< bool > lost(PACKET_COUNT);
+		unsigned int lostCount = 0;
+		for (int i = 0; i < PACKET_COUNT; ++i) {
+			lost[i] = i % LOSS_INTERVAL == LOSS_INTERVAL / 2;
+			lostCount += lost[i] ? 1 : 0;
+		}
+
+		// What the server would report back about the link
+		PacketLossEstimator estimator;
+		estimator.update(PACKET_COUNT - lostCount, 0, lostCount);
+		QCOMPARE(estimator.getLossPercentage(), 5);
+
+		const std::vector< float > speech = makeSpeech();
+		const std::vector< bool > lossless(PACKET_COUNT);
+
+		// Without in-band FEC, the packets after the lost ones don't carry anything to restore them from, so that they
+		// are concealed instead
+		const std::vector< Packet > plainPackets = encode(speech, false, 0);
+		const Playback plainReference            = play(plainPackets, lossless);
+		const Playback plainReceived             = play(plainPackets, lost);
+		const double plainSNR = lostAudioSNR(plainReference.left, plainReceived.left, lost);
+
+		const std::vector< Packet > fecPackets = encode(speech, true, estimator.getLossPercentage());
+		const Playback fecReference            = play(fecPackets, lossless);
+		const Playback fecReceived             = play(fecPackets, lost);
+		const double restoredSNR               = lostAudioSNR(fecReference.left, fecReceived.left, lost);
+
+		for (const Packet &packet : fecPackets) {
+			QVERIFY(!packet.empty());
+		}
+
+		QCOMPARE(plainReference.recoveries, 0u);
+		QCOMPARE(fecReference.recoveries, 0u);
+		QCOMPARE(plainReceived.recoveries, lostCount);
+		QCOMPARE(fecReceived.recoveries, lostCount);
+
+		qDebug("Lost audio: %.1f dB SNR concealed without FEC, %.1f dB restored from FEC", plainSNR, restoredSNR);
+
+		QVERIFY(restoredSNR > plainSNR);
+		QCOMPARE(s_caches.size(), static_cast< std::size_t >(0));
+	}
+};
+
+QTEST_MAIN(TestPacketLoss)
+#include "TestPacketLoss.moc"
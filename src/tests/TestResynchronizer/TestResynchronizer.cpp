@@ -0,0 +1,170 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "Resynchronizer.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <algorithm>
+#include <thread>
+
+static constexpr std::size_t FRAME_SIZE = 480;
+
+/// Adds a microphone frame whose samples are all set to the given value
+static void addMic(Resynchronizer &resync, short value) {
+	short *frame = resync.micFrame();
+	std::fill(frame, frame + FRAME_SIZE, value);
+	resync.addMic();
+}
+
+/// @returns The value of the microphone frame returned for the next speaker frame or -1 if there is none
+static short addSpeaker(Resynchronizer &resync) {
+	std::fill(resync.speakerFrame(), resync.speakerFrame() + FRAME_SIZE, 0);
+
+	const AudioChunk chunk = resync.addSpeaker();
+	if (chunk.empty()) {
+		return -1;
+	}
+
+	if (chunk.speaker != resync.speakerFrame()) {
+		return -2;
+	}
+	for (std::size_t i = 1; i < FRAME_SIZE; ++i) {
+		if (chunk.mic[i] != chunk.mic[0]) {
+			return -3;
+		}
+	}
+
+	return chunk.mic[0];
+}
+
+class TestResynchronizer : public QObject {
+	Q_OBJECT
+private slots:
+	void test_nominalLag() {
+		Resynchronizer resync;
+		resync.setFrameSizes(FRAME_SIZE, FRAME_SIZE);
+
+		// The microphone is only passed on once it is lagging behind by the nominal lag
+		QCOMPARE(addSpeaker(resync), static_cast< short >(-1));
+		addMic(resync, 1);
+		QCOMPARE(addSpeaker(resync), static_cast< short >(-1));
+		addMic(resync, 2);
+		QCOMPARE(resync.statistics().queued, 2u);
+
+		short next = 3;
+		for (short expected = 1; expected < 100; ++expected) {
+			QCOMPARE(addSpeaker(resync), expected);
+			addMic(resync, next++);
+		}
+		QCOMPARE(resync.statistics().queued, 2u);
+
+		// Once filled up, the queue is drained completely before speaker frames are dropped again
+		QCOMPARE(addSpeaker(resync), static_cast< short >(100));
+		QCOMPARE(addSpeaker(resync), static_cast< short >(101));
+		QCOMPARE(addSpeaker(resync), static_cast< short >(-1));
+
+		const Resynchronizer::Statistics statistics = resync.statistics();
+		QCOMPARE(statistics.queued, 0u);
+		QCOMPARE(statistics.micDrops, static_cast< std::uint64_t >(0));
+		QCOMPARE(statistics.speakerDrops, static_cast< std::uint64_t >(3));
+	}
+
+	void test_overflow() {
+		Resynchronizer resync;
+		resync.setFrameSizes(FRAME_SIZE, FRAME_SIZE);
+
+		for (short i = 1; i <= 7; ++i) {
+			addMic(resync, i);
+		}
+		QCOMPARE(resync.statistics().queued, 5u);
+		QCOMPARE(resync.statistics().micDrops, static_cast< std::uint64_t >(2));
+
+		// The queue may not grow back to its maximum until it has drained to 3 frames
+		QCOMPARE(addSpeaker(resync), static_cast< short >(1));
+		addMic(resync, 8);
+		QCOMPARE(resync.statistics().queued, 4u);
+		QCOMPARE(resync.statistics().micDrops, static_cast< std::uint64_t >(3));
+
+		QCOMPARE(addSpeaker(resync), static_cast< short >(2));
+		addMic(resync, 9);
+		addMic(resync, 10);
+		QCOMPARE(resync.statistics().queued, 5u);
+		QCOMPARE(resync.statistics().micDrops, static_cast< std::uint64_t >(3));
+
+		for (short expected : { 3, 4, 5, 9, 10 }) {
+			QCOMPARE(addSpeaker(resync), expected);
+		}
+	}
+
+	void test_reset() {
+		Resynchronizer resync;
+		resync.setFrameSizes(FRAME_SIZE, FRAME_SIZE);
+
+		for (short i = 1; i <= 3; ++i) {
+			addMic(resync, i);
+		}
+
+		const AudioChunk chunk = resync.addSpeaker();
+		QVERIFY(!chunk.empty());
+
+		// The chunk stays valid while the queue is reset and refilled
+		resync.reset();
+		QCOMPARE(resync.statistics().queued, 0u);
+		for (short i = 4; i <= 8; ++i) {
+			addMic(resync, i);
+		}
+		QCOMPARE(chunk.mic[0], static_cast< short >(1));
+		QCOMPARE(chunk.mic[FRAME_SIZE - 1], static_cast< short >(1));
+
+		QCOMPARE(addSpeaker(resync), static_cast< short >(4));
+	}
+
+	void test_concurrent() {
+		Resynchronizer resync;
+		resync.setFrameSizes(FRAME_SIZE, FRAME_SIZE);
+
+		constexpr short FRAMES = 20000;
+
+		std::thread mic([&resync]() {
+			for (short i = 1; i <= FRAMES; ++i) {
+				addMic(resync, i);
+				if (i % 3 == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+
+		// Every frame has to arrive in one piece and in order
+		short last           = 0;
+		std::uint64_t passed = 0;
+		bool consistent      = true;
+		for (int i = 0; i < 2 * FRAMES; ++i) {
+			const short value = addSpeaker(resync);
+			if (value == -1) {
+				continue;
+			}
+
+			consistent = consistent && value > last;
+			last       = value;
+			passed++;
+
+			if (i % 5 == 0) {
+				std::this_thread::yield();
+			}
+		}
+
+		mic.join();
+
+		QVERIFY(consistent);
+
+		const Resynchronizer::Statistics statistics = resync.statistics();
+		QCOMPARE(passed + statistics.micDrops + statistics.queued, static_cast< std::uint64_t >(FRAMES));
+	}
+};
+
+QTEST_MAIN(TestResynchronizer)
+#include "TestResynchronizer.moc"
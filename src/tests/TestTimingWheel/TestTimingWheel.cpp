@@ -0,0 +1,162 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "TimingWheel.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using std::chrono::milliseconds;
+
+static const TimingWheel::Clock::time_point START = TimingWheel::Clock::time_point() + std::chrono::hours(1);
+static constexpr milliseconds TICK(10);
+
+class TestTimingWheel : public QObject {
+	Q_OBJECT
+private slots:
+	void test_expiry() {
+		TimingWheel wheel(TICK, START);
+		TimingWheel::Timer timer;
+		int fired = 0;
+
+		wheel.schedule(timer, milliseconds(25), [&fired]() { fired++; });
+		QVERIFY(timer.isScheduled());
+		QCOMPARE(wheel.size(), static_cast< std::size_t >(1));
+
+		// Timers never expire early
+		wheel.advance(START + milliseconds(29));
+		QCOMPARE(fired, 0);
+		wheel.advance(START + milliseconds(30));
+		QCOMPARE(fired, 1);
+		QVERIFY(!timer.isScheduled());
+		QCOMPARE(wheel.size(), static_cast< std::size_t >(0));
+
+		wheel.advance(START + milliseconds(1000));
+		QCOMPARE(fired, 1);
+	}
+
+	void test_cascading() {
+		TimingWheel wheel(TICK, START);
+
+		// Delays on every level of the wheel, including ones right at the boundaries of the levels
+		std::vector< std::uint64_t > delays;
+		for (unsigned int level = 0; level < TimingWheel::LEVELS; ++level) {
+			const std::uint64_t range = std::uint64_t(1) << (TimingWheel::SLOT_BITS * (level + 1));
+			delays.insert(delays.end(), { range - 1, range, range + 1, range / 2 + 3 });
+		}
+
+		// Advance the wheel a bit first, so that the timers don't start at a boundary
+		wheel.advance(START + 37 * TICK);
+
+		std::vector< std::unique_ptr< TimingWheel::Timer > > timers;
+		std::vector< std::uint64_t > firedAt(delays.size(), 0);
+		std::uint64_t now = 37;
+
+		for (std::size_t i = 0; i < delays.size(); ++i) {
+			timers.push_back(std::make_unique< TimingWheel::Timer >());
+			wheel.schedule(*timers.back(), static_cast< int >(delays[i]) * TICK,
+						   [&firedAt, &now, i]() { firedAt[i] = now; });
+		}
+
+		// Delays beyond the range of the wheel are shortened
+		const std::uint64_t maxTicks = TimingWheel::MAX_TICKS;
+
+		// Jump over ticks in which nothing expires, but hit every deadline exactly
+		std::vector< std::uint64_t > deadlines;
+		for (std::uint64_t delay : delays) {
+			deadlines.push_back(38 + std::min(delay, maxTicks));
+		}
+		std::sort(deadlines.begin(), deadlines.end());
+
+		for (std::uint64_t deadline : deadlines) {
+			now = deadline - 1;
+			wheel.advance(START + static_cast< int >(now) * TICK);
+			now = deadline;
+			wheel.advance(START + static_cast< int >(now) * TICK);
+		}
+
+		for (std::size_t i = 0; i < delays.size(); ++i) {
+			QCOMPARE(firedAt[i], 38 + std::min(delays[i], maxTicks));
+		}
+		QCOMPARE(wheel.size(), static_cast< std::size_t >(0));
+	}
+
+	void test_cancel() {
+		TimingWheel wheel(TICK, START);
+		int fired = 0;
+
+		TimingWheel::Timer cancelled;
+		wheel.schedule(cancelled, 5 * TICK, [&fired]() { fired++; });
+		cancelled.cancel();
+		QVERIFY(!cancelled.isScheduled());
+
+		{
+			TimingWheel::Timer destroyed;
+			wheel.schedule(destroyed, 5 * TICK, [&fired]() { fired++; });
+		}
+		QCOMPARE(wheel.size(), static_cast< std::size_t >(0));
+
+		// Rescheduling replaces the previous deadline
+		TimingWheel::Timer rescheduled;
+		wheel.schedule(rescheduled, 2 * TICK, [&fired]() { fired += 10; });
+		wheel.schedule(rescheduled, 8 * TICK, [&fired]() { fired += 100; });
+		QCOMPARE(wheel.size(), static_cast< std::size_t >(1));
+
+		wheel.advance(START + 5 * TICK);
+		QCOMPARE(fired, 0);
+		wheel.advance(START + 8 * TICK);
+		QCOMPARE(fired, 100);
+	}
+
+	void test_callbacks() {
+		TimingWheel wheel(TICK, START);
+		TimingWheel::Timer first;
+		TimingWheel::Timer second;
+		TimingWheel::Timer periodic;
+		int secondFired   = 0;
+		int periodicFired = 0;
+
+		// Both expire in the same tick, whichever comes first cancels the other one
+		wheel.schedule(first, 3 * TICK, [&second]() { second.cancel(); });
+		wheel.schedule(second, 3 * TICK, [&first, &secondFired]() {
+			first.cancel();
+			secondFired++;
+		});
+
+		std::function< void() > repeat = [&]() {
+			if (++periodicFired < 5) {
+				wheel.schedule(periodic, 2 * TICK, repeat);
+			}
+		};
+		wheel.schedule(periodic, 2 * TICK, repeat);
+
+		wheel.advance(START + 2 * TICK);
+		QCOMPARE(periodicFired, 1);
+
+		// Timers rescheduled by a callback expire in the same call if it covers their new deadline
+		wheel.advance(START + 100 * TICK);
+		QVERIFY(!first.isScheduled());
+		QVERIFY(!second.isScheduled());
+		QVERIFY(secondFired <= 1);
+		QCOMPARE(periodicFired, 5);
+		QCOMPARE(wheel.size(), static_cast< std::size_t >(0));
+	}
+
+	void test_destroyWheel() {
+		TimingWheel::Timer timer;
+		{
+			TimingWheel wheel(TICK, START);
+			wheel.schedule(timer, 10 * TICK, []() {});
+		}
+		QVERIFY(!timer.isScheduled());
+	}
+};
+
+QTEST_MAIN(TestTimingWheel)
+#include "TestTimingWheel.moc"
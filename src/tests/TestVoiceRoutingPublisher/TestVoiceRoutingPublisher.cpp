@@ -0,0 +1,189 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "VoiceRouting.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static std::unique_ptr< VoiceRoutingSnapshot > makeSnapshot(std::uint64_t generation) {
+	std::unique_ptr< VoiceRoutingSnapshot > snapshot = std::make_unique< VoiceRoutingSnapshot >();
+	snapshot->generation                             = generation;
+
+	return snapshot;
+}
+
+class TestVoiceRoutingPublisher : public QObject {
+	Q_OBJECT;
+private slots:
+	void test_publish() {
+		VoiceRoutingPublisher publisher;
+
+		QCOMPARE(publisher.current().generation, static_cast< std::uint64_t >(0));
+
+		publisher.publish(makeSnapshot(1));
+		QCOMPARE(publisher.current().generation, static_cast< std::uint64_t >(1));
+
+		{
+			VoiceRoutingPublisher::ReadGuard guard(publisher, 0);
+			QCOMPARE(guard.snapshot().generation, static_cast< std::uint64_t >(1));
+		}
+
+		// Without any active reader, replaced snapshots are freed right away
+		QVERIFY(!publisher.hasRetired());
+	}
+
+	void test_lookup() {
+		VoiceRoutingSnapshot snapshot;
+
+		// Only the address is compared, so the pointers don't have to point to actual users
+		ServerUser *user  = reinterpret_cast< ServerUser * >(0x10);
+		ServerUser *other = reinterpret_cast< ServerUser * >(0x20);
+
+		VoiceRoutingSnapshot::User entry;
+		entry.user = user;
+		snapshot.users.emplace(1, entry);
+
+		snapshot.channels[0] = std::make_shared< const std::vector< VoiceRoute > >(std::vector< VoiceRoute >{
+			{ other, Mumble::Protocol::AudioContext::NORMAL, VolumeAdjustment::fromFactor(1.0f), 0 } });
+
+		QVERIFY(snapshot.findUser(user, 1));
+		// A different user that got the same session assigned
+		QVERIFY(!snapshot.findUser(other, 1));
+		QVERIFY(!snapshot.findUser(user, 2));
+
+		QCOMPARE(snapshot.channelRoutes(0).size(), static_cast< std::size_t >(1));
+		QVERIFY(snapshot.channelRoutes(1).empty());
+		QVERIFY(snapshot.frequencyRoutes(118000).empty());
+	}
+
+	void test_whisperRoutes() {
+		ServerUser *other = reinterpret_cast< ServerUser * >(0x20);
+
+		VoiceRoutingSnapshot::User entry;
+		entry.whisperTargets[1].routes.store(new std::vector< VoiceRoute >(
+			1, { other, Mumble::Protocol::AudioContext::WHISPER, VolumeAdjustment::fromFactor(1.0f), 0 }));
+
+		// The entries taken over by the next snapshot have to resolve their whisper targets again
+		VoiceRoutingSnapshot::User copy = entry;
+		QCOMPARE(copy.whisperTargets.size(), static_cast< std::size_t >(1));
+		QVERIFY(!copy.whisperTargets.at(1).routes.load());
+		QCOMPARE(entry.whisperTargets.at(1).routes.load()->size(), static_cast< std::size_t >(1));
+	}
+
+	void test_retireWhileReading() {
+		VoiceRoutingPublisher publisher;
+
+		bool deleted = false;
+
+		const VoiceRoutingSnapshot &snapshot = publisher.enter(3);
+
+		publisher.retire([&deleted]() { deleted = true; });
+		publisher.publish(makeSnapshot(1));
+
+		// The reader entered before the object got retired and thus might still be using it
+		QVERIFY(!deleted);
+		QVERIFY(publisher.hasRetired());
+		QCOMPARE(snapshot.generation, static_cast< std::uint64_t >(0));
+
+		// Readers entering after the publication don't hold the retired objects back
+		{
+			VoiceRoutingPublisher::ReadGuard guard(publisher, 4);
+			QCOMPARE(guard.snapshot().generation, static_cast< std::uint64_t >(1));
+
+			publisher.leave(3);
+
+			QVERIFY(!publisher.reclaim());
+			QVERIFY(deleted);
+		}
+	}
+
+	void test_retireRequiresPublication() {
+		VoiceRoutingPublisher publisher;
+
+		bool deleted = false;
+
+		publisher.retire([&deleted]() { deleted = true; });
+
+		// The object might still be reachable from the current snapshot
+		QVERIFY(publisher.reclaim());
+		QVERIFY(!deleted);
+
+		publisher.publish(makeSnapshot(1));
+		QVERIFY(deleted);
+	}
+
+	void test_destructor() {
+		bool deleted = false;
+
+		{
+			VoiceRoutingPublisher publisher;
+
+			publisher.retire([&deleted]() { deleted = true; });
+		}
+
+		QVERIFY(deleted);
+	}
+
+	void test_concurrentReaders() {
+		constexpr std::size_t readerCount      = 4;
+		constexpr std::uint64_t publishedCount = 2000;
+
+		VoiceRoutingPublisher publisher;
+
+		// Every published snapshot owns a flag that is reset when the snapshot is freed. Readers verify that the
+		// snapshot they are using hasn't been freed yet.
+		std::vector< std::unique_ptr< std::atomic< bool > > > alive;
+		for (std::uint64_t i = 0; i <= publishedCount; ++i) {
+			alive.push_back(std::make_unique< std::atomic< bool > >(true));
+		}
+
+		std::atomic< bool > done{ false };
+		std::atomic< bool > failed{ false };
+
+		std::vector< std::thread > readers;
+		for (std::size_t reader = 0; reader < readerCount; ++reader) {
+			readers.emplace_back([&, reader]() {
+				std::uint64_t lastGeneration = 0;
+
+				while (!done.load()) {
+					VoiceRoutingPublisher::ReadGuard guard(publisher, reader);
+
+					const std::uint64_t generation = guard.snapshot().generation;
+
+					if (generation < lastGeneration || !alive[generation]->load()) {
+						failed.store(true);
+					}
+
+					lastGeneration = generation;
+				}
+			});
+		}
+
+		for (std::uint64_t generation = 1; generation <= publishedCount; ++generation) {
+			publisher.publish(makeSnapshot(generation));
+			publisher.retire([&alive, generation]() { alive[generation - 1]->store(false); });
+		}
+
+		done.store(true);
+		for (std::thread &current : readers) {
+			current.join();
+		}
+
+		QVERIFY(!failed.load());
+
+		// All readers are idle now
+		publisher.publish(makeSnapshot(publishedCount + 1));
+		QVERIFY(!publisher.hasRetired());
+	}
+};
+
+QTEST_MAIN(TestVoiceRoutingPublisher)
+#include "TestVoiceRoutingPublisher.moc"
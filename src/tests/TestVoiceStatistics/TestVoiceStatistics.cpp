@@ -0,0 +1,115 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "VoiceStatistics.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <cstring>
+#include <limits>
+
+static std::uint64_t valueOf(const VoiceStatistics::Snapshot &snapshot, const char *name) {
+	for (const std::pair< const char *, std::uint64_t > &entry : snapshot.entries()) {
+		if (std::strcmp(entry.first, name) == 0) {
+			return entry.second;
+		}
+	}
+
+	return std::numeric_limits< std::uint64_t >::max();
+}
+
+class TestVoiceStatistics : public QObject {
+	Q_OBJECT
+private slots:
+	void test_buckets() {
+		// Small values are exact
+		for (std::uint64_t value = 0; value < 2 * VoiceHistogram::SUB_BUCKETS; ++value) {
+			QCOMPARE(VoiceHistogram::upperBoundOf(VoiceHistogram::bucketOf(value)), value);
+		}
+
+		std::size_t previousBucket = 0;
+		for (std::uint64_t value = 1; value < (std::uint64_t(1) << 40); value = value * 3 / 2 + 1) {
+			const std::size_t bucket = VoiceHistogram::bucketOf(value);
+			QVERIFY(bucket < VoiceHistogram::BUCKETS);
+			QVERIFY(bucket >= previousBucket);
+
+			// The upper bound is at most 1/SUB_BUCKETS above the value
+			const std::uint64_t upperBound = VoiceHistogram::upperBoundOf(bucket);
+			QVERIFY(upperBound >= value);
+			QVERIFY(upperBound - value <= value / VoiceHistogram::SUB_BUCKETS);
+
+			previousBucket = bucket;
+		}
+
+		QCOMPARE(VoiceHistogram::bucketOf(std::numeric_limits< std::uint64_t >::max()), VoiceHistogram::BUCKETS - 1);
+		QCOMPARE(VoiceHistogram::upperBoundOf(VoiceHistogram::BUCKETS - 1),
+				 std::numeric_limits< std::uint64_t >::max());
+	}
+
+	void test_quantiles() {
+		VoiceHistogram histogram;
+
+		QCOMPARE(histogram.snapshot().quantile(0.5), std::uint64_t(0));
+		QCOMPARE(histogram.snapshot().max(), std::uint64_t(0));
+
+		for (std::uint64_t value = 1; value <= 1000; ++value) {
+			histogram.record(value * 1000);
+		}
+		histogram.record(5000000, 10);
+
+		const VoiceHistogram::Snapshot snapshot = histogram.snapshot();
+		QCOMPARE(snapshot.count, std::uint64_t(1010));
+
+		const std::uint64_t median = snapshot.quantile(0.5);
+		QVERIFY(median >= 505000);
+		QVERIFY(median <= 505000 + 505000 / VoiceHistogram::SUB_BUCKETS);
+
+		QVERIFY(snapshot.quantile(0.995) >= 5000000);
+		QVERIFY(snapshot.max() >= 5000000);
+		QVERIFY(snapshot.max() <= 5000000 + 5000000 / VoiceHistogram::SUB_BUCKETS);
+		QCOMPARE(snapshot.mean(), (500500000 + 50000000) / std::uint64_t(1010));
+	}
+
+	void test_mergeAndSince() {
+		VoiceStatistics first;
+		VoiceStatistics second;
+
+		first.countReceived(3);
+		first.countAudioPacket();
+		first.fanOut.record(10);
+		second.countReceived(2);
+		second.countBandwidthDrop();
+		second.countDecryptFailure();
+		second.countTcpFallbackSend();
+		second.countTunnelDrop();
+		second.fanOut.record(20);
+
+		VoiceStatistics::Snapshot earlier = first.snapshot();
+		earlier.merge(second.snapshot());
+		QCOMPARE(earlier.packetsReceived, std::uint64_t(5));
+		QCOMPARE(valueOf(earlier, "bandwidthDrops"), std::uint64_t(1));
+		QCOMPARE(valueOf(earlier, "decryptFailures"), std::uint64_t(1));
+		QCOMPARE(valueOf(earlier, "tcpFallbackSends"), std::uint64_t(1));
+		QCOMPARE(valueOf(earlier, "tunnelDrops"), std::uint64_t(1));
+		QCOMPARE(valueOf(earlier, "fanOut.mean"), std::uint64_t(15));
+		QCOMPARE(valueOf(earlier, "fanOut.max"), VoiceHistogram::upperBoundOf(VoiceHistogram::bucketOf(20)));
+
+		first.countReceived();
+		first.fanOut.record(4);
+
+		VoiceStatistics::Snapshot later = first.snapshot();
+		later.merge(second.snapshot());
+
+		const VoiceStatistics::Snapshot interval = later.since(earlier);
+		QCOMPARE(interval.packetsReceived, std::uint64_t(1));
+		QCOMPARE(interval.bandwidthDrops, std::uint64_t(0));
+		QCOMPARE(interval.fanOut.count, std::uint64_t(1));
+		QCOMPARE(interval.fanOut.max(), std::uint64_t(4));
+	}
+};
+
+QTEST_MAIN(TestVoiceStatistics)
+#include "TestVoiceStatistics.moc"
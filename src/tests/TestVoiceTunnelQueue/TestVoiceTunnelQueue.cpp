@@ -0,0 +1,140 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "VoiceTunnel.h"
+
+#include "MumbleProtocol.h"
+
+#include <QObject>
+#include <QtEndian>
+#include <QtTest>
+
+#include <thread>
+#include <vector>
+
+class TestVoiceTunnelQueue : public QObject {
+	Q_OBJECT
+private slots:
+	void test_frame() {
+		const unsigned char payload[] = { 0x01, 0x02, 0x03 };
+
+		const QByteArray message = VoiceTunnelQueue::frame(payload, sizeof(payload));
+		const unsigned char *uc  = reinterpret_cast< const unsigned char * >(message.constData());
+
+		QCOMPARE(message.size(), 9);
+		QCOMPARE(qFromBigEndian< quint16 >(&uc[0]),
+				 static_cast< quint16 >(Mumble::Protocol::TCPMessageType::UDPTunnel));
+		QCOMPARE(qFromBigEndian< quint32 >(&uc[2]), static_cast< quint32 >(3));
+		QCOMPARE(message.mid(6), QByteArray("\x01\x02\x03"));
+	}
+
+	void test_order() {
+		VoiceTunnelQueue queue;
+
+		// Go around the ring a couple of times
+		for (int round = 0; round < 3; ++round) {
+			for (int i = 0; i < 10; ++i) {
+				QVERIFY(queue.push(QByteArray::number(i)));
+			}
+
+			QByteArray message;
+			for (int i = 0; i < 10; ++i) {
+				QVERIFY(queue.pop(message));
+				QCOMPARE(message, QByteArray::number(i));
+			}
+			QVERIFY(!queue.pop(message));
+		}
+	}
+
+	void test_sharing() {
+		VoiceTunnelQueue first;
+		VoiceTunnelQueue second;
+
+		const QByteArray message("voice");
+		QVERIFY(first.push(message));
+		QVERIFY(second.push(message));
+
+		QByteArray popped;
+		QVERIFY(first.pop(popped));
+		// Queueing the message didn't copy it
+		QCOMPARE(popped.constData(), message.constData());
+	}
+
+	void test_full() {
+		VoiceTunnelQueue queue;
+
+		for (std::size_t i = 0; i < VoiceTunnelQueue::CAPACITY; ++i) {
+			QVERIFY(queue.push(QByteArray::number(static_cast< int >(i))));
+		}
+		QVERIFY(!queue.push(QByteArray("dropped")));
+
+		QByteArray message;
+		QVERIFY(queue.pop(message));
+		QCOMPARE(message, QByteArray("0"));
+
+		// Taking a message makes room for another one
+		QVERIFY(queue.push(QByteArray("next")));
+	}
+
+	void test_pending() {
+		VoiceTunnelQueue queue;
+
+		QVERIFY(queue.markPending());
+		QVERIFY(!queue.markPending());
+
+		queue.clearPending();
+		QVERIFY(queue.markPending());
+	}
+
+	void test_concurrentProducers() {
+		constexpr int PRODUCERS = 4;
+		constexpr int MESSAGES  = 10000;
+
+		VoiceTunnelQueue queue;
+		std::vector< std::thread > producers;
+		std::vector< int > lastReceived(PRODUCERS, -1);
+
+		for (int producer = 0; producer < PRODUCERS; ++producer) {
+			producers.emplace_back([&queue, producer]() {
+				for (int i = 0; i < MESSAGES; ++i) {
+					const QByteArray message = QByteArray::number(producer) + ':' + QByteArray::number(i);
+					while (!queue.push(message)) {
+						std::this_thread::yield();
+					}
+				}
+			});
+		}
+
+		int received = 0;
+		bool ordered = true;
+		QByteArray message;
+		while (received < PRODUCERS * MESSAGES) {
+			if (!queue.pop(message)) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			const QList< QByteArray > parts = message.split(':');
+			const int producer              = parts[0].toInt();
+			const int index                 = parts[1].toInt();
+
+			// Messages of the same producer arrive in order
+			ordered                = ordered && index > lastReceived[producer];
+			lastReceived[producer] = index;
+
+			++received;
+		}
+
+		for (std::thread &producer : producers) {
+			producer.join();
+		}
+
+		QVERIFY(ordered);
+		QVERIFY(!queue.pop(message));
+	}
+};
+
+QTEST_MAIN(TestVoiceTunnelQueue)
+#include "TestVoiceTunnelQueue.moc"
@@ -0,0 +1,156 @@
+// Copyright 2022 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "XPlaneComPoller.h"
+
+#include <QNetworkDatagram>
+#include <QObject>
+#include <QUdpSocket>
+#include <QtTest>
+
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <vector>
+
+/// Answers GETD requests the way the XPC plugin does, reporting the given value for every requested dataref in turn
+class FakeXPlane {
+public:
+	FakeXPlane(std::vector< float > values) : m_values(std::move(values)) {
+		std::promise< quint16 > port;
+		std::future< quint16 > portFuture = port.get_future();
+
+		m_thread = std::thread([this, &port]() {
+			QUdpSocket socket;
+			socket.bind(QHostAddress::LocalHost, 0);
+			port.set_value(socket.localPort());
+
+			while (m_running.load()) {
+				if (!socket.waitForReadyRead(10)) {
+					continue;
+				}
+
+				while (socket.hasPendingDatagrams()) {
+					const QNetworkDatagram request = socket.receiveDatagram();
+					const QByteArray data          = request.data();
+
+					if (data.size() < 6 || !data.startsWith("GETD")) {
+						continue;
+					}
+
+					++m_requests;
+
+					const unsigned char count = static_cast< unsigned char >(data[5]);
+
+					QByteArray response("RESP", 4);
+					response.append('\0');
+					response.append(static_cast< char >(count));
+					for (unsigned char i = 0; i < count; ++i) {
+						const float value = i < m_values.size() ? m_values[i] : 0.0f;
+
+						char row[1 + sizeof(float)];
+						row[0] = 1;
+						std::memcpy(row + 1, &value, sizeof(float));
+						response.append(row, sizeof(row));
+					}
+
+					socket.writeDatagram(response, request.senderAddress(), request.senderPort());
+				}
+			}
+		});
+
+		m_port = portFuture.get();
+	}
+
+	~FakeXPlane() {
+		m_running.store(false);
+		m_thread.join();
+	}
+
+	quint16 port() const { return m_port; }
+	int requests() const { return m_requests.load(); }
+
+private:
+	std::vector< float > m_values;
+	std::atomic< bool > m_running = { true };
+	std::atomic< int > m_requests = { 0 };
+	quint16 m_port                = 0;
+	std::thread m_thread;
+};
+
+class TestXPlaneComPoller : public QObject {
+	Q_OBJECT
+private slots:
+	void test_conversion() {
+		// X-Plane cuts 118.325 MHz off to 11832
+		QCOMPARE(SimulatorComState::fromXPlane(11832.0f), Frequency(118325));
+		QCOMPARE(SimulatorComState::fromXPlane(12190.0f), Frequency(121900));
+		QCOMPARE(SimulatorComState::fromXPlane(13597.0f), Frequency(135975));
+	}
+
+	void test_comparison() {
+		SimulatorComState a;
+		SimulatorComState b;
+		QVERIFY(a == b);
+
+		b.com2Standby = Frequency(121500);
+		QVERIFY(a != b);
+
+		b           = a;
+		b.transmit2 = true;
+		QVERIFY(a != b);
+	}
+
+	void test_probe() {
+		FakeXPlane xplane({ 1.0f });
+		XPlaneComPoller poller("127.0.0.1", xplane.port());
+
+		QVERIFY(poller.probe());
+		QCOMPARE(xplane.requests(), 1);
+	}
+
+	void test_poll() {
+		FakeXPlane xplane({ 11832.0f, 12190.0f, 12100.0f, 13597.0f });
+		XPlaneComPoller poller("127.0.0.1", xplane.port());
+
+		// The same socket and buffers are used for every poll
+		for (int i = 1; i <= 3; ++i) {
+			SimulatorComState state;
+			QVERIFY(poller.poll(state));
+
+			QCOMPARE(state.com1Active, Frequency(118325));
+			QCOMPARE(state.com2Active, Frequency(121900));
+			QCOMPARE(state.com1Standby, Frequency(121000));
+			QCOMPARE(state.com2Standby, Frequency(135975));
+			QVERIFY(state.transmit1);
+			QVERIFY(!state.transmit2);
+			QVERIFY(state.receiveAll);
+
+			QCOMPARE(xplane.requests(), i);
+		}
+	}
+
+	void test_noSimulator() {
+		quint16 port;
+		{
+			// Find a port nobody listens on
+			QUdpSocket socket;
+			QVERIFY(socket.bind(QHostAddress::LocalHost, 0));
+			port = socket.localPort();
+		}
+
+		XPlaneComPoller poller("127.0.0.1", port);
+
+		QVERIFY(!poller.probe());
+
+		SimulatorComState state;
+		QVERIFY(!poller.poll(state));
+		QVERIFY(state.com1Active.isNull());
+	}
+};
+
+QTEST_MAIN(TestXPlaneComPoller)
+#include "TestXPlaneComPoller.moc"